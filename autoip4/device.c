@@ -22,8 +22,10 @@
 #include "netinfo_priv.h"
 #include "autoip.h"
 #include "appconfig.h"
+#include "devindex.h"
 
 ni_autoip_device_t *	ni_autoip_active;
+static ni_devindex_t	ni_autoip_index = NI_DEVINDEX_INIT;
 
 /*
  * Create and destroy autoip device handles
@@ -49,6 +51,7 @@ ni_autoip_device_new(const char *ifname, const ni_linkinfo_t *link)
 
 	/* append to end of list */
 	*pos = dev;
+	ni_devindex_add(&ni_autoip_index, dev->link.ifindex, dev->ifname, dev);
 
 	return dev;
 }
@@ -56,27 +59,13 @@ ni_autoip_device_new(const char *ifname, const ni_linkinfo_t *link)
 ni_autoip_device_t *
 ni_autoip_device_find(const char *ifname)
 {
-	ni_autoip_device_t *dev;
-
-	for (dev = ni_autoip_active; dev; dev = dev->next) {
-		if (!strcmp(dev->ifname, ifname))
-			return dev;
-	}
-
-	return NULL;
+	return ni_devindex_by_name(&ni_autoip_index, ifname);
 }
 
 ni_autoip_device_t *
 ni_autoip_device_by_index(unsigned int ifindex)
 {
-	ni_autoip_device_t *dev;
-
-	for (dev = ni_autoip_active; dev; dev = dev->next) {
-		if (dev->link.ifindex == ifindex)
-			return dev;
-	}
-
-	return NULL;
+	return ni_devindex_by_index(&ni_autoip_index, ifindex);
 }
 
 static void
@@ -133,6 +122,7 @@ ni_autoip_device_free(ni_autoip_device_t *dev)
 	ni_debug_autoip("%s: Deleting autoip4 device with index %u",
 			dev->ifname, dev->link.ifindex);
 
+	ni_devindex_remove(&ni_autoip_index, dev->link.ifindex, dev);
 	ni_autoip_device_drop_lease(dev);
 	ni_autoip_device_close(dev);
 
@@ -26,6 +26,7 @@
 #include <wicked/wireless.h>
 #include <wicked/objectmodel.h>
 #include "autoip4/autoip.h"
+#include "metrics.h"
 
 enum {
 	OPT_HELP,
@@ -429,6 +430,9 @@ autoip4_supplicant(void)
 			ni_fatal("unable to background server");
 	}
 
+	ni_server_async_logging(program_name);
+	ni_metrics_listen(program_name);
+
 	while (!ni_caught_terminal_signal()) {
 		long timeout;
 
@@ -440,6 +444,8 @@ autoip4_supplicant(void)
 			ni_fatal("ni_socket_wait failed");
 	}
 
+	ni_addrconf_lease_file_flush();
+
 	ni_server_deactivate_interface_events();
 
 	autoip4_device_destroy_all(autoip4_dbus_server);
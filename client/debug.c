@@ -0,0 +1,222 @@
+/*
+ *	wicked client debug commands
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include <wicked/types.h>
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/netinfo.h>
+#include <wicked/dbus.h>
+#include <wicked/dbus-errors.h>
+#include <wicked/objectmodel.h>
+
+#include "main.h"
+
+static const ni_intmap_t	ni_debug_service_names[] = {
+	{ "wickedd",		0				},
+	{ "nanny",		1				},
+	{ "dhcp4",		2				},
+	{ "dhcp6",		3				},
+	{ "auto4",		4				},
+	{ NULL,			0				}
+};
+
+static const char *		ni_debug_bus_names[] = {
+	NI_OBJECTMODEL_DBUS_BUS_NAME,
+	NI_OBJECTMODEL_DBUS_BUS_NAME_NANNY,
+	NI_OBJECTMODEL_DBUS_BUS_NAME_DHCP4,
+	NI_OBJECTMODEL_DBUS_BUS_NAME_DHCP6,
+	NI_OBJECTMODEL_DBUS_BUS_NAME_AUTO4,
+};
+
+/*
+ * Call a method of the Metrics interface on the server root
+ * object of a service and print the returned text.
+ */
+static int
+ni_do_debug_call(const char *service, const char *method)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_client_t *client;
+	ni_dbus_object_t *root;
+	unsigned int index = 0;
+	const char *text;
+	char *path = NULL;
+	char *p;
+	int status = NI_WICKED_RC_ERROR;
+
+	if (service && ni_parse_uint_mapped(service, ni_debug_service_names, &index) < 0) {
+		fprintf(stderr, "unknown service name '%s'\n", service);
+		return NI_WICKED_RC_USAGE;
+	}
+
+	if (!(client = ni_create_dbus_client(ni_debug_bus_names[index]))) {
+		ni_error("Unable to connect to %s dbus service", ni_debug_bus_names[index]);
+		return status;
+	}
+
+	/* the server root object path is the bus name foo.bar as /foo/bar */
+	ni_string_printf(&path, "/%s", ni_debug_bus_names[index]);
+	for (p = path; (p = strchr(p, '.')) != NULL; )
+		*p = '/';
+
+	root = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class,
+					path, NULL, NULL);
+	if (!ni_dbus_object_call_variant(root, NI_OBJECTMODEL_NAMESPACE ".Metrics",
+				method, 0, NULL, 1, &result, &error)) {
+		ni_dbus_print_error(&error, "%s.%s() failed", path, method);
+		dbus_error_free(&error);
+	} else
+	if (!ni_dbus_variant_get_string(&result, &text)) {
+		ni_error("%s.%s(): cannot parse response", path, method);
+	} else {
+		fputs(text, stdout);
+		status = NI_WICKED_RC_SUCCESS;
+	}
+
+	ni_dbus_variant_destroy(&result);
+	ni_dbus_object_free(root);
+	ni_dbus_client_free(client);
+	ni_string_free(&path);
+	return status;
+}
+
+static int
+ni_do_debug_show(const char *method, int argc, char **argv)
+{
+	enum {	OPT_HELP = 'h', OPT_SERVICE = 's' };
+	static struct option    options[] = {
+		{ "help",	no_argument,		NULL,	OPT_HELP	},
+		{ "service",	required_argument,	NULL,	OPT_SERVICE	},
+		{ NULL,		no_argument,		NULL,	0		}
+	};
+	int opt = 0, status = NI_WICKED_RC_USAGE;
+	const char *service = NULL;
+
+	optind = 1;
+	while ((opt = getopt_long(argc, argv, "+hs:", options, NULL)) != EOF) {
+		switch (opt) {
+		case OPT_SERVICE:
+			service = optarg;
+			break;
+
+		case OPT_HELP:
+			status = NI_WICKED_RC_SUCCESS;
+		default:
+		usage:
+			fprintf(stderr,
+					"Usage: %s [options]\n"
+					"\n"
+					"Options:\n"
+					"  --help, -h           show this help text and exit.\n"
+					"  --service, -s <name> query wickedd (default), nanny,\n"
+					"                       dhcp4, dhcp6 or auto4 service.\n"
+					"\n", argv[0]);
+			return status;
+		}
+	}
+	if (argc - optind)
+		goto usage;
+
+	return ni_do_debug_call(service, method);
+}
+
+int
+ni_do_debug(const char *caller, int argc, char **argv)
+{
+	enum {	OPT_HELP = 'h' };
+	static struct option	options[] = {
+		{ "help",	no_argument,		NULL,	OPT_HELP	},
+		{ NULL,		no_argument,		NULL,	0		}
+	};
+	int opt = 0, status = NI_WICKED_RC_USAGE;
+	char *program = NULL;
+	char *command = NULL;
+	const char *cmd;
+
+	ni_string_printf(&program, "%s %s", caller  ? caller  : "wicked",
+					    argv[0] ? argv[0] : "debug");
+
+	optind = 1;
+	argv[0] = program;
+	while ((opt = getopt_long(argc, argv, "+h", options, NULL)) != EOF) {
+		switch (opt) {
+		case OPT_HELP:
+			status = NI_WICKED_RC_SUCCESS;
+		default:
+		usage:
+			fprintf(stderr,
+				"\nUsage:\n"
+				"  %s [common options] command [...]\n"
+				"\n"
+				"Common options:\n"
+				"  --help, -h           show this help text and exit.\n"
+				"\n"
+				"Supported Commands:\n"
+				"  help                 show this help text and exit.\n"
+				"  memstat              show the tagged memory allocations\n"
+				"  metrics              show the daemon internals metrics\n"
+				"\n", argv[0]);
+			goto cleanup;
+		}
+	}
+
+	if (optind >= argc || ni_string_empty(argv[optind])) {
+		fprintf(stderr, "%s: missing command\n", program);
+		goto usage;
+	}
+
+	cmd = argv[optind];
+	ni_string_printf(&command, "%s %s", program, cmd);
+	argv[optind] = command;
+
+	if (ni_string_eq(cmd, "help")) {
+		argv[optind] = (char *)cmd;
+		status = NI_WICKED_RC_SUCCESS;
+		goto usage;
+	} else
+	if (ni_string_eq(cmd, "memstat")) {
+		status = ni_do_debug_show("GetMemoryUsage", argc - optind, argv + optind);
+	} else
+	if (ni_string_eq(cmd, "metrics")) {
+		status = ni_do_debug_show("GetMetrics", argc - optind, argv + optind);
+	} else {
+		argv[optind] = (char *)cmd;
+		fprintf(stderr, "%s: unsupported command %s\n", program, cmd);
+		goto usage;
+	}
+	argv[optind] = (char *)cmd;
+
+cleanup:
+	argv[0] = NULL;
+	ni_string_free(&command);
+	ni_string_free(&program);
+	return status;
+}
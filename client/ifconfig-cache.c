@@ -0,0 +1,428 @@
+/*
+ *	Persistent cache of interface configurations converted from
+ *	(compat) config sources, e.g. the suse ifcfg files.
+ *
+ *	A cache entry is stored per config source as a XML file in the
+ *	wicked state directory and contains the list of files the config
+ *	has been generated from, each with a stat signature and a content
+ *	hash, followed by the generated (raw) config documents.
+ *	As long as none of the files changed, the entry is used instead
+ *	of reading and converting all of them again.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/netinfo.h>
+#include <wicked/xml.h>
+
+#include "util_priv.h"
+#include "wicked-client.h"
+
+#define NI_IFCONFIG_CACHE_DIR		"ifconfig-cache"
+#define NI_IFCONFIG_CACHE_VERSION	"2"
+
+#define NI_IFCONFIG_CACHE_NODE		"ifconfig-cache"
+#define NI_IFCONFIG_CACHE_SOURCE_NODE	"source"
+#define NI_IFCONFIG_CACHE_VAR_NODE	"var"
+#define NI_IFCONFIG_CACHE_NOTE_NODE	"note"
+#define NI_IFCONFIG_CACHE_CONFIG_NODE	"config"
+
+typedef struct ni_ifconfig_cache_source {
+	char *			path;
+	char *			stat;	/* dev:ino:size:mtime or NULL */
+	char *			hash;	/* lazily computed content hash */
+} ni_ifconfig_cache_source_t;
+
+struct ni_ifconfig_cache {
+	char *			key;
+	char *			file;
+
+	unsigned int		count;
+	ni_ifconfig_cache_source_t *sources;
+};
+
+static const char *
+ni_ifconfig_cache_stat(const char *path, char **sig)
+{
+	struct stat st;
+
+	ni_string_free(sig);
+	if (stat(path, &st) < 0)
+		return NULL;
+
+	return ni_string_printf(sig, "%llu:%llu:%llu:%lld.%09ld",
+			(unsigned long long)st.st_dev,
+			(unsigned long long)st.st_ino,
+			(unsigned long long)st.st_size,
+			(long long)st.st_mtim.tv_sec,
+			(long)st.st_mtim.tv_nsec);
+}
+
+static int
+ni_ifconfig_cache_name_cmp(const void *a, const void *b)
+{
+	return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+/*
+ * Hash the file content, or the sorted list of names for directories.
+ */
+static const char *
+ni_ifconfig_cache_hash(const char *path, char **hash)
+{
+	unsigned char md[20];
+	char buf[4096];
+	ni_hashctx_t *ctx;
+	ssize_t len;
+	int fd, ret;
+
+	ni_string_free(hash);
+	if (!(ctx = ni_hashctx_new(NI_HASHCTX_SHA1)))
+		return NULL;
+
+	ni_hashctx_begin(ctx);
+	if (ni_isdir(path)) {
+		ni_string_array_t names = NI_STRING_ARRAY_INIT;
+		unsigned int i;
+
+		ni_scandir(path, NULL, &names);
+		if (names.count)
+			qsort(names.data, names.count, sizeof(names.data[0]),
+					ni_ifconfig_cache_name_cmp);
+		for (i = 0; i < names.count; ++i)
+			ni_hashctx_put(ctx, names.data[i], strlen(names.data[i]) + 1);
+		ni_string_array_destroy(&names);
+	} else {
+		if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+			ni_hashctx_free(ctx);
+			return NULL;
+		}
+		while ((len = read(fd, buf, sizeof(buf))) > 0)
+			ni_hashctx_put(ctx, buf, len);
+		close(fd);
+		if (len < 0) {
+			ni_hashctx_free(ctx);
+			return NULL;
+		}
+	}
+	ni_hashctx_finish(ctx);
+
+	ret = ni_hashctx_get_digest(ctx, md, sizeof(md));
+	ni_hashctx_free(ctx);
+	if (ret <= 0)
+		return NULL;
+
+	*hash = xmalloc(ret * 2 + 1);
+	ni_format_hex_data(md, ret, *hash, ret * 2 + 1, "", FALSE);
+	return *hash;
+}
+
+static void
+ni_ifconfig_cache_source_destroy(ni_ifconfig_cache_source_t *src)
+{
+	ni_string_free(&src->path);
+	ni_string_free(&src->stat);
+	ni_string_free(&src->hash);
+}
+
+/*
+ * Create a cache handle for a config source, identified by the type
+ * (e.g. "compat:suse") and path and generated from the source files
+ * and directories in the list. Returns NULL when caching is disabled.
+ */
+ni_ifconfig_cache_t *
+ni_ifconfig_cache_new(const char *type, const char *path, const ni_string_array_t *files)
+{
+	ni_ifconfig_cache_t *cache;
+	char *dirname = NULL;
+	unsigned int i;
+
+	/* only root maintains the cache in the state directory */
+	if (geteuid() != 0 || ni_string_empty(type) || !files || !files->count)
+		return NULL;
+
+	if (!ni_string_printf(&dirname, "%s/%s", ni_config_statedir(), NI_IFCONFIG_CACHE_DIR))
+		return NULL;
+
+	if (ni_mkdir_maybe(dirname, 0700) < 0) {
+		ni_debug_ifconfig("Cannot create ifconfig cache directory %s: %m", dirname);
+		ni_string_free(&dirname);
+		return NULL;
+	}
+
+	cache = xcalloc(1, sizeof(*cache));
+	ni_string_printf(&cache->key, "%s:%s", type, path ? path : "");
+	ni_string_printf(&cache->file, "%s/%08x.xml", dirname, ni_string_hash(cache->key));
+	ni_string_free(&dirname);
+
+	cache->count = files->count;
+	cache->sources = xcalloc(cache->count, sizeof(cache->sources[0]));
+	for (i = 0; i < files->count; ++i) {
+		ni_ifconfig_cache_source_t *src = &cache->sources[i];
+
+		ni_string_dup(&src->path, files->data[i]);
+		ni_ifconfig_cache_stat(src->path, &src->stat);
+	}
+	return cache;
+}
+
+void
+ni_ifconfig_cache_free(ni_ifconfig_cache_t *cache)
+{
+	unsigned int i;
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < cache->count; ++i)
+		ni_ifconfig_cache_source_destroy(&cache->sources[i]);
+	free(cache->sources);
+	ni_string_free(&cache->key);
+	ni_string_free(&cache->file);
+	free(cache);
+}
+
+/*
+ * Verify the sources recorded in the cache file against the current
+ * ones. When the stat signature differs, the content hash decides.
+ */
+static ni_bool_t
+ni_ifconfig_cache_verify(ni_ifconfig_cache_t *cache, xml_node_t *root, ni_bool_t *refresh)
+{
+	xml_node_t *node = NULL;
+	unsigned int i = 0;
+
+	while ((node = xml_node_get_next_child(root, NI_IFCONFIG_CACHE_SOURCE_NODE, node))) {
+		ni_ifconfig_cache_source_t *src;
+		const char *stat, *hash;
+
+		if (i >= cache->count)
+			return FALSE;
+
+		src = &cache->sources[i++];
+		if (!ni_string_eq(src->path, xml_node_get_attr(node, "path")))
+			return FALSE;
+
+		stat = xml_node_get_attr(node, "stat");
+		if (ni_string_eq(src->stat, stat))
+			continue;
+		if (!src->stat || !stat)
+			return FALSE;
+
+		hash = xml_node_get_attr(node, "hash");
+		if (!src->hash && !ni_ifconfig_cache_hash(src->path, &src->hash))
+			return FALSE;
+		if (!ni_string_eq(src->hash, hash))
+			return FALSE;
+
+		*refresh = TRUE;
+	}
+	return i == cache->count;
+}
+
+/*
+ * Load the cached config documents, variables and conversion notes
+ * when the cache entry is still valid for the sources.
+ */
+ni_bool_t
+ni_ifconfig_cache_load(ni_ifconfig_cache_t *cache, xml_document_array_t *docs,
+			ni_var_array_t *vars, ni_string_array_t *notes)
+{
+	xml_document_array_t loaded = XML_DOCUMENT_ARRAY_INIT;
+	xml_document_t *cache_doc;
+	xml_node_t *root, *node, *cnode, *next;
+	ni_bool_t refresh = FALSE;
+	unsigned int i;
+
+	if (!cache || !docs || !ni_file_exists(cache->file))
+		return FALSE;
+
+	if (!(cache_doc = xml_document_read(cache->file))) {
+		ni_debug_ifconfig("Unable to read ifconfig cache %s", cache->file);
+		return FALSE;
+	}
+
+	root = xml_node_get_child(xml_document_root(cache_doc), NI_IFCONFIG_CACHE_NODE);
+	if (!root || !ni_string_eq(xml_node_get_attr(root, "version"), NI_IFCONFIG_CACHE_VERSION) ||
+	    !ni_string_eq(xml_node_get_attr(root, "wicked"), PACKAGE_VERSION) ||
+	    !ni_string_eq(xml_node_get_attr(root, "key"), cache->key) ||
+	    !ni_ifconfig_cache_verify(cache, root, &refresh)) {
+		ni_debug_ifconfig("Ifconfig cache %s is outdated", cache->file);
+		xml_document_free(cache_doc);
+		return FALSE;
+	}
+
+	node = NULL;
+	while ((node = xml_node_get_next_child(root, NI_IFCONFIG_CACHE_VAR_NODE, node))) {
+		if (vars)
+			ni_var_array_set(vars, xml_node_get_attr(node, "name"),
+						xml_node_get_attr(node, "value"));
+	}
+
+	node = NULL;
+	while ((node = xml_node_get_next_child(root, NI_IFCONFIG_CACHE_NOTE_NODE, node))) {
+		if (notes && !ni_string_empty(node->cdata))
+			ni_string_array_append(notes, node->cdata);
+	}
+
+	node = NULL;
+	while ((node = xml_node_get_next_child(root, NI_IFCONFIG_CACHE_CONFIG_NODE, node))) {
+		const char *origin = xml_node_get_attr(node, "origin");
+		xml_document_t *doc;
+		xml_node_t *droot;
+
+		doc = xml_document_new();
+		droot = xml_document_root(doc);
+		for (cnode = node->children; cnode; cnode = next) {
+			next = cnode->next;
+			xml_node_reparent(droot, cnode);
+		}
+		if (!ni_string_empty(origin))
+			xml_node_location_relocate(droot, origin);
+		xml_document_array_append(&loaded, doc);
+	}
+	xml_document_free(cache_doc);
+
+	ni_debug_ifconfig("Using ifconfig cache %s with %u config documents",
+			cache->file, loaded.count);
+
+	/* Sources were touched, but are unchanged -- update signatures */
+	if (refresh)
+		ni_ifconfig_cache_save(cache, &loaded, vars, notes);
+
+	for (i = 0; i < loaded.count; ++i)
+		xml_document_array_append(docs, loaded.data[i]);
+	loaded.count = 0;
+	xml_document_array_destroy(&loaded);
+	return TRUE;
+}
+
+/*
+ * Store the (raw) config documents, variables and conversion notes
+ * generated from the sources into the cache file.
+ */
+ni_bool_t
+ni_ifconfig_cache_save(ni_ifconfig_cache_t *cache, const xml_document_array_t *docs,
+			const ni_var_array_t *vars, const ni_string_array_t *notes)
+{
+	char tempname[PATH_MAX];
+	xml_document_t *cache_doc;
+	xml_node_t *root, *node;
+	unsigned int i;
+	ni_bool_t ret = FALSE;
+	FILE *fp;
+	int fd;
+
+	if (!cache || !docs)
+		return FALSE;
+
+	cache_doc = xml_document_new();
+	root = xml_node_new(NI_IFCONFIG_CACHE_NODE, xml_document_root(cache_doc));
+	xml_node_add_attr(root, "version", NI_IFCONFIG_CACHE_VERSION);
+	xml_node_add_attr(root, "wicked", PACKAGE_VERSION);
+	xml_node_add_attr(root, "key", cache->key);
+
+	for (i = 0; i < cache->count; ++i) {
+		ni_ifconfig_cache_source_t *src = &cache->sources[i];
+		char *stat = NULL;
+
+		node = xml_node_new(NI_IFCONFIG_CACHE_SOURCE_NODE, root);
+		xml_node_add_attr(node, "path", src->path);
+		if (!src->stat)
+			continue;
+
+		if (!src->hash && !ni_ifconfig_cache_hash(src->path, &src->hash))
+			goto failure;
+
+		/* modified while we were reading it -- don't cache */
+		ni_ifconfig_cache_stat(src->path, &stat);
+		if (!ni_string_eq(src->stat, stat)) {
+			ni_debug_ifconfig("Source %s changed, not updating ifconfig cache",
+					src->path);
+			ni_string_free(&stat);
+			goto failure;
+		}
+		ni_string_free(&stat);
+
+		xml_node_add_attr(node, "stat", src->stat);
+		xml_node_add_attr(node, "hash", src->hash);
+	}
+
+	for (i = 0; vars && i < vars->count; ++i) {
+		node = xml_node_new(NI_IFCONFIG_CACHE_VAR_NODE, root);
+		xml_node_add_attr(node, "name", vars->data[i].name);
+		xml_node_add_attr(node, "value", vars->data[i].value);
+	}
+
+	for (i = 0; notes && i < notes->count; ++i)
+		xml_node_new_element(NI_IFCONFIG_CACHE_NOTE_NODE, root, notes->data[i]);
+
+	for (i = 0; i < docs->count; ++i) {
+		xml_node_t *droot = xml_document_root(docs->data[i]);
+		xml_node_t *cnode;
+
+		node = xml_node_new(NI_IFCONFIG_CACHE_CONFIG_NODE, root);
+		if (xml_node_location_filename(droot))
+			xml_node_add_attr(node, "origin", xml_node_location_filename(droot));
+		for (cnode = droot->children; cnode; cnode = cnode->next)
+			xml_node_clone(cnode, node);
+	}
+
+	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", cache->file);
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_debug_ifconfig("Cannot create temporary ifconfig cache file %s: %m", tempname);
+		goto failure;
+	}
+	if (!(fp = fdopen(fd, "we"))) {
+		close(fd);
+		unlink(tempname);
+		goto failure;
+	}
+	if (xml_document_print(cache_doc, fp) < 0) {
+		fclose(fp);
+		unlink(tempname);
+		goto failure;
+	}
+	fclose(fp);
+
+	if (rename(tempname, cache->file) < 0) {
+		ni_debug_ifconfig("Cannot rename %s to %s: %m", tempname, cache->file);
+		unlink(tempname);
+		goto failure;
+	}
+
+	ni_debug_ifconfig("Updated ifconfig cache %s", cache->file);
+	ret = TRUE;
+
+failure:
+	xml_document_free(cache_doc);
+	return ret;
+}
@@ -181,6 +181,7 @@ main(int argc, char **argv)
 				"  iaid        <action> ...\n"
 				"  duid        <action> ...\n"
 				"  arp         <action> ...\n"
+				"  debug       <action> ...\n"
 				"\n"
 				, program);
 			goto done;
@@ -327,6 +328,9 @@ main(int argc, char **argv)
 	if (!strcmp(cmd, "arp")) {
 		status = ni_do_arp(program, argc - optind, argv + optind);
 	} else
+	if (!strcmp(cmd, "debug")) {
+		status = ni_do_debug(program, argc - optind, argv + optind);
+	} else
 	if (!strcmp(cmd, "ethtool")) {
 		status = ni_do_ethtool(program, argc - optind, argv + optind);
 	} else {
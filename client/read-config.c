@@ -41,12 +41,15 @@
 #include <wicked/logging.h>
 #include <wicked/netinfo.h>
 
+#include "appconfig.h"
 #include "wicked-client.h"
 #include "client/ifconfig.h"
 
 #if defined(COMPAT_AUTO) || defined(COMPAT_SUSE)
 extern ni_bool_t	__ni_suse_get_ifconfig(const char *, const char *,
 						ni_compat_ifconfig_t *);
+extern ni_bool_t	__ni_suse_get_ifconfig_sources(const char *, const char *,
+						ni_string_array_t *);
 #endif
 #if defined(COMPAT_AUTO) || defined(COMPAT_REDHAT)
 extern ni_bool_t	__ni_redhat_get_ifconfig(const char *, const char *,
@@ -538,20 +541,91 @@ ni_ifconfig_read_wicked(xml_document_array_t *array, const char *type,
  * Read old-style ifcfg file(s)
  */
 #if defined(COMPAT_AUTO) || defined(COMPAT_SUSE)
+static void
+ni_ifconfig_read_compat_add_docs(xml_document_array_t *array, xml_document_array_t *docs,
+			ni_bool_t check_prio, ni_bool_t raw)
+{
+	ni_client_state_config_t conf = NI_CLIENT_STATE_CONFIG_INIT;
+	unsigned int i;
+
+	for (i = 0; i < docs->count; ++i) {
+		xml_document_t *doc = docs->data[i];
+		xml_node_t *root = xml_document_root(doc);
+
+		if (!raw) {
+			ni_string_dup(&conf.origin, xml_node_location_filename(root));
+			ni_ifconfig_metadata_add_to_node(root, &conf);
+		}
+
+		if (ni_ifconfig_validate_adding_doc(doc, check_prio)) {
+			ni_debug_ifconfig("%s: %s", __func__, xml_node_location(root));
+			xml_document_array_append(array, doc);
+		} else {
+			xml_document_free(doc);
+		}
+	}
+	docs->count = 0;
+	xml_document_array_destroy(docs);
+	ni_client_state_config_reset(&conf);
+}
+
 ni_bool_t
 ni_ifconfig_read_compat_suse(xml_document_array_t *array, const char *type,
 			const char *root, const char *path, ni_bool_t check_prio, ni_bool_t raw)
 {
+	extern unsigned int ni_wait_for_interfaces;
+	xml_document_array_t docs = XML_DOCUMENT_ARRAY_INIT;
+	ni_string_array_t sources = NI_STRING_ARRAY_INIT;
+	ni_string_array_t notes = NI_STRING_ARRAY_INIT;
+	ni_var_array_t vars = NI_VAR_ARRAY_INIT;
+	ni_ifconfig_cache_t *cache = NULL;
+	const ni_string_array_t *files;
 	ni_compat_ifconfig_t conf;
+	char *key = NULL;
+	unsigned int i;
 	ni_bool_t rv;
 
+	/*
+	 * The conversion of thousands of ifcfg files takes a while;
+	 * reuse the result of the last run while none of them changed.
+	 */
+	if (__ni_suse_get_ifconfig_sources(root, path, &sources)) {
+		/* the conversion applies the wicked config, e.g. update masks */
+		if ((files = ni_config_files())) {
+			for (i = 0; i < files->count; ++i)
+				ni_string_array_append(&sources, files->data[i]);
+		}
+		ni_string_printf(&key, "%s%s", root ? root : "", path ? path : "");
+		cache = ni_ifconfig_cache_new(type, key, &sources);
+		ni_string_free(&key);
+	}
+	ni_string_array_destroy(&sources);
+
+	if (ni_ifconfig_cache_load(cache, &docs, &vars, &notes)) {
+		ni_var_array_get_uint(&vars, "wait-for-interfaces", &ni_wait_for_interfaces);
+		for (i = 0; i < notes.count; ++i)
+			ni_note("%s", notes.data[i]);
+		ni_ifconfig_read_compat_add_docs(array, &docs, check_prio, raw);
+		ni_string_array_destroy(&notes);
+		ni_var_array_destroy(&vars);
+		ni_ifconfig_cache_free(cache);
+		return TRUE;
+	}
+
 	ni_compat_ifconfig_init(&conf, type);
 
 	/* TODO: apply timeout */
 	if ((rv = __ni_suse_get_ifconfig(root, path, &conf))) {
-		ni_compat_generate_interfaces(array, &conf, check_prio, raw);
+		ni_compat_generate_interfaces(&docs, &conf, FALSE, TRUE);
+		if (cache) {
+			ni_var_array_set_uint(&vars, "wait-for-interfaces", ni_wait_for_interfaces);
+			ni_ifconfig_cache_save(cache, &docs, &vars, &conf.notes);
+		}
+		ni_ifconfig_read_compat_add_docs(array, &docs, check_prio, raw);
 	}
 	ni_compat_ifconfig_destroy(&conf);
+	ni_var_array_destroy(&vars);
+	ni_ifconfig_cache_free(cache);
 	return rv;
 }
 #endif
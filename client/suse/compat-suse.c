@@ -38,6 +38,8 @@
 #include <netlink/netlink.h>
 #include <sys/types.h>
 #include <sys/utsname.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <pwd.h>
 #include <grp.h>
 
@@ -77,10 +79,12 @@
 
 typedef ni_bool_t (*try_function_t)(const ni_sysconfig_t *, ni_netdev_t *, const char *);
 
-static ni_compat_netdev_t *	__ni_suse_read_interface(const char *, const char *);
+static ni_compat_netdev_t *	__ni_suse_read_interface(const char *, const char *, ni_sysconfig_t *);
 static ni_bool_t		__ni_suse_read_globals(const char *, const char *, const char *);
 static void			__ni_suse_free_globals(void);
-static void			__ni_suse_show_unapplied_routes(void);
+static void			__ni_suse_global_ifsysctl_files(const char *, const char *,
+							ni_string_array_t *, ni_string_array_t *);
+static void			__ni_suse_show_unapplied_routes(ni_string_array_t *);
 static void			__ni_suse_adjust_slaves(ni_compat_netdev_array_t *);
 static void			__ni_suse_adjust_ovs_system(ni_compat_netdev_t *);
 static ni_bool_t		__ni_suse_sysconfig_read(ni_sysconfig_t *, ni_compat_netdev_t *);
@@ -132,6 +136,10 @@ static ni_bool_t		__ni_ipv6_disbled;
 #define __NI_SUSE_ROUTES_GLOBAL			"routes"
 #define __NI_SUSE_IFSYSCTL_FILE			"ifsysctl"
 
+#define __NI_SUSE_IFCFG_WORKERS_VAR		"WICKED_IFCFG_WORKERS"
+#define __NI_SUSE_IFCFG_WORKERS_MAX		16
+#define __NI_SUSE_IFCFG_WORKERS_MIN_FILES	64
+
 #define __NI_VLAN_TAG_MAX			4094
 #define __NI_WIRELESS_WPA_PSK_HEX_LEN	64
 #define __NI_WIRELESS_WPA_PSK_MIN_LEN	8
@@ -204,10 +212,113 @@ __ni_suse_ifcfg_scan_files(const char *dirname, ni_string_array_t *res)
 	return res->count - count;
 }
 
+/*
+ * Reading and parsing of the ifcfg files is independent per file, so
+ * with many of them it is done by a pool of reader threads. The
+ * conversion uses (not thread-safe) library state and is done by the
+ * caller afterwards, in the sequential file order as before.
+ */
+typedef struct ni_suse_ifcfg_reader {
+	pthread_mutex_t			lock;
+	unsigned int			next;
+	const char *			dirname;
+	const ni_string_array_t *	files;
+	ni_sysconfig_t **		configs;
+} ni_suse_ifcfg_reader_t;
+
+static void *
+__ni_suse_ifcfg_read_worker(void *arg)
+{
+	ni_suse_ifcfg_reader_t *reader = arg;
+	char pathbuf[PATH_MAX];
+	unsigned int i;
+
+	for (;;) {
+		pthread_mutex_lock(&reader->lock);
+		i = reader->next++;
+		pthread_mutex_unlock(&reader->lock);
+
+		if (i >= reader->files->count)
+			break;
+
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s",
+				reader->dirname, reader->files->data[i]);
+		reader->configs[i] = ni_sysconfig_read(pathbuf);
+	}
+	return NULL;
+}
+
+static unsigned int
+__ni_suse_ifcfg_read_workers(unsigned int count)
+{
+	unsigned int workers = 0;
+	const char *value;
+	long cpus;
+
+	value = __ni_suse_config_defaults ? ni_sysconfig_get_value(
+			__ni_suse_config_defaults, __NI_SUSE_IFCFG_WORKERS_VAR) : NULL;
+	if (!ni_string_empty(value)) {
+		if (ni_parse_uint(value, &workers, 10) < 0) {
+			ni_warn("%s: cannot parse %s='%s'", __func__,
+					__NI_SUSE_IFCFG_WORKERS_VAR, value);
+			workers = 0;
+		} else
+		if (workers <= 1)
+			return 0;
+	} else {
+		if (count < __NI_SUSE_IFCFG_WORKERS_MIN_FILES)
+			return 0;
+	}
+
+	if (!workers) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = cpus > 1 ? cpus : 0;
+	}
+	if (workers > __NI_SUSE_IFCFG_WORKERS_MAX)
+		workers = __NI_SUSE_IFCFG_WORKERS_MAX;
+	if (workers > count)
+		workers = count;
+	return workers > 1 ? workers : 0;
+}
+
+static ni_sysconfig_t **
+__ni_suse_ifcfg_read_parallel(const char *dirname, const ni_string_array_t *files)
+{
+	pthread_t threads[__NI_SUSE_IFCFG_WORKERS_MAX];
+	ni_suse_ifcfg_reader_t reader;
+	unsigned int workers, started, i;
+
+	if (!(workers = __ni_suse_ifcfg_read_workers(files->count)))
+		return NULL;
+
+	memset(&reader, 0, sizeof(reader));
+	pthread_mutex_init(&reader.lock, NULL);
+	reader.dirname = dirname;
+	reader.files = files;
+	reader.configs = xcalloc(files->count, sizeof(reader.configs[0]));
+
+	/* the calling thread is one of the workers */
+	for (started = 0; started < workers - 1; ++started) {
+		if (pthread_create(&threads[started], NULL,
+				__ni_suse_ifcfg_read_worker, &reader) != 0)
+			break;
+	}
+	ni_debug_readwrite("Reading %u %sfiles using %u threads", files->count,
+			__NI_SUSE_CONFIG_IFPREFIX, started + 1);
+
+	__ni_suse_ifcfg_read_worker(&reader);
+	for (i = 0; i < started; ++i)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&reader.lock);
+	return reader.configs;
+}
+
 ni_bool_t
 __ni_suse_get_ifconfig(const char *root, const char *path, ni_compat_ifconfig_t *result)
 {
 	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	ni_sysconfig_t **configs;
 	ni_bool_t success = FALSE;
 	char pathbuf[PATH_MAX];
 	char *pathname = NULL;
@@ -241,18 +352,26 @@ __ni_suse_get_ifconfig(const char *root, const char *path, ni_compat_ifconfig_t
 			goto done;
 		}
 
+		configs = __ni_suse_ifcfg_read_parallel(pathname, &files);
 		for (i = 0; i < files.count; ++i) {
 			const char *filename = files.data[i];
 			const char *ifname = filename + (sizeof(__NI_SUSE_CONFIG_IFPREFIX)-1);
 			ni_compat_netdev_t *compat;
 
+			/* read error has been reported by the reader */
+			if (configs && !configs[i])
+				continue;
+
 			snprintf(pathbuf, sizeof(pathbuf), "%s/%s", pathname, filename);
-			if (!(compat = __ni_suse_read_interface(pathbuf, ifname)))
+			compat = __ni_suse_read_interface(pathbuf, ifname,
+						configs ? configs[i] : NULL);
+			if (!compat)
 				continue;
 
 			ni_compat_netdev_set_origin(compat, result->schema, pathbuf);
 			ni_compat_netdev_array_append(&result->netdevs, compat);
 		}
+		free(configs);
 
 		if (__ni_suse_config_defaults) {
 			extern unsigned int ni_wait_for_interfaces;
@@ -268,7 +387,7 @@ __ni_suse_get_ifconfig(const char *root, const char *path, ni_compat_ifconfig_t
 	}
 
 	__ni_suse_adjust_slaves(&result->netdevs);
-	__ni_suse_show_unapplied_routes();
+	__ni_suse_show_unapplied_routes(&result->notes);
 
 	success = TRUE;
 
@@ -279,6 +398,84 @@ done:
 	return success;
 }
 
+/*
+ * Collect the files and directories the ifcfg configuration is
+ * generated from, including the ones probed but not existing,
+ * so that a cached conversion can be checked for changes.
+ */
+ni_bool_t
+__ni_suse_get_ifconfig_sources(const char *root, const char *path, ni_string_array_t *sources)
+{
+	const char *hostnames[] = __NI_SUSE_HOSTNAME_FILES, **name;
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	const char *_path = __NI_SUSE_SYSCONFIG_NETWORK_DIR;
+	char pathbuf[PATH_MAX];
+	char *pathname = NULL;
+	unsigned int i;
+
+	if (!sources)
+		return FALSE;
+
+	if (!ni_string_empty(path))
+		_path = path;
+
+	if (!root)
+		root = "";
+
+	if (ni_string_empty(root))
+		snprintf(pathbuf, sizeof(pathbuf), "%s", _path);
+	else
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", root, _path);
+
+	if (!ni_realpath(pathbuf, &pathname) || !ni_isdir(pathname)) {
+		ni_string_free(&pathname);
+		return FALSE;
+	}
+
+	/* the directories, so added or removed files are noticed */
+	ni_string_array_append(sources, pathname);
+	snprintf(pathbuf, sizeof(pathbuf), "%s/providers", pathname);
+	ni_string_array_append(sources, pathbuf);
+
+	if (ni_scandir(pathname, NULL, &files)) {
+		for (i = 0; i < files.count; ++i) {
+			snprintf(pathbuf, sizeof(pathbuf), "%s/%s", pathname, files.data[i]);
+			if (ni_isreg(pathbuf))
+				ni_string_array_append(sources, pathbuf);
+		}
+	}
+	ni_string_array_destroy(&files);
+
+	snprintf(pathbuf, sizeof(pathbuf), "%s/providers", pathname);
+	if (ni_scandir(pathbuf, NULL, &files)) {
+		for (i = 0; i < files.count; ++i) {
+			snprintf(pathbuf, sizeof(pathbuf), "%s/providers/%s",
+					pathname, files.data[i]);
+			if (ni_isreg(pathbuf))
+				ni_string_array_append(sources, pathbuf);
+		}
+	}
+	ni_string_array_destroy(&files);
+
+	for (name = hostnames; name && !ni_string_empty(*name); name++) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, *name);
+		ni_string_array_append(sources, pathbuf);
+	}
+
+	__ni_suse_global_ifsysctl_files(root, _path, &files, sources);
+	for (i = 0; i < files.count; ++i) {
+		if (ni_string_array_index(sources, files.data[i]) == -1)
+			ni_string_array_append(sources, files.data[i]);
+	}
+	ni_string_array_destroy(&files);
+
+	/* ipv6 support changes the generated config */
+	ni_string_array_append(sources, __NI_SUSE_PROC_IPV6_DIR);
+
+	ni_string_free(&pathname);
+	return TRUE;
+}
+
 /*
  * Read HOSTNAME file
  */
@@ -315,11 +512,11 @@ __ni_suse_read_default_hostname(const char *root, char **hostname)
 	return *hostname;
 }
 
-static ni_bool_t
-__ni_suse_read_global_ifsysctl(const char *root, const char *path)
+static void
+__ni_suse_global_ifsysctl_files(const char *root, const char *path, ni_string_array_t *files,
+				ni_string_array_t *probed)
 {
 	const char *sysctldirs[] = __NI_SUSE_SYSCTL_DIRS, **sysctld;
-	ni_string_array_t files = NI_STRING_ARRAY_INIT;
 	char dirname[PATH_MAX];
 	char pathbuf[PATH_MAX];
 	const char *name;
@@ -327,8 +524,6 @@ __ni_suse_read_global_ifsysctl(const char *root, const char *path)
 	unsigned int i;
 	struct utsname u;
 
-	ni_var_array_destroy(&__ni_suse_global_ifsysctl);
-
 	/*
 	 * first /boot/sysctl.conf-<kernelversion>
 	 */
@@ -336,9 +531,11 @@ __ni_suse_read_global_ifsysctl(const char *root, const char *path)
 	if (uname(&u) == 0) {
 		snprintf(pathbuf, sizeof(pathbuf), "%s%s%s", root,
 				__NI_SUSE_SYSCTL_BOOT, u.release);
+		if (probed)
+			ni_string_array_append(probed, pathbuf);
 		name = ni_realpath(pathbuf, &real);
 		if (name && ni_isreg(name))
-			ni_string_array_append(&files, name);
+			ni_string_array_append(files, name);
 		ni_string_free(&real);
 	}
 
@@ -349,6 +546,8 @@ __ni_suse_read_global_ifsysctl(const char *root, const char *path)
 		ni_string_array_t names = NI_STRING_ARRAY_INIT;
 
 		snprintf(dirname, sizeof(dirname), "%s%s", root, *sysctld);
+		if (probed)
+			ni_string_array_append(probed, dirname);
 		if (!ni_isdir(dirname))
 			continue;
 
@@ -358,7 +557,7 @@ __ni_suse_read_global_ifsysctl(const char *root, const char *path)
 						dirname, names.data[i]);
 				name = ni_realpath(pathbuf, &real);
 				if (name && ni_isreg(name))
-					ni_string_array_append(&files, name);
+					ni_string_array_append(files, name);
 				ni_string_free(&real);
 			}
 		}
@@ -369,10 +568,12 @@ __ni_suse_read_global_ifsysctl(const char *root, const char *path)
 	 * then the old /etc/sysctl.conf
 	 */
 	snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, __NI_SUSE_SYSCTL_FILE);
+	if (probed)
+		ni_string_array_append(probed, pathbuf);
 	name = ni_realpath(pathbuf, &real);
 	if (name && ni_isreg(name)) {
-		if (ni_string_array_index(&files, name) == -1)
-			ni_string_array_append(&files, name);
+		if (ni_string_array_index(files, name) == -1)
+			ni_string_array_append(files, name);
 	}
 	ni_string_free(&real);
 
@@ -386,17 +587,31 @@ __ni_suse_read_global_ifsysctl(const char *root, const char *path)
 		snprintf(pathbuf, sizeof(pathbuf), "%s/%s/%s",
 				root, path, __NI_SUSE_IFSYSCTL_FILE);
 
+	if (probed)
+		ni_string_array_append(probed, pathbuf);
 	name = ni_realpath(pathbuf, &real);
 	if (name && ni_isreg(name)) {
-		if (ni_string_array_index(&files, name) == -1)
-			ni_string_array_append(&files, name);
+		if (ni_string_array_index(files, name) == -1)
+			ni_string_array_append(files, name);
 	}
 	ni_string_free(&real);
+}
+
+static ni_bool_t
+__ni_suse_read_global_ifsysctl(const char *root, const char *path)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	const char *name;
+	unsigned int i;
+
+	ni_var_array_destroy(&__ni_suse_global_ifsysctl);
+	__ni_suse_global_ifsysctl_files(root, path, &files, NULL);
 
 	for (i = 0; i < files.count; ++i) {
 		name = files.data[i];
 		ni_ifsysctl_file_load(&__ni_suse_global_ifsysctl, name);
 	}
+	ni_string_array_destroy(&files);
 	return TRUE;
 }
 
@@ -458,10 +673,11 @@ __ni_suse_read_globals(const char *root, const char *path, const char *real)
 }
 
 static void
-__ni_suse_show_unapplied_routes(void)
+__ni_suse_show_unapplied_routes(ni_string_array_t *notes)
 {
 	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
 	ni_route_table_t *tab;
+	char *note = NULL;
 	unsigned int i;
 
 	for (tab = __ni_suse_global_routes; tab; tab = tab->next) {
@@ -471,11 +687,14 @@ __ni_suse_show_unapplied_routes(void)
 			if (!rp || rp->users >= 2)
 				continue;
 
-			ni_note("discarding route not matching any interface: %s",
+			ni_string_printf(&note, "discarding route not matching any interface: %s",
 					ni_route_print(&out, rp));
+			ni_note("%s", note);
+			ni_string_array_append(notes, note);
 			ni_stringbuf_destroy(&out);
 		}
 	}
+	ni_string_free(&note);
 }
 
 static void
@@ -1516,33 +1735,33 @@ error:
  * Read the configuration of a single interface from a sysconfig file
  */
 static ni_compat_netdev_t *
-__ni_suse_read_interface(const char *filename, const char *ifname)
+__ni_suse_read_interface(const char *filename, const char *ifname, ni_sysconfig_t *sc)
 {
 	const char *basename = ni_basename(filename);
 	size_t pfxlen = sizeof(__NI_SUSE_CONFIG_IFPREFIX)-1;
 	ni_compat_netdev_t *compat = NULL;
-	ni_sysconfig_t *sc;
 
 	if (ni_string_len(ifname) == 0) {
 		if (!__ni_suse_ifcfg_valid_prefix(basename, __NI_SUSE_CONFIG_IFPREFIX)) {
 			ni_error("Rejecting file without '%s' prefix: %s",
 				__NI_SUSE_CONFIG_IFPREFIX, filename);
-			return NULL;
+			goto error;
 		}
 		if (!__ni_suse_ifcfg_valid_suffix(basename, pfxlen)) {
 			ni_error("Rejecting blacklisted %sfile: %s",
 				__NI_SUSE_CONFIG_IFPREFIX, filename);
-			return NULL;
+			goto error;
 		}
 		ifname = basename + pfxlen;
 	}
 
 	if (!ni_netdev_name_is_valid(ifname)) {
 		ni_error("Rejecting suspect interface name: %s", ifname);
-		return NULL;
+		goto error;
 	}
 
-	if (!(sc = ni_sysconfig_read(filename)))
+	/* unless already read by the parallel ifcfg reader */
+	if (!sc && !(sc = ni_sysconfig_read(filename)))
 		goto error;
 
 	compat = ni_compat_netdev_new(ifname);
@@ -5173,6 +5392,19 @@ __ni_suse_addrconf_dhcp4_options(const ni_sysconfig_t *sc, ni_compat_netdev_t *c
 	if ((string = ni_sysconfig_get_value(sc, "DHCLIENT_RELEASE_BEFORE_QUIT")))
 		compat->dhcp4.release_lease = ni_string_eq(string, "yes");
 
+	if ((string = ni_sysconfig_get_value(sc, "DHCLIENT_RAPID_COMMIT")) != NULL) {
+		if (!strcasecmp(string, "yes")) {
+			compat->dhcp4.rapid_commit = TRUE;
+		} else
+		if (!strcasecmp(string, "no")) {
+			compat->dhcp4.rapid_commit = FALSE;
+		} else {
+			ni_warn("%s: Cannot parse DHCLIENT_RAPID_COMMIT='%s'",
+				ni_basename(sc->pathname), string);
+			ret = FALSE;
+		}
+	}
+
 	if ((string = ni_sysconfig_get_value(sc, "DHCLIENT_SET_HOSTNAME"))) {
 		if (ni_string_eq(string, "yes")) {
 			ni_addrconf_update_set(&compat->dhcp4.update,
@@ -5359,6 +5591,7 @@ __ni_suse_addrconf_dhcp4(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat, n
 	ni_addrconf_update_set(&compat->dhcp4.update, NI_ADDRCONF_UPDATE_MTU, !dev->link.mtu);
 	compat->dhcp4.recover_lease = TRUE;
 	compat->dhcp4.release_lease = FALSE;
+	compat->dhcp4.rapid_commit = FALSE;
 
 	config = ni_config_dhcp4_find_device(dev->name);
 	if ((merged = ni_sysconfig_merge_defaults(sc, __ni_suse_dhcp_defaults))) {
@@ -78,6 +78,7 @@ typedef struct ni_compat_netdev {
 		unsigned int	lease_time;
 		ni_bool_t	recover_lease;
 		ni_bool_t	release_lease;
+		ni_bool_t	rapid_commit;
 
 		unsigned int	route_priority;
 		unsigned int	update;
@@ -128,6 +129,7 @@ typedef struct ni_compat_ifconfig {
 	unsigned int		timeout;
 
 	ni_compat_netdev_array_t netdevs;
+	ni_string_array_t	notes;	/* conversion notes, kept in the ifconfig cache */
 } ni_compat_ifconfig_t;
 
 extern ni_compat_netdev_t *	ni_compat_netdev_new(const char *);
@@ -155,6 +157,15 @@ extern ni_bool_t		ni_ifconfig_metadata_get_from_node(ni_client_state_config_t *,
 extern void			ni_ifconfig_metadata_clear(xml_node_t *);
 extern const char *		ni_ifconfig_format_origin(char **, const char *, const char *);
 
+typedef struct ni_ifconfig_cache	ni_ifconfig_cache_t;
+
+extern ni_ifconfig_cache_t *	ni_ifconfig_cache_new(const char *, const char *, const ni_string_array_t *);
+extern void			ni_ifconfig_cache_free(ni_ifconfig_cache_t *);
+extern ni_bool_t		ni_ifconfig_cache_load(ni_ifconfig_cache_t *, xml_document_array_t *,
+						ni_var_array_t *, ni_string_array_t *);
+extern ni_bool_t		ni_ifconfig_cache_save(ni_ifconfig_cache_t *, const xml_document_array_t *,
+						const ni_var_array_t *, const ni_string_array_t *);
+
 typedef struct ni_nanny_fsm_monitor	ni_nanny_fsm_monitor_t;
 
 extern ni_nanny_fsm_monitor_t *	ni_nanny_fsm_monitor_new(ni_fsm_t *);
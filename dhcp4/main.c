@@ -23,6 +23,7 @@
 
 #include "dhcp4/dhcp4.h"
 #include "dhcp4/tester.h"
+#include "metrics.h"
 
 enum {
 	/* common */
@@ -469,6 +470,9 @@ dhcp4_supplicant(void)
 			ni_fatal("unable to background server");
 	}
 
+	ni_server_async_logging(program_name);
+	ni_metrics_listen(program_name);
+
 	if (opt_recover_state)
 		dhcp4_recover_state(opt_state_file);
 
@@ -483,6 +487,8 @@ dhcp4_supplicant(void)
 			ni_fatal("ni_socket_wait failed");
 	}
 
+	ni_addrconf_lease_file_flush();
+
 	if (opt_recover_state)
 		ni_objectmodel_save_state(opt_state_file);
 
@@ -43,6 +43,7 @@
 #include "dhcp6/tester.h"
 #include "netinfo_priv.h"
 #include "duid.h"
+#include "metrics.h"
 
 
 #define CONFIG_DHCP6_STATE_FILE	"dhcp6-state.xml"
@@ -454,6 +455,9 @@ dhcp6_supplicant(void)
 			ni_fatal("Unable to background server");
 	}
 
+	ni_server_async_logging(program_name);
+	ni_metrics_listen(program_name);
+
 	if (opt_recover_state)
 		dhcp6_recover_state(opt_state_file);
 
@@ -468,6 +472,8 @@ dhcp6_supplicant(void)
 			ni_fatal("ni_socket_wait failed");
 	}
 
+	ni_addrconf_lease_file_flush();
+
 	/*
 	if (opt_recover_state)
 		ni_objectmodel_save_state(opt_state_file);
@@ -7,6 +7,8 @@
 #ifndef __WICKED_LINKSTATS_H__
 #define __WICKED_LINKSTATS_H__
 
+#include <stdint.h>
+
 struct ni_link_stats {
 	unsigned long		rx_packets;		/* total packets received	*/
 	unsigned long		tx_packets;		/* total packets transmitted	*/
@@ -39,4 +41,18 @@ struct ni_link_stats {
 	unsigned long		tx_compressed;
 };
 
+/*
+ * Extended link counters by name, e.g. the bond 802.3ad,
+ * bridge stp and multicast or the offload cpu hit counters.
+ */
+typedef struct ni_link_xstat {
+	const char *		name;
+	uint64_t		value;
+} ni_link_xstat_t;
+
+struct ni_link_xstats {
+	unsigned int		count;
+	ni_link_xstat_t *	data;
+};
+
 #endif /* __WICKED_LINKSTATS_H__ */
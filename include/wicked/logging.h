@@ -40,6 +40,26 @@ extern ni_bool_t	ni_log_destination(const char *program, const char *destination
 extern void		ni_log_reopen(void);
 extern void		ni_log_close(void);
 
+/*
+ * Asynchronous logging: the messages are captured into an in-memory
+ * ring and written to the log destination by a writer thread. The
+ * overflow policy decides whether a full ring drops new messages or
+ * blocks the caller until the writer made room. The flight recorder
+ * dumps the last records of the ring into a file on a crash or on
+ * SIGUSR2.
+ */
+typedef enum {
+	NI_LOG_OVERFLOW_DROP,
+	NI_LOG_OVERFLOW_BLOCK,
+} ni_log_overflow_t;
+
+extern ni_bool_t	ni_log_async_start(unsigned int records, ni_log_overflow_t overflow,
+					unsigned int flight_records, const char *dumpfile);
+extern void		ni_log_async_flush(void);
+extern void		ni_log_async_stop(void);
+extern unsigned long	ni_log_async_dropped(void);
+extern int		ni_log_flight_recorder_dump(void);
+
 enum {
 	NI_LOG_ERROR,
 	NI_LOG_WARNING,
@@ -18,6 +18,7 @@
 #include "client/client_state.h"
 
 typedef struct ni_link_stats	ni_link_stats_t;
+typedef struct ni_link_xstats	ni_link_xstats_t;
 typedef struct ni_ethtool_stats	ni_ethtool_stats_t;
 
 typedef struct ni_slaveinfo	ni_slaveinfo_t;
@@ -52,6 +53,7 @@ struct ni_linkinfo {
 	unsigned int		saved_mtu;
 
 	ni_link_stats_t *	stats;
+	ni_link_xstats_t *	xstats;
 	ni_ethtool_stats_t *	ethtool_stats;
 };
 
@@ -134,6 +136,7 @@ typedef ni_bool_t	ni_init_appdata_callback_t(void *, const xml_node_t *);
 extern int		ni_init_ex(const char *appname, ni_init_appdata_callback_t *, void *);
 
 extern int		ni_server_background(const char *, ni_daemon_close_t);
+extern int		ni_server_async_logging(const char *);
 extern int		ni_server_listen_interface_events(void (*handler)(ni_netdev_t *, ni_event_t));
 extern int		ni_server_enable_interface_addr_events(void (*handler)(ni_netdev_t *, ni_event_t, const ni_address_t *));
 extern int		ni_server_enable_interface_prefix_events(void (*handler)(ni_netdev_t *, ni_event_t, const ni_ipv6_ra_pinfo_t *));
@@ -225,6 +228,7 @@ extern void		ni_netdev_set_ethtool(ni_netdev_t *, ni_ethtool_t *);
 extern void		ni_netdev_set_ethernet(ni_netdev_t *, ni_ethernet_t *);
 extern void		ni_netdev_set_infiniband(ni_netdev_t *, ni_infiniband_t *);
 extern void		ni_netdev_set_link_stats(ni_netdev_t *, ni_link_stats_t *);
+extern void		ni_netdev_set_link_xstats(ni_netdev_t *, ni_link_xstats_t *);
 extern void		ni_netdev_set_wireless(ni_netdev_t *, ni_wireless_t *);
 extern void		ni_netdev_set_openvpn(ni_netdev_t *, ni_openvpn_t *);
 extern void		ni_netdev_set_tuntap(ni_netdev_t *, ni_tuntap_t *);
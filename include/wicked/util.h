@@ -25,6 +25,19 @@ typedef struct ni_intmap {
 	unsigned int	value;
 } ni_intmap_t;
 
+/*
+ * Lazily built hash index over a static, NULL terminated ni_intmap_t
+ * array; declare it next to the map using NI_INTMAP_INDEX_INIT.
+ */
+typedef struct ni_intmap_index {
+	const ni_intmap_t *	map;
+	unsigned int		size;
+	unsigned int *		names;
+	unsigned int *		values;
+} ni_intmap_index_t;
+
+#define NI_INTMAP_INDEX_INIT(_map)	{ .map = (_map), .size = 0, .names = NULL, .values = NULL }
+
 typedef struct ni_uint_arrray {
 	unsigned int	count;
 	unsigned int *	data;
@@ -216,6 +229,11 @@ extern int		ni_parse_uint_maybe_mapped(const char *, const struct ni_intmap *, u
 
 extern const char *	ni_format_uint_mapped(unsigned int, const ni_intmap_t *);
 extern const char *	ni_format_uint_maybe_mapped(unsigned int, const ni_intmap_t *);
+extern int		ni_parse_uint_indexed(const char *, ni_intmap_index_t *, unsigned int *);
+extern const char *	ni_format_uint_indexed(unsigned int, ni_intmap_index_t *);
+extern int		ni_parse_uint_maybe_indexed(const char *, ni_intmap_index_t *, unsigned int *, int);
+extern const char *	ni_format_uint_maybe_indexed(unsigned int, ni_intmap_index_t *);
+extern void		ni_intmap_index_destroy(ni_intmap_index_t *);
 extern const char *	ni_format_hex(const unsigned char *data, unsigned int data_len,
 				char *namebuf, size_t name_max);
 extern const char *	ni_print_hex(const unsigned char *data, unsigned int data_len);
@@ -392,6 +410,10 @@ extern ni_bool_t	ni_string_ishex(const char *);
 extern int		ni_string_remove_char(char *, int);
 extern void		ni_string_tolower(char *);
 extern void		ni_string_toupper(char *);
+extern unsigned int	ni_string_hash(const char *);
+
+#define NI_HASH_FNV1A_INIT	2166136261U
+extern uint32_t		ni_hash_fnv1a(uint32_t, const void *, size_t);
 
 extern char *		ni_sprint_hex(const unsigned char *, size_t);
 extern const char *	ni_sprint_uint(unsigned int);
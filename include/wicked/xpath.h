@@ -57,10 +57,13 @@ typedef struct xpath_result {
 	unsigned int		users;
 	xpath_node_type_t	type;
 	unsigned int		count;
+	unsigned int		size;
 	xpath_node_t *		node;
 } xpath_result_t;
 
 extern xpath_enode_t *	xpath_expression_parse(const char *);
+extern xpath_enode_t *	xpath_expression_compile(const char *);
+extern void		xpath_expression_cache_flush(void);
 extern void		xpath_expression_free(xpath_enode_t *);
 extern xpath_result_t *	xpath_expression_eval(const xpath_enode_t *, xml_node_t *);
 
@@ -31,6 +31,7 @@
 #include "client/ifconfig.h"
 #include "util_priv.h"
 #include "nanny.h"
+#include "metrics.h"
 
 enum {
 	OPT_HELP,
@@ -271,6 +272,9 @@ babysit(void)
 			ni_fatal("unable to background server");
 	}
 
+	ni_server_async_logging(program_name);
+	ni_metrics_listen(program_name);
+
 	if (ni_config_use_nanny()) {
 		ni_rfkill_open(handle_rfkill_event, mgr);
 		ni_nanny_discover_state(mgr);
@@ -29,8 +29,10 @@
 #include <wicked/wireless.h>
 #include <wicked/modem.h>
 #include "netinfo_priv.h"
+#include "snapshot.h"
 #include "udev-utils.h"
 #include "auto6.h"
+#include "metrics.h"
 
 enum {
 	OPT_HELP,
@@ -274,6 +276,9 @@ run_interface_server(void)
 			ni_fatal("unable to background server");
 	}
 
+	ni_server_async_logging(program_name);
+	ni_metrics_listen(program_name);
+
 	discover_state(dbus_server);
 
 	if (opt_recover_state)
@@ -290,6 +295,9 @@ run_interface_server(void)
 			ni_fatal("ni_socket_wait failed");
 	}
 
+	ni_addrconf_lease_file_flush();
+	ni_netconfig_snapshot_save(ni_global_state_handle(0));
+
 	if (opt_recover_state)
 		ni_objectmodel_save_state(opt_state_file);
 
@@ -323,6 +331,9 @@ discover_state(ni_dbus_server_t *server)
 	ni_modem_t *modem;
 #endif
 
+	/* reconcile the snapshot of a clean shutdown in the refresh */
+	ni_netconfig_snapshot_load();
+
 	nc = ni_global_state_handle(1);
 	if (nc == NULL)
 		ni_fatal("failed to discover interface state");
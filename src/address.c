@@ -44,7 +44,7 @@ do_address_new(void)
 {
 	ni_address_t *ap;
 
-	ap = xcalloc(1, sizeof(*ap));
+	ap = xcalloc_tagged(NI_MEMTAG_ADDRESS, 1, sizeof(*ap));
 	if (ap) {
 		ap->refcount = 1;
 	}
@@ -129,7 +129,7 @@ ni_address_free(ni_address_t *ap)
 			return;
 
 		ni_string_free(&ap->label);
-		free(ap);
+		xfree_tagged(NI_MEMTAG_ADDRESS, ap);
 	}
 }
 
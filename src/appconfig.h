@@ -43,6 +43,9 @@ struct ni_extension {
 	/* Format type. Only in use by system-updater. */
 	char *			format;
 
+	/* Settle time in msec. Only in use by system-updater. */
+	unsigned int		settle;
+
 	/* Shell commands */
 	ni_script_action_t *	actions;
 
@@ -56,6 +59,9 @@ struct ni_extension {
 	 */
 	ni_var_array_t		environment;
 
+	/* Co-process serving the shell commands */
+	struct ni_coprocess *	coprocess;
+
 	ni_config_fslocation_t	statedir;
 };
 
@@ -74,6 +80,16 @@ typedef struct ni_config_rtnl_event {
 	unsigned int	mesg_buff_length;
 } ni_config_rtnl_event_t;
 
+typedef struct ni_config_packet_capture {
+	/*
+	 * packet capture (raw socket) related tunables
+	 */
+	ni_bool_t	rx_ring;
+	unsigned int	rx_ring_blocks;
+	unsigned int	rx_ring_timeout;
+	ni_bool_t	shared;
+} ni_config_packet_capture_t;
+
 typedef enum {
 	NI_CONFIG_BONDING_CTL_NETLINK = 0,
 	NI_CONFIG_BONDING_CTL_SYSFS,
@@ -95,6 +111,24 @@ typedef struct ni_config_teamd {
 	ni_config_teamd_ctl_t	ctl;
 } ni_config_teamd_t;
 
+typedef enum {
+	NI_CONFIG_DHCP_RENEW_SPREAD_NONE = 0,
+	NI_CONFIG_DHCP_RENEW_SPREAD_HASHED,
+	NI_CONFIG_DHCP_RENEW_SPREAD_RANDOM,
+} ni_config_dhcp_renew_spread_t;
+
+#define NI_CONFIG_DHCP_RENEW_JITTER	10	/* percent */
+#define NI_CONFIG_DHCP_RENEW_JITTER_MAX	50	/* percent */
+
+typedef struct ni_config_dhcp_renew {
+	/*
+	 * spreading of the lease renewals (T1/T2)
+	 */
+	ni_config_dhcp_renew_spread_t	spread;
+	unsigned int			jitter;		/* max percent to renew earlier	*/
+	unsigned int			max_rate;	/* renewals per second, global	*/
+} ni_config_dhcp_renew_t;
+
 typedef enum {
 	NI_CONFIG_DHCP4_ROUTES_CSR,
 	NI_CONFIG_DHCP4_ROUTES_MSCSR,
@@ -117,6 +151,7 @@ typedef struct ni_config_dhcp4 {
 	unsigned int		routes_opts;
 	char *			vendor_class;
 	unsigned int		lease_time;
+	ni_config_dhcp_renew_t	renew;
 	ni_string_array_t	ignore_servers;
 
 	unsigned int		num_preferred_servers;
@@ -135,6 +170,7 @@ typedef struct ni_config_dhcp6 {
 
 	unsigned int		allow_update;
 	unsigned int		lease_time;
+	ni_config_dhcp_renew_t	renew;
 	unsigned int		release_nretries;
 
 	ni_string_array_t 	user_class_data;
@@ -158,6 +194,66 @@ typedef struct ni_config_auto6 {
 	unsigned int	allow_update;
 } ni_config_auto6_t;
 
+typedef enum {
+	NI_CONFIG_CLIENT_STATE_STORE_FILES = 0,
+	NI_CONFIG_CLIENT_STATE_STORE_LOG,
+} ni_config_client_state_store_t;
+
+typedef struct ni_config_client_state {
+	/*
+	 * interface client-state store tunables
+	 */
+	ni_config_client_state_store_t store;
+	ni_bool_t		sync;
+} ni_config_client_state_t;
+
+typedef struct ni_config_warm_restart {
+	/*
+	 * wickedd netconfig snapshot tunables
+	 */
+	ni_bool_t		enabled;
+	unsigned int		refresh_batch;
+	unsigned int		refresh_interval;
+} ni_config_warm_restart_t;
+
+typedef struct ni_config_link_stats {
+	/*
+	 * bulk link statistics cache tunables
+	 */
+	unsigned int		cache_time;
+} ni_config_link_stats_t;
+
+typedef struct ni_config_metrics {
+	/*
+	 * daemon internals metrics export
+	 */
+	ni_bool_t		enabled;
+} ni_config_metrics_t;
+
+typedef struct ni_config_async_logging {
+	/*
+	 * asynchronous log ring and flight recorder
+	 */
+	ni_bool_t		enabled;
+	unsigned int		records;
+	ni_log_overflow_t	overflow;
+	unsigned int		flight_recorder;
+} ni_config_async_logging_t;
+
+typedef enum {
+	NI_CONFIG_LEASE_FILE_FORMAT_XML = 0,
+	NI_CONFIG_LEASE_FILE_FORMAT_BINARY,
+} ni_config_lease_file_format_t;
+
+typedef struct ni_config_lease_file {
+	/*
+	 * lease file store tunables
+	 */
+	ni_config_lease_file_format_t format;
+	unsigned int		write_delay;
+	ni_bool_t		sync;
+} ni_config_lease_file_t;
+
 typedef struct ni_config {
 	ni_config_fslocation_t	piddir;
 	ni_config_fslocation_t	storedir;
@@ -174,6 +270,7 @@ typedef struct ni_config {
 	    ni_config_auto4_t		auto4;
 	    ni_config_auto6_t		auto6;
 
+	    ni_config_lease_file_t	lease_file;
 	} addrconf;
 
 	char *			dbus_xml_schema_file;
@@ -186,10 +283,18 @@ typedef struct ni_config {
 	    ni_string_array_t	ifconfig;
 	} sources;
 
+	ni_string_array_t	files;	/* read config files and optional includes */
+
 	char *			dbus_name;
 	char *			dbus_type;
 
 	ni_config_rtnl_event_t	rtnl_event;
+	ni_config_packet_capture_t packet_capture;
+	ni_config_client_state_t client_state;
+	ni_config_warm_restart_t warm_restart;
+	ni_config_link_stats_t	link_stats;
+	ni_config_metrics_t	metrics;
+	ni_config_async_logging_t async_logging;
 
 	ni_config_bonding_t	bonding;
 	ni_config_teamd_t	teamd;
@@ -203,12 +308,22 @@ extern ni_extension_t *	ni_config_find_system_updater(ni_config_t *, const char
 extern unsigned int	ni_config_addrconf_update_mask(ni_addrconf_mode_t, unsigned int);
 extern unsigned int	ni_config_addrconf_update(const char *, ni_addrconf_mode_t, unsigned int);
 extern ni_bool_t	ni_config_use_nanny(void);
+extern const ni_string_array_t *	ni_config_files(void);
 
 extern const ni_config_dhcp4_t *	ni_config_dhcp4_find_device(const char *);
 extern const ni_config_dhcp6_t *	ni_config_dhcp6_find_device(const char *);
 
+extern const char *	ni_config_dhcp_renew_spread_name(ni_config_dhcp_renew_spread_t);
+
 extern ni_config_bonding_ctl_t	ni_config_bonding_ctl(void);
 
+extern const ni_config_lease_file_t *	ni_config_lease_file(void);
+extern const ni_config_client_state_t *	ni_config_client_state(void);
+extern const ni_config_warm_restart_t *	ni_config_warm_restart(void);
+extern const ni_config_link_stats_t *	ni_config_link_stats(void);
+extern const ni_config_metrics_t *	ni_config_metrics(void);
+extern const ni_config_async_logging_t *ni_config_async_logging(void);
+
 extern ni_bool_t	ni_config_teamd_enable(ni_config_teamd_ctl_t);
 extern ni_bool_t	ni_config_teamd_disable(void);
 extern ni_bool_t	ni_config_teamd_enabled(void);
@@ -16,8 +16,18 @@
 #include <wicked/socket.h>
 #include "netinfo_priv.h"
 #include "socket_priv.h"
+#include "util_priv.h"
 #include "buffer.h"
 
+/*
+ * Probes and announcements of many addresses are sent in bursts,
+ * paced to not overrun the socket buffer and the link.
+ */
+#define NI_ARP_SEND_BURST	32
+#define NI_ARP_SEND_PACE	10	/* msec */
+
+#define NI_ARP_INDEX_SIZE_MIN	16
+
 static void	ni_arp_socket_recv(ni_socket_t *);
 static int	ni_arp_parse(ni_arp_socket_t *, ni_buffer_t *, ni_arp_packet_t *);
 
@@ -218,6 +228,107 @@ ni_arp_timeout_left(struct timeval *started, const struct timeval *current, unsi
 }
 
 
+/*
+ * Hash index of the address set positions by the IPv4 address, using
+ * open addressing; the slots hold the array position + 1.
+ */
+static inline unsigned int
+ni_arp_address_hash(struct in_addr ip)
+{
+	uint32_t hash = ip.s_addr;
+
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3bU;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+static inline struct in_addr
+ni_arp_address_ip(const ni_address_t *ap)
+{
+	return ap->local_addr.sin.sin_addr;
+}
+
+static void
+ni_arp_address_index_destroy(ni_arp_address_index_t *index)
+{
+	free(index->slot);
+	memset(index, 0, sizeof(*index));
+}
+
+static void
+ni_arp_address_index_insert(ni_arp_address_index_t *index, const ni_address_array_t *set,
+				unsigned int pos)
+{
+	unsigned int i;
+
+	i = ni_arp_address_hash(ni_arp_address_ip(set->data[pos]));
+	for (i &= index->size - 1; index->slot[i]; i = (i + 1) & (index->size - 1))
+		;
+	index->slot[i] = pos + 1;
+}
+
+static void
+ni_arp_address_index_rehash(ni_arp_address_index_t *index, const ni_address_array_t *set,
+				unsigned int size)
+{
+	unsigned int pos;
+
+	free(index->slot);
+	index->slot = xcalloc(size, sizeof(*index->slot));
+	index->size = size;
+
+	for (pos = 0; pos < set->count; ++pos)
+		ni_arp_address_index_insert(index, set, pos);
+}
+
+static ni_address_t *
+ni_arp_address_index_find(const ni_arp_address_index_t *index, const ni_address_array_t *set,
+				struct in_addr ip)
+{
+	unsigned int i, pos;
+	ni_address_t *ap;
+
+	if (!index->size)
+		return NULL;
+
+	i = ni_arp_address_hash(ip) & (index->size - 1);
+	for ( ; (pos = index->slot[i]); i = (i + 1) & (index->size - 1)) {
+		ap = set->data[pos - 1];
+		if (ni_arp_address_ip(ap).s_addr == ip.s_addr)
+			return ap;
+	}
+	return NULL;
+}
+
+static unsigned int
+ni_arp_address_set_add(ni_address_array_t *set, ni_arp_address_index_t *index, ni_address_t *ap)
+{
+	ni_address_t *ref;
+
+	if (ap->family != AF_INET || !ni_sockaddr_is_ipv4_specified(&ap->local_addr))
+		return 0;
+
+	if (ni_arp_address_index_find(index, set, ni_arp_address_ip(ap)))
+		return 0;	/* already have it */
+
+	ref = ni_address_ref(ap);
+	if (!ref || !ni_address_array_append(set, ref)) {
+		ni_address_free(ref);
+		return 0;
+	}
+
+	/* keep the load factor below 1/2 */
+	if (set->count * 2 > index->size) {
+		ni_arp_address_index_rehash(index, set, index->size ?
+				index->size << 1 : NI_ARP_INDEX_SIZE_MIN);
+	} else {
+		ni_arp_address_index_insert(index, set, set->count - 1);
+	}
+
+	return set->count;
+}
+
 void
 ni_arp_verify_init(ni_arp_verify_t *vfy,  unsigned int nprobes, unsigned int wait_ms)
 {
@@ -231,38 +342,28 @@ ni_arp_verify_reset(ni_arp_verify_t *vfy,  unsigned int nprobes, unsigned int wa
 {
 	vfy->nprobes = nprobes;
 	vfy->wait_ms = wait_ms;
+	vfy->cursor = 0;
+	vfy->sent = 0;
 	timerclear(&vfy->started);
 	ni_address_array_destroy(&vfy->ipaddrs);
+	ni_arp_address_index_destroy(&vfy->index);
 }
 
 void
 ni_arp_verify_destroy(ni_arp_verify_t *vfy)
 {
 	ni_address_array_destroy(&vfy->ipaddrs);
+	ni_arp_address_index_destroy(&vfy->index);
 	memset(vfy, 0, sizeof(*vfy));
 }
 
 unsigned int
 ni_arp_verify_add_address(ni_arp_verify_t *vfy,  ni_address_t *ap)
 {
-	ni_address_t *ref;
-
 	if (!vfy || !ap || !vfy->nprobes)
 		return 0;
 
-	if (ap->family != AF_INET || !ni_sockaddr_is_ipv4_specified(&ap->local_addr))
-		return 0;
-
-	if (ni_address_array_find_match(&vfy->ipaddrs, ap, NULL, ni_address_equal_local_addr))
-		return 0;	/* already have it */
-
-	ref = ni_address_ref(ap);
-	if (!ref || !ni_address_array_append(&vfy->ipaddrs, ref)) {
-		ni_address_free(ref);
-		return 0;
-	}
-
-	return vfy->ipaddrs.count;
+	return ni_arp_address_set_add(&vfy->ipaddrs, &vfy->index, ap);
 }
 
 void
@@ -282,7 +383,7 @@ ni_arp_verify_process(ni_arp_socket_t *sock, const ni_arp_packet_t *pkt, void *u
 	/* Is it about the address we're validating? */
 	memset(&sip, 0, sizeof(sip));
 	ni_sockaddr_set_ipv4(&sip.local_addr, pkt->sip, 0);
-	dup = ni_address_array_find_match(&vfy->ipaddrs, &sip, NULL, ni_address_equal_local_addr);
+	dup = ni_arp_address_index_find(&vfy->index, &vfy->ipaddrs, pkt->sip);
 	if (!dup) {
 		ni_debug_application("%s: ignore report about unrelated address %s from  %s",
 				sock->dev_info.ifname, ni_sockaddr_print(&sip.local_addr),
@@ -342,12 +443,34 @@ ni_arp_verify_process(ni_arp_socket_t *sock, const ni_arp_packet_t *pkt, void *u
 			hwaddr ? " (in use by " : "", hwaddr ? hwaddr : "", hwaddr ? ")" : "");
 }
 
+/*
+ * Restrict the socket to replies about the addresses under verification
+ */
+static void
+ni_arp_verify_set_filter(ni_arp_socket_t *sock, const ni_arp_verify_t *vfy)
+{
+	struct in_addr *sips;
+	unsigned int i, count;
+	ni_address_t *ap;
+
+	sips = xcalloc(vfy->ipaddrs.count + 1, sizeof(*sips));
+	for (count = 0, i = 0; i < vfy->ipaddrs.count; ++i) {
+		ap = vfy->ipaddrs.data[i];
+
+		if (ni_address_is_duplicate(ap) || !ni_address_is_tentative(ap))
+			continue;
+
+		sips[count++] = ni_arp_address_ip(ap);
+	}
+	ni_capture_set_arp_filter(sock->capture, sips, count);
+	free(sips);
+}
+
 ni_bool_t
 ni_arp_verify_send(ni_arp_socket_t *sock, ni_arp_verify_t *vfy, unsigned int *timeout)
 {
 	static struct in_addr null = { 0 };
-	const struct in_addr *ip;
-	unsigned int i, count;
+	unsigned int i, burst;
 	struct timeval now;
 	ni_address_t *ap;
 
@@ -355,42 +478,57 @@ ni_arp_verify_send(ni_arp_socket_t *sock, ni_arp_verify_t *vfy, unsigned int *ti
 		return FALSE;
 
 	ni_timer_get_time(&now);
-	if ((*timeout = ni_arp_timeout_left(&vfy->started, &now, vfy->wait_ms)))
-		return TRUE;
+	if (!vfy->cursor) {
+		if ((*timeout = ni_arp_timeout_left(&vfy->started, &now, vfy->wait_ms)))
+			return TRUE;
+
+		if (!vfy->nprobes || !vfy->ipaddrs.count)
+			goto done;
 
-	if (vfy->nprobes && vfy->ipaddrs.count) {
-		vfy->started = now;
 		vfy->nprobes--;
+		vfy->sent = 0;
+		ni_arp_verify_set_filter(sock, vfy);
+	}
 
-		for (count = 0, i = 0; i < vfy->ipaddrs.count; ++i) {
-			ap = vfy->ipaddrs.data[i];
+	for (burst = 0; vfy->cursor < vfy->ipaddrs.count && burst < NI_ARP_SEND_BURST; ) {
+		ap = vfy->ipaddrs.data[vfy->cursor++];
 
-			if (ni_address_is_duplicate(ap))
-				continue;
+		if (ni_address_is_duplicate(ap))
+			continue;
 
-			if (!ni_address_is_tentative(ap))
-				continue;
+		if (!ni_address_is_tentative(ap))
+			continue;
 
-			ni_debug_application("%s: sending arp verify for IP %s",
-					sock->dev_info.ifname,
-					ni_sockaddr_print(&ap->local_addr));
+		ni_debug_application("%s: sending arp verify for IP %s",
+				sock->dev_info.ifname,
+				ni_sockaddr_print(&ap->local_addr));
 
-			ip = &ap->local_addr.sin.sin_addr;
-			if (ni_arp_send_request(sock, null, *ip) > 0)
-				count++;
-		}
-		if (count) {
-			*timeout = vfy->wait_ms;
-			return TRUE;
-		}
+		burst++;
+		if (ni_arp_send_request(sock, null, ni_arp_address_ip(ap)) > 0)
+			vfy->sent++;
+	}
+	if (vfy->cursor < vfy->ipaddrs.count) {
+		*timeout = NI_ARP_SEND_PACE;
+		return TRUE;
 	}
 
-	for (count = 0, i = 0; i < vfy->ipaddrs.count; ++i) {
+	/* The wait for replies starts when all probes of the round are out */
+	vfy->cursor = 0;
+	vfy->started = now;
+	if (vfy->sent) {
+		*timeout = vfy->wait_ms;
+		return TRUE;
+	}
+
+done:
+	for (i = 0; i < vfy->ipaddrs.count; ++i) {
 		ap = vfy->ipaddrs.data[i];
 
 		if (ni_address_is_tentative(ap))
 			ni_address_set_tentative(ap, FALSE);
 	}
+	/* the socket is kept for later runs, let it receive all arp again */
+	ni_capture_set_arp_filter(sock->capture, NULL, 0);
 
 	return FALSE;
 }
@@ -408,45 +546,34 @@ ni_arp_notify_reset(ni_arp_notify_t *nfy,  unsigned int nclaims, unsigned int wa
 {
 	nfy->nclaims = nclaims;
 	nfy->wait_ms = wait_ms;
+	nfy->cursor = 0;
+	nfy->sent = 0;
 	timerclear(&nfy->started);
 	ni_address_array_destroy(&nfy->ipaddrs);
+	ni_arp_address_index_destroy(&nfy->index);
 }
 
 void
 ni_arp_notify_destroy(ni_arp_notify_t *nfy)
 {
 	ni_address_array_destroy(&nfy->ipaddrs);
+	ni_arp_address_index_destroy(&nfy->index);
 	memset(nfy, 0, sizeof(*nfy));
 }
 
 unsigned int
 ni_arp_notify_add_address(ni_arp_notify_t *nfy,  ni_address_t *ap)
 {
-	ni_address_t *ref;
-
 	if (!nfy || !ap || !nfy->nclaims)
 		return 0;
 
-	if (ap->family != AF_INET || !ni_sockaddr_is_ipv4_specified(&ap->local_addr))
-		return 0;
-
-	if (ni_address_array_find_match(&nfy->ipaddrs, ap, NULL, ni_address_equal_local_addr))
-		return 0;	/* already have it */
-
-	ref = ni_address_ref(ap);
-	if (!ref || !ni_address_array_append(&nfy->ipaddrs, ref)) {
-		ni_address_free(ref);
-		return 0;
-	}
-
-	return nfy->ipaddrs.count;
+	return ni_arp_address_set_add(&nfy->ipaddrs, &nfy->index, ap);
 }
 
 ni_bool_t
 ni_arp_notify_send(ni_arp_socket_t *sock, ni_arp_notify_t *nfy, unsigned int *timeout)
 {
-	const struct in_addr *ip;
-	unsigned int i, count;
+	unsigned int burst;
 	struct timeval now;
 	ni_address_t *ap;
 
@@ -454,36 +581,45 @@ ni_arp_notify_send(ni_arp_socket_t *sock, ni_arp_notify_t *nfy, unsigned int *ti
 		return FALSE;
 
 	ni_timer_get_time(&now);
-	if ((*timeout = ni_arp_timeout_left(&nfy->started, &now, nfy->wait_ms)))
-		return TRUE;
+	if (!nfy->cursor) {
+		if ((*timeout = ni_arp_timeout_left(&nfy->started, &now, nfy->wait_ms)))
+			return TRUE;
+
+		if (!nfy->nclaims || !nfy->ipaddrs.count)
+			return FALSE;
 
-	if (nfy->nclaims && nfy->ipaddrs.count) {
-		nfy->started = now;
 		nfy->nclaims--;
+		nfy->sent = 0;
+	}
 
-		for (count = 0, i = 0; i < nfy->ipaddrs.count; ++i) {
-			ap = nfy->ipaddrs.data[i];
+	for (burst = 0; nfy->cursor < nfy->ipaddrs.count && burst < NI_ARP_SEND_BURST; ) {
+		ap = nfy->ipaddrs.data[nfy->cursor++];
 
-			if (ni_address_is_duplicate(ap))
-				continue;
+		if (ni_address_is_duplicate(ap))
+			continue;
 
-			if (ni_address_is_tentative(ap))
-				continue;
+		if (ni_address_is_tentative(ap))
+			continue;
 
-			ni_debug_application("%s: sending arp notify for IP %s",
-					sock->dev_info.ifname,
-					ni_sockaddr_print(&ap->local_addr));
+		ni_debug_application("%s: sending arp notify for IP %s",
+				sock->dev_info.ifname,
+				ni_sockaddr_print(&ap->local_addr));
 
-			ip = &ap->local_addr.sin.sin_addr;
-			if (ni_arp_send_grat_request(sock, *ip) > 0)
-				count++;
-		}
-		if (count) {
-			*timeout = nfy->wait_ms;
-			return TRUE;
-		}
+		burst++;
+		if (ni_arp_send_grat_request(sock, ni_arp_address_ip(ap)) > 0)
+			nfy->sent++;
+	}
+	if (nfy->cursor < nfy->ipaddrs.count) {
+		*timeout = NI_ARP_SEND_PACE;
+		return TRUE;
+	}
+
+	nfy->cursor = 0;
+	nfy->started = now;
+	if (nfy->sent) {
+		*timeout = nfy->wait_ms;
+		return TRUE;
 	}
 
 	return FALSE;
 }
-
@@ -52,6 +52,7 @@ static const ni_intmap_t	__map_kern_mode[] = {
 	{ "balance-alb",	NI_BOND_MODE_BALANCE_ALB   },
 	{ NULL }
 };
+static ni_intmap_index_t	__index_kern_mode = NI_INTMAP_INDEX_INIT(__map_kern_mode);
 static const ni_intmap_t	__map_kern_arp_validate[] = {
 	{ "none",		NI_BOND_ARP_VALIDATE_NONE   },
 	{ "active",		NI_BOND_ARP_VALIDATE_ACTIVE },
@@ -114,6 +115,7 @@ static const ni_intmap_t	__map_user_mode[] = {
 	{ "balance-alb",	NI_BOND_MODE_BALANCE_ALB   },
 	{ NULL }
 };
+static ni_intmap_index_t	__index_user_mode = NI_INTMAP_INDEX_INIT(__map_user_mode);
 /*
  * The kernel's xmit hash policies contain a + character.
  */
@@ -717,7 +719,7 @@ __ni_bonding_set_module_option_mode(ni_bonding_t *bonding, char *value)
 	/* When we parse /sys/net/class/<ifname>/bonding/mode, we end up
 	 * with "balance-rr 0" or similar; strip off the int value */
 	value[strcspn(value, " \t\n")] = '\0';
-	rv = ni_parse_uint_mapped(value, __map_kern_mode, &bonding->mode);
+	rv = ni_parse_uint_indexed(value, &__index_kern_mode, &bonding->mode);
 	if (rv < 0)
 		ni_error("bonding: kernel reports unknown mode \"%s\"", value);
 	return rv;
@@ -728,7 +730,7 @@ __ni_bonding_get_module_option_mode(const ni_bonding_t *bonding, char *buffer, s
 {
 	const char *name;
 
-	name = ni_format_uint_mapped(bonding->mode, __map_kern_mode);
+	name = ni_format_uint_indexed(bonding->mode, &__index_kern_mode);
 	if (name == NULL) {
 		ni_error("bonding: unsupported bonding mode %u", bonding->mode);
 		return -1;
@@ -741,7 +743,7 @@ __ni_bonding_get_module_option_mode(const ni_bonding_t *bonding, char *buffer, s
 const char *
 ni_bonding_mode_type_to_name(unsigned int mode)
 {
-	return ni_format_uint_mapped(mode, __map_user_mode);
+	return ni_format_uint_indexed(mode, &__index_user_mode);
 }
 
 int
@@ -749,7 +751,7 @@ ni_bonding_mode_name_to_type(const char *name)
 {
 	unsigned int value;
 
-	if (ni_parse_uint_maybe_mapped(name, __map_user_mode, &value, 10) != 0)
+	if (ni_parse_uint_maybe_indexed(name, &__index_user_mode, &value, 10) != 0)
 		return -1;
 	return value;
 }
@@ -1392,8 +1394,8 @@ ni_bonding_set_option(ni_bonding_t *bond, const char *option, const char *value)
 		return FALSE;
 
 	if (strcmp(option, "mode") == 0) {
-		if (ni_parse_uint_maybe_mapped(value,
-				__map_kern_mode, &tmp, 10) != 0)
+		if (ni_parse_uint_maybe_indexed(value,
+				&__index_kern_mode, &tmp, 10) != 0)
 			return FALSE;
 
 		bond->mode = tmp;
@@ -24,6 +24,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -40,12 +41,19 @@
 #include <netpacket/packet.h>
 #endif
 
+#if defined(PACKET_RX_RING) && defined(TPACKET3_HDRLEN)
+#include <sys/mman.h>
+#define NI_CAPTURE_RX_RING	1
+#endif
+
 #include <wicked/logging.h>
 #include <wicked/socket.h>
 #include "netinfo_priv.h"
 #include "socket_priv.h"
+#include "appconfig.h"
 #include "modprobe.h"
 #include "buffer.h"
+#include "checksum.h"
 
 #define MTU_MAX			1500
 #define DHCP_CLIENT_PORT	68
@@ -54,6 +62,12 @@
 # define ETHERTYPE_LLDP		0x88CC
 #endif
 
+#define NI_CAPTURE_RX_RING_FRAMES	4	/* min. frames per ring block */
+#define NI_CAPTURE_SHARED_MTU		9216	/* shared socket buffer size */
+#define NI_CAPTURE_SHARED_HASH_MIN	64
+#define NI_CAPTURE_SHARED_RCVBUF	(4 * 1024 * 1024)
+#define NI_CAPTURE_SHARED_BATCH		64	/* packets per wakeup */
+
 #define	AFPACKET_MODULE_NAME	"af_packet"
 #define AFPACKET_MODULE_OPTS	NULL
 
@@ -73,29 +87,33 @@ struct tpacket_auxdata {
 /*
  * Credit where credit is due :)
  * The below BPF filter is taken from ISC DHCP
+ *
+ * It is used as the head of the generated filters: packets which
+ * passed all the tests continue after its last instruction, with
+ * the IP header length in the X register.
  */
-static struct bpf_insn std_ipv4_bpf_filter [] = {
+static const struct bpf_insn std_ipv4_bpf_filter [] = {
 	/* Make sure it's a UDP packet... */
 	BPF_STMT(BPF_LD + BPF_B + BPF_ABS, 9),
-	BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, IPPROTO_UDP, 0, 6),
+	BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, IPPROTO_UDP, 0, 5),
 
 	/* Make sure this isn't a fragment... */
 	BPF_STMT(BPF_LD + BPF_H + BPF_ABS, 6),
-	BPF_JUMP(BPF_JMP + BPF_JSET + BPF_K, 0x1fff, 4, 0),
+	BPF_JUMP(BPF_JMP + BPF_JSET + BPF_K, 0x1fff, 3, 0),
 
 	/* Get the IP header length... */
 	BPF_STMT(BPF_LDX + BPF_B + BPF_MSH, 0),
 
 	/* Make sure it's to the right port... */
 	BPF_STMT(BPF_LD + BPF_H + BPF_IND, 2),
-	BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, DHCP_CLIENT_PORT, 0, 1),
-
-	/* If we passed all the tests, ask for the whole packet. */
-	BPF_STMT(BPF_RET + BPF_K, ~0U),
+	BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, DHCP_CLIENT_PORT, 1, 0),
 
 	/* Otherwise, drop it. */
 	BPF_STMT(BPF_RET + BPF_K, 0),
 };
+#define STD_IPV4_BPF_FILTER_LEN		(sizeof(std_ipv4_bpf_filter) / sizeof(std_ipv4_bpf_filter[0]))
+#define STD_IPV4_BPF_FILTER_PROTO	1
+#define STD_IPV4_BPF_FILTER_PORT	6
 
 /*
  * Wrap sockaddr_ll same to ni_sockaddr_t,
@@ -117,68 +135,83 @@ struct ni_capture {
 	ni_socket_t *		sock;
 	ni_packetaddr_t		addr;
 	int			protocol;
+	uint8_t			ip_protocol;
+	uint16_t		ip_port;
+
+	/* Current udp payload matches of the filter */
+	unsigned int		nmatch;
+	ni_capture_match_t	match[NI_CAPTURE_MATCH_MAX];
 
 	char *			ifname;
 
 	void *			buffer;
 	size_t			mtu;
 
+	/*
+	 * TPACKET_V3 receive ring; the kernel fills whole blocks
+	 * of frames, which we hand out in place one by one and
+	 * return to the kernel when all of them were consumed.
+	 */
+	struct {
+		unsigned char *		map;
+		size_t			size;
+		unsigned int		block_size;
+		unsigned int		block_nr;
+
+		unsigned int		block;
+		unsigned int		released;
+		unsigned int		count;
+		unsigned char *		frame;
+		ni_bool_t		owned;
+	} ring;
+
+	void			(*receive)(ni_socket_t *);
+
+	/*
+	 * Shared capture; a single unbound socket (the master) receives
+	 * the packets for all member captures of the same protocol and
+	 * dispatches them by interface index.
+	 */
+	struct {
+		ni_capture_t *		master;
+		ni_capture_t *		next;
+		unsigned int		ifindex;
+
+		unsigned int		refcount;
+		unsigned int		count;
+		unsigned int		size;
+		ni_capture_t **		hash;
+		struct bpf_insn *	filter;
+		unsigned int		filter_len;
+		ni_bool_t		dirty;
+		ni_bool_t		drained;
+		unsigned int		unlinked;
+	} shared;
+
+	/* Packet passed from the master to a member */
+	struct {
+		void *			data;
+		ssize_t			bytes;
+		ni_bool_t		partial_csum;
+		ni_sockaddr_t		from;
+	} packet;
+
 	struct {
 		struct timeval		deadline;
 		const ni_buffer_t *	buffer;
 		ni_timeout_param_t	timeout;
 	} retrans;
 
+	/* Set while the retransmit callback runs, which may free us */
+	ni_bool_t *		freed;
+
 	void *			user_data;
 };
 
 static int		ni_capture_set_filter(ni_capture_t *, const ni_capture_protinfo_t *);
+static void		__ni_capture_shared_recv(ni_socket_t *);
 static ssize_t		__ni_capture_send(const ni_capture_t *, const ni_buffer_t *);
 
-static uint32_t
-checksum_partial(uint32_t sum, const void *data, uint16_t len)
-{
-	union {
-		const uint16_t *s;
-		const uint8_t *c;
-	} u;
-
-	u.s = data;
-	while (len > 1) {
-		sum += *u.s++;
-		len -= 2;
-	}
-
-	if (len == 1) {
-		union {
-			uint8_t c[2];
-			uint16_t s;
-		} bs;
-		bs.c[0] = u.c[0];
-		bs.c[1] = 0;
-		sum += bs.s;
-	}
-	return sum;
-}
-
-static inline uint16_t
-checksum_fold(uint32_t sum)
-{
-	sum = (sum >> 16) + (sum & 0xffff);
-	sum +=(sum >> 16);
-
-	return ~sum;
-}
-
-static uint16_t
-checksum(const void *data, uint16_t length)
-{
-	uint32_t sum;
-
-	sum = checksum_partial(0, data, length);
-	return checksum_fold(sum);
-}
-
 static uint16_t
 ipudp_checksum(const struct ip *iph, const struct udphdr *uhp,
 		const void *data, size_t length)
@@ -198,11 +231,16 @@ ipudp_checksum(const struct ip *iph, const struct udphdr *uhp,
 	bs.c[0] = 0;
 	bs.c[1] = IPPROTO_UDP;
 
-	csum = checksum_partial(bs.s + uh.uh_ulen, &iph->ip_src, 2* sizeof(iph->ip_src));
-	csum = checksum_partial(csum, data, length);
-	csum = checksum_partial(csum, &uh, sizeof(uh));
+	/*
+	 * The sum does not depend on the order of the words; the payload
+	 * comes last as ni_checksum_partial permits an odd length in the
+	 * last chunk only.
+	 */
+	csum = ni_checksum_partial(bs.s + uh.uh_ulen, &iph->ip_src, 2* sizeof(iph->ip_src));
+	csum = ni_checksum_partial(csum, &uh, sizeof(uh));
+	csum = ni_checksum_partial(csum, data, length);
 
-	return checksum_fold(csum);
+	return ni_checksum_fold(csum);
 }
 
 int
@@ -253,7 +291,7 @@ ni_capture_build_udp_header(ni_buffer_t *bp,
 	ip->ip_sum = 0;
 
 	/* Finally, do the checksums */
-	ip->ip_sum = checksum( ip, sizeof(*ip));
+	ip->ip_sum = ni_checksum(ip, sizeof(*ip));
 	udp->uh_sum = ipudp_checksum(ip, udp, payload, payload_len);
 
 	return 0;
@@ -279,7 +317,7 @@ ni_capture_inspect_udp_header(void *data, size_t bytes, size_t *payload_len,
 		return NULL;
 	}
 
-	if (checksum(iph, ihl) != 0) {
+	if (ni_checksum(iph, ihl) != 0) {
 		ni_debug_socket("bad IP header checksum, ignoring");
 		return NULL;
 	}
@@ -354,6 +392,7 @@ ni_capture_force_retransmit(ni_capture_t *capture, unsigned int delay)
 static void
 ni_capture_retransmit(ni_capture_t *capture)
 {
+	ni_bool_t freed = FALSE;
 	int rv;
 
 	ni_debug_socket("%s: retransmit request", capture->ifname);
@@ -367,8 +406,13 @@ ni_capture_retransmit(ni_capture_t *capture)
 	if (!ni_timeout_recompute(&capture->retrans.timeout))
 		return;
 
-	if (capture->retrans.timeout.timeout_callback)
+	if (capture->retrans.timeout.timeout_callback) {
+		capture->freed = &freed;
 		capture->retrans.timeout.timeout_callback(capture->retrans.timeout.timeout_data);
+		if (freed)
+			return;
+		capture->freed = NULL;
+	}
 
 	rv = __ni_capture_send(capture, capture->retrans.buffer);
 
@@ -419,7 +463,7 @@ __ni_capture_socket_check_timeout(ni_socket_t *sock, const struct timeval *now)
  * Capture receive handling
  */
 int
-__ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_sockaddr_t *from)
+__ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_sockaddr_t *from, int flags)
 {
 #if defined(PACKET_AUXDATA)
 	/* use 2 times bigger buffer to catch possible additions... */
@@ -445,9 +489,12 @@ __ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_soc
 	if (from)
 		memset(from, 0, sizeof(*from));
 
-	if ((bytes = recvmsg (fd, &msg, 0)) < 0)
+	if ((bytes = recvmsg (fd, &msg, flags)) < 0)
 		return bytes;
 
+	if (msg.msg_flags & MSG_TRUNC)
+		ni_debug_socket("received packet truncated to %zd bytes", bytes);
+
 	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
 		if (cmsg->cmsg_level == SOL_PACKET &&
 		    cmsg->cmsg_type == PACKET_AUXDATA &&
@@ -463,10 +510,309 @@ __ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_soc
 #else
 	*partial_csum = FALSE;
 
-	return read(fd, buf, len);
+	return recv(fd, buf, len, flags);
 #endif
 }
 
+#if defined(NI_CAPTURE_RX_RING)
+/*
+ * TPACKET_V3 receive ring handling
+ */
+static inline struct tpacket_block_desc *
+__ni_capture_ring_block(const ni_capture_t *capture, unsigned int block)
+{
+	return (struct tpacket_block_desc *)(capture->ring.map +
+			(size_t)block * capture->ring.block_size);
+}
+
+static inline ni_bool_t
+__ni_capture_ring_block_ready(const ni_capture_t *capture, unsigned int block)
+{
+	const struct tpacket_block_desc *desc;
+
+	desc = __ni_capture_ring_block(capture, block);
+	return !!(*(volatile __u32 *)&desc->hdr.bh1.block_status & TP_STATUS_USER);
+}
+
+static void
+__ni_capture_ring_release(ni_capture_t *capture)
+{
+	struct tpacket_block_desc *desc;
+
+	desc = __ni_capture_ring_block(capture, capture->ring.block);
+
+	__sync_synchronize();
+	desc->hdr.bh1.block_status = TP_STATUS_KERNEL;
+	__sync_synchronize();
+
+	capture->ring.owned = FALSE;
+	capture->ring.frame = NULL;
+	capture->ring.count = 0;
+	capture->ring.block = (capture->ring.block + 1) % capture->ring.block_nr;
+	capture->ring.released++;
+}
+
+static void
+__ni_capture_ring_consumed(ni_capture_t *capture)
+{
+	if (capture->ring.owned && capture->ring.count == 0)
+		__ni_capture_ring_release(capture);
+}
+
+static ni_bool_t
+__ni_capture_ring_pending(const ni_capture_t *capture)
+{
+	unsigned int block = capture->ring.block;
+
+	if (!capture->ring.map)
+		return FALSE;
+
+	if (capture->ring.owned) {
+		if (capture->ring.count)
+			return TRUE;
+		block = (block + 1) % capture->ring.block_nr;
+	}
+	return __ni_capture_ring_block_ready(capture, block);
+}
+
+/*
+ * Return the next frame from the ring. The data is not copied, but
+ * points into the ring block, which is handed back to the kernel in
+ * the next call after its last frame has been consumed.
+ */
+static ssize_t
+__ni_capture_ring_recv(ni_capture_t *capture, void **data, ni_bool_t *partial_csum, ni_sockaddr_t *from)
+{
+	struct tpacket_block_desc *desc;
+	struct tpacket3_hdr *hdr;
+
+	__ni_capture_ring_consumed(capture);
+
+	while (!capture->ring.owned) {
+		if (!__ni_capture_ring_block_ready(capture, capture->ring.block)) {
+			errno = EAGAIN;
+			return -1;
+		}
+		__sync_synchronize();
+
+		desc = __ni_capture_ring_block(capture, capture->ring.block);
+		capture->ring.owned = TRUE;
+		capture->ring.count = desc->hdr.bh1.num_pkts;
+		capture->ring.frame = (unsigned char *)desc + desc->hdr.bh1.offset_to_first_pkt;
+
+		if (capture->ring.count == 0)
+			__ni_capture_ring_release(capture);
+	}
+
+	hdr = (struct tpacket3_hdr *)capture->ring.frame;
+	if (--capture->ring.count)
+		capture->ring.frame += hdr->tp_next_offset;
+
+	*partial_csum = !!(hdr->tp_status & TP_STATUS_CSUMNOTREADY);
+	if (from) {
+		memset(from, 0, sizeof(*from));
+		memcpy(&from->ss, (unsigned char *)hdr + TPACKET_ALIGN(sizeof(*hdr)),
+				sizeof(struct sockaddr_ll));
+	}
+	if (hdr->tp_snaplen < hdr->tp_len) {
+		ni_debug_socket("%s: received packet truncated from %u to %u bytes",
+				capture->ifname, hdr->tp_len, hdr->tp_snaplen);
+	}
+
+	*data = (unsigned char *)hdr + hdr->tp_mac;
+	return hdr->tp_snaplen;
+}
+
+static ni_bool_t
+__ni_capture_ring_open(ni_capture_t *capture, const ni_config_packet_capture_t *conf, size_t min_size)
+{
+	int fd = capture->sock->__fd;
+	int version = TPACKET_V3;
+	struct tpacket_req3 req;
+	size_t frame_size, block_size;
+	void *map;
+
+	frame_size = TPACKET_ALIGN(TPACKET_ALIGN(TPACKET3_HDRLEN + 16) + capture->mtu);
+	block_size = getpagesize();
+	while (block_size < TPACKET_ALIGN(sizeof(struct tpacket_block_desc)) +
+				NI_CAPTURE_RX_RING_FRAMES * frame_size)
+		block_size <<= 1;
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = block_size;
+	req.tp_block_nr = conf->rx_ring_blocks;
+	if (req.tp_block_nr < min_size / block_size)
+		req.tp_block_nr = min_size / block_size;
+	req.tp_frame_size = frame_size;
+	req.tp_frame_nr = (block_size / frame_size) * req.tp_block_nr;
+	req.tp_retire_blk_tov = conf->rx_ring_timeout;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		ni_debug_socket("%s: cannot set TPACKET_V3 packet version: %m",
+				capture->ifname);
+		return FALSE;
+	}
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+		ni_debug_socket("%s: cannot setup packet rx ring: %m",
+				capture->ifname);
+		goto reset;
+	}
+
+	map = mmap(NULL, (size_t)block_size * req.tp_block_nr, PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		ni_debug_socket("%s: cannot map packet rx ring: %m",
+				capture->ifname);
+		memset(&req, 0, sizeof(req));
+		setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req));
+		goto reset;
+	}
+
+	capture->ring.map = map;
+	capture->ring.size = (size_t)block_size * req.tp_block_nr;
+	capture->ring.block_size = block_size;
+	capture->ring.block_nr = req.tp_block_nr;
+
+	ni_debug_socket("%s: using packet rx ring with %u blocks of %zu bytes",
+			capture->ifname, capture->ring.block_nr, block_size);
+	return TRUE;
+
+reset:
+	version = TPACKET_V1;
+	setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version));
+	return FALSE;
+}
+
+static void
+__ni_capture_ring_close(ni_capture_t *capture)
+{
+	if (capture->ring.map)
+		munmap(capture->ring.map, capture->ring.size);
+	memset(&capture->ring, 0, sizeof(capture->ring));
+}
+#else
+static inline void
+__ni_capture_ring_consumed(ni_capture_t *capture)
+{
+}
+
+static inline ni_bool_t
+__ni_capture_ring_pending(const ni_capture_t *capture)
+{
+	return FALSE;
+}
+
+static inline ssize_t
+__ni_capture_ring_recv(ni_capture_t *capture, void **data, ni_bool_t *partial_csum, ni_sockaddr_t *from)
+{
+	errno = EAGAIN;
+	return -1;
+}
+
+static inline ni_bool_t
+__ni_capture_ring_open(ni_capture_t *capture, const ni_config_packet_capture_t *conf, size_t min_size)
+{
+	return FALSE;
+}
+
+static inline void
+__ni_capture_ring_close(ni_capture_t *capture)
+{
+}
+#endif
+
+/*
+ * Fetch the next packet from the ring, the socket or the master
+ */
+static ssize_t
+__ni_capture_recv_packet(ni_capture_t *capture, void **packet, ni_bool_t *partial_csum, ni_sockaddr_t *from)
+{
+	ssize_t bytes;
+
+	if (capture->shared.master) {
+		if (!capture->packet.data) {
+			errno = EAGAIN;
+			return -1;
+		}
+
+		*packet = capture->packet.data;
+		*partial_csum = capture->packet.partial_csum;
+		if (from)
+			*from = capture->packet.from;
+		bytes = capture->packet.bytes;
+		memset(&capture->packet, 0, sizeof(capture->packet));
+		return bytes;
+	}
+
+	if (capture->ring.map) {
+		bytes = __ni_capture_ring_recv(capture, packet, partial_csum, from);
+
+		/* packets queued before the ring has been set up */
+		if (bytes < 0 && errno == EAGAIN) {
+			*packet = capture->buffer;
+			bytes = __ni_capture_recv(capture->sock->__fd, *packet,
+					capture->mtu, partial_csum, from,
+					MSG_DONTWAIT);
+		}
+		return bytes;
+	}
+
+	/* the shared socket is read until drained */
+	*packet = capture->buffer;
+	return __ni_capture_recv(capture->sock->__fd, *packet, capture->mtu,
+				partial_csum, from,
+				capture->receive == __ni_capture_shared_recv ?
+					MSG_DONTWAIT : 0);
+}
+
+/*
+ * Socket receive callback; dispatches all frames pending in the
+ * receive ring to the protocol receive callback, at most one full
+ * ring turn per wakeup to not starve other sockets.
+ * Without ring, the shared socket is read in batches of packets.
+ */
+static void
+__ni_capture_socket_recv(ni_socket_t *sock)
+{
+	ni_capture_t *capture = sock->user_data;
+	unsigned int released, batch;
+
+	if (!capture || !capture->receive) {
+		ni_error("capture socket without capture object?!");
+		return;
+	}
+
+	if (!capture->ring.map && capture->receive == __ni_capture_shared_recv) {
+		capture->shared.drained = FALSE;
+		for (batch = 0; batch < NI_CAPTURE_SHARED_BATCH; ++batch) {
+			capture->receive(sock);
+
+			if (sock->__fd < 0 || capture->shared.drained)
+				return;
+		}
+		return;
+	}
+
+	if (!capture->ring.map) {
+		capture->receive(sock);
+		return;
+	}
+
+	released = capture->ring.released;
+	do {
+		capture->receive(sock);
+
+		/* the receive callback may have closed the capture */
+		if (sock->__fd < 0)
+			return;
+	} while (__ni_capture_ring_pending(capture) &&
+		 capture->ring.released - released < capture->ring.block_nr);
+
+	/* the frames are processed, return a consumed block right away */
+	__ni_capture_ring_consumed(capture);
+}
+
 ni_bool_t
 ni_capture_from_hwaddr_set(ni_hwaddr_t *hwaddr, const ni_sockaddr_t *from)
 {
@@ -494,19 +840,26 @@ ni_capture_from_hwaddr_print(const ni_sockaddr_t *from)
 	return ni_link_address_print(&hwaddr);
 }
 
+/*
+ * Receive the next packet and initialize the reader buffer with
+ * its payload. The buffer data is owned by the capture and valid
+ * until the next ni_capture_recv call only.
+ */
 int
 ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, const char *hint)
 {
+	void *packet = NULL;
 	void *payload;
 	size_t payload_len;
 	ssize_t bytes;
 	ni_bool_t partial_checksum = FALSE;
 	const char *lladdr;
 
-	bytes = __ni_capture_recv(capture->sock->__fd, capture->buffer,
-				  capture->mtu, &partial_checksum, from);
-
+	bytes = __ni_capture_recv_packet(capture, &packet, &partial_checksum, from);
 	if (bytes < 0) {
+		if (errno == EAGAIN)
+			return -1;
+
 		ni_error("%s: %s cannot read %s%spacket from socket: %m",
 				capture->ifname, __FUNCTION__,
 				hint ? hint : "", hint ? " " : "");
@@ -522,7 +875,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 	switch (capture->protocol) {
 	case ETHERTYPE_IP:
 		/* Make sure IP and UDP header are sane */
-		payload = ni_capture_inspect_udp_header(capture->buffer, bytes,
+		payload = ni_capture_inspect_udp_header(packet, bytes,
 						&payload_len, partial_checksum);
 		if (payload == NULL) {
 			ni_debug_socket("%s: bad IP/UDP %s%spacket header",
@@ -534,7 +887,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 
 	case ETHERTYPE_ARP:
 	case ETHERTYPE_LLDP:
-		payload = capture->buffer;
+		payload = packet;
 		payload_len = bytes;
 		break;
 
@@ -663,6 +1016,12 @@ __ni_capture_enable_packet_auxdata(int fd)
 #endif
 }
 
+static const ni_config_packet_capture_t *
+__ni_capture_config(void)
+{
+	return ni_global.config ? &ni_global.config->packet_capture : NULL;
+}
+
 static void
 __ni_capture_init_once(void)
 {
@@ -676,10 +1035,514 @@ __ni_capture_init_once(void)
 	ni_modprobe(AFPACKET_MODULE_NAME, AFPACKET_MODULE_OPTS);
 }
 
+/*
+ * Filter generation
+ */
+static unsigned int
+__ni_capture_filter_head(struct bpf_insn *insns, uint8_t ip_protocol, uint16_t ip_port)
+{
+	memcpy(insns, std_ipv4_bpf_filter, sizeof(std_ipv4_bpf_filter));
+	insns[STD_IPV4_BPF_FILTER_PROTO].k = ip_protocol;
+	insns[STD_IPV4_BPF_FILTER_PORT].k = ip_port;
+	return STD_IPV4_BPF_FILTER_LEN;
+}
+
+static inline unsigned int
+__ni_capture_match_chunk(const ni_capture_match_t *match, unsigned int pos, unsigned int *value)
+{
+	const unsigned char *data = match->data + pos;
+
+	switch (match->len - pos) {
+	case 1:
+		*value = data[0];
+		return 1;
+	case 2:
+	case 3:
+		*value = (data[0] << 8) | data[1];
+		return 2;
+	default:
+		*value = (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+		return 4;
+	}
+}
+
+static unsigned int
+__ni_capture_filter_match_len(const ni_capture_match_t *match, unsigned int count)
+{
+	unsigned int i, pos, value, len = 0;
+
+	for (i = 0; i < count; ++i) {
+		for (pos = 0; pos < match[i].len; len += 2)
+			pos += __ni_capture_match_chunk(&match[i], pos, &value);
+	}
+	return len;
+}
+
+/*
+ * Compare the udp payload (at X + udp header) with the matches in
+ * chunks of up to 4 bytes. On mismatch, it jumps to the instruction
+ * at fail offset after the generated code.
+ */
+static unsigned int
+__ni_capture_filter_match(struct bpf_insn *insns, const ni_capture_match_t *match,
+			unsigned int count, unsigned int fail)
+{
+	static const unsigned int size[] = { 0, BPF_B, BPF_H, 0, BPF_W };
+	unsigned int total, i, pos, chunk, value, len = 0;
+
+	total = __ni_capture_filter_match_len(match, count);
+	for (i = 0; i < count; ++i) {
+		for (pos = 0; pos < match[i].len; pos += chunk) {
+			chunk = __ni_capture_match_chunk(&match[i], pos, &value);
+
+			insns[len++] = (struct bpf_insn)BPF_STMT(BPF_LD + size[chunk] + BPF_IND,
+					sizeof(struct udphdr) + match[i].offset + pos);
+			insns[len] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					value, 0, total - len - 1 + fail);
+			len++;
+		}
+	}
+	return len;
+}
+
+/*
+ * Shared capture handling
+ */
+static ni_capture_t *		__ni_capture_shared_list;
+
+static ni_capture_t *
+__ni_capture_shared_find(const ni_capture_t *master, unsigned int ifindex)
+{
+	ni_capture_t *capture;
+
+	if (!master->shared.size)
+		return NULL;
+
+	capture = master->shared.hash[ifindex & (master->shared.size - 1)];
+	for ( ; capture; capture = capture->shared.next) {
+		if (capture->shared.ifindex == ifindex)
+			return capture;
+	}
+	return NULL;
+}
+
+static void
+__ni_capture_shared_rehash(ni_capture_t *master, unsigned int size)
+{
+	ni_capture_t **hash, *capture, *next;
+	unsigned int i, slot;
+
+	hash = xcalloc(size, sizeof(*hash));
+	for (i = 0; i < master->shared.size; ++i) {
+		for (capture = master->shared.hash[i]; capture; capture = next) {
+			next = capture->shared.next;
+			slot = capture->shared.ifindex & (size - 1);
+			capture->shared.next = hash[slot];
+			hash[slot] = capture;
+		}
+	}
+	free(master->shared.hash);
+	master->shared.hash = hash;
+	master->shared.size = size;
+}
+
+static void
+__ni_capture_shared_link(ni_capture_t *master, ni_capture_t *capture)
+{
+	unsigned int slot;
+
+	if (master->shared.count >= master->shared.size) {
+		__ni_capture_shared_rehash(master, master->shared.size ?
+				master->shared.size << 1 : NI_CAPTURE_SHARED_HASH_MIN);
+	}
+
+	slot = capture->shared.ifindex & (master->shared.size - 1);
+	capture->shared.next = master->shared.hash[slot];
+	master->shared.hash[slot] = capture;
+	master->shared.count++;
+}
+
+static void
+__ni_capture_shared_unlink(ni_capture_t *master, ni_capture_t *capture)
+{
+	ni_capture_t **pos;
+
+	if (!master->shared.size)
+		return;
+
+	pos = &master->shared.hash[capture->shared.ifindex & (master->shared.size - 1)];
+	for ( ; *pos; pos = &(*pos)->shared.next) {
+		if (*pos == capture) {
+			*pos = capture->shared.next;
+			capture->shared.next = NULL;
+			master->shared.count--;
+			master->shared.unlinked++;
+			return;
+		}
+	}
+}
+
+/*
+ * The socket of a pure link layer protocol receives its ethertype only,
+ * ip based protocols are checked as in std_ipv4_bpf_filter first.
+ */
+static unsigned int
+__ni_capture_shared_filter_head(const ni_capture_t *master, struct bpf_insn *insns)
+{
+	if (master->protocol != ETHERTYPE_IP)
+		return 0;
+	return __ni_capture_filter_head(insns, master->ip_protocol, master->ip_port);
+}
+
+/*
+ * The shared filter checks the protocol and port as std_ipv4_bpf_filter,
+ * followed by a block for each member, matching its interface index and
+ * its udp payload matches. When it is too large for the kernel, a compact
+ * variant matches the interface index only, or everything is accepted
+ * and demultiplexed in user space only.
+ */
+static unsigned int
+__ni_capture_shared_build_filter(ni_capture_t *master, struct bpf_insn *insns, ni_bool_t compact)
+{
+	unsigned int len, i, n;
+	ni_capture_t *capture;
+
+	len = __ni_capture_shared_filter_head(master, insns);
+#if defined(SKF_AD_IFINDEX)
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_LD + BPF_W + BPF_ABS,
+						SKF_AD_OFF + SKF_AD_IFINDEX);
+	for (i = 0; i < master->shared.size; ++i) {
+		capture = master->shared.hash[i];
+		for ( ; capture; capture = capture->shared.next) {
+			n = compact ? 0 : __ni_capture_filter_match_len(capture->match, capture->nmatch);
+			if (n == 0) {
+				insns[len++] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+							capture->shared.ifindex, 0, 1);
+				insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, ~0U);
+				continue;
+			}
+
+			insns[len++] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+							capture->shared.ifindex, 0, n + 2);
+			len += __ni_capture_filter_match(insns + len,
+							capture->match, capture->nmatch, 1);
+			insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, ~0U);
+			insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, 0);
+		}
+	}
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, 0);
+#else
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, ~0U);
+#endif
+	return len;
+}
+
+static int
+__ni_capture_shared_set_filter(ni_capture_t *master)
+{
+	unsigned int len, i, pass;
+	struct bpf_insn *insns;
+	ni_capture_t *capture;
+	struct sock_fprog pf;
+	int ret = -1;
+
+	len = STD_IPV4_BPF_FILTER_LEN + 2;
+	for (i = 0; i < master->shared.size; ++i) {
+		capture = master->shared.hash[i];
+		for ( ; capture; capture = capture->shared.next)
+			len += 3 + __ni_capture_filter_match_len(capture->match, capture->nmatch);
+	}
+	insns = xcalloc(len, sizeof(*insns));
+
+	memset(&pf, 0, sizeof(pf));
+	pf.filter = insns;
+	for (pass = 0; pass < 3 && ret < 0; ++pass) {
+		if (pass < 2) {
+			pf.len = __ni_capture_shared_build_filter(master, insns, pass > 0);
+		} else {
+			pf.len = __ni_capture_shared_filter_head(master, insns);
+			insns[pf.len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, ~0U);
+		}
+#if defined(BPF_MAXINSNS)
+		if (pf.len > BPF_MAXINSNS)
+			continue;
+#endif
+		/* e.g. the compact or accept-all program does not change with the matches */
+		if (master->shared.filter && master->shared.filter_len == pf.len &&
+		    !memcmp(master->shared.filter, insns, pf.len * sizeof(*insns)))
+			ret = 0;
+		else if (setsockopt(master->sock->__fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) == 0)
+			ret = 1;
+		else if (errno != ENOMEM || pass == 2)
+			break;
+	}
+
+	if (ret < 0) {
+		ni_error("%s: SO_ATTACH_FILTER: %m", master->ifname);
+		free(insns);
+		return ret;
+	}
+
+	master->shared.dirty = FALSE;
+	if (ret > 0) {
+		free(master->shared.filter);
+		master->shared.filter = insns;
+		master->shared.filter_len = pf.len;
+	} else {
+		free(insns);
+	}
+	return 0;
+}
+
+static void
+__ni_capture_shared_release(ni_capture_t *master)
+{
+	ni_capture_t **pos;
+
+	ni_assert(master->shared.refcount);
+	if (--master->shared.refcount)
+		return;
+
+	for (pos = &__ni_capture_shared_list; *pos; pos = &(*pos)->shared.next) {
+		if (*pos == master) {
+			*pos = master->shared.next;
+			break;
+		}
+	}
+	ni_capture_free(master);
+}
+
+/*
+ * Receive callback of the master socket. The protocol receive callback
+ * of the member is called with the socket user data pointing to the
+ * member capture, so its ni_capture_recv call returns the packet.
+ */
+static void
+__ni_capture_shared_recv(ni_socket_t *sock)
+{
+	ni_capture_t *master = sock->user_data;
+	const struct sockaddr_ll *sll;
+	ni_capture_t *capture;
+	ni_bool_t partial_csum = FALSE;
+	ni_sockaddr_t from;
+	void *packet = NULL;
+	ssize_t bytes;
+
+	bytes = __ni_capture_recv_packet(master, &packet, &partial_csum, &from);
+	if (bytes < 0) {
+		if (errno != EAGAIN)
+			ni_error("%s: cannot read packet from socket: %m", master->ifname);
+		master->shared.drained = TRUE;
+		return;
+	}
+
+	sll = (const struct sockaddr_ll *)&from.ss;
+	if (!(capture = __ni_capture_shared_find(master, sll->sll_ifindex))) {
+		ni_debug_socket("%s: ignoring packet for interface index %d",
+				master->ifname, sll->sll_ifindex);
+		return;
+	}
+
+	capture->packet.data = packet;
+	capture->packet.bytes = bytes;
+	capture->packet.partial_csum = partial_csum;
+	capture->packet.from = from;
+
+	/* the callback may free the member and with it the master */
+	master->shared.refcount++;
+	sock->user_data = capture;
+	capture->receive(sock);
+	sock->user_data = master;
+	__ni_capture_shared_release(master);
+}
+
+static int
+__ni_capture_shared_get_timeout(const ni_socket_t *sock, struct timeval *tv)
+{
+	ni_capture_t *master, *capture;
+	unsigned int i;
+
+	if (!(master = sock->user_data)) {
+		ni_error("capture socket without capture object?!");
+		return -1;
+	}
+
+	/* Apply deferred filter updates once per main loop iteration */
+	if (master->shared.dirty)
+		__ni_capture_shared_set_filter(master);
+
+	timerclear(tv);
+	for (i = 0; i < master->shared.size; ++i) {
+		capture = master->shared.hash[i];
+		for ( ; capture; capture = capture->shared.next) {
+			const struct timeval *deadline = &capture->retrans.deadline;
+
+			if (timerisset(deadline) && (!timerisset(tv) || timercmp(deadline, tv, <)))
+				*tv = *deadline;
+		}
+	}
+	return timerisset(tv)? 0 : -1;
+}
+
+static void
+__ni_capture_shared_check_timeout(ni_socket_t *sock, const struct timeval *now)
+{
+	ni_capture_t *master, *capture, *next;
+	unsigned int i, unlinked;
+
+	if (!(master = sock->user_data)) {
+		ni_error("capture socket without capture object?!");
+		return;
+	}
+
+	/*
+	 * The retransmit callback may close any member, not only its own
+	 * one, so the saved next pointer is valid as long as no member has
+	 * been unlinked meanwhile; otherwise rescan, the members already
+	 * retransmitted are rearmed to a later deadline. Closing the last
+	 * member frees the master, so keep it until the walk is done.
+	 */
+	master->shared.refcount++;
+restart:
+	unlinked = master->shared.unlinked;
+	for (i = 0; i < master->shared.size; ++i) {
+		for (capture = master->shared.hash[i]; capture; capture = next) {
+			next = capture->shared.next;
+
+			if (!timerisset(&capture->retrans.deadline) ||
+			    !timercmp(&capture->retrans.deadline, now, <))
+				continue;
+
+			ni_capture_retransmit(capture);
+			if (unlinked != master->shared.unlinked)
+				goto restart;
+		}
+	}
+	__ni_capture_shared_release(master);
+}
+
+static ni_capture_t *
+__ni_capture_shared_get(const ni_capture_protinfo_t *protinfo, const ni_config_packet_capture_t *conf)
+{
+	ni_capture_t *master;
+	int rcvbuf = NI_CAPTURE_SHARED_RCVBUF;
+	int fd;
+
+	for (master = __ni_capture_shared_list; master; master = master->shared.next) {
+		if (master->protocol == protinfo->eth_protocol &&
+		    master->ip_protocol == protinfo->ip_protocol &&
+		    master->ip_port == protinfo->ip_port &&
+		    !master->sock->error)
+			return master;
+	}
+
+	switch (protinfo->eth_protocol) {
+	case ETHERTYPE_LLDP:
+		break;
+	case ETHERTYPE_IP:
+		if (protinfo->ip_protocol != IPPROTO_UDP && protinfo->ip_protocol != IPPROTO_TCP)
+			return NULL;
+		break;
+	default:
+		return NULL;
+	}
+
+	if ((fd = socket (PF_PACKET, SOCK_DGRAM, htons(protinfo->eth_protocol))) < 0) {
+		ni_error("socket: %m");
+		return NULL;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	/* It queues the packets of all devices */
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0)
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	master = xcalloc(1, sizeof(*master));
+	if (protinfo->eth_protocol == ETHERTYPE_IP)
+		ni_string_printf(&master->ifname, "shared:%u", protinfo->ip_port);
+	else
+		ni_string_printf(&master->ifname, "shared:0x%04x", protinfo->eth_protocol);
+	master->sock = ni_socket_wrap(fd, SOCK_DGRAM);
+	master->protocol = protinfo->eth_protocol;
+	master->ip_protocol = protinfo->ip_protocol;
+	master->ip_port = protinfo->ip_port;
+
+	master->mtu = NI_CAPTURE_SHARED_MTU;
+	master->buffer = xmalloc(master->mtu);
+	if (conf->rx_ring)
+		__ni_capture_ring_open(master, conf, NI_CAPTURE_SHARED_RCVBUF);
+
+	if (__ni_capture_shared_set_filter(master) < 0) {
+		ni_capture_free(master);
+		return NULL;
+	}
+	__ni_capture_enable_packet_auxdata(fd);
+
+	master->receive = __ni_capture_shared_recv;
+	master->sock->receive = __ni_capture_socket_recv;
+	master->sock->get_timeout = __ni_capture_shared_get_timeout;
+	master->sock->check_timeout = __ni_capture_shared_check_timeout;
+	master->sock->user_data = master;
+	ni_socket_activate(master->sock);
+
+	master->shared.next = __ni_capture_shared_list;
+	__ni_capture_shared_list = master;
+	return master;
+}
+
+static ni_capture_t *
+__ni_capture_shared_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo,
+			const ni_config_packet_capture_t *conf, void (*receive)(ni_socket_t *))
+{
+	ni_capture_t *master, *capture;
+
+	if (!(master = __ni_capture_shared_get(protinfo, conf)))
+		return NULL;
+
+	if (__ni_capture_shared_find(master, devinfo->ifindex)) {
+		ni_debug_socket("%s: interface index %u already captured by %s",
+				devinfo->ifname, devinfo->ifindex, master->ifname);
+		return NULL;
+	}
+
+	capture = xcalloc(1, sizeof(*capture));
+	ni_string_dup(&capture->ifname, devinfo->ifname);
+	capture->sock = ni_socket_hold(master->sock);
+	capture->protocol = protinfo->eth_protocol;
+	capture->ip_protocol = protinfo->ip_protocol;
+	capture->ip_port = protinfo->ip_port;
+	capture->receive = receive;
+	capture->shared.master = master;
+	capture->shared.ifindex = devinfo->ifindex;
+
+	master->shared.refcount++;
+	__ni_capture_shared_link(master, capture);
+
+	/* Update filter immediately to not miss the replies */
+	if (__ni_capture_shared_set_filter(master) < 0) {
+		ni_capture_free(capture);
+		return NULL;
+	}
+	return capture;
+}
+
+static void
+__ni_capture_init_addr(ni_capture_t *capture, const ni_capture_devinfo_t *devinfo,
+			const ni_capture_protinfo_t *protinfo, const ni_hwaddr_t *destaddr)
+{
+	capture->addr.sll.sll_family = AF_PACKET;
+	capture->addr.sll.sll_protocol = htons(protinfo->eth_protocol);
+	capture->addr.sll.sll_ifindex = devinfo->ifindex;
+	capture->addr.sll.sll_hatype = htons(devinfo->hwaddr.type);
+	capture->addr.sll.sll_halen = destaddr->len;
+	memcpy(&capture->addr.sll.sll_addr, destaddr->data, destaddr->len);
+}
+
 ni_capture_t *
 ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo, void (*receive)(ni_socket_t *))
 {
 	ni_packetaddr_t	addr;
+	const ni_config_packet_capture_t *conf;
 	ni_capture_t *capture = NULL;
 	ni_hwaddr_t destaddr;
 	int fd = -1;
@@ -704,6 +1567,14 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 
 	__ni_capture_init_once();
 
+	/* Join the shared socket when permitted */
+	conf = __ni_capture_config();
+	if (protinfo->shared && conf && conf->shared &&
+	    (capture = __ni_capture_shared_open(devinfo, protinfo, conf, receive))) {
+		__ni_capture_init_addr(capture, devinfo, protinfo, &destaddr);
+		return capture;
+	}
+
 	if ((fd = socket (PF_PACKET, SOCK_DGRAM, htons(protinfo->eth_protocol))) < 0) {
 		ni_error("socket: %m");
 		return NULL;
@@ -716,13 +1587,20 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	ni_string_dup(&capture->ifname, devinfo->ifname);
 	capture->sock = ni_socket_wrap(fd, SOCK_DGRAM);
 	capture->protocol = protinfo->eth_protocol;
+	capture->ip_protocol = protinfo->ip_protocol;
+	capture->ip_port = protinfo->ip_port;
 
-	capture->addr.sll.sll_family = AF_PACKET;
-	capture->addr.sll.sll_protocol = htons(protinfo->eth_protocol);
-	capture->addr.sll.sll_ifindex = devinfo->ifindex;
-	capture->addr.sll.sll_hatype = htons(devinfo->hwaddr.type);
-	capture->addr.sll.sll_halen = destaddr.len;
-	memcpy(&capture->addr.sll.sll_addr, destaddr.data, destaddr.len);
+	/* Jumbo frames are sized by the device mtu */
+	capture->mtu = devinfo->mtu;
+	if (capture->mtu < MTU_MAX)
+		capture->mtu = MTU_MAX;
+	capture->buffer = xmalloc(capture->mtu);
+
+	/* Setup the ring before bind, to not queue packets meanwhile */
+	if (conf && conf->rx_ring)
+		__ni_capture_ring_open(capture, conf, 0);
+
+	__ni_capture_init_addr(capture, devinfo, protinfo, &destaddr);
 
 	if (ni_capture_set_filter(capture, protinfo) < 0)
 		goto failed;
@@ -739,12 +1617,8 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 
 	__ni_capture_enable_packet_auxdata(fd);
 
-	capture->mtu = devinfo->mtu;
-	if (capture->mtu == 0)
-		capture->mtu = MTU_MAX;
-	capture->buffer = xmalloc(capture->mtu);
-
-	capture->sock->receive = receive;
+	capture->receive = receive;
+	capture->sock->receive = __ni_capture_socket_recv;
 	capture->sock->get_timeout = __ni_capture_socket_get_timeout;
 	capture->sock->check_timeout = __ni_capture_socket_check_timeout;
 	capture->sock->user_data = capture;
@@ -759,13 +1633,39 @@ failed:
 }
 
 static int
-ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
+__ni_capture_set_udp_filter(ni_capture_t *cap)
 {
+	unsigned int len;
+	struct bpf_insn *insns;
 	struct sock_fprog pf;
+	int ret = 0;
+
+	len = STD_IPV4_BPF_FILTER_LEN + 2 + __ni_capture_filter_match_len(cap->match, cap->nmatch);
+	insns = xcalloc(len, sizeof(*insns));
+
+	len = __ni_capture_filter_head(insns, cap->ip_protocol, cap->ip_port);
+	len += __ni_capture_filter_match(insns + len, cap->match, cap->nmatch, 1);
+
+	/* If we passed all the tests, ask for the whole packet. */
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, ~0U);
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, 0);
 
-	/* Install the DHCP filter */
 	memset(&pf, 0, sizeof(pf));
+	pf.filter = insns;
+	pf.len = len;
+
+	if (setsockopt(cap->sock->__fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) < 0) {
+		ni_error("%s: SO_ATTACH_FILTER: %m", cap->ifname);
+		ret = -1;
+	}
+
+	free(insns);
+	return ret;
+}
 
+static int
+ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
+{
 	switch (protinfo->eth_protocol) {
 	case ETHERTYPE_ARP:
 	case ETHERTYPE_LLDP:
@@ -781,26 +1681,157 @@ ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
 			return -1;
 		}
 
-		std_ipv4_bpf_filter[1].k = protinfo->ip_protocol;
-		std_ipv4_bpf_filter[6].k = protinfo->ip_port;
-
-		pf.filter = std_ipv4_bpf_filter;
-		pf.len = sizeof(std_ipv4_bpf_filter) / sizeof(std_ipv4_bpf_filter[0]);
-		break;
+		/* Install the DHCP filter */
+		return __ni_capture_set_udp_filter(cap);
 
 	default:
 		ni_error("cannot build capture filter for ether type 0x%04x: not supported", protinfo->eth_protocol);
 		return -1;
 	}
+}
 
-	if (setsockopt(cap->sock->__fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) < 0) {
-		ni_error("SO_ATTACH_FILTER: %m");
+static ni_bool_t
+__ni_capture_match_eq(const ni_capture_match_t *a, const ni_capture_match_t *b)
+{
+	return a->offset == b->offset && a->len == b->len &&
+		!memcmp(a->data, b->data, a->len);
+}
+
+/*
+ * Restrict the udp filter of the capture to packets with the given
+ * data in the udp payload, e.g. the transaction id. The filter of the
+ * socket is replaced atomically; no matches reset it to the port only.
+ * The filter of a shared socket is updated in the next main loop pass.
+ */
+int
+ni_capture_set_match(ni_capture_t *capture, const ni_capture_match_t *match, unsigned int count)
+{
+	unsigned int i;
+
+	if (!capture || capture->protocol != ETHERTYPE_IP || count > NI_CAPTURE_MATCH_MAX)
 		return -1;
+
+	for (i = 0; i < count; ++i) {
+		if (!match[i].len || match[i].len > sizeof(match[i].data))
+			return -1;
 	}
 
+	if (count == capture->nmatch) {
+		for (i = 0; i < count; ++i) {
+			if (!__ni_capture_match_eq(&capture->match[i], &match[i]))
+				break;
+		}
+		if (i == count)
+			return 0;
+	}
+
+	memset(capture->match, 0, sizeof(capture->match));
+	memcpy(capture->match, match, count * sizeof(*match));
+	capture->nmatch = count;
+
+	/*
+	 * The shared filter covers all members; rebuild it once per main
+	 * loop iteration instead of once per member on a mass start.
+	 */
+	if (capture->shared.master) {
+		capture->shared.master->shared.dirty = TRUE;
+		return 0;
+	}
+	return __ni_capture_set_udp_filter(capture);
+}
+
+/*
+ * Restrict an arp capture to the packets with one of the given sender
+ * ip addresses, e.g. the addresses under duplicate address detection.
+ * The addresses are compared in a linear sequence of two instructions
+ * each, after a fixed head and before the final drop. The kernel limits
+ * a program to BPF_MAXINSNS instructions and charges it to the socket
+ * optmem; when the addresses exceed either, the filter is disabled.
+ * Without addresses, the socket receives all arp packets again, as
+ * before the first call.
+ */
+#define NI_CAPTURE_ARP_FILTER_HEAD	9
+#if defined(BPF_MAXINSNS)
+#define NI_CAPTURE_ARP_FILTER_MAX	((BPF_MAXINSNS - NI_CAPTURE_ARP_FILTER_HEAD - 1) / 2)
+#else
+#define NI_CAPTURE_ARP_FILTER_MAX	((4096 - NI_CAPTURE_ARP_FILTER_HEAD - 1) / 2)
+#endif
+
+static int
+__ni_capture_detach_filter(ni_capture_t *capture)
+{
+	struct sock_fprog pf;
+
+	memset(&pf, 0, sizeof(pf));
+	if (setsockopt(capture->sock->__fd, SOL_SOCKET, SO_DETACH_FILTER,
+				&pf, sizeof(pf)) < 0 && errno != ENOENT) {
+		ni_error("%s: SO_DETACH_FILTER: %m", capture->ifname);
+		return -1;
+	}
 	return 0;
 }
 
+int
+ni_capture_set_arp_filter(ni_capture_t *capture, const struct in_addr *sips, unsigned int count)
+{
+	struct bpf_insn *insns;
+	struct sock_fprog pf;
+	unsigned int i, len;
+	int ret = 0;
+
+	if (!capture || capture->protocol != ETHERTYPE_ARP || capture->shared.master)
+		return -1;
+
+	if (!count || count > NI_CAPTURE_ARP_FILTER_MAX)
+		return __ni_capture_detach_filter(capture);
+
+	memset(&pf, 0, sizeof(pf));
+	insns = xcalloc(NI_CAPTURE_ARP_FILTER_HEAD + 2 * count + 1, sizeof(*insns));
+	len = 0;
+
+	/* Make sure it's an IPv4 arp packet... */
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_LD + BPF_H + BPF_ABS,
+					offsetof(struct arphdr, ar_pro));
+	insns[len++] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, ETHERTYPE_IP, 1, 0);
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, 0);
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_LD + BPF_B + BPF_ABS,
+					offsetof(struct arphdr, ar_pln));
+	insns[len++] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, 4, 1, 0);
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, 0);
+
+	/* Load the sender ip after the sender hardware address... */
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_LD + BPF_B + BPF_ABS,
+					offsetof(struct arphdr, ar_hln));
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_MISC + BPF_TAX, 0);
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_LD + BPF_W + BPF_IND,
+					sizeof(struct arphdr));
+
+	/* ... and ask for the whole packet when it matches */
+	for (i = 0; i < count; ++i) {
+		insns[len++] = (struct bpf_insn)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+					ntohl(sips[i].s_addr), 0, 1);
+		insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, ~0U);
+	}
+	insns[len++] = (struct bpf_insn)BPF_STMT(BPF_RET + BPF_K, 0);
+
+	pf.filter = insns;
+	pf.len = len;
+	if (setsockopt(capture->sock->__fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) == 0) {
+		ret = 0;
+	} else
+	if (errno == ENOMEM) {
+		ni_debug_socket("%s: arp filter of %u addresses exceeds the socket optmem",
+				capture->ifname, count);
+		ret = __ni_capture_detach_filter(capture);
+	} else {
+		ni_error("%s: SO_ATTACH_FILTER: %m", capture->ifname);
+		ret = -1;
+	}
+
+	free(insns);
+	return ret;
+}
+
 ssize_t
 __ni_capture_send(const ni_capture_t *capture, const ni_buffer_t *buf)
 {
@@ -838,12 +1869,26 @@ ni_capture_send(ni_capture_t *capture, const ni_buffer_t *buf, const ni_timeout_
 void
 ni_capture_free(ni_capture_t *capture)
 {
+	ni_capture_t *master;
+
 	if (!capture)
 		return;
+	if (capture->freed)
+		*capture->freed = TRUE;
+	if ((master = capture->shared.master)) {
+		__ni_capture_shared_unlink(master, capture);
+		master->shared.dirty = TRUE;
+		ni_socket_release(capture->sock);
+		capture->sock = NULL;
+		__ni_capture_shared_release(master);
+	}
 	if (capture->sock)
 		ni_socket_close(capture->sock);
+	__ni_capture_ring_close(capture);
 	if (capture->buffer)
 		free(capture->buffer);
+	free(capture->shared.hash);
+	free(capture->shared.filter);
 	ni_string_free(&capture->ifname);
 	free(capture);
 }
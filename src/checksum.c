@@ -0,0 +1,309 @@
+/*
+ *	Internet checksum (RFC 1071) routines
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ *	The one's complement sum does not depend on the word size it is
+ *	computed with (2^16 == 1 mod 0xffff), so the optimized variants
+ *	add 32-bit words to 64-bit accumulators and fold at the end.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#if defined(__SSE2__)
+#define NI_CHECKSUM_SSE2	1
+#endif
+#if defined(__x86_64__) && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define NI_CHECKSUM_AVX2	1
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NI_CHECKSUM_NEON	1
+#endif
+
+#include <wicked/types.h>
+#include "checksum.h"
+
+#define NI_CHECKSUM_SIMD_MIN	64	/* below, the generic variant is faster */
+
+static inline uint32_t
+__ni_checksum_fold64(uint64_t sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	return sum;
+}
+
+static inline uint32_t
+__ni_checksum_load32(const unsigned char *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint16_t
+__ni_checksum_load16(const unsigned char *p)
+{
+	uint16_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t
+__ni_checksum_tail(uint64_t sum, const unsigned char *p, size_t len)
+{
+	union {
+		uint8_t c[2];
+		uint16_t s;
+	} bs;
+
+	for ( ; len >= 4; p += 4, len -= 4)
+		sum += __ni_checksum_load32(p);
+	if (len >= 2) {
+		sum += __ni_checksum_load16(p);
+		p += 2;
+		len -= 2;
+	}
+	if (len == 1) {
+		bs.c[0] = p[0];
+		bs.c[1] = 0;
+		sum += bs.s;
+	}
+	return sum;
+}
+
+/*
+ * The classic 16-bit word loop; the reference for the tests.
+ */
+static uint32_t
+ni_checksum_scalar(uint32_t init, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	uint64_t sum = init;
+	union {
+		uint8_t c[2];
+		uint16_t s;
+	} bs;
+
+	for ( ; len > 1; p += 2, len -= 2)
+		sum += __ni_checksum_load16(p);
+
+	if (len == 1) {
+		bs.c[0] = p[0];
+		bs.c[1] = 0;
+		sum += bs.s;
+	}
+	return __ni_checksum_fold64(sum);
+}
+
+/*
+ * Word at a time: 32 bytes per iteration into two accumulators.
+ */
+static uint32_t
+ni_checksum_generic(uint32_t init, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	uint64_t s0 = init, s1 = 0;
+
+	for ( ; len >= 32; p += 32, len -= 32) {
+		s0 += __ni_checksum_load32(p +  0);
+		s1 += __ni_checksum_load32(p +  4);
+		s0 += __ni_checksum_load32(p +  8);
+		s1 += __ni_checksum_load32(p + 12);
+		s0 += __ni_checksum_load32(p + 16);
+		s1 += __ni_checksum_load32(p + 20);
+		s0 += __ni_checksum_load32(p + 24);
+		s1 += __ni_checksum_load32(p + 28);
+	}
+
+	s0 = __ni_checksum_tail(s0, p, len);
+	return __ni_checksum_fold64((uint64_t)__ni_checksum_fold64(s0) + __ni_checksum_fold64(s1));
+}
+
+#if defined(NI_CHECKSUM_SSE2)
+/*
+ * Zero-extends the 32-bit words of 16 bytes into 64-bit lanes.
+ */
+static uint32_t
+ni_checksum_sse2(uint32_t init, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	__m128i zero = _mm_setzero_si128();
+	__m128i a0 = zero, a1 = zero, v0, v1;
+	uint64_t lane[2], sum;
+
+	for ( ; len >= 32; p += 32, len -= 32) {
+		v0 = _mm_loadu_si128((const __m128i *)(p +  0));
+		v1 = _mm_loadu_si128((const __m128i *)(p + 16));
+		a0 = _mm_add_epi64(a0, _mm_unpacklo_epi32(v0, zero));
+		a1 = _mm_add_epi64(a1, _mm_unpackhi_epi32(v0, zero));
+		a0 = _mm_add_epi64(a0, _mm_unpacklo_epi32(v1, zero));
+		a1 = _mm_add_epi64(a1, _mm_unpackhi_epi32(v1, zero));
+	}
+	_mm_storeu_si128((__m128i *)lane, _mm_add_epi64(a0, a1));
+
+	sum = __ni_checksum_tail(init, p, len);
+	sum = (uint64_t)__ni_checksum_fold64(sum) + __ni_checksum_fold64(lane[0])
+	    + __ni_checksum_fold64(lane[1]);
+	return __ni_checksum_fold64(sum);
+}
+#endif
+
+#if defined(NI_CHECKSUM_AVX2)
+__attribute__((target("avx2")))
+static uint32_t
+ni_checksum_avx2(uint32_t init, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	__m256i zero = _mm256_setzero_si256();
+	__m256i a0 = zero, a1 = zero, v0, v1;
+	uint64_t lane[4], sum;
+
+	for ( ; len >= 64; p += 64, len -= 64) {
+		v0 = _mm256_loadu_si256((const __m256i *)(p +  0));
+		v1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+		a0 = _mm256_add_epi64(a0, _mm256_unpacklo_epi32(v0, zero));
+		a1 = _mm256_add_epi64(a1, _mm256_unpackhi_epi32(v0, zero));
+		a0 = _mm256_add_epi64(a0, _mm256_unpacklo_epi32(v1, zero));
+		a1 = _mm256_add_epi64(a1, _mm256_unpackhi_epi32(v1, zero));
+	}
+	_mm256_storeu_si256((__m256i *)lane, _mm256_add_epi64(a0, a1));
+
+	sum = __ni_checksum_tail(init, p, len);
+	sum = (uint64_t)__ni_checksum_fold64(sum)
+	    + __ni_checksum_fold64(lane[0]) + __ni_checksum_fold64(lane[1])
+	    + __ni_checksum_fold64(lane[2]) + __ni_checksum_fold64(lane[3]);
+	return __ni_checksum_fold64(sum);
+}
+
+static ni_bool_t
+ni_checksum_avx2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+}
+#endif
+
+#if defined(NI_CHECKSUM_NEON)
+/*
+ * Pairwise adds the 32-bit words of 16 bytes into 64-bit lanes.
+ */
+static uint32_t
+ni_checksum_neon(uint32_t init, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	uint64x2_t a0 = vdupq_n_u64(0), a1 = vdupq_n_u64(0);
+	uint64_t sum;
+
+	for ( ; len >= 32; p += 32, len -= 32) {
+		a0 = vpadalq_u32(a0, vreinterpretq_u32_u8(vld1q_u8(p +  0)));
+		a1 = vpadalq_u32(a1, vreinterpretq_u32_u8(vld1q_u8(p + 16)));
+	}
+	a0 = vaddq_u64(a0, a1);
+
+	sum = __ni_checksum_tail(init, p, len);
+	sum = (uint64_t)__ni_checksum_fold64(sum)
+	    + __ni_checksum_fold64(vgetq_lane_u64(a0, 0))
+	    + __ni_checksum_fold64(vgetq_lane_u64(a0, 1));
+	return __ni_checksum_fold64(sum);
+}
+#endif
+
+/*
+ * Select the fastest variant available on this host once
+ */
+static ni_checksum_func_t *	ni_checksum_best;
+static const char *		ni_checksum_best_name;
+
+static void
+ni_checksum_select(void)
+{
+	ni_checksum_func_t *func = ni_checksum_generic;
+	const char *name = "generic";
+
+#if defined(NI_CHECKSUM_SSE2)
+	func = ni_checksum_sse2;
+	name = "sse2";
+#endif
+#if defined(NI_CHECKSUM_AVX2)
+	if (ni_checksum_avx2_supported()) {
+		func = ni_checksum_avx2;
+		name = "avx2";
+	}
+#endif
+#if defined(NI_CHECKSUM_NEON)
+	func = ni_checksum_neon;
+	name = "neon";
+#endif
+	ni_checksum_best_name = name;
+	ni_checksum_best = func;
+}
+
+uint32_t
+ni_checksum_partial(uint32_t sum, const void *data, size_t len)
+{
+	if (len < NI_CHECKSUM_SIMD_MIN)
+		return ni_checksum_generic(sum, data, len);
+
+	if (!ni_checksum_best)
+		ni_checksum_select();
+	return ni_checksum_best(sum, data, len);
+}
+
+ni_checksum_func_t *
+ni_checksum_impl(const char *name)
+{
+	if (!name)
+		return NULL;
+
+	if (!strcmp(name, "scalar"))
+		return ni_checksum_scalar;
+	if (!strcmp(name, "generic"))
+		return ni_checksum_generic;
+#if defined(NI_CHECKSUM_SSE2)
+	if (!strcmp(name, "sse2"))
+		return ni_checksum_sse2;
+#endif
+#if defined(NI_CHECKSUM_AVX2)
+	if (!strcmp(name, "avx2"))
+		return ni_checksum_avx2_supported() ? ni_checksum_avx2 : NULL;
+#endif
+#if defined(NI_CHECKSUM_NEON)
+	if (!strcmp(name, "neon"))
+		return ni_checksum_neon;
+#endif
+	return NULL;
+}
+
+const char *
+ni_checksum_impl_name(void)
+{
+	if (!ni_checksum_best)
+		ni_checksum_select();
+	return ni_checksum_best_name;
+}
@@ -0,0 +1,58 @@
+/*
+ *	Internet checksum (RFC 1071) routines
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifndef NI_CHECKSUM_H
+#define NI_CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The partial sums are in host byte order of the 16-bit words, as
+ * the folded checksum, which can be stored into a header as is.
+ * Only the last chunk of a sum may have an odd length.
+ */
+typedef uint32_t	ni_checksum_func_t(uint32_t, const void *, size_t);
+
+extern uint32_t		ni_checksum_partial(uint32_t, const void *, size_t);
+
+static inline uint16_t
+ni_checksum_fold(uint32_t sum)
+{
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum += (sum >> 16);
+
+	return ~sum;
+}
+
+static inline uint16_t
+ni_checksum(const void *data, size_t len)
+{
+	return ni_checksum_fold(ni_checksum_partial(0, data, len));
+}
+
+/*
+ * Implementations by name ("scalar", "generic", "sse2", "avx2",
+ * "neon"); NULL when not available on this host. For tests only.
+ */
+extern ni_checksum_func_t *	ni_checksum_impl(const char *);
+extern const char *		ni_checksum_impl_name(void);
+
+#endif /* NI_CHECKSUM_H */
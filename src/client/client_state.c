@@ -436,6 +436,9 @@ ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex
 	FILE *fp = NULL;
 	int fd;
 
+	if (ni_client_state_log_enabled())
+		return ni_client_state_log_save(client_state, ifindex);
+
 	ni_client_state_filename(ifindex, path, sizeof(path));
 	snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
 
@@ -495,6 +498,9 @@ ni_client_state_load(ni_client_state_t *client_state, unsigned int ifindex)
 	if (!client_state)
 		return FALSE;
 
+	if (ni_client_state_log_enabled())
+		return ni_client_state_log_load(client_state, ifindex);
+
 	ni_client_state_filename(ifindex, path, sizeof(path));
 	if (!(fp = fopen(path, "re"))) {
 		if (errno != ENOENT)
@@ -538,6 +544,9 @@ ni_client_state_move(unsigned int ifindex_old, unsigned int ifindex_new)
 	if (ifindex_old == ifindex_new)
 		return TRUE;
 
+	if (ni_client_state_log_enabled())
+		return ni_client_state_log_move(ifindex_old, ifindex_new);
+
 	ni_client_state_filename(ifindex_old, path_old, sizeof(path_old));
 	ni_client_state_filename(ifindex_new, path_new, sizeof(path_new));
 
@@ -558,6 +567,9 @@ ni_client_state_drop(unsigned int ifindex)
 {
 	char path[PATH_MAX] = {'\0'};
 
+	if (ni_client_state_log_enabled())
+		return ni_client_state_log_drop(ifindex);
+
 	ni_client_state_filename(ifindex, path, sizeof(path));
 
 	if (unlink(path) < 0) {
@@ -82,8 +82,16 @@ extern ni_bool_t	ni_client_state_load(ni_client_state_t *, unsigned int);
 extern ni_bool_t	ni_client_state_save(const ni_client_state_t *, unsigned int);
 extern ni_bool_t	ni_client_state_move(unsigned int, unsigned int);
 extern ni_bool_t	ni_client_state_drop(unsigned int);
+extern ni_bool_t	ni_client_state_begin(void);
+extern ni_bool_t	ni_client_state_commit(void);
 extern ni_bool_t	ni_client_state_set_persistent(xml_node_t *);
 
+extern ni_bool_t	ni_client_state_log_enabled(void);
+extern ni_bool_t	ni_client_state_log_load(ni_client_state_t *, unsigned int);
+extern ni_bool_t	ni_client_state_log_save(const ni_client_state_t *, unsigned int);
+extern ni_bool_t	ni_client_state_log_move(unsigned int, unsigned int);
+extern ni_bool_t	ni_client_state_log_drop(unsigned int);
+
 extern void		ni_client_state_control_debug(const char *, const ni_client_state_control_t *, const char *);
 extern void		ni_client_state_config_debug(const char *, const ni_client_state_config_t *, const char *);
 extern void		ni_client_state_debug(const char *, const ni_client_state_t *, const char *);
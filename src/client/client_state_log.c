@@ -0,0 +1,783 @@
+/*
+ *	Consolidated store of the interface client-state: a single log
+ *	file in the state dir, replacing the state-<ifindex>.xml files.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ *	The log is a sequence of records, each with its length and a
+ *	checksum, setting or dropping the state of an ifindex. Records
+ *	are appended in batches terminated by a commit record with one
+ *	write under an exclusive lock; the batches are applied at once
+ *	only, a torn batch left by a crash is truncated by the next user.
+ *	The log is compacted to the live records when most of it is dead,
+ *	by writing a new log and renaming it over the old one.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include <wicked/util.h>
+#include <wicked/xml.h>
+#include <wicked/netinfo.h>	/* for ni_config_statedir() */
+#include <wicked/logging.h>
+
+#include "client/client_state.h"
+#include "appconfig.h"
+#include "buffer.h"
+#include "util_priv.h"
+
+#define NI_CLIENT_STATE_LOG_FILE		"client-state.log"
+#define NI_CLIENT_STATE_LOG_MAGIC		"WCSL"
+#define NI_CLIENT_STATE_LOG_VERSION		1
+#define NI_CLIENT_STATE_LOG_HDRLEN		8
+#define NI_CLIENT_STATE_LOG_RECLEN		16
+#define NI_CLIENT_STATE_LOG_BUCKETS		256
+#define NI_CLIENT_STATE_LOG_COMPACT_MIN		(64 * 1024)
+
+enum {
+	NI_CLIENT_STATE_LOG_SET = 1,
+	NI_CLIENT_STATE_LOG_DROP,
+	NI_CLIENT_STATE_LOG_COMMIT,
+};
+
+typedef struct ni_client_state_log_entry	ni_client_state_log_entry_t;
+
+struct ni_client_state_log_entry {
+	ni_client_state_log_entry_t *next;
+
+	unsigned int		ifindex;
+	size_t			size;		/* of the record in the log */
+	char *			data;		/* client-state node as xml */
+};
+
+typedef struct ni_client_state_log {
+	int			fd;
+	dev_t			dev;
+	ino_t			ino;
+	off_t			offset;		/* end of the last applied batch */
+	size_t			live;		/* size of the live records */
+
+	unsigned int		depth;		/* transaction nesting level */
+	ni_buffer_t		batch;		/* records of the transaction */
+
+	ni_client_state_log_entry_t *hash[NI_CLIENT_STATE_LOG_BUCKETS];
+} ni_client_state_log_t;
+
+static ni_client_state_log_t	ni_client_state_log = { .fd = -1 };
+
+static ni_bool_t	ni_client_state_log_migrate(ni_client_state_log_t *);
+
+ni_bool_t
+ni_client_state_log_enabled(void)
+{
+	const ni_config_client_state_t *conf = ni_config_client_state();
+
+	return conf && conf->store == NI_CONFIG_CLIENT_STATE_STORE_LOG;
+}
+
+static ni_bool_t
+ni_client_state_log_sync(void)
+{
+	const ni_config_client_state_t *conf = ni_config_client_state();
+
+	return conf && conf->sync;
+}
+
+static void
+ni_client_state_log_filename(char *path, size_t size)
+{
+	snprintf(path, size, "%s/%s", ni_config_statedir(),
+			NI_CLIENT_STATE_LOG_FILE);
+}
+
+static void
+ni_client_state_log_sync_dir(void)
+{
+	const char *dir = ni_config_statedir();
+	int fd;
+
+	if ((fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+		ni_warn("Unable to open state directory '%s': %m", dir);
+		return;
+	}
+	if (fsync(fd) < 0)
+		ni_warn("Unable to sync state directory '%s': %m", dir);
+	close(fd);
+}
+
+/*
+ * The in-memory index of the state in the log
+ */
+static ni_client_state_log_entry_t **
+ni_client_state_log_entry_pos(ni_client_state_log_t *log, unsigned int ifindex)
+{
+	ni_client_state_log_entry_t **pos, *entry;
+
+	pos = &log->hash[ifindex % NI_CLIENT_STATE_LOG_BUCKETS];
+	for (; (entry = *pos); pos = &entry->next) {
+		if (entry->ifindex == ifindex)
+			break;
+	}
+	return pos;
+}
+
+static ni_client_state_log_entry_t *
+ni_client_state_log_entry_find(ni_client_state_log_t *log, unsigned int ifindex)
+{
+	return *ni_client_state_log_entry_pos(log, ifindex);
+}
+
+static void
+ni_client_state_log_entry_set(ni_client_state_log_t *log, unsigned int ifindex,
+				const char *data, size_t len, size_t size)
+{
+	ni_client_state_log_entry_t **pos, *entry;
+
+	pos = ni_client_state_log_entry_pos(log, ifindex);
+	if (!(entry = *pos)) {
+		entry = *pos = xcalloc(1, sizeof(*entry));
+		entry->ifindex = ifindex;
+	} else {
+		log->live -= entry->size;
+	}
+	ni_string_set(&entry->data, data, len);
+	entry->size = size;
+	log->live += size;
+}
+
+static void
+ni_client_state_log_entry_drop(ni_client_state_log_t *log, unsigned int ifindex)
+{
+	ni_client_state_log_entry_t **pos, *entry;
+
+	pos = ni_client_state_log_entry_pos(log, ifindex);
+	if ((entry = *pos)) {
+		*pos = entry->next;
+		log->live -= entry->size;
+		ni_string_free(&entry->data);
+		free(entry);
+	}
+}
+
+static void
+ni_client_state_log_reset(ni_client_state_log_t *log)
+{
+	ni_client_state_log_entry_t *entry;
+	unsigned int i;
+
+	for (i = 0; i < NI_CLIENT_STATE_LOG_BUCKETS; ++i) {
+		while ((entry = log->hash[i])) {
+			log->hash[i] = entry->next;
+			ni_string_free(&entry->data);
+			free(entry);
+		}
+	}
+	log->live = 0;
+	log->offset = 0;
+}
+
+static void
+ni_client_state_log_close(ni_client_state_log_t *log)
+{
+	if (log->fd >= 0)
+		close(log->fd);
+	log->fd = -1;
+	ni_client_state_log_reset(log);
+}
+
+/*
+ * Log records
+ */
+static void
+ni_client_state_log_put(ni_buffer_t *bp, unsigned int op, unsigned int ifindex,
+				const char *data, size_t len)
+{
+	size_t size = NI_CLIENT_STATE_LOG_RECLEN + len;
+	unsigned char *rec;
+	uint32_t value;
+
+	ni_buffer_ensure_tailroom(bp, size);
+	if (!(rec = ni_buffer_push_tail(bp, size)))
+		return;
+
+	memset(rec, 0, NI_CLIENT_STATE_LOG_RECLEN);
+	value = htonl(size);
+	memcpy(rec, &value, sizeof(value));
+	rec[8] = op;
+	value = htonl(ifindex);
+	memcpy(rec + 12, &value, sizeof(value));
+	if (len)
+		memcpy(rec + NI_CLIENT_STATE_LOG_RECLEN, data, len);
+
+	value = htonl(ni_hash_fnv1a(NI_HASH_FNV1A_INIT, rec + 8, size - 8));
+	memcpy(rec + 4, &value, sizeof(value));
+}
+
+static size_t
+ni_client_state_log_get(const unsigned char *rec, size_t avail, unsigned int *op,
+				unsigned int *ifindex)
+{
+	uint32_t size, sum, value;
+
+	if (avail < NI_CLIENT_STATE_LOG_RECLEN)
+		return 0;
+
+	memcpy(&size, rec, sizeof(size));
+	memcpy(&sum, rec + 4, sizeof(sum));
+	size = ntohl(size);
+	if (size < NI_CLIENT_STATE_LOG_RECLEN || size > avail)
+		return 0;
+	if (ntohl(sum) != ni_hash_fnv1a(NI_HASH_FNV1A_INIT, rec + 8, size - 8))
+		return 0;
+
+	*op = rec[8];
+	memcpy(&value, rec + 12, sizeof(value));
+	*ifindex = ntohl(value);
+	return size;
+}
+
+/*
+ * Apply the committed batches in data and return their length.
+ */
+static size_t
+ni_client_state_log_apply(ni_client_state_log_t *log, const unsigned char *data, size_t len)
+{
+	size_t pos, size, batch, bsize, committed = 0;
+	unsigned int op, ifindex;
+
+	for (pos = 0; pos < len; pos += size) {
+		if (!(size = ni_client_state_log_get(data + pos, len - pos, &op, &ifindex)))
+			break;
+		if (op != NI_CLIENT_STATE_LOG_COMMIT)
+			continue;
+
+		for (batch = committed; batch < pos; batch += bsize) {
+			bsize = ni_client_state_log_get(data + batch, pos - batch, &op, &ifindex);
+			switch (op) {
+			case NI_CLIENT_STATE_LOG_SET:
+				ni_client_state_log_entry_set(log, ifindex,
+					(const char *)data + batch + NI_CLIENT_STATE_LOG_RECLEN,
+					bsize - NI_CLIENT_STATE_LOG_RECLEN, bsize);
+				break;
+			case NI_CLIENT_STATE_LOG_DROP:
+				ni_client_state_log_entry_drop(log, ifindex);
+				break;
+			default:
+				break;
+			}
+		}
+		committed = pos + size;
+	}
+	return committed;
+}
+
+/*
+ * Bring the index up to date with the log, with the log locked.
+ */
+static ni_bool_t
+ni_client_state_log_refresh(ni_client_state_log_t *log)
+{
+	unsigned char hdr[NI_CLIENT_STATE_LOG_HDRLEN];
+	unsigned char *data;
+	struct stat st;
+	size_t len, done;
+	uint16_t version;
+
+	if (fstat(log->fd, &st) < 0)
+		return FALSE;
+
+	if (st.st_size < log->offset)
+		ni_client_state_log_reset(log);
+
+	if (log->offset == 0) {
+		if (st.st_size == 0) {
+			memcpy(hdr, NI_CLIENT_STATE_LOG_MAGIC, 4);
+			version = htons(NI_CLIENT_STATE_LOG_VERSION);
+			memcpy(hdr + 4, &version, sizeof(version));
+			memset(hdr + 6, 0, 2);
+			if (write(log->fd, hdr, sizeof(hdr)) != sizeof(hdr)) {
+				ni_error("Cannot write client-state log header: %m");
+				return FALSE;
+			}
+			log->offset = sizeof(hdr);
+			if (ni_client_state_log_migrate(log))
+				return TRUE;
+
+			/* an empty log retries the migration on the next open */
+			if (ftruncate(log->fd, 0) < 0)
+				ni_error("Cannot truncate client-state log: %m");
+			log->offset = 0;
+			return FALSE;
+		}
+
+		if (pread(log->fd, hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+		    memcmp(hdr, NI_CLIENT_STATE_LOG_MAGIC, 4)) {
+			ni_error("Client-state log is not valid");
+			return FALSE;
+		}
+		memcpy(&version, hdr + 4, sizeof(version));
+		if (ntohs(version) != NI_CLIENT_STATE_LOG_VERSION) {
+			ni_error("Unsupported client-state log version %u", ntohs(version));
+			return FALSE;
+		}
+		log->offset = sizeof(hdr);
+	}
+
+	if (st.st_size == log->offset)
+		return TRUE;
+
+	len = st.st_size - log->offset;
+	data = xmalloc(len);
+	if (pread(log->fd, data, len, log->offset) != (ssize_t)len) {
+		ni_error("Cannot read client-state log: %m");
+		free(data);
+		return FALSE;
+	}
+	done = ni_client_state_log_apply(log, data, len);
+	free(data);
+
+	log->offset += done;
+	if (done < len) {
+		ni_warn("Discarding %zu bytes of an incomplete client-state log update",
+				len - done);
+		if (ftruncate(log->fd, log->offset) < 0)
+			ni_error("Cannot truncate client-state log: %m");
+	}
+	return TRUE;
+}
+
+/*
+ * Lock the log, reopening it when an other process has compacted it
+ */
+static ni_bool_t
+ni_client_state_log_lock(ni_client_state_log_t *log)
+{
+	char path[PATH_MAX] = {'\0'};
+	struct stat st;
+	unsigned int retries;
+
+	ni_client_state_log_filename(path, sizeof(path));
+	for (retries = 0; retries < 3; ++retries) {
+		if (log->fd < 0) {
+			log->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+			if (log->fd < 0 || fstat(log->fd, &st) < 0) {
+				ni_error("Cannot open client-state log '%s': %m", path);
+				ni_client_state_log_close(log);
+				return FALSE;
+			}
+			log->dev = st.st_dev;
+			log->ino = st.st_ino;
+			ni_client_state_log_reset(log);
+		}
+
+		if (flock(log->fd, LOCK_EX) < 0) {
+			ni_error("Cannot lock client-state log '%s': %m", path);
+			return FALSE;
+		}
+		if (stat(path, &st) == 0 && st.st_dev == log->dev && st.st_ino == log->ino) {
+			if (ni_client_state_log_refresh(log))
+				return TRUE;
+			flock(log->fd, LOCK_UN);
+			return FALSE;
+		}
+		ni_client_state_log_close(log);
+	}
+	return FALSE;
+}
+
+static void
+ni_client_state_log_unlock(ni_client_state_log_t *log)
+{
+	if (log->fd >= 0)
+		flock(log->fd, LOCK_UN);
+}
+
+/*
+ * Rewrite the log with the live records only, when most of it is dead
+ */
+static void
+ni_client_state_log_compact(ni_client_state_log_t *log)
+{
+	char path[PATH_MAX] = {'\0'};
+	char temp[PATH_MAX] = {'\0'};
+	ni_client_state_log_entry_t *entry;
+	size_t dead = log->offset - NI_CLIENT_STATE_LOG_HDRLEN - log->live;
+	unsigned char hdr[NI_CLIENT_STATE_LOG_HDRLEN];
+	ni_buffer_t data;
+	struct stat st;
+	uint16_t version;
+	unsigned int i;
+	int fd;
+
+	if (dead < NI_CLIENT_STATE_LOG_COMPACT_MIN || dead < log->live)
+		return;
+
+	ni_buffer_init_dynamic(&data, log->live + sizeof(hdr) + NI_CLIENT_STATE_LOG_RECLEN);
+	memcpy(hdr, NI_CLIENT_STATE_LOG_MAGIC, 4);
+	version = htons(NI_CLIENT_STATE_LOG_VERSION);
+	memcpy(hdr + 4, &version, sizeof(version));
+	memset(hdr + 6, 0, 2);
+	ni_buffer_put(&data, hdr, sizeof(hdr));
+	for (i = 0; i < NI_CLIENT_STATE_LOG_BUCKETS; ++i) {
+		for (entry = log->hash[i]; entry; entry = entry->next) {
+			ni_client_state_log_put(&data, NI_CLIENT_STATE_LOG_SET,
+					entry->ifindex, entry->data, strlen(entry->data));
+		}
+	}
+	ni_client_state_log_put(&data, NI_CLIENT_STATE_LOG_COMMIT, 0, NULL, 0);
+
+	ni_client_state_log_filename(path, sizeof(path));
+	snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
+	if ((fd = mkostemp(temp, O_APPEND | O_CLOEXEC)) < 0) {
+		ni_error("Cannot create client-state log temp file: %m");
+		ni_buffer_destroy(&data);
+		return;
+	}
+	if (write(fd, ni_buffer_head(&data), ni_buffer_count(&data)) !=
+			(ssize_t)ni_buffer_count(&data) ||
+	    (ni_client_state_log_sync() && fdatasync(fd) < 0) ||
+	    fstat(fd, &st) < 0 || rename(temp, path) < 0) {
+		ni_error("Cannot compact client-state log: %m");
+		ni_buffer_destroy(&data);
+		unlink(temp);
+		close(fd);
+		return;
+	}
+
+	/* make the rename itself durable before the old log is dropped */
+	if (ni_client_state_log_sync())
+		ni_client_state_log_sync_dir();
+
+	ni_debug_readwrite("Compacted client-state log from %lu to %u bytes",
+			(unsigned long)log->offset, ni_buffer_count(&data));
+
+	/* the old log is unlinked, the lock on it does not matter */
+	close(log->fd);
+	log->fd = fd;
+	log->dev = st.st_dev;
+	log->ino = st.st_ino;
+	log->offset = ni_buffer_count(&data);
+	log->live = ni_buffer_count(&data) - sizeof(hdr) - NI_CLIENT_STATE_LOG_RECLEN;
+	ni_buffer_destroy(&data);
+}
+
+/*
+ * Append a batch of records with a commit record and apply it,
+ * with the log locked.
+ */
+static ni_bool_t
+ni_client_state_log_append(ni_client_state_log_t *log, ni_buffer_t *batch)
+{
+	const unsigned char *data;
+	size_t len;
+
+	ni_client_state_log_put(batch, NI_CLIENT_STATE_LOG_COMMIT, 0, NULL, 0);
+	data = ni_buffer_head(batch);
+	len = ni_buffer_count(batch);
+
+	if (write(log->fd, data, len) != (ssize_t)len ||
+	    (ni_client_state_log_sync() && fdatasync(log->fd) < 0)) {
+		ni_error("Cannot write client-state log: %m");
+		if (ftruncate(log->fd, log->offset) < 0)
+			ni_error("Cannot truncate client-state log: %m");
+		return FALSE;
+	}
+
+	log->offset += ni_client_state_log_apply(log, data, len);
+	ni_client_state_log_compact(log);
+	return TRUE;
+}
+
+static ni_bool_t
+ni_client_state_log_flush(ni_client_state_log_t *log, ni_buffer_t *batch)
+{
+	ni_bool_t ret;
+
+	if (!ni_buffer_count(batch))
+		return TRUE;
+
+	if (!ni_client_state_log_lock(log))
+		return FALSE;
+	ret = ni_client_state_log_append(log, batch);
+	ni_client_state_log_unlock(log);
+	return ret;
+}
+
+/*
+ * Import the state files into a new log and remove the imported ones;
+ * files which cannot be parsed are kept for the administrator.
+ */
+static ni_bool_t
+ni_client_state_log_migrate(ni_client_state_log_t *log)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	ni_string_array_t imported = NI_STRING_ARRAY_INIT;
+	char path[PATH_MAX] = {'\0'};
+	unsigned int i, ifindex;
+	xml_node_t *xml, *node;
+	ni_buffer_t batch;
+	char *data;
+	FILE *fp;
+	int len;
+
+	if (!ni_scandir(ni_config_statedir(), "state-*.xml", &files))
+		return TRUE;
+
+	ni_buffer_init_dynamic(&batch, 4096);
+	for (i = 0; i < files.count; ++i) {
+		len = 0;
+		if (sscanf(files.data[i], "state-%u.xml%n", &ifindex, &len) != 1 ||
+		    !len || files.data[i][len] != '\0')
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", ni_config_statedir(), files.data[i]);
+		if (!(fp = fopen(path, "re")))
+			continue;
+		xml = xml_node_scan(fp, path);
+		fclose(fp);
+
+		node = xml && !xml->name ? xml->children : xml;
+		if (node && ni_string_eq(node->name, NI_CLIENT_STATE_XML_NODE) &&
+		    (data = xml_node_sprint(node))) {
+			ni_client_state_log_put(&batch, NI_CLIENT_STATE_LOG_SET,
+						ifindex, data, strlen(data));
+			ni_string_array_append(&imported, files.data[i]);
+			free(data);
+		} else {
+			ni_warn("Cannot migrate client-state file '%s'", path);
+		}
+		xml_node_free(xml);
+	}
+
+	if (ni_buffer_count(&batch)) {
+		if (!ni_client_state_log_append(log, &batch)) {
+			ni_buffer_destroy(&batch);
+			ni_string_array_destroy(&imported);
+			ni_string_array_destroy(&files);
+			return FALSE;
+		}
+		ni_debug_readwrite("Migrated %u client-state files to the log", imported.count);
+	}
+	ni_buffer_destroy(&batch);
+
+	for (i = 0; i < imported.count; ++i) {
+		snprintf(path, sizeof(path), "%s/%s", ni_config_statedir(), imported.data[i]);
+		unlink(path);
+	}
+	ni_string_array_destroy(&imported);
+	ni_string_array_destroy(&files);
+	return TRUE;
+}
+
+/*
+ * Whether the open transaction sets a state for the ifindex
+ */
+static ni_bool_t
+ni_client_state_log_batch_sets(const ni_buffer_t *batch, unsigned int ifindex)
+{
+	const unsigned char *rec = ni_buffer_head(batch);
+	size_t len = ni_buffer_count(batch);
+	uint32_t size, value;
+
+	for ( ; len >= NI_CLIENT_STATE_LOG_RECLEN; rec += size, len -= size) {
+		memcpy(&size, rec, sizeof(size));
+		size = ntohl(size);
+		if (size < NI_CLIENT_STATE_LOG_RECLEN || size > len)
+			break;
+
+		memcpy(&value, rec + 12, sizeof(value));
+		if (rec[8] == NI_CLIENT_STATE_LOG_SET && ntohl(value) == ifindex)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * Add a record to the open transaction or write it right away
+ */
+static ni_bool_t
+ni_client_state_log_update(unsigned int op, unsigned int ifindex, const char *data)
+{
+	ni_client_state_log_t *log = &ni_client_state_log;
+	ni_buffer_t batch;
+	ni_bool_t ret;
+
+	if (log->depth) {
+		if (!log->batch.base)
+			ni_buffer_init_dynamic(&log->batch, 4096);
+		ni_client_state_log_put(&log->batch, op, ifindex, data, data ? strlen(data) : 0);
+		return TRUE;
+	}
+
+	ni_buffer_init_dynamic(&batch, 1024);
+	ni_client_state_log_put(&batch, op, ifindex, data, data ? strlen(data) : 0);
+	ret = ni_client_state_log_flush(log, &batch);
+	ni_buffer_destroy(&batch);
+	return ret;
+}
+
+ni_bool_t
+ni_client_state_log_save(const ni_client_state_t *client_state, unsigned int ifindex)
+{
+	xml_node_t *node;
+	char *data;
+	ni_bool_t ret;
+
+	if (!(node = xml_node_new(NI_CLIENT_STATE_XML_NODE, NULL)))
+		return FALSE;
+
+	if (!ni_client_state_print_xml(client_state, node) || !(data = xml_node_sprint(node))) {
+		ni_error("Cannot format state into xml for ifindex %u", ifindex);
+		xml_node_free(node);
+		return FALSE;
+	}
+	xml_node_free(node);
+
+	ret = ni_client_state_log_update(NI_CLIENT_STATE_LOG_SET, ifindex, data);
+	free(data);
+	return ret;
+}
+
+ni_bool_t
+ni_client_state_log_load(ni_client_state_t *client_state, unsigned int ifindex)
+{
+	ni_client_state_log_t *log = &ni_client_state_log;
+	ni_client_state_log_entry_t *entry;
+	xml_document_t *doc;
+	xml_node_t *node;
+	ni_bool_t ret;
+
+	if (!ni_client_state_log_lock(log))
+		return FALSE;
+
+	if (!(entry = ni_client_state_log_entry_find(log, ifindex))) {
+		ni_client_state_log_unlock(log);
+		return FALSE;
+	}
+	doc = xml_document_from_string(entry->data, NI_CLIENT_STATE_LOG_FILE);
+	ni_client_state_log_unlock(log);
+
+	node = doc ? xml_document_root(doc) : NULL;
+	if (node && !node->name)
+		node = node->children;
+	if (!node || !ni_string_eq(node->name, NI_CLIENT_STATE_XML_NODE)) {
+		ni_error("Cannot parse state of ifindex %u from the client-state log", ifindex);
+		xml_document_free(doc);
+		return FALSE;
+	}
+
+	ni_client_state_reset(client_state);
+	ret = ni_client_state_parse_xml(node, client_state);
+	xml_document_free(doc);
+	return ret;
+}
+
+ni_bool_t
+ni_client_state_log_move(unsigned int ifindex_old, unsigned int ifindex_new)
+{
+	ni_client_state_log_t *log = &ni_client_state_log;
+	ni_client_state_log_entry_t *entry;
+	ni_buffer_t batch;
+	ni_bool_t ret;
+
+	if (!ni_client_state_log_lock(log))
+		return FALSE;
+
+	if (!(entry = ni_client_state_log_entry_find(log, ifindex_old))) {
+		ni_client_state_log_unlock(log);
+		return TRUE;
+	}
+
+	ni_buffer_init_dynamic(&batch, entry->size + 2 * NI_CLIENT_STATE_LOG_RECLEN);
+	ni_client_state_log_put(&batch, NI_CLIENT_STATE_LOG_SET, ifindex_new,
+				entry->data, strlen(entry->data));
+	ni_client_state_log_put(&batch, NI_CLIENT_STATE_LOG_DROP, ifindex_old, NULL, 0);
+	if (log->depth) {
+		ni_client_state_log_unlock(log);
+		if (!log->batch.base)
+			ni_buffer_init_dynamic(&log->batch, 4096);
+		ni_buffer_ensure_tailroom(&log->batch, ni_buffer_count(&batch));
+		ni_buffer_put(&log->batch, ni_buffer_head(&batch), ni_buffer_count(&batch));
+		ni_buffer_destroy(&batch);
+		return TRUE;
+	}
+
+	ret = ni_client_state_log_append(log, &batch);
+	ni_client_state_log_unlock(log);
+	ni_buffer_destroy(&batch);
+	return ret;
+}
+
+ni_bool_t
+ni_client_state_log_drop(unsigned int ifindex)
+{
+	ni_client_state_log_t *log = &ni_client_state_log;
+	ni_bool_t found;
+
+	/* do not grow the log with drops of interfaces without state */
+	if (!ni_client_state_log_lock(log))
+		return FALSE;
+	found = ni_client_state_log_entry_find(log, ifindex) != NULL ||
+		(log->depth && ni_client_state_log_batch_sets(&log->batch, ifindex));
+	ni_client_state_log_unlock(log);
+
+	if (!found)
+		return TRUE;
+	return ni_client_state_log_update(NI_CLIENT_STATE_LOG_DROP, ifindex, NULL);
+}
+
+/*
+ * Transactions: the updates until the outermost commit are written
+ * to the log as a single batch.
+ */
+ni_bool_t
+ni_client_state_begin(void)
+{
+	if (ni_client_state_log_enabled())
+		ni_client_state_log.depth++;
+	return TRUE;
+}
+
+ni_bool_t
+ni_client_state_commit(void)
+{
+	ni_client_state_log_t *log = &ni_client_state_log;
+	ni_bool_t ret;
+
+	if (!log->depth || --log->depth)
+		return TRUE;
+
+	if (!log->batch.base)
+		return TRUE;
+
+	ret = ni_client_state_log_flush(log, &log->batch);
+	ni_buffer_destroy(&log->batch);
+	memset(&log->batch, 0, sizeof(log->batch));
+	return ret;
+}
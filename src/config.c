@@ -25,6 +25,7 @@
 #include "netinfo_priv.h"
 #include "util_priv.h"
 #include "appconfig.h"
+#include "process.h"
 #include "xml-schema.h"
 #include "dhcp.h"
 #include "duid.h"
@@ -49,6 +50,13 @@ static ni_bool_t	ni_config_parse_system_updater(ni_extension_t **, xml_node_t *)
 static ni_bool_t	ni_config_parse_extension(ni_extension_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_sources(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_rtnl_event(ni_config_rtnl_event_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_packet_capture(ni_config_packet_capture_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_lease_file(ni_config_lease_file_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_client_state(ni_config_client_state_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_warm_restart(ni_config_warm_restart_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_link_stats(ni_config_link_stats_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_metrics(ni_config_metrics_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_async_logging(ni_config_async_logging_t *, const xml_node_t *);
 static ni_bool_t	ni_config_parse_bonding(ni_config_bonding_t *, const xml_node_t *);
 static ni_bool_t	ni_config_parse_teamd(ni_config_teamd_t *, const xml_node_t *);
 static ni_c_binding_t *	ni_c_binding_new(ni_c_binding_t **, const char *name, const char *lib, const char *symbol);
@@ -81,6 +89,11 @@ ni_config_new()
 	conf->addrconf.auto6.allow_update   = ni_config_addrconf_update_auto6();
 	conf->addrconf.dhcp4.routes_opts = -1U;
 	conf->addrconf.dhcp6.release_nretries = -1U;
+	conf->addrconf.dhcp4.renew.jitter = NI_CONFIG_DHCP_RENEW_JITTER;
+	conf->addrconf.dhcp6.renew.jitter = NI_CONFIG_DHCP_RENEW_JITTER;
+	conf->addrconf.lease_file.format = NI_CONFIG_LEASE_FILE_FORMAT_XML;
+	conf->addrconf.lease_file.write_delay = 0;
+	conf->addrconf.lease_file.sync = FALSE;
 
 	ni_config_fslocation_init(&conf->piddir,   WICKED_PIDDIR,   0755);
 	ni_config_fslocation_init(&conf->statedir, WICKED_STATEDIR, 0755);
@@ -91,6 +104,27 @@ ni_config_new()
 	conf->rtnl_event.recv_buff_length = 1024 * 1024;
 	conf->rtnl_event.mesg_buff_length = 0;
 
+	conf->packet_capture.rx_ring = FALSE;
+	conf->packet_capture.rx_ring_blocks = 4;
+	conf->packet_capture.rx_ring_timeout = 10;
+	conf->packet_capture.shared = FALSE;
+
+	conf->client_state.store = NI_CONFIG_CLIENT_STATE_STORE_FILES;
+	conf->client_state.sync = FALSE;
+
+	conf->warm_restart.enabled = FALSE;
+	conf->warm_restart.refresh_batch = 32;
+	conf->warm_restart.refresh_interval = 100;
+
+	conf->link_stats.cache_time = 1000;
+
+	conf->metrics.enabled = FALSE;
+
+	conf->async_logging.enabled = FALSE;
+	conf->async_logging.records = 1024;
+	conf->async_logging.overflow = NI_LOG_OVERFLOW_DROP;
+	conf->async_logging.flight_recorder = 0;
+
 	/* we enable it explicitly in wickedd only */
 	conf->teamd.enabled = FALSE;
 
@@ -113,6 +147,7 @@ ni_config_dhcp4_clone(const ni_config_dhcp4_t *src, const char *device)
 	ni_string_dup(&dst->device, device);
 
 	dst->lease_time = src->lease_time;
+	dst->renew = src->renew;
 	dst->allow_update = src->allow_update;
 	ni_string_dup(&dst->vendor_class, src->vendor_class);
 	ni_string_array_copy(&dst->ignore_servers, &src->ignore_servers);
@@ -176,6 +211,7 @@ ni_config_dhcp6_clone(const ni_config_dhcp6_t *src, const char *device)
 	ni_string_dup(&dst->device, device);
 
 	dst->lease_time = src->lease_time;
+	dst->renew = src->renew;
 	dst->allow_update = src->allow_update;
 	ni_string_dup(&dst->default_duid, src->default_duid);
 	dst->create_duid = src->create_duid;
@@ -239,6 +275,7 @@ void
 ni_config_free(ni_config_t *conf)
 {
 	ni_string_array_destroy(&conf->sources.ifconfig);
+	ni_string_array_destroy(&conf->files);
 	ni_extension_list_destroy(&conf->dbus_extensions);
 	ni_extension_list_destroy(&conf->ns_extensions);
 	ni_extension_list_destroy(&conf->fw_extensions);
@@ -264,6 +301,7 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 	xml_node_t *node, *child;
 
 	ni_debug_wicked("Reading config file %s", filename);
+	ni_string_array_append(&conf->files, filename);
 	doc = xml_document_read(filename);
 	if (!doc) {
 		ni_error("%s: error parsing configuration file", filename);
@@ -297,8 +335,10 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 				goto failed;
 			/* If the file is marked as optional, but does not exist, silently
 			 * skip it */
-			if (optional && !ni_file_exists(path))
+			if (optional && !ni_file_exists(path)) {
+				ni_string_array_append(&conf->files, path);
 				continue;
+			}
 			if (!__ni_config_parse(conf, path, cb, appdata))
 				goto failed;
 		} else
@@ -375,6 +415,10 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 				if (!strcmp(gchild->name, "auto6")
 				 && !ni_config_parse_addrconf_auto6(&conf->addrconf.auto6, gchild))
 					goto failed;
+
+				if (!strcmp(gchild->name, "lease-file")
+				 && !ni_config_parse_lease_file(&conf->addrconf.lease_file, gchild))
+					goto failed;
 			}
 		} else
 		if (strcmp(child->name, "sources") == 0) {
@@ -405,6 +449,30 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 			if (!ni_config_parse_rtnl_event(&conf->rtnl_event, child))
 				goto failed;
 		} else
+		if (strcmp(child->name, "packet-capture") == 0) {
+			if (!ni_config_parse_packet_capture(&conf->packet_capture, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "client-state") == 0) {
+			if (!ni_config_parse_client_state(&conf->client_state, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "warm-restart") == 0) {
+			if (!ni_config_parse_warm_restart(&conf->warm_restart, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "link-stats") == 0) {
+			if (!ni_config_parse_link_stats(&conf->link_stats, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "metrics") == 0) {
+			if (!ni_config_parse_metrics(&conf->metrics, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "async-logging") == 0) {
+			if (!ni_config_parse_async_logging(&conf->async_logging, child))
+				goto failed;
+		} else
 		if (strcmp(child->name, "bonding") == 0) {
 			if (!ni_config_parse_bonding(&conf->bonding, child))
 				goto failed;
@@ -512,6 +580,58 @@ ni_config_dhcp4_cid_type_parse(ni_config_dhcp4_cid_type_t *type, const char *nam
 	return ni_parse_uint_mapped(name, config_dhcp6_cid_type_names, type);
 }
 
+/*
+ * dhcp lease renewal spreading options
+ */
+static const ni_intmap_t	config_dhcp_renew_spread_names[] = {
+	{ "none",		NI_CONFIG_DHCP_RENEW_SPREAD_NONE	},
+	{ "hashed",		NI_CONFIG_DHCP_RENEW_SPREAD_HASHED	},
+	{ "random",		NI_CONFIG_DHCP_RENEW_SPREAD_RANDOM	},
+	{ NULL,			-1U					}
+};
+
+const char *
+ni_config_dhcp_renew_spread_name(ni_config_dhcp_renew_spread_t spread)
+{
+	return ni_format_uint_mapped(spread, config_dhcp_renew_spread_names);
+}
+
+static void
+ni_config_parse_dhcp_renew(ni_config_dhcp_renew_t *renew, const xml_node_t *node, ni_bool_t global)
+{
+	const xml_node_t *child;
+	unsigned int value;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "spread")) {
+			if (ni_parse_uint_mapped(child->cdata, config_dhcp_renew_spread_names, &value) == 0)
+				renew->spread = value;
+			else
+				ni_warn("%s: invalid <renew><spread>%s</spread></renew> option",
+						xml_node_location(child), child->cdata);
+		} else
+		if (ni_string_eq(child->name, "jitter")) {
+			if (ni_parse_uint(child->cdata, &value, 10) == 0 &&
+			    value <= NI_CONFIG_DHCP_RENEW_JITTER_MAX)
+				renew->jitter = value;
+			else
+				ni_warn("%s: invalid <renew><jitter>%s</jitter></renew> option",
+						xml_node_location(child), child->cdata);
+		} else
+		if (ni_string_eq(child->name, "max-rate")) {
+			if (!global)
+				ni_warn("%s: <renew><max-rate> is a global option, ignored in <device>",
+						xml_node_location(child));
+			else
+			if (ni_parse_uint(child->cdata, &value, 10) == 0)
+				renew->max_rate = value;
+			else
+				ni_warn("%s: invalid <renew><max-rate>%s</max-rate></renew> option",
+						xml_node_location(child), child->cdata);
+		}
+	}
+}
+
 static ni_bool_t
 ni_config_parse_addrconf_dhcp4_nodes(ni_config_dhcp4_t *dhcp4, xml_node_t *node)
 {
@@ -529,6 +649,9 @@ ni_config_parse_addrconf_dhcp4_nodes(ni_config_dhcp4_t *dhcp4, xml_node_t *node)
 		if (!strcmp(child->name, "lease-time") && child->cdata)
 			dhcp4->lease_time = strtoul(child->cdata, NULL, 0);
 		else
+		if (!strcmp(child->name, "renew"))
+			ni_config_parse_dhcp_renew(&dhcp4->renew, child, !dhcp4->device);
+		else
 		if (!strcmp(child->name, "ignore-server")) {
 			if ((attrval = xml_node_get_attr(child, "ip")) != NULL)
 				ni_string_array_append(&dhcp4->ignore_servers, attrval);
@@ -1075,6 +1198,9 @@ ni_config_parse_addrconf_dhcp6_nodes(ni_config_dhcp6_t *dhcp6, xml_node_t *node)
 		if (!strcmp(child->name, "release-retransmits") && child->cdata) {
 			dhcp6->release_nretries = strtoul(child->cdata, NULL, 0);
 		} else
+		if (!strcmp(child->name, "renew")) {
+			ni_config_parse_dhcp_renew(&dhcp6->renew, child, !dhcp6->device);
+		} else
 		if (!strcmp(child->name, "ignore-server")
 		 && (attrval = xml_node_get_attr(child, "ip")) != NULL) {
 			ni_string_array_append(&dhcp6->ignore_servers, attrval);
@@ -1340,6 +1466,51 @@ ni_config_parse_extension(ni_extension_t *ex, xml_node_t *node)
 			}
 			value = xml_node_get_attr(child, "value");
 			ni_var_array_set(&ex->environment, name, value);
+		} else
+		if (!strcmp(child->name, "coprocess")) {
+			unsigned int instances = NI_COPROCESS_INSTANCES_DEFAULT;
+			unsigned int timeout = NI_COPROCESS_TIMEOUT_DEFAULT;
+			ni_bool_t reentrant = FALSE;
+			const char *command, *attr;
+
+			if (!(command = xml_node_get_attr(child, "command"))) {
+				ni_error("%s: <coprocess> element without command attribute",
+						xml_node_location(child));
+				return FALSE;
+			}
+			if ((attr = xml_node_get_attr(child, "instances")) &&
+			    (ni_parse_uint(attr, &instances, 10) || !instances ||
+			     instances > NI_COPROCESS_INSTANCES_MAX)) {
+				ni_error("%s: invalid <coprocess> instances \"%s\"",
+						xml_node_location(child), attr);
+				return FALSE;
+			}
+			if ((attr = xml_node_get_attr(child, "timeout")) &&
+			    ni_parse_uint(attr, &timeout, 10)) {
+				ni_error("%s: invalid <coprocess> timeout \"%s\"",
+						xml_node_location(child), attr);
+				return FALSE;
+			}
+			if ((attr = xml_node_get_attr(child, "reentrant")) &&
+			    ni_parse_boolean(attr, &reentrant)) {
+				ni_error("%s: invalid <coprocess> reentrant \"%s\"",
+						xml_node_location(child), attr);
+				return FALSE;
+			}
+
+			ni_coprocess_free(ex->coprocess);
+			if (!(ex->coprocess = ni_coprocess_new(command, instances, timeout, reentrant)))
+				return FALSE;
+		}
+	}
+
+	/* The scripts of the extension run as co-process calls */
+	if (ex->coprocess) {
+		ni_script_action_t *script;
+
+		for (script = ex->actions; script; script = script->next) {
+			ni_coprocess_free(script->process->coprocess);
+			script->process->coprocess = ni_coprocess_hold(ex->coprocess);
 		}
 	}
 
@@ -1400,7 +1571,7 @@ ni_bool_t
 ni_config_parse_system_updater(ni_extension_t **list, xml_node_t *node)
 {
 	ni_extension_t *ex;
-	const char *name;
+	const char *name, *attr;
 
 	if (!(name = xml_node_get_attr(node, "name"))) {
 		ni_error("%s: <%s> element lacks name attribute",
@@ -1413,6 +1584,14 @@ ni_config_parse_system_updater(ni_extension_t **list, xml_node_t *node)
 	/* If the updater has a format type, extract. */
 	ni_string_dup(&ex->format, xml_node_get_attr(node, "format"));
 
+	/* Time to wait for further lease events to coalesce with */
+	if ((attr = xml_node_get_attr(node, "settle")) &&
+	    ni_parse_uint(attr, &ex->settle, 10)) {
+		ni_error("%s: invalid <%s> settle time \"%s\"",
+				xml_node_location(node), node->name, attr);
+		return FALSE;
+	}
+
 	return ni_config_parse_extension(ex, node);
 }
 
@@ -1501,6 +1680,308 @@ ni_config_parse_rtnl_event(ni_config_rtnl_event_t *conf, xml_node_t *node)
 	return TRUE;
 }
 
+static ni_bool_t
+ni_config_parse_packet_capture(ni_config_packet_capture_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "rx-ring")) {
+			if (ni_parse_boolean(child->cdata, &conf->rx_ring)) {
+				ni_error("%s: invalid <packet-capture><rx-ring>%s</rx-ring></packet-capture> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "rx-ring-blocks")) {
+			if (ni_parse_uint(child->cdata, &conf->rx_ring_blocks, 0) ||
+			    conf->rx_ring_blocks < 2 || conf->rx_ring_blocks > 1024) {
+				ni_error("%s: invalid <packet-capture><rx-ring-blocks>%s</rx-ring-blocks></packet-capture> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "rx-ring-timeout")) {
+			if (ni_parse_uint(child->cdata, &conf->rx_ring_timeout, 0) ||
+			    conf->rx_ring_timeout == 0 || conf->rx_ring_timeout > 1000) {
+				ni_error("%s: invalid <packet-capture><rx-ring-timeout>%s</rx-ring-timeout></packet-capture> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "shared")) {
+			if (ni_parse_boolean(child->cdata, &conf->shared)) {
+				ni_error("%s: invalid <packet-capture><shared>%s</shared></packet-capture> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * lease file store options
+ */
+static const ni_intmap_t	config_lease_file_format_names[] = {
+	{ "xml",	NI_CONFIG_LEASE_FILE_FORMAT_XML		},
+	{ "binary",	NI_CONFIG_LEASE_FILE_FORMAT_BINARY	},
+	{ NULL,		-1U					}
+};
+
+static ni_bool_t
+ni_config_parse_lease_file(ni_config_lease_file_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int format;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "format")) {
+			if (ni_parse_uint_mapped(child->cdata, config_lease_file_format_names, &format)) {
+				ni_error("%s: invalid <lease-file><format>%s</format></lease-file> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			conf->format = format;
+		} else
+		if (ni_string_eq(child->name, "write-delay")) {
+			if (ni_parse_uint(child->cdata, &conf->write_delay, 0) ||
+			    conf->write_delay > 60000) {
+				ni_error("%s: invalid <lease-file><write-delay>%s</write-delay></lease-file> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "sync")) {
+			if (ni_parse_boolean(child->cdata, &conf->sync)) {
+				ni_error("%s: invalid <lease-file><sync>%s</sync></lease-file> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+const ni_config_lease_file_t *
+ni_config_lease_file(void)
+{
+	return ni_global.config ? &ni_global.config->addrconf.lease_file : NULL;
+}
+
+/*
+ * interface client-state store options
+ */
+static const ni_intmap_t	config_client_state_store_names[] = {
+	{ "files",	NI_CONFIG_CLIENT_STATE_STORE_FILES	},
+	{ "log",	NI_CONFIG_CLIENT_STATE_STORE_LOG	},
+	{ NULL,		-1U					}
+};
+
+static ni_bool_t
+ni_config_parse_client_state(ni_config_client_state_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int store;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "store")) {
+			if (ni_parse_uint_mapped(child->cdata, config_client_state_store_names, &store)) {
+				ni_error("%s: invalid <client-state><store>%s</store></client-state> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			conf->store = store;
+		} else
+		if (ni_string_eq(child->name, "sync")) {
+			if (ni_parse_boolean(child->cdata, &conf->sync)) {
+				ni_error("%s: invalid <client-state><sync>%s</sync></client-state> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+const ni_config_client_state_t *
+ni_config_client_state(void)
+{
+	return ni_global.config ? &ni_global.config->client_state : NULL;
+}
+
+/*
+ * wickedd netconfig snapshot options
+ */
+static ni_bool_t
+ni_config_parse_warm_restart(ni_config_warm_restart_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "enable")) {
+			if (ni_parse_boolean(child->cdata, &conf->enabled)) {
+				ni_error("%s: invalid <warm-restart><enable>%s</enable></warm-restart> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "refresh-batch")) {
+			if (ni_parse_uint(child->cdata, &conf->refresh_batch, 0) ||
+			    conf->refresh_batch == 0) {
+				ni_error("%s: invalid <warm-restart><refresh-batch>%s</refresh-batch></warm-restart> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "refresh-interval")) {
+			if (ni_parse_uint(child->cdata, &conf->refresh_interval, 0) ||
+			    conf->refresh_interval > 60000) {
+				ni_error("%s: invalid <warm-restart><refresh-interval>%s</refresh-interval></warm-restart> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+const ni_config_warm_restart_t *
+ni_config_warm_restart(void)
+{
+	return ni_global.config ? &ni_global.config->warm_restart : NULL;
+}
+
+/*
+ * bulk link statistics options
+ */
+static ni_bool_t
+ni_config_parse_link_stats(ni_config_link_stats_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "cache-time")) {
+			if (ni_parse_uint(child->cdata, &conf->cache_time, 0) ||
+			    conf->cache_time > 60000) {
+				ni_error("%s: invalid <link-stats><cache-time>%s</cache-time></link-stats> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+const ni_config_link_stats_t *
+ni_config_link_stats(void)
+{
+	return ni_global.config ? &ni_global.config->link_stats : NULL;
+}
+
+/*
+ * daemon metrics export options
+ */
+static ni_bool_t
+ni_config_parse_metrics(ni_config_metrics_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "enable")) {
+			if (ni_parse_boolean(child->cdata, &conf->enabled)) {
+				ni_error("%s: invalid <metrics><enable>%s</enable></metrics> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+const ni_config_metrics_t *
+ni_config_metrics(void)
+{
+	return ni_global.config ? &ni_global.config->metrics : NULL;
+}
+
+/*
+ * asynchronous logging options
+ */
+static const ni_intmap_t	config_async_logging_overflow_names[] = {
+	{ "drop",	NI_LOG_OVERFLOW_DROP	},
+	{ "block",	NI_LOG_OVERFLOW_BLOCK	},
+	{ NULL,		-1U			}
+};
+
+static ni_bool_t
+ni_config_parse_async_logging(ni_config_async_logging_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int overflow;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "enable")) {
+			if (ni_parse_boolean(child->cdata, &conf->enabled)) {
+				ni_error("%s: invalid <async-logging><enable>%s</enable></async-logging> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "records")) {
+			if (ni_parse_uint(child->cdata, &conf->records, 0) ||
+			    conf->records < 16 || conf->records > 65536) {
+				ni_error("%s: invalid <async-logging><records>%s</records></async-logging> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "overflow")) {
+			if (ni_parse_uint_mapped(child->cdata, config_async_logging_overflow_names, &overflow)) {
+				ni_error("%s: invalid <async-logging><overflow>%s</overflow></async-logging> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			conf->overflow = overflow;
+		} else
+		if (ni_string_eq(child->name, "flight-recorder")) {
+			if (ni_parse_uint(child->cdata, &conf->flight_recorder, 0)) {
+				ni_error("%s: invalid <async-logging><flight-recorder>%s</flight-recorder></async-logging> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+const ni_config_async_logging_t *
+ni_config_async_logging(void)
+{
+	return ni_global.config ? &ni_global.config->async_logging : NULL;
+}
+
 /*
  * bonding support config options
  */
@@ -1907,6 +2388,15 @@ ni_config_use_nanny(void)
 	return ni_global.config ? ni_global.config->use_nanny : FALSE;
 }
 
+/*
+ * The config files read, e.g. for caches of data depending on them
+ */
+const ni_string_array_t *
+ni_config_files(void)
+{
+	return ni_global.config ? &ni_global.config->files : NULL;
+}
+
 void
 ni_config_fslocation_init(ni_config_fslocation_t *loc, const char *path, unsigned int mode)
 {
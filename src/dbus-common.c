@@ -584,13 +584,13 @@ __ni_dbus_array_grow(ni_dbus_variant_t *var, size_t element_size, unsigned int g
 		void *new_data;
 
 		max = NI_DBUS_ARRAY_ALLOCATION(len + grow_by);
-		new_data = xcalloc(max, element_size);
+		new_data = xcalloc_tagged(NI_MEMTAG_DBUS_ARRAY, max, element_size);
 		if (new_data == NULL)
 			ni_fatal("%s: out of memory try to grow array to %u elements",
 					__FUNCTION__, len + grow_by);
 
 		memcpy(new_data, var->byte_array_value, len * element_size);
-		free(var->byte_array_value);
+		xfree_tagged(NI_MEMTAG_DBUS_ARRAY, var->byte_array_value);
 		var->byte_array_value = new_data;
 	}
 }
@@ -751,18 +751,18 @@ ni_dbus_variant_destroy(ni_dbus_variant_t *var)
 
 		switch (var->array.element_type) {
 		case DBUS_TYPE_BYTE:
-			free(var->byte_array_value);
+			xfree_tagged(NI_MEMTAG_DBUS_ARRAY, var->byte_array_value);
 			break;
 		case DBUS_TYPE_STRING:
 		case DBUS_TYPE_OBJECT_PATH:
 			for (i = 0; i < var->array.len; ++i)
 				free(var->string_array_value[i]);
-			free(var->string_array_value);
+			xfree_tagged(NI_MEMTAG_DBUS_ARRAY, var->string_array_value);
 			break;
 		case DBUS_TYPE_DICT_ENTRY:
 			for (i = 0; i < var->array.len; ++i)
 				ni_dbus_variant_destroy(&var->dict_array_value[i].datum);
-			free(var->dict_array_value);
+			xfree_tagged(NI_MEMTAG_DBUS_ARRAY, var->dict_array_value);
 			break;
 		case DBUS_TYPE_INVALID:
 			if (var->array.element_signature == NULL)
@@ -771,18 +771,24 @@ ni_dbus_variant_destroy(ni_dbus_variant_t *var)
 		case DBUS_TYPE_VARIANT:
 			for (i = 0; i < var->array.len; ++i)
 				ni_dbus_variant_destroy(&var->variant_array_value[i]);
-			free(var->variant_array_value);
+			xfree_tagged(NI_MEMTAG_DBUS_ARRAY, var->variant_array_value);
 			break;
 		case DBUS_TYPE_STRUCT:
 			for (i = 0; i < var->array.len; ++i)
 				ni_dbus_variant_destroy(&var->struct_value[i]);
-			free(var->struct_value);
+			xfree_tagged(NI_MEMTAG_DBUS_ARRAY, var->struct_value);
 			break;
 		default:
 			ni_warn("Don't know how to destroy this type of array");
 			break;
 		}
 		ni_string_free(&var->array.element_signature);
+	} else if (var->type == DBUS_TYPE_STRUCT) {
+		unsigned int i;
+
+		for (i = 0; i < var->array.len; ++i)
+			ni_dbus_variant_destroy(&var->struct_value[i]);
+		xfree_tagged(NI_MEMTAG_DBUS_ARRAY, var->struct_value);
 	}
 
 	if (var->__message)
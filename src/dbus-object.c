@@ -38,7 +38,7 @@ __ni_dbus_object_new(const ni_dbus_class_t *class, const char *path)
 {
 	ni_dbus_object_t *object;
 
-	object = xcalloc(1, sizeof(*object));
+	object = xcalloc_tagged(NI_MEMTAG_DBUS_OBJECT, 1, sizeof(*object));
 	ni_string_dup(&object->path, path);
 	object->class = class;
 	return object;
@@ -120,7 +120,7 @@ __ni_dbus_object_free(ni_dbus_object_t *object)
 		__ni_dbus_object_free(child);
 
 	free(object->interfaces);
-	free(object);
+	xfree_tagged(NI_MEMTAG_DBUS_OBJECT, object);
 }
 
 /*
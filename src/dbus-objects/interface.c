@@ -23,10 +23,12 @@
 #include <wicked/dbus-service.h>
 #include <wicked/system.h>
 #include <wicked/xml.h>
+#include <wicked/linkstats.h>
 #include "netinfo_priv.h"
 #include "dbus-common.h"
 #include "xml-schema.h"
 #include "appconfig.h"
+#include "ifstats.h"
 #include "model.h"
 #include "debug.h"
 
@@ -458,10 +460,125 @@ ni_objectmodel_netif_list_get_addresses(ni_dbus_object_t *object, const ni_dbus_
 	return rv;
 }
 
+/*
+ * InterfaceList.getStatistics
+ */
+static dbus_bool_t
+ni_objectmodel_netif_list_get_statistics_args(const ni_dbus_variant_t *args,
+					dbus_bool_t *refresh, dbus_bool_t *xstats)
+{
+	if (!ni_dbus_variant_is_dict(args))
+		return FALSE;
+
+	ni_dbus_dict_get_bool(args, "refresh", refresh);
+	ni_dbus_dict_get_bool(args, "xstats", xstats);
+
+	return TRUE;
+}
+
+static void
+ni_objectmodel_netif_link_stats_to_dict(const ni_link_stats_t *s, ni_dbus_variant_t *dict)
+{
+	ni_dbus_dict_add_uint64(dict, "rx-packets", s->rx_packets);
+	ni_dbus_dict_add_uint64(dict, "tx-packets", s->tx_packets);
+	ni_dbus_dict_add_uint64(dict, "rx-bytes", s->rx_bytes);
+	ni_dbus_dict_add_uint64(dict, "tx-bytes", s->tx_bytes);
+	ni_dbus_dict_add_uint64(dict, "rx-errors", s->rx_errors);
+	ni_dbus_dict_add_uint64(dict, "tx-errors", s->tx_errors);
+	ni_dbus_dict_add_uint64(dict, "rx-dropped", s->rx_dropped);
+	ni_dbus_dict_add_uint64(dict, "tx-dropped", s->tx_dropped);
+	ni_dbus_dict_add_uint64(dict, "multicast", s->multicast);
+	ni_dbus_dict_add_uint64(dict, "collisions", s->collisions);
+	ni_dbus_dict_add_uint64(dict, "rx-length-errors", s->rx_length_errors);
+	ni_dbus_dict_add_uint64(dict, "rx-over-errors", s->rx_over_errors);
+	ni_dbus_dict_add_uint64(dict, "rx-crc-errors", s->rx_crc_errors);
+	ni_dbus_dict_add_uint64(dict, "rx-frame-errors", s->rx_frame_errors);
+	ni_dbus_dict_add_uint64(dict, "rx-fifo-errors", s->rx_fifo_errors);
+	ni_dbus_dict_add_uint64(dict, "rx-missed-errors", s->rx_missed_errors);
+	ni_dbus_dict_add_uint64(dict, "tx-aborted-errors", s->tx_aborted_errors);
+	ni_dbus_dict_add_uint64(dict, "tx-carrier-errors", s->tx_carrier_errors);
+	ni_dbus_dict_add_uint64(dict, "tx-fifo-errors", s->tx_fifo_errors);
+	ni_dbus_dict_add_uint64(dict, "tx-heartbeat-errors", s->tx_heartbeat_errors);
+	ni_dbus_dict_add_uint64(dict, "tx-window-errors", s->tx_window_errors);
+	ni_dbus_dict_add_uint64(dict, "rx-compressed", s->rx_compressed);
+	ni_dbus_dict_add_uint64(dict, "tx-compressed", s->tx_compressed);
+}
+
+static dbus_bool_t
+ni_objectmodel_netif_list_get_statistics(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	dbus_bool_t refresh = TRUE;
+	dbus_bool_t xstats = FALSE;
+	ni_netdev_t *dev;
+	dbus_bool_t rv;
+
+	if (!reply || !argv || argc != 1 ||
+	    !ni_objectmodel_netif_list_get_statistics_args(&argv[0], &refresh, &xstats)) {
+		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
+				"%s.%s: invalid refresh and xstats argument dict",
+				object->path, method->name);
+		return FALSE;
+	}
+
+	NI_TRACE_ENTER_ARGS("refresh=%s, xstats=%s",
+			ni_format_boolean(refresh), ni_format_boolean(xstats));
+
+	/* one (cached) statistics dump for all interfaces */
+	if (refresh && (!nc || ni_ifstats_refresh(nc, NI_IFSTATS_LINK |
+					(xstats ? NI_IFSTATS_XSTATS : 0)) < 0)) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "Unable to refresh interface statistics");
+		return FALSE;
+	}
+
+	ni_dbus_variant_init_dict(&result);
+	for (dev = nc ? ni_netconfig_devlist(nc) : NULL; dev; dev = dev->next) {
+		ni_dbus_variant_t *dict, *stats;
+		const char *path;
+		unsigned int i;
+
+		path = ni_objectmodel_netif_full_path(dev);
+		if (ni_string_empty(path) || !dev->link.stats)
+			continue;
+
+		if (!(dict = ni_dbus_dict_add(&result, path)))
+			break;
+
+		ni_dbus_variant_init_dict(dict);
+		ni_dbus_dict_add_string(dict, "name",  dev->name);
+		ni_dbus_dict_add_uint32(dict, "index", dev->link.ifindex);
+
+		if (!(stats = ni_dbus_dict_add(dict, "link")))
+			break;
+		ni_dbus_variant_init_dict(stats);
+		ni_objectmodel_netif_link_stats_to_dict(dev->link.stats, stats);
+
+		if (!xstats || !dev->link.xstats || !dev->link.xstats->count)
+			continue;
+
+		if (!(stats = ni_dbus_dict_add(dict, "xstats")))
+			break;
+		ni_dbus_variant_init_dict(stats);
+		for (i = 0; i < dev->link.xstats->count; ++i) {
+			const ni_link_xstat_t *xs = &dev->link.xstats->data[i];
+
+			ni_dbus_dict_add_uint64(stats, xs->name, xs->value);
+		}
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
 static ni_dbus_method_t		ni_objectmodel_netif_list_methods[] = {
 	{ "deviceByName",	"s",		.handler = ni_objectmodel_netif_list_device_by_name },
 	{ "identifyDevice",	"sa{sv}",	.handler = ni_objectmodel_netif_list_identify_device },
 	{ "getAddresses",	"a{sv}",	.handler = ni_objectmodel_netif_list_get_addresses },
+	{ "getStatistics",	"a{sv}",	.handler = ni_objectmodel_netif_list_get_statistics },
 	{ NULL }
 };
 
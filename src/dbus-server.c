@@ -11,11 +11,13 @@
 #include <wicked/logging.h>
 #include <wicked/dbus-service.h>
 #include <wicked/dbus-errors.h>
+#include <wicked/objectmodel.h>
 #include "dbus-server.h"
 #include "dbus-object.h"
 #include "dbus-dict.h"
 #include "debug.h"
 #include "util_priv.h"
+#include "metrics.h"
 
 
 struct ni_dbus_server_object {
@@ -33,6 +35,7 @@ struct ni_dbus_server {
 
 static dbus_bool_t		ni_dbus_object_register_object_manager(ni_dbus_object_t *);
 static dbus_bool_t		ni_dbus_object_register_introspectable_interface(ni_dbus_object_t *);
+static dbus_bool_t		ni_dbus_object_register_metrics_interface(ni_dbus_object_t *);
 static const char *		__ni_dbus_server_root_path(const char *);
 static void			__ni_dbus_server_object_init(ni_dbus_object_t *object, ni_dbus_server_t *server);
 
@@ -58,6 +61,7 @@ ni_dbus_server_open(const char *bus_type, const char *bus_name, void *root_objec
 	/* Translate bus name foo.bar.baz into object path /foo/bar/baz */
 	root = ni_dbus_object_new(&dbus_root_object_class, __ni_dbus_server_root_path(bus_name), root_object_handle);
 	__ni_dbus_server_object_init(root, server);
+	ni_dbus_object_register_metrics_interface(root);
 	__ni_dbus_object_insert(&server->root_object, root);
 
 	return server;
@@ -216,6 +220,7 @@ ni_dbus_server_register_object(ni_dbus_server_t *server, const char *object_path
 static const ni_dbus_service_t __ni_dbus_object_manager_interface;
 static const ni_dbus_service_t __ni_dbus_object_properties_interface;
 static const ni_dbus_service_t __ni_dbus_object_introspectable_interface;
+static const ni_dbus_service_t __ni_dbus_object_metrics_interface;
 static dbus_bool_t		__ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *,
 					ni_dbus_variant_t *dict, DBusError *);
 
@@ -238,6 +243,12 @@ ni_dbus_object_register_introspectable_interface(ni_dbus_object_t *object)
 	return ni_dbus_object_register_service(object, &__ni_dbus_object_introspectable_interface);
 }
 
+dbus_bool_t
+ni_dbus_object_register_metrics_interface(ni_dbus_object_t *object)
+{
+	return ni_dbus_object_register_service(object, &__ni_dbus_object_metrics_interface);
+}
+
 const ni_dbus_service_t *
 ni_dbus_get_standard_service(const char *name)
 {
@@ -245,6 +256,7 @@ ni_dbus_get_standard_service(const char *name)
 		&__ni_dbus_object_manager_interface,
 		&__ni_dbus_object_properties_interface,
 		&__ni_dbus_object_introspectable_interface,
+		&__ni_dbus_object_metrics_interface,
 
 		NULL
 	};
@@ -505,6 +517,46 @@ static const ni_dbus_service_t __ni_dbus_object_introspectable_interface = {
 	.methods = __ni_dbus_object_introspectable_methods,
 };
 
+/*
+ * The built-in Metrics interface of the server root object
+ */
+static dbus_bool_t
+__ni_dbus_object_metrics_get_metrics(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+		unsigned int argc, const ni_dbus_variant_t *argv,
+		ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_stringbuf_t data = NI_STRINGBUF_INIT_DYNAMIC;
+
+	ni_metrics_format(&data);
+	ni_dbus_message_append_string(reply, data.string ? data.string : "");
+	ni_stringbuf_destroy(&data);
+	return TRUE;
+}
+
+static dbus_bool_t
+__ni_dbus_object_metrics_get_memory_usage(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+		unsigned int argc, const ni_dbus_variant_t *argv,
+		ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_stringbuf_t data = NI_STRINGBUF_INIT_DYNAMIC;
+
+	ni_memstat_format(&data);
+	ni_dbus_message_append_string(reply, data.string ? data.string : "");
+	ni_stringbuf_destroy(&data);
+	return TRUE;
+}
+
+static ni_dbus_method_t	__ni_dbus_object_metrics_methods[] = {
+	{ "GetMetrics",		"",		.handler = __ni_dbus_object_metrics_get_metrics },
+	{ "GetMemoryUsage",	"",		.handler = __ni_dbus_object_metrics_get_memory_usage },
+	{ NULL }
+};
+
+static const ni_dbus_service_t __ni_dbus_object_metrics_interface = {
+	.name = NI_OBJECTMODEL_NAMESPACE ".Metrics",
+	.methods = __ni_dbus_object_metrics_methods,
+};
+
 dbus_bool_t
 __ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *object, ni_dbus_variant_t *obj_dict, DBusError *error)
 {
@@ -577,6 +629,7 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 	const ni_dbus_service_t *svc;
 	ni_dbus_server_t *server;
 	dbus_bool_t rv = FALSE;
+	double begin;
 
 	/* Clean out deceased objects */
 	ni_dbus_objects_garbage_collect();
@@ -596,6 +649,8 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 	}
 
 	server = ni_dbus_object_get_server(object);
+	ni_metrics_inc(NI_METRIC_DBUS_CALLS);
+	begin = ni_metrics_time();
 
 	method = ni_dbus_service_get_method(svc, method_name);
 	if (method == NULL
@@ -686,8 +741,10 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 		}
 	}
 
+	ni_metrics_observe_since(NI_METRIC_DBUS_CALL_DURATION, begin);
 	if (!rv) {
 error_reply:
+		ni_metrics_inc(NI_METRIC_DBUS_CALL_ERRORS);
 		if (reply)
 			dbus_message_unref(reply);
 		if (!dbus_error_is_set(&error))
@@ -1773,7 +1773,7 @@ ni_dbus_xml_expand_element_reference(xml_node_t *doc_node, const char *expr_stri
 	if (xml_node_is_empty(doc_node))
 		return 0;
 
-	expression = xpath_expression_parse(expr_string);
+	expression = xpath_expression_compile(expr_string);
 	if (expression == NULL)
 		return -NI_ERROR_DOCUMENT_ERROR;
 
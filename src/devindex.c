@@ -0,0 +1,249 @@
+/*
+ *	Hash index of the device handles of an addrconf supplicant
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wicked/util.h>
+#include "util_priv.h"
+#include "devindex.h"
+
+#define NI_DEVINDEX_SIZE_MIN	64
+
+struct ni_devindex_entry {
+	ni_devindex_entry_t *	index_next;
+	ni_devindex_entry_t *	name_next;
+	unsigned int		ifindex;
+	unsigned int		hash;
+	char *			ifname;
+	void *			dev;
+};
+
+static inline unsigned int
+ni_devindex_ifindex_hash(unsigned int ifindex)
+{
+	ifindex ^= ifindex >> 16;
+	ifindex *= 0x45d9f3bU;
+	ifindex ^= ifindex >> 16;
+	return ifindex;
+}
+
+/*
+ * Append to the tail of the bucket chains, so the first added
+ * handle of duplicate keys is found first.
+ */
+static void
+ni_devindex_link_index(ni_devindex_entry_t **table, unsigned int size, ni_devindex_entry_t *entry)
+{
+	ni_devindex_entry_t **pos;
+
+	pos = &table[ni_devindex_ifindex_hash(entry->ifindex) & (size - 1)];
+	while (*pos)
+		pos = &(*pos)->index_next;
+	entry->index_next = NULL;
+	*pos = entry;
+}
+
+static void
+ni_devindex_link_name(ni_devindex_entry_t **table, unsigned int size, ni_devindex_entry_t *entry)
+{
+	ni_devindex_entry_t **pos;
+
+	pos = &table[entry->hash & (size - 1)];
+	while (*pos)
+		pos = &(*pos)->name_next;
+	entry->name_next = NULL;
+	*pos = entry;
+}
+
+static void
+ni_devindex_unlink_name(ni_devindex_t *index, ni_devindex_entry_t *entry)
+{
+	ni_devindex_entry_t **pos;
+
+	for (pos = &index->by_name[entry->hash & (index->size - 1)]; *pos; pos = &(*pos)->name_next) {
+		if (*pos == entry) {
+			*pos = entry->name_next;
+			break;
+		}
+	}
+}
+
+static void
+ni_devindex_resize(ni_devindex_t *index, unsigned int size)
+{
+	ni_devindex_entry_t **by_index, **by_name, *entry, *next;
+	unsigned int i;
+
+	by_index = xcalloc(size, sizeof(*by_index));
+	by_name = xcalloc(size, sizeof(*by_name));
+
+	for (i = 0; i < index->size; ++i) {
+		for (entry = index->by_index[i]; entry; entry = next) {
+			next = entry->index_next;
+			ni_devindex_link_index(by_index, size, entry);
+		}
+		for (entry = index->by_name[i]; entry; entry = next) {
+			next = entry->name_next;
+			ni_devindex_link_name(by_name, size, entry);
+		}
+	}
+
+	free(index->by_index);
+	free(index->by_name);
+	index->by_index = by_index;
+	index->by_name = by_name;
+	index->size = size;
+}
+
+void
+ni_devindex_add(ni_devindex_t *index, unsigned int ifindex, const char *ifname, void *dev)
+{
+	ni_devindex_entry_t *entry;
+
+	if (!index || !dev)
+		return;
+
+	if (index->count >= index->size)
+		ni_devindex_resize(index, index->size ? index->size << 1 : NI_DEVINDEX_SIZE_MIN);
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->ifindex = ifindex;
+	entry->ifname = ifname ? xstrdup(ifname) : NULL;
+	entry->hash = ni_string_hash(ifname);
+	entry->dev = dev;
+
+	ni_devindex_link_index(index->by_index, index->size, entry);
+	ni_devindex_link_name(index->by_name, index->size, entry);
+	index->count++;
+}
+
+static ni_devindex_entry_t *
+ni_devindex_entry(const ni_devindex_t *index, unsigned int ifindex, void *dev)
+{
+	ni_devindex_entry_t *entry;
+
+	if (!index || !index->size)
+		return NULL;
+
+	entry = index->by_index[ni_devindex_ifindex_hash(ifindex) & (index->size - 1)];
+	for ( ; entry; entry = entry->index_next) {
+		if (entry->dev == dev)
+			return entry;
+	}
+	return NULL;
+}
+
+void
+ni_devindex_rename(ni_devindex_t *index, unsigned int ifindex, const char *ifname, void *dev)
+{
+	ni_devindex_entry_t *entry;
+
+	if (!(entry = ni_devindex_entry(index, ifindex, dev)))
+		return;
+
+	ni_devindex_unlink_name(index, entry);
+	ni_string_dup(&entry->ifname, ifname);
+	entry->hash = ni_string_hash(ifname);
+	ni_devindex_link_name(index->by_name, index->size, entry);
+}
+
+void
+ni_devindex_remove(ni_devindex_t *index, unsigned int ifindex, void *dev)
+{
+	ni_devindex_entry_t **pos, *entry;
+
+	if (!(entry = ni_devindex_entry(index, ifindex, dev)))
+		return;
+
+	pos = &index->by_index[ni_devindex_ifindex_hash(ifindex) & (index->size - 1)];
+	for ( ; *pos; pos = &(*pos)->index_next) {
+		if (*pos == entry) {
+			*pos = entry->index_next;
+			break;
+		}
+	}
+	ni_devindex_unlink_name(index, entry);
+
+	ni_string_free(&entry->ifname);
+	free(entry);
+
+	if (--index->count == 0)
+		ni_devindex_destroy(index);
+}
+
+void *
+ni_devindex_by_index(const ni_devindex_t *index, unsigned int ifindex)
+{
+	ni_devindex_entry_t *entry;
+
+	if (!index || !index->size)
+		return NULL;
+
+	entry = index->by_index[ni_devindex_ifindex_hash(ifindex) & (index->size - 1)];
+	for ( ; entry; entry = entry->index_next) {
+		if (entry->ifindex == ifindex)
+			return entry->dev;
+	}
+	return NULL;
+}
+
+void *
+ni_devindex_by_name(const ni_devindex_t *index, const char *ifname)
+{
+	ni_devindex_entry_t *entry;
+	unsigned int hash;
+
+	if (!index || !index->size || !ifname)
+		return NULL;
+
+	hash = ni_string_hash(ifname);
+	entry = index->by_name[hash & (index->size - 1)];
+	for ( ; entry; entry = entry->name_next) {
+		if (entry->hash == hash && ni_string_eq(entry->ifname, ifname))
+			return entry->dev;
+	}
+	return NULL;
+}
+
+void
+ni_devindex_destroy(ni_devindex_t *index)
+{
+	ni_devindex_entry_t *entry, *next;
+	unsigned int i;
+
+	if (!index)
+		return;
+
+	for (i = 0; i < index->size; ++i) {
+		for (entry = index->by_index[i]; entry; entry = next) {
+			next = entry->index_next;
+			ni_string_free(&entry->ifname);
+			free(entry);
+		}
+	}
+	free(index->by_index);
+	free(index->by_name);
+	memset(index, 0, sizeof(*index));
+}
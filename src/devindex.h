@@ -0,0 +1,49 @@
+/*
+ *	Hash index of the device handles of an addrconf supplicant
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifndef NI_DEVINDEX_H
+#define NI_DEVINDEX_H
+
+#include <wicked/types.h>
+
+/*
+ * Maps the interface index and name to the device handle, next to
+ * the list of the handles, which is kept for iteration. The lookups
+ * return the handle added first, as a scan of the list would.
+ */
+typedef struct ni_devindex_entry	ni_devindex_entry_t;
+
+typedef struct ni_devindex {
+	unsigned int			count;
+	unsigned int			size;
+	ni_devindex_entry_t **		by_index;
+	ni_devindex_entry_t **		by_name;
+} ni_devindex_t;
+
+#define NI_DEVINDEX_INIT		{ .count = 0, .size = 0, .by_index = NULL, .by_name = NULL }
+
+extern void		ni_devindex_add(ni_devindex_t *, unsigned int, const char *, void *);
+extern void		ni_devindex_rename(ni_devindex_t *, unsigned int, const char *, void *);
+extern void		ni_devindex_remove(ni_devindex_t *, unsigned int, void *);
+extern void *		ni_devindex_by_index(const ni_devindex_t *, unsigned int);
+extern void *		ni_devindex_by_name(const ni_devindex_t *, const char *);
+extern void		ni_devindex_destroy(ni_devindex_t *);
+
+#endif /* NI_DEVINDEX_H */
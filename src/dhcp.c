@@ -38,6 +38,8 @@
 #include <wicked/address.h>
 #include <wicked/logging.h>
 #include <wicked/xml.h>
+#include <wicked/socket.h>
+#include "appconfig.h"
 #include "dhcp.h"
 #include "buffer.h"
 
@@ -1876,3 +1878,97 @@ ni_dhcp_check_user_class_id(const char *id, size_t len)
 	return TRUE;
 }
 
+
+/*
+ * Spread the lease renewals of clients, which got their leases at
+ * the same time (boot of a rack, server failover), over a window
+ * of jitter percent before the T1/T2 times the server has sent.
+ * RFC 2131, 4.4.5 asks to add some random "fuzz" to the times.
+ *
+ * The hashed policy uses an offset derived from a hash over the
+ * client/IA identifiers, which stays the same for each renewal;
+ * the random one mixes in a per-process seed and a salt.
+ */
+uint32_t
+ni_dhcp_renew_hash(uint32_t hash, const void *data, size_t len)
+{
+	if (!hash)
+		hash = NI_HASH_FNV1A_INIT;
+	return data ? ni_hash_fnv1a(hash, data, len) : hash;
+}
+
+static uint32_t
+ni_dhcp_renew_mix(uint32_t hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x7feb352dU;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bU;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+unsigned int
+ni_dhcp_renew_spread(const ni_config_dhcp_renew_t *renew, unsigned int seconds,
+			uint32_t hash, uint32_t salt)
+{
+	static uint32_t seed;
+	uint64_t window;
+
+	if (!renew || !renew->jitter || !seconds || seconds == -1U)
+		return seconds;
+
+	switch (renew->spread) {
+	case NI_CONFIG_DHCP_RENEW_SPREAD_HASHED:
+		hash = ni_dhcp_renew_mix(hash);
+		break;
+	case NI_CONFIG_DHCP_RENEW_SPREAD_RANDOM:
+		if (!seed)
+			seed = random() | 1;
+		hash = ni_dhcp_renew_mix(hash ^ ni_dhcp_renew_mix(seed ^ salt));
+		break;
+	case NI_CONFIG_DHCP_RENEW_SPREAD_NONE:
+	default:
+		return seconds;
+	}
+
+	window = (uint64_t)seconds * renew->jitter / 100;
+	return seconds - (unsigned int)((window * hash) >> 32);
+}
+
+/*
+ * Reserves the next renewal slot and returns the delay in msec
+ * the caller has to wait for it: up to rate renewals are sent at
+ * once, the following ones are paced at 1/rate second intervals.
+ */
+unsigned long
+ni_dhcp_renew_delay(ni_dhcp_renew_limit_t *limit, unsigned int rate)
+{
+	struct timeval now, burst, interval, wait;
+
+	if (!limit || !rate)
+		return 0;
+
+	ni_timer_get_time(&now);
+	interval.tv_sec  = 0;
+	interval.tv_usec = rate > 1 ? 1000000 / rate : 0;
+	if (rate == 1)
+		interval.tv_sec = 1;
+
+	if (timercmp(&limit->tat, &now, <))
+		limit->tat = now;
+
+	/* the slots within one second from now are free to use */
+	burst.tv_sec = 1;
+	burst.tv_usec = 0;
+	timersub(&burst, &interval, &burst);
+	timeradd(&now, &burst, &burst);
+
+	timerclear(&wait);
+	if (timercmp(&limit->tat, &burst, >))
+		timersub(&limit->tat, &burst, &wait);
+
+	timeradd(&limit->tat, &interval, &limit->tat);
+
+	return wait.tv_sec * 1000 + (wait.tv_usec + 999) / 1000;
+}
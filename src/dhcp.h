@@ -22,6 +22,7 @@
 #ifndef   WICKED_DHCP_H
 #define   WICKED_DHCP_H
 
+#include <sys/time.h>
 #include <wicked/addrconf.h>
 
 
@@ -144,4 +145,18 @@ extern ni_bool_t			ni_dhcp_domain_decode(ni_buffer_t *, char **);
 
 extern ni_bool_t			ni_dhcp_check_user_class_id(const char *, size_t);
 
+/*
+ * Lease renewal (T1/T2) spreading and rate limit
+ */
+struct ni_config_dhcp_renew;
+
+typedef struct ni_dhcp_renew_limit {
+	struct timeval			tat;	/* next renewal slot */
+} ni_dhcp_renew_limit_t;
+
+extern uint32_t				ni_dhcp_renew_hash(uint32_t, const void *, size_t);
+extern unsigned int			ni_dhcp_renew_spread(const struct ni_config_dhcp_renew *,
+								unsigned int, uint32_t, uint32_t);
+extern unsigned long			ni_dhcp_renew_delay(ni_dhcp_renew_limit_t *, unsigned int);
+
 #endif /* WICKED_DHCP_H */
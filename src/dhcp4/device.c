@@ -27,6 +27,7 @@
 #include "dhcp.h"
 #include "iaid.h"
 #include "duid.h"
+#include "devindex.h"
 
 
 static unsigned int	ni_dhcp4_do_bits(const ni_config_dhcp4_t *, unsigned int);
@@ -34,6 +35,7 @@ static const char *	ni_dhcp4_print_doflags(unsigned int);
 static void		ni_dhcp4_config_set_request_options(const char *, ni_uint_array_t *, const ni_string_array_t *);
 
 ni_dhcp4_device_t *	ni_dhcp4_active;
+static ni_devindex_t	ni_dhcp4_index = NI_DEVINDEX_INIT;
 
 /*
  * Create and destroy dhcp4 device handles
@@ -63,6 +65,7 @@ ni_dhcp4_device_new(const char *ifname, const ni_linkinfo_t *link)
 
 	/* append to end of list */
 	*pos = dev;
+	ni_devindex_add(&ni_dhcp4_index, dev->system.ifindex, dev->ifname, dev);
 
 	return dev;
 }
@@ -70,14 +73,13 @@ ni_dhcp4_device_new(const char *ifname, const ni_linkinfo_t *link)
 ni_dhcp4_device_t *
 ni_dhcp4_device_by_index(unsigned int ifindex)
 {
-	ni_dhcp4_device_t *dev;
-
-	for (dev = ni_dhcp4_active; dev; dev = dev->next) {
-		if (dev->system.ifindex == ifindex)
-			return dev;
-	}
+	return ni_devindex_by_index(&ni_dhcp4_index, ifindex);
+}
 
-	return NULL;
+ni_dhcp4_device_t *
+ni_dhcp4_device_find(const char *ifname)
+{
+	return ni_devindex_by_name(&ni_dhcp4_index, ifname);
 }
 
 static void
@@ -141,6 +143,7 @@ ni_dhcp4_device_free(ni_dhcp4_device_t *dev)
 	ni_debug_dhcp("%s: Deleting dhcp4 device with index %u",
 			dev->ifname, dev->link.ifindex);
 
+	ni_devindex_remove(&ni_dhcp4_index, dev->system.ifindex, dev);
 	ni_dhcp4_device_drop_buffer(dev);
 	ni_dhcp4_device_drop_lease(dev);
 	ni_dhcp4_device_drop_best_offer(dev);
@@ -290,6 +293,7 @@ ni_dhcp4_acquire(ni_dhcp4_device_t *dev, const ni_dhcp4_request_t *info)
 	config->route_priority = info->route_priority;
 	config->recover_lease = info->recover_lease;
 	config->release_lease = info->release_lease;
+	config->rapid_commit = info->rapid_commit;
 
 	config->max_lease_time = ni_dhcp4_config_max_lease_time();
 	if (config->max_lease_time == 0)
@@ -358,6 +362,7 @@ ni_dhcp4_acquire(ni_dhcp4_device_t *dev, const ni_dhcp4_request_t *info)
 		ni_trace("  update-flags    %s", ni_dhcp4_print_doflags(config->doflags));
 		ni_trace("  recover_lease   %s", config->recover_lease ? "true" : "false");
 		ni_trace("  release_lease   %s", config->release_lease ? "true" : "false");
+		ni_trace("  rapid_commit    %s", config->rapid_commit ? "true" : "false");
 	}
 	ni_dhcp4_config_set_request_options(dev->ifname, &config->request_options, &info->request_options);
 
@@ -568,6 +573,7 @@ ni_dhcp4_device_event(ni_dhcp4_device_t *dev, ni_netdev_t *ifp, ni_event_t event
 			ni_debug_dhcp("%s: Updating interface name to %s",
 					dev->ifname, ifp->name);
 			ni_string_dup(&dev->ifname, ifp->name);
+			ni_devindex_rename(&ni_dhcp4_index, dev->system.ifindex, dev->ifname, dev);
 		}
 		/* Does return -1 on failure. */
 		ni_dhcp4_device_refresh(dev);
@@ -674,6 +680,9 @@ ni_dhcp4_device_prepare_message(void *data)
 		ni_error("unable to build DHCP4 message");
 		return -1;
 	}
+
+	/* Drop replies to other transactions in the kernel */
+	ni_dhcp4_socket_update_filter(dev);
 	return 0;
 }
 
@@ -43,6 +43,7 @@ typedef struct ni_dhcp4_device {
 	struct {
 	    enum fsm_state	state;
 	    const ni_timer_t *	timer;
+	    ni_bool_t		renew_deferred;
 	} fsm;
 
 	struct {
@@ -143,6 +144,7 @@ struct ni_dhcp4_request {
 	unsigned int		lease_time;	/* to request specific lease time	*/
 	ni_bool_t		recover_lease;	/* recover and reuse existing lease	*/
 	ni_bool_t		release_lease;	/* release lease on drop request	*/
+	ni_bool_t		rapid_commit;	/* request a 2-message exchange	*/
 
 	/* Options controlling what to put into the lease request */
 	char *			clientid;
@@ -196,6 +198,7 @@ struct ni_dhcp4_config {
 	unsigned int		max_lease_time;
 	ni_bool_t		recover_lease;
 	ni_bool_t		release_lease;
+	ni_bool_t		rapid_commit;
 };
 
 enum ni_dhcp4_event {
@@ -228,10 +231,48 @@ extern int		ni_dhcp4_build_message(const ni_dhcp4_device_t *,
 extern void		ni_dhcp4_fsm_link_up(ni_dhcp4_device_t *);
 extern void		ni_dhcp4_fsm_link_down(ni_dhcp4_device_t *);
 
+/*
+ * Option index of a received message: the first pass records where
+ * the options are in the packet (incl. the overloaded sname/file areas)
+ * and picks up the fields needed to accept or drop it, without to
+ * allocate anything. The lease is decoded from it for the chosen
+ * message only; the packet buffer has to stay valid until then.
+ */
+#define NI_DHCP4_INDEX_SPANS	512
+
+typedef struct ni_dhcp4_option_span {
+	uint16_t		offset;
+	uint16_t		next;
+	uint8_t			code;
+	uint8_t			len;
+	uint8_t			area;
+} ni_dhcp4_option_span_t;
+
+typedef struct ni_dhcp4_option_index {
+	const ni_dhcp4_message_t *message;
+	const unsigned char *	options;
+
+	int			msg_type;
+	unsigned int		overload;
+	ni_bool_t		rapid_commit;
+	struct in_addr		server_id;
+	ni_opaque_t		client_id;
+
+	unsigned int		count;
+	uint16_t		first[256];
+	uint16_t		last[256];
+	ni_dhcp4_option_span_t	span[NI_DHCP4_INDEX_SPANS];
+} ni_dhcp4_option_index_t;
+
+extern int		ni_dhcp4_parse_index(const ni_dhcp4_message_t *, ni_buffer_t *,
+						ni_dhcp4_option_index_t *);
+extern int		ni_dhcp4_parse_lease(const ni_dhcp4_config_t *, const ni_dhcp4_option_index_t *,
+						ni_addrconf_lease_t **);
 extern int		ni_dhcp4_parse_response(const ni_dhcp4_config_t *, const ni_dhcp4_message_t *,
 						ni_buffer_t *, ni_addrconf_lease_t **);
 
 extern int		ni_dhcp4_socket_open(ni_dhcp4_device_t *);
+extern int		ni_dhcp4_socket_update_filter(ni_dhcp4_device_t *);
 
 extern ni_bool_t	ni_dhcp4_supported(const ni_netdev_t *);
 extern int		ni_dhcp4_device_start(ni_dhcp4_device_t *);
@@ -239,6 +280,7 @@ extern void		ni_dhcp4_device_stop(ni_dhcp4_device_t *);
 extern unsigned int	ni_dhcp4_device_uptime(const ni_dhcp4_device_t *, unsigned int);
 extern ni_dhcp4_device_t *ni_dhcp4_device_new(const char *, const ni_linkinfo_t *);
 extern ni_dhcp4_device_t *ni_dhcp4_device_by_index(unsigned int);
+extern ni_dhcp4_device_t *ni_dhcp4_device_find(const char *);
 extern ni_dhcp4_device_t *ni_dhcp4_device_get(ni_dhcp4_device_t *);
 extern void		ni_dhcp4_device_put(ni_dhcp4_device_t *);
 extern void		ni_dhcp4_device_event(ni_dhcp4_device_t *, ni_netdev_t *, ni_event_t);
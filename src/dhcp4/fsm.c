@@ -22,7 +22,10 @@
 #include <wicked/route.h>
 #include <netlink/netlink.h>
 #include "netinfo_priv.h"
+#include "appconfig.h"
 #include "buffer.h"
+#include "dhcp.h"
+#include "metrics.h"
 
 #include "dhcp4/dhcp4.h"
 #include "dhcp4/protocol.h"
@@ -42,6 +45,7 @@ static void		ni_dhcp4_send_event(enum ni_dhcp4_event, ni_dhcp4_device_t *, ni_ad
 static void		__ni_dhcp4_fsm_timeout(void *, const ni_timer_t *);
 
 static ni_dhcp4_event_handler_t *ni_dhcp4_fsm_event_handler;
+static ni_dhcp_renew_limit_t	ni_dhcp4_fsm_renew_limit;
 
 static void
 ni_dhcp4_defer_timeout(void *user_data, const ni_timer_t *timer)
@@ -70,12 +74,39 @@ ni_dhcp4_fsm_init_device(ni_dhcp4_device_t *dev)
 	}
 }
 
+/*
+ * Decode the lease of the message we're going to use from its index
+ */
+static ni_addrconf_lease_t *
+ni_dhcp4_fsm_parse_lease(ni_dhcp4_device_t *dev, const ni_dhcp4_option_index_t *index,
+			const char *sender)
+{
+	ni_addrconf_lease_t *lease = NULL;
+
+	if (ni_dhcp4_parse_lease(dev->config, index, &lease) < 0 || !lease) {
+		ni_error("%s: unable to parse DHCP4 response%s%s", dev->ifname,
+				sender ? " sender " : "", sender ? sender : "");
+		return NULL;
+	}
+	ni_string_dup(&lease->dhcp4.sender_hwa, sender);
+
+	/* set reqest client-id in the response early to have it in test mode */
+	if (!lease->dhcp4.client_id.len && dev->config->client_id.len) {
+		ni_opaque_set(&lease->dhcp4.client_id,	dev->config->client_id.data,
+							dev->config->client_id.len);
+	}
+	return lease;
+}
+
 int
 ni_dhcp4_fsm_process_dhcp4_packet(ni_dhcp4_device_t *dev, ni_buffer_t *msgbuf, ni_sockaddr_t *from)
 {
 	ni_dhcp4_message_t *message;
+	ni_dhcp4_option_index_t index;
 	ni_addrconf_lease_t *lease = NULL;
 	const char *sender = NULL;
+	char sender_hwa[128];
+	ni_bool_t rapid_ack, offered = FALSE;
 	int msg_code;
 
 	if (dev->fsm.state == NI_DHCP4_STATE_VALIDATING) {
@@ -109,18 +140,22 @@ ni_dhcp4_fsm_process_dhcp4_packet(ni_dhcp4_device_t *dev, ni_buffer_t *msgbuf, n
 		return -1;
 	}
 
-	msg_code = ni_dhcp4_parse_response(dev->config, message, msgbuf, &lease);
-	sender = ni_capture_from_hwaddr_print(from);
+	/* Index the options only; the lease is decoded from the index
+	 * for the offer or ack we are going to use.
+	 */
+	msg_code = ni_dhcp4_parse_index(message, msgbuf, &index);
+	if ((sender = ni_capture_from_hwaddr_print(from))) {
+		snprintf(sender_hwa, sizeof(sender_hwa), "%s", sender);
+		sender = sender_hwa;
+	}
 	if (msg_code < 0) {
 		/* Ignore this message, time out later */
 		ni_error("%s: unable to parse DHCP4 response%s%s", dev->ifname,
 				sender ? " sender " : "", sender ? sender : "");
 		return -1;
 	}
-	ni_string_dup(&lease->dhcp4.sender_hwa, sender);
-	sender = lease->dhcp4.sender_hwa;
 
-	if (dev->config->client_id.len && !lease->dhcp4.client_id.len) {
+	if (dev->config->client_id.len && !index.client_id.len) {
 		/*
 		 * https://tools.ietf.org/html/rfc6842:
 		 *
@@ -139,8 +174,8 @@ ni_dhcp4_fsm_process_dhcp4_packet(ni_dhcp4_device_t *dev, ni_buffer_t *msgbuf, n
 		 */
 		ni_debug_dhcp("%s: server does not send client-id back", dev->ifname);
 	} else
-	if (lease->dhcp4.client_id.len &&
-	    !ni_opaque_eq(&dev->config->client_id, &lease->dhcp4.client_id)) {
+	if (index.client_id.len &&
+	    !ni_opaque_eq(&dev->config->client_id, &index.client_id)) {
 		/*
 		 * https://tools.ietf.org/html/rfc6842:
 		 *
@@ -160,24 +195,24 @@ ni_dhcp4_fsm_process_dhcp4_packet(ni_dhcp4_device_t *dev, ni_buffer_t *msgbuf, n
 			ni_dhcp4_fsm_state_name(dev->fsm.state),
 			sender ? " sender " : "", sender ? sender : "");
 
-	if (lease->dhcp4.client_id.len) {
+	if (index.client_id.len) {
 		ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
 				"%s: and matching client id %s", dev->ifname,
-				ni_print_hex(lease->dhcp4.client_id.data,
-						lease->dhcp4.client_id.len));
-	}
-
-	/* set reqest client-id in the response early to have it in test mode */
-	if (!lease->dhcp4.client_id.len && dev->config->client_id.len) {
-		ni_opaque_set(&lease->dhcp4.client_id,	dev->config->client_id.data,
-							dev->config->client_id.len);
+				ni_print_hex(index.client_id.data,
+						index.client_id.len));
 	}
 
+	/* An ACK to our DISCOVER with rapid commit (RFC 4039) is an offer
+	 * the server already committed to; it is subject to the same checks.
+	 */
+	rapid_ack = msg_code == DHCP4_ACK && index.rapid_commit &&
+			dev->config->rapid_commit &&
+			dev->config->dry_run != NI_DHCP4_RUN_OFFER;
 
 	/* When receiving a DHCP4 OFFER, verify sender address against list of
 	 * servers to ignore, and preferred servers. */
-	if (msg_code == DHCP4_OFFER && dev->fsm.state == NI_DHCP4_STATE_SELECTING) {
-		struct in_addr srv_addr = lease->dhcp4.server_id;
+	if ((msg_code == DHCP4_OFFER || rapid_ack) && dev->fsm.state == NI_DHCP4_STATE_SELECTING) {
+		struct in_addr srv_addr = index.server_id;
 		const char *ipaddr = inet_ntoa(srv_addr);
 		ni_hwaddr_t hwaddr;
 		int weight = 0;
@@ -219,7 +254,7 @@ ni_dhcp4_fsm_process_dhcp4_packet(ni_dhcp4_device_t *dev, ni_buffer_t *msgbuf, n
 				weight = 100;
 
 			ni_debug_dhcp("%s: received lease offer from %s; server weight=%d (best offer=%d)",
-					dev->ifname, inet_ntoa(lease->dhcp4.server_id),
+					dev->ifname, inet_ntoa(srv_addr),
 					weight,	dev->best_offer.weight);
 
 			/* negative weight means never. */
@@ -229,18 +264,26 @@ ni_dhcp4_fsm_process_dhcp4_packet(ni_dhcp4_device_t *dev, ni_buffer_t *msgbuf, n
 			/* weight between 0 and 100 means maybe. */
 			if (weight < 100) {
 				if (dev->best_offer.weight < weight) {
+					if (!(lease = ni_dhcp4_fsm_parse_lease(dev, &index, sender)))
+						return -1;
 					ni_dhcp4_device_set_best_offer(dev, lease, weight);
 					return 0;
 				}
 				/* OK, but it is better than previous */
 			} else {
 				/* If the weight has maximum value, just accept this offer. */
+				if (!(lease = ni_dhcp4_fsm_parse_lease(dev, &index, sender)))
+					return -1;
 				ni_dhcp4_device_set_best_offer(dev, lease, weight);
 				lease = NULL;
+				offered = TRUE;
 			}
 		} else {
+			if (!(lease = ni_dhcp4_fsm_parse_lease(dev, &index, sender)))
+				return -1;
 			ni_dhcp4_device_set_best_offer(dev, lease, weight);
 			lease = NULL;
+			offered = TRUE;
 		}
 	}
 
@@ -286,10 +329,24 @@ ni_dhcp4_fsm_process_dhcp4_packet(ni_dhcp4_device_t *dev, ni_buffer_t *msgbuf, n
 		case NI_DHCP4_STATE_RENEWING:
 		case NI_DHCP4_STATE_REBINDING:
 		case NI_DHCP4_STATE_REBOOT:
+			if (!(lease = ni_dhcp4_fsm_parse_lease(dev, &index, sender)))
+				goto out;
 			ni_dhcp4_process_ack(dev, lease);
 			lease = NULL;
 			break;
 		case NI_DHCP4_STATE_SELECTING:
+			/* A rapid commit ACK accepted as best offer above;
+			 * a not (yet) good enough one gets requested later.
+			 */
+			if (!rapid_ack || !offered || !dev->best_offer.lease)
+				goto ignore;
+			lease = dev->best_offer.lease;
+			dev->best_offer.lease = NULL;
+			ni_dhcp4_device_drop_best_offer(dev);
+			ni_info("%s: Received rapid commit ack", dev->ifname);
+			ni_dhcp4_process_ack(dev, lease);
+			lease = NULL;
+			break;
 		case NI_DHCP4_STATE_VALIDATING:
 		case NI_DHCP4_STATE_BOUND:
 		case __NI_DHCP4_STATE_MAX:
@@ -448,6 +505,45 @@ ni_dhcp4_fsm_request(ni_dhcp4_device_t *dev, const ni_addrconf_lease_t *lease)
 	ni_dhcp4_device_send_message(dev, DHCP4_REQUEST, lease);
 }
 
+/*
+ * Spread the renewal and rebind times of the lease; the hashed offset
+ * is derived from the client-id (IAID and DUID in RFC 4361 mode) or
+ * the hardware address, the random one varies with the time the lease
+ * has been acquired. The lease keeps the times granted by the server.
+ */
+static unsigned int
+ni_dhcp4_fsm_spread(const ni_dhcp4_device_t *dev, const ni_addrconf_lease_t *lease,
+			unsigned int seconds)
+{
+	const ni_config_dhcp4_t *conf;
+	uint32_t hash;
+
+	conf = ni_config_dhcp4_find_device(dev->ifname);
+	if (!conf || conf->renew.spread == NI_CONFIG_DHCP_RENEW_SPREAD_NONE)
+		return seconds;
+
+	if (dev->config->client_id.len) {
+		hash = ni_dhcp_renew_hash(0, dev->config->client_id.data,
+						dev->config->client_id.len);
+	} else {
+		hash = ni_dhcp_renew_hash(0, dev->system.hwaddr.data,
+						dev->system.hwaddr.len);
+	}
+	return ni_dhcp_renew_spread(&conf->renew, seconds, hash, lease->time_acquired);
+}
+
+static unsigned int
+ni_dhcp4_fsm_renewal_time(const ni_dhcp4_device_t *dev, const ni_addrconf_lease_t *lease)
+{
+	return ni_dhcp4_fsm_spread(dev, lease, lease->dhcp4.renewal_time);
+}
+
+static unsigned int
+ni_dhcp4_fsm_rebind_time(const ni_dhcp4_device_t *dev, const ni_addrconf_lease_t *lease)
+{
+	return ni_dhcp4_fsm_spread(dev, lease, lease->dhcp4.rebind_time);
+}
+
 static ni_bool_t
 ni_dhcp4_fsm_renewal(ni_dhcp4_device_t *dev, ni_bool_t oneshot)
 {
@@ -455,7 +551,7 @@ ni_dhcp4_fsm_renewal(ni_dhcp4_device_t *dev, ni_bool_t oneshot)
 	time_t expire_time, deadline = now + 10;
 	ni_bool_t retry = FALSE;
 
-	expire_time = dev->lease->time_acquired + dev->lease->dhcp4.rebind_time;
+	expire_time = dev->lease->time_acquired + ni_dhcp4_fsm_rebind_time(dev, dev->lease);
 	if (expire_time > now || oneshot) {
 		ni_info("%s: Initiating renewal of DHCPv4 lease", dev->ifname);
 		if (expire_time > now && deadline > expire_time)
@@ -468,10 +564,37 @@ ni_dhcp4_fsm_renewal(ni_dhcp4_device_t *dev, ni_bool_t oneshot)
 	return retry;
 }
 
+/*
+ * Pace the renewals to the configured global max-rate; returns
+ * TRUE when the renewal has been deferred to a later slot.
+ */
+static ni_bool_t
+ni_dhcp4_fsm_renewal_defer(ni_dhcp4_device_t *dev)
+{
+	unsigned long delay;
+
+	if (dev->fsm.renew_deferred) {
+		dev->fsm.renew_deferred = FALSE;
+		return FALSE;
+	}
+
+	delay = ni_dhcp_renew_delay(&ni_dhcp4_fsm_renew_limit,
+				ni_global.config->addrconf.dhcp4.renew.max_rate);
+	if (!delay)
+		return FALSE;
+
+	ni_debug_dhcp("%s: deferring renewal of DHCPv4 lease by %lu msec",
+			dev->ifname, delay);
+	dev->fsm.renew_deferred = TRUE;
+	ni_dhcp4_fsm_set_timeout_msec(dev, delay);
+	return TRUE;
+}
+
 static void
 ni_dhcp4_fsm_renewal_init(ni_dhcp4_device_t *dev)
 {
 	dev->fsm.state = NI_DHCP4_STATE_RENEWING;
+	ni_metrics_inc(NI_METRIC_DHCP4_RENEWALS);
 	ni_dhcp4_new_xid(dev);
 	dev->start_time = time(NULL);
 	/* Send renewal request at least once */
@@ -657,6 +780,8 @@ ni_dhcp4_fsm_timeout(ni_dhcp4_device_t *dev)
 		break;
 
 	case NI_DHCP4_STATE_BOUND:
+		if (ni_dhcp4_fsm_renewal_defer(dev))
+			break;
 		ni_dhcp4_fsm_renewal_init(dev);
 		break;
 
@@ -862,9 +987,12 @@ ni_dhcp4_fsm_commit_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 			dev->defer.timer = NULL;
 		}
 		if (dev->config->dry_run == NI_DHCP4_RUN_NORMAL) {
+			unsigned int renewal = ni_dhcp4_fsm_renewal_time(dev, lease);
+
 			ni_debug_dhcp("%s: schedule renewal of lease in %u seconds",
-					dev->ifname, lease->dhcp4.renewal_time);
-			ni_dhcp4_fsm_set_timeout(dev, lease->dhcp4.renewal_time);
+					dev->ifname, renewal);
+			dev->fsm.renew_deferred = FALSE;
+			ni_dhcp4_fsm_set_timeout(dev, renewal);
 		}
 
 		/* If the user requested a specific route metric, apply it now */
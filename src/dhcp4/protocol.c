@@ -28,6 +28,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,6 +45,7 @@
 #include "dhcp.h"
 #include "buffer.h"
 #include "socket_priv.h"
+#include "util_priv.h"
 
 static void	ni_dhcp4_socket_recv(ni_socket_t *);
 
@@ -103,6 +105,7 @@ ni_dhcp4_socket_open(ni_dhcp4_device_t *dev)
 	prot_info.eth_protocol = ETHERTYPE_IP;
 	prot_info.ip_protocol = IPPROTO_UDP;
 	prot_info.ip_port = DHCP4_CLIENT_PORT;
+	prot_info.shared = TRUE;
 
 	if ((capture = dev->capture) != NULL) {
 		if (ni_capture_is_valid(capture, ETHERTYPE_IP))
@@ -120,6 +123,44 @@ ni_dhcp4_socket_open(ni_dhcp4_device_t *dev)
 	return 0;
 }
 
+/*
+ * Restrict the capture filter to replies to our current transaction,
+ * so the kernel drops replies for other clients on the same segment.
+ */
+int
+ni_dhcp4_socket_update_filter(ni_dhcp4_device_t *dev)
+{
+	ni_capture_match_t match[NI_CAPTURE_MATCH_MAX];
+	unsigned int count = 0;
+
+	if (!dev->capture)
+		return -1;
+
+	memset(match, 0, sizeof(match));
+	if (dev->dhcp4.xid) {
+		match[count].offset = offsetof(ni_dhcp4_message_t, xid);
+		match[count].len = sizeof(dev->dhcp4.xid);
+		memcpy(match[count].data, &dev->dhcp4.xid, sizeof(dev->dhcp4.xid));
+		count++;
+
+		switch (dev->system.hwaddr.type) {
+		case ARPHRD_ETHER:
+		case ARPHRD_IEEE802:
+			if (!dev->system.hwaddr.len || dev->system.hwaddr.len > sizeof(match[count].data))
+				break;
+			match[count].offset = offsetof(ni_dhcp4_message_t, chaddr);
+			match[count].len = dev->system.hwaddr.len;
+			memcpy(match[count].data, dev->system.hwaddr.data, dev->system.hwaddr.len);
+			count++;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return ni_capture_set_match(dev->capture, match, count);
+}
+
 /*
  * This callback is invoked from the socket code when we
  * detect an incoming DHCP4 packet on the raw socket.
@@ -214,11 +255,12 @@ ni_dhcp4_option_next(ni_buffer_t *bp, ni_buffer_t *optbuf)
 		return -1;
 	if (bp->head == bp->tail)
 		return DHCP4_END;
-	if (bp->tail - bp->head < 2)
-		goto underflow;
 
+	/* an END or PAD may be the last byte of an unpadded message */
 	code = bp->base[bp->head++];
 	if (code != DHCP4_PAD && code != DHCP4_END) {
+		if (bp->head == bp->tail)
+			goto underflow;
 		count = bp->base[bp->head++];
 		if (bp->tail - bp->head < count)
 			goto underflow;
@@ -762,6 +804,15 @@ __ni_dhcp4_build_msg_discover(const ni_dhcp4_device_t *dev,
 	if (__ni_dhcp4_build_msg_put_our_hostname(dev, msgbuf, &options->fqdn, options->hostname) < 0)
 		return -1;
 
+	/* Ask for a committed lease in an ACK to save the REQUEST
+	 * round trip; in offer dry-run mode we want the offer.
+	 */
+	if (options->rapid_commit && options->dry_run != NI_DHCP4_RUN_OFFER) {
+		ni_dhcp4_option_put_empty(msgbuf, DHCP4_RAPID_COMMIT);
+		ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
+				"%s: using rapid-commit", dev->ifname);
+	}
+
 	return 0;
 }
 
@@ -1798,52 +1849,38 @@ ni_dhcp4_apply_routes(ni_addrconf_lease_t *lease, ni_route_array_t *routes)
 }
 
 /*
- * Parse a DHCP4 response.
+ * Index the options of a DHCP4 response area, the options field or
+ * an overloaded sname/file field (RFC 2131, 4.1 and RFC 3396).
  */
-int
-ni_dhcp4_parse_response(const ni_dhcp4_config_t *config, const ni_dhcp4_message_t *message,
-			ni_buffer_t *options, ni_addrconf_lease_t **leasep)
-{
-	ni_buffer_t overload_buf;
-	ni_addrconf_lease_t *lease;
-	ni_route_array_t default_routes = NI_ROUTE_ARRAY_INIT;
-	ni_route_array_t static_routes = NI_ROUTE_ARRAY_INIT;
-	ni_route_array_t classless_routes = NI_ROUTE_ARRAY_INIT;
-	ni_string_array_t dns_servers = NI_STRING_ARRAY_INIT;
-	ni_string_array_t dns_search = NI_STRING_ARRAY_INIT;
-	ni_string_array_t dns_domain = NI_STRING_ARRAY_INIT;
-	ni_string_array_t nis_servers = NI_STRING_ARRAY_INIT;
-	char *nisdomain = NULL;
-	char *tmp = NULL;
-	int opt_overload = 0;
-	int msg_type = -1;
-	int use_bootserver = 1;
-	int use_bootfile = 1;
-	unsigned int pfxlen;
-	ni_dhcp_option_t *opts = NULL, *opt;
-
-	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET);
-
-	lease->state = NI_ADDRCONF_STATE_GRANTED;
-	lease->type = NI_ADDRCONF_DHCP;
-	lease->family = AF_INET;
-	lease->time_acquired = time(NULL);
-	lease->fqdn.enabled = NI_TRISTATE_DEFAULT;
-	lease->fqdn.qualify = config->fqdn.qualify;
-
-	lease->dhcp4.address.s_addr = message->yiaddr;
-	lease->dhcp4.boot_saddr.s_addr = message->siaddr;
-	lease->dhcp4.relay_addr.s_addr = message->giaddr;
+enum {
+	NI_DHCP4_AREA_OPTIONS,
+	NI_DHCP4_AREA_BOOTFILE,
+	NI_DHCP4_AREA_SERVERNAME,
+};
 
-parse_more:
-	/* Loop as long as we still have data in the buffer. */
-	while (ni_buffer_count(options) && !options->underflow) {
-		ni_buffer_t buf;
-		int option;
+static const unsigned char *
+ni_dhcp4_index_area_base(const ni_dhcp4_option_index_t *index, unsigned int area)
+{
+	switch (area) {
+	case NI_DHCP4_AREA_BOOTFILE:
+		return index->message->bootfile;
+	case NI_DHCP4_AREA_SERVERNAME:
+		return index->message->servername;
+	default:
+		return index->options;
+	}
+}
 
-		option = ni_dhcp4_option_next(options, &buf);
+static int
+ni_dhcp4_index_area(ni_dhcp4_option_index_t *index, unsigned int area, ni_buffer_t *bp)
+{
+	const unsigned char *base = ni_dhcp4_index_area_base(index, area);
+	ni_dhcp4_option_span_t *span;
+	ni_buffer_t buf;
+	int option;
 
-		//ni_debug_dhcp("handle option %s (%d)", ni_dhcp4_option_name(option), option);
+	while (ni_buffer_count(bp) && !bp->underflow) {
+		option = ni_dhcp4_option_next(bp, &buf);
 		if (option == DHCP4_END || option < 0)
 			break;
 
@@ -1853,18 +1890,24 @@ parse_more:
 
 		case DHCP4_MESSAGETYPE:
 			option = ni_buffer_getc(&buf);
-			if (option == EOF || msg_type != -1)
-				goto error;
-			msg_type = option;
+			if (option == EOF || index->msg_type != -1)
+				return -1;
+			index->msg_type = option;
+			continue;
+
+		case DHCP4_RAPID_COMMIT:
+			/* zero length flag, an ACK to our DISCOVER */
+			index->rapid_commit = TRUE;
 			continue;
 
 		case DHCP4_OPTIONSOVERLOADED:
-			if (options != &overload_buf) {
-				opt_overload = ni_buffer_getc(&buf);
-				if (opt_overload == EOF) {
+			if (area == NI_DHCP4_AREA_OPTIONS) {
+				option = ni_buffer_getc(&buf);
+				if (option == EOF) {
 					ni_debug_dhcp("DHCP4: ignoring invalid OVERLOAD option");
-					opt_overload = 0;
+					option = 0;
 				}
+				index->overload = option;
 			} else if (ni_buffer_getc(&buf) == EOF) {
 				ni_debug_dhcp("DHCP4: ignoring invalid OVERLOAD option in overloaded data");
 			} else {
@@ -1880,41 +1923,172 @@ parse_more:
 			ni_debug_dhcp("%s has zero length", ni_dhcp4_option_name(option));
 			continue;
 		}
-
-		if ((opt = ni_dhcp_option_list_find(opts, option))) {
-			if (ni_dhcp_option_append(opt, ni_buffer_count(&buf), ni_buffer_head(&buf)))
-				ni_buffer_pull_head(&buf, ni_buffer_count(&buf));
-		} else
-		if ((opt = ni_dhcp_option_new(option, ni_buffer_count(&buf), ni_buffer_head(&buf)))) {
-			if (ni_dhcp_option_list_append(&opts, opt))
-				ni_buffer_pull_head(&buf, ni_buffer_count(&buf));
-			else
-				ni_dhcp_option_free(opt);
-		} else {
-			ni_debug_dhcp("unable to allocate DHCP4 option %s", ni_dhcp4_option_name(option));
-			continue;
+		if (index->count >= NI_DHCP4_INDEX_SPANS) {
+			ni_debug_dhcp("unable to parse DHCP4 response: too many options");
+			return -1;
 		}
 
-		if (buf.underflow) {
-			ni_debug_dhcp("unable to parse DHCP4 option %s: too short",
-					ni_dhcp4_option_name(option));
-		} else if (ni_buffer_count(&buf)) {
-			ni_debug_dhcp("excess data in DHCP4 option %s - %u bytes left",
-					ni_dhcp4_option_name(option),
-					ni_buffer_count(&buf));
-		}
+		span = &index->span[index->count++];
+		span->offset = (const unsigned char *)ni_buffer_head(&buf) - base;
+		span->code = option;
+		span->len = ni_buffer_count(&buf);
+		span->area = area;
+		span->next = 0;
+
+		/* split options get concatenated (RFC 3396) */
+		if (index->last[option])
+			index->span[index->last[option] - 1].next = index->count;
+		else
+			index->first[option] = index->count;
+		index->last[option] = index->count;
 	}
 
-	if (options->underflow) {
+	if (bp->underflow) {
 		ni_debug_dhcp("unable to parse DHCP4 response: truncated packet");
-		goto error;
+		return -1;
 	}
+	return 0;
+}
 
-	while ((opt = ni_dhcp_option_list_pull(&opts))) {
+/*
+ * Copy the (concatenated) data of an indexed option into a fixed
+ * size buffer; returns the option length, also when it is larger.
+ */
+static size_t
+ni_dhcp4_index_copy(const ni_dhcp4_option_index_t *index, unsigned int code,
+			void *data, size_t size)
+{
+	const ni_dhcp4_option_span_t *span;
+	unsigned int pos;
+	size_t len = 0, n;
+
+	for (pos = index->first[code & 0xff]; pos; pos = span->next) {
+		span = &index->span[pos - 1];
+		if (len < size) {
+			n = size - len < span->len ? size - len : span->len;
+			memcpy((unsigned char *)data + len,
+				ni_dhcp4_index_area_base(index, span->area) + span->offset, n);
+		}
+		len += span->len;
+	}
+	return len;
+}
+
+/*
+ * First pass over a DHCP4 response: index the options and pick up the
+ * message type and the identifiers used to accept or to drop it.
+ */
+int
+ni_dhcp4_parse_index(const ni_dhcp4_message_t *message, ni_buffer_t *options,
+			ni_dhcp4_option_index_t *index)
+{
+	ni_buffer_t overload_buf;
+	size_t len;
+
+	index->message = message;
+	index->options = ni_buffer_head(options);
+	index->msg_type = -1;
+	index->overload = 0;
+	index->rapid_commit = FALSE;
+	index->count = 0;
+	memset(index->first, 0, sizeof(index->first));
+	memset(index->last, 0, sizeof(index->last));
+
+	if (ni_dhcp4_index_area(index, NI_DHCP4_AREA_OPTIONS, options) < 0)
+		return -1;
+
+	if (index->overload & DHCP4_OVERLOAD_BOOTFILE) {
+		ni_buffer_init_reader(&overload_buf, (void *)message->bootfile,
+					sizeof(message->bootfile));
+		if (ni_dhcp4_index_area(index, NI_DHCP4_AREA_BOOTFILE, &overload_buf) < 0)
+			return -1;
+	}
+	if (index->overload & DHCP4_OVERLOAD_SERVERNAME) {
+		ni_buffer_init_reader(&overload_buf, (void *)message->servername,
+					sizeof(message->servername));
+		if (ni_dhcp4_index_area(index, NI_DHCP4_AREA_SERVERNAME, &overload_buf) < 0)
+			return -1;
+	}
+
+	index->server_id.s_addr = 0;
+	if (ni_dhcp4_index_copy(index, DHCP4_SERVERIDENTIFIER, &index->server_id,
+				sizeof(index->server_id)) < sizeof(index->server_id))
+		index->server_id.s_addr = 0;
+
+	/* a client-id we cannot compare is not ours, drop the message */
+	len = ni_dhcp4_index_copy(index, DHCP4_CLIENTID, index->client_id.data,
+				sizeof(index->client_id.data));
+	if (len > sizeof(index->client_id.data)) {
+		ni_debug_dhcp("unable to parse DHCP4 response: client-id too long (%zu bytes)",
+				len);
+		return -1;
+	}
+	index->client_id.len = len;
+
+	return index->msg_type;
+}
+
+/*
+ * Second pass: decode the lease from the indexed options.
+ */
+int
+ni_dhcp4_parse_lease(const ni_dhcp4_config_t *config, const ni_dhcp4_option_index_t *index,
+			ni_addrconf_lease_t **leasep)
+{
+	const ni_dhcp4_message_t *message = index->message;
+	const ni_dhcp4_option_span_t *span;
+	ni_addrconf_lease_t *lease;
+	ni_route_array_t default_routes = NI_ROUTE_ARRAY_INIT;
+	ni_route_array_t static_routes = NI_ROUTE_ARRAY_INIT;
+	ni_route_array_t classless_routes = NI_ROUTE_ARRAY_INIT;
+	ni_string_array_t dns_servers = NI_STRING_ARRAY_INIT;
+	ni_string_array_t dns_search = NI_STRING_ARRAY_INIT;
+	ni_string_array_t dns_domain = NI_STRING_ARRAY_INIT;
+	ni_string_array_t nis_servers = NI_STRING_ARRAY_INIT;
+	char *nisdomain = NULL;
+	char *tmp = NULL;
+	int use_bootserver = !(index->overload & DHCP4_OVERLOAD_SERVERNAME);
+	int use_bootfile = !(index->overload & DHCP4_OVERLOAD_BOOTFILE);
+	unsigned char *joined = NULL;
+	unsigned int pfxlen, pos;
+	ni_dhcp_option_t *opt;
+
+	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET);
+
+	lease->state = NI_ADDRCONF_STATE_GRANTED;
+	lease->type = NI_ADDRCONF_DHCP;
+	lease->family = AF_INET;
+	lease->time_acquired = time(NULL);
+	lease->fqdn.enabled = NI_TRISTATE_DEFAULT;
+	lease->fqdn.qualify = config->fqdn.qualify;
+
+	lease->dhcp4.address.s_addr = message->yiaddr;
+	lease->dhcp4.boot_saddr.s_addr = message->siaddr;
+	lease->dhcp4.relay_addr.s_addr = message->giaddr;
+	lease->dhcp4.rapid_commit = index->rapid_commit;
+
+	/* Decode the options in the order they first appear in */
+	for (pos = 0; pos < index->count; ++pos) {
 		ni_buffer_t buf;
-		int option = opt->code;
+		int option;
+		size_t len;
+
+		span = &index->span[pos];
+		option = span->code;
+		if (index->first[option] != pos + 1)
+			continue;
+
+		if (!span->next) {
+			/* the common case; read it in place */
+			ni_buffer_init_reader(&buf, (void *)(ni_dhcp4_index_area_base(index,
+						span->area) + span->offset), span->len);
+		} else {
+			len = ni_dhcp4_index_copy(index, option, NULL, 0);
+			joined = xrealloc(joined, len);
+			ni_dhcp4_index_copy(index, option, joined, len);
+			ni_buffer_init_reader(&buf, joined, len);
+		}
 
-		ni_buffer_init_reader(&buf, opt->data, opt->len);
 		switch (option) {
 		case DHCP4_ADDRESS:
 			ni_dhcp4_option_get_ipv4(&buf, &lease->dhcp4.address);
@@ -2053,16 +2227,17 @@ parse_more:
 
 		default:
 			ni_debug_dhcp("adding unparsed DHCP4 option %s code %u len %u",
-					ni_dhcp4_option_name(option), option, opt->len);
+					ni_dhcp4_option_name(option), option,
+					ni_buffer_count(&buf));
 
-			if (ni_dhcp_option_list_append(&lease->dhcp4.options, opt)) {
+			opt = ni_dhcp_option_new(option, ni_buffer_count(&buf), ni_buffer_head(&buf));
+			if (opt && ni_dhcp_option_list_append(&lease->dhcp4.options, opt))
 				ni_buffer_clear(&buf);
-				opt = NULL;
-			}
+			else
+				ni_dhcp_option_free(opt);
 			break;
 		}
 
-		ni_dhcp_option_free(opt);
 		if (buf.underflow) {
 			ni_debug_dhcp("unable to parse DHCP4 option %s (%u): too short",
 					ni_dhcp4_option_name(option), option);
@@ -2073,31 +2248,6 @@ parse_more:
 		}
 	}
 
-	if (opt_overload) {
-		const void *more_data = NULL;
-		size_t size = 0;
-
-		if (opt_overload & DHCP4_OVERLOAD_BOOTFILE) {
-			use_bootfile = 0;
-			more_data = message->bootfile;
-			size = sizeof(message->bootfile);
-			opt_overload &= ~DHCP4_OVERLOAD_BOOTFILE;
-		} else
-		if (opt_overload & DHCP4_OVERLOAD_SERVERNAME) {
-			use_bootserver = 0;
-			more_data = message->servername;
-			size = sizeof(message->servername);
-			opt_overload &= ~DHCP4_OVERLOAD_SERVERNAME;
-		} else {
-			opt_overload = 0;
-		}
-		if (more_data) {
-			ni_buffer_init_reader(&overload_buf, (void *) more_data, size);
-			options = &overload_buf;
-			goto parse_more;
-		}
-	}
-
 	if (use_bootserver && message->servername[0]) {
 		char tmp[sizeof(message->servername)];
 		size_t len;
@@ -2194,9 +2344,7 @@ parse_more:
 	}
 
 	*leasep = lease;
-	lease = NULL;
 
-done:
 	ni_route_array_destroy(&default_routes);
 	ni_route_array_destroy(&static_routes);
 	ni_route_array_destroy(&classless_routes);
@@ -2205,17 +2353,30 @@ done:
 	ni_string_array_destroy(&dns_domain);
 	ni_string_array_destroy(&nis_servers);
 	ni_string_free(&nisdomain);
-	ni_dhcp_option_list_destroy(&opts);
+	free(joined);
 
-	return msg_type;
+	return 0;
+}
 
-error:
-	if (lease)
-		ni_addrconf_lease_free(lease);
-	msg_type = -1;
-	goto done;
+/*
+ * Parse a DHCP4 response.
+ */
+int
+ni_dhcp4_parse_response(const ni_dhcp4_config_t *config, const ni_dhcp4_message_t *message,
+			ni_buffer_t *options, ni_addrconf_lease_t **leasep)
+{
+	ni_dhcp4_option_index_t *index;
+	int msg_type;
+
+	index = xcalloc(1, sizeof(*index));
+	msg_type = ni_dhcp4_parse_index(message, options, index);
+	if (msg_type >= 0 && ni_dhcp4_parse_lease(config, index, leasep) < 0)
+		msg_type = -1;
+	free(index);
+	return msg_type;
 }
 
+
 /*
  * Map DHCP4 options to names
  */
@@ -2283,6 +2444,7 @@ static const char *__dhcp4_option_names[256] = {
  [DHCP4_CLASSID]			= "DHCP4_CLASSID",
  [DHCP4_CLIENTID]		= "DHCP4_CLIENTID",
  [DHCP4_USERCLASS]		= "DHCP4_USERCLASS",
+ [DHCP4_RAPID_COMMIT]		= "DHCP4_RAPID_COMMIT",
  [DHCP4_FQDN]			= "DHCP4_FQDN",
  [DHCP4_NDS_SERVER]		= "DHCP4_NDS_SERVER",
  [DHCP4_NDS_TREE]		= "DHCP4_NDS_TREE",
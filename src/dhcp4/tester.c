@@ -206,6 +206,10 @@ ni_dhcp4_tester_req_xml_init(ni_dhcp4_request_t *req, xml_document_t *doc)
 			if (ni_parse_boolean(child->cdata, &req->release_lease) != 0)
 				goto failure;
 		} else
+		if (ni_string_eq(child->name, "rapid-commit")) {
+			if (ni_parse_boolean(child->cdata, &req->rapid_commit) != 0)
+				goto failure;
+		} else
 		if (ni_string_eq(child->name, "request-options")) {
 			xml_node_t *opt;
 			for (opt = child->children; opt; opt = opt->next) {
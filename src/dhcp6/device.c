@@ -45,6 +45,7 @@
 #include "iaid.h"
 #include "duid.h"
 #include "dhcp.h"
+#include "devindex.h"
 
 
 /*
@@ -78,6 +79,7 @@
 #endif
 
 ni_dhcp6_device_t *		ni_dhcp6_active;
+static ni_devindex_t		ni_dhcp6_index = NI_DEVINDEX_INIT;
 
 static void			ni_dhcp6_device_close(ni_dhcp6_device_t *);
 static void			ni_dhcp6_device_free(ni_dhcp6_device_t *);
@@ -112,6 +114,7 @@ ni_dhcp6_device_new(const char *ifname, const ni_linkinfo_t *link)
 
 	/* append to end of list */
 	*pos = dev;
+	ni_devindex_add(&ni_dhcp6_index, dev->link.ifindex, dev->ifname, dev);
 
 	return dev;
 }
@@ -119,13 +122,13 @@ ni_dhcp6_device_new(const char *ifname, const ni_linkinfo_t *link)
 ni_dhcp6_device_t *
 ni_dhcp6_device_by_index(unsigned int ifindex)
 {
-	ni_dhcp6_device_t *dev;
+	return ni_devindex_by_index(&ni_dhcp6_index, ifindex);
+}
 
-	for (dev = ni_dhcp6_active; dev; dev = dev->next) {
-		if (dev->link.ifindex == ifindex)
-			return dev;
-	}
-	return NULL;
+ni_dhcp6_device_t *
+ni_dhcp6_device_find(const char *ifname)
+{
+	return ni_devindex_by_name(&ni_dhcp6_index, ifname);
 }
 
 /*
@@ -199,6 +202,7 @@ ni_dhcp6_device_free(ni_dhcp6_device_t *dev)
 	ni_debug_dhcp("%s: Deleting dhcp6 device with index %u",
 			dev->ifname, dev->link.ifindex);
 
+	ni_devindex_remove(&ni_dhcp6_index, dev->link.ifindex, dev);
 	ni_buffer_destroy(&dev->message);
 	ni_dhcp6_device_drop_lease(dev);
 	ni_dhcp6_device_drop_best_offer(dev);
@@ -1101,6 +1105,7 @@ ni_dhcp6_device_event(ni_dhcp6_device_t *dev, ni_netdev_t *ifp, ni_event_t event
 			ni_debug_dhcp("%s: Updating interface name to %s",
 					dev->ifname, ifp->name);
 			ni_string_dup(&dev->ifname, ifp->name);
+			ni_devindex_rename(&ni_dhcp6_index, dev->link.ifindex, dev->ifname, dev);
 		}
 	break;
 	case NI_EVENT_DEVICE_DOWN:
@@ -183,6 +183,7 @@ struct ni_dhcp6_device {
 	struct {
 	    ni_socket_t *	sock;		/* multicast socket		*/
 	    ni_sockaddr_t	dest;		/* relays & servers multicast	*/
+	    unsigned int	filter_xid;	/* xid of the socket filter	*/
 	} mcast;
 
 	struct timeval		start_time;	/* when we started managing     */
@@ -193,6 +194,7 @@ struct ni_dhcp6_device {
 	struct {
 	    int			state;
 	    unsigned int	fail_on_timeout : 1;
+	    unsigned int	renew_deferred : 1;
 	    const ni_timer_t *	timer;
 	} fsm;
 
@@ -228,6 +230,8 @@ struct ni_dhcp6_device {
 };
 
 
+extern ni_dhcp6_device_t *	ni_dhcp6_active;
+
 /*
  * -- device methods
  */
@@ -236,6 +240,7 @@ extern ni_dhcp6_device_t *	ni_dhcp6_device_get(ni_dhcp6_device_t *);
 extern void			ni_dhcp6_device_put(ni_dhcp6_device_t *);
 
 extern ni_dhcp6_device_t *	ni_dhcp6_device_by_index(unsigned int);
+extern ni_dhcp6_device_t *	ni_dhcp6_device_find(const char *);
 extern ni_dhcp6_device_t *	ni_dhcp6_device_by_index_show_all(unsigned int);
 
 extern void			ni_dhcp6_device_set_request(ni_dhcp6_device_t *, ni_dhcp6_request_t *);
@@ -35,6 +35,9 @@
 #include "dhcp6/protocol.h"
 #include "dhcp6/fsm.h"
 #include "duid.h"
+#include "appconfig.h"
+#include "dhcp.h"
+#include "metrics.h"
 
 
 struct ni_dhcp6_message {
@@ -42,6 +45,8 @@ struct ni_dhcp6_message {
 	unsigned int		type;
 	unsigned int		xid;
 
+	ni_bool_t		indexed;
+	ni_dhcp6_option_index_t	index;
 	ni_addrconf_lease_t *	lease;
 };
 
@@ -55,6 +60,7 @@ static int			ni_dhcp6_fsm_solicit      (ni_dhcp6_device_t *);
 static int			__ni_dhcp6_fsm_release    (ni_dhcp6_device_t *, unsigned int);
 static int			ni_dhcp6_fsm_request_lease(ni_dhcp6_device_t *, const ni_addrconf_lease_t *);
 static int			ni_dhcp6_fsm_confirm_lease(ni_dhcp6_device_t *, const ni_addrconf_lease_t *);
+static ni_bool_t		ni_dhcp6_fsm_renew_defer(ni_dhcp6_device_t *);
 static int			ni_dhcp6_fsm_renew(ni_dhcp6_device_t *);
 static int			ni_dhcp6_fsm_rebind(ni_dhcp6_device_t *);
 static int			ni_dhcp6_fsm_decline(ni_dhcp6_device_t *);
@@ -71,8 +77,11 @@ static unsigned int		ni_dhcp6_fsm_get_expire_timeout(ni_dhcp6_device_t *);
 static unsigned int		ni_dhcp6_fsm_mark_renew_ia(ni_dhcp6_device_t *);
 static unsigned int		ni_dhcp6_fsm_mark_rebind_ia(ni_dhcp6_device_t *);
 
+static ni_dhcp_renew_limit_t	ni_dhcp6_fsm_renew_limit;
+
 static void			ni_dhcp6_send_event(enum ni_dhcp6_event, const ni_dhcp6_device_t *, ni_addrconf_lease_t *);
 
+static int			__fsm_index_client_options(ni_dhcp6_device_t *, struct ni_dhcp6_message *, ni_buffer_t *);
 static int			__fsm_parse_client_options(ni_dhcp6_device_t *, struct ni_dhcp6_message *, ni_buffer_t *);
 
 
@@ -437,6 +446,8 @@ ni_dhcp6_fsm_timeout(ni_dhcp6_device_t *dev)
 		break;
 
 	case NI_DHCP6_STATE_BOUND:
+		if (ni_dhcp6_fsm_renew_defer(dev))
+			break;
 		ni_dhcp6_fsm_renew(dev);
 		break;
 
@@ -499,14 +510,22 @@ __fsm_select_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, n
 
 	switch (msg->type) {
 	case NI_DHCP6_ADVERTISE:
-		if (__fsm_parse_client_options(dev, msg, opts) < 0)
+		/* drop what we would discard anyway before to parse it */
+		if (__fsm_index_client_options(dev, msg, opts) < 0)
 			return -1;
 
-
-		if (msg->lease->dhcp6.rapid_commit) {
+		if (msg->index.rapid_commit) {
 			ni_string_printf(hint, "advertise with rapid commit option");
 			goto cleanup;
 		}
+		if (ni_dhcp6_config_server_preference(&msg->sender, &msg->index.server_id, &weight) &&
+		    weight < 0) {
+			ni_string_printf(hint, "blacklisted server");
+			goto cleanup;
+		}
+
+		if (__fsm_parse_client_options(dev, msg, opts) < 0)
+			return -1;
 
 		/*
 		 * We've to (RFC MUST) discard all advertise messages with
@@ -582,13 +601,21 @@ __fsm_select_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, n
 	break;
 
 	case NI_DHCP6_REPLY:
-		if (__fsm_parse_client_options(dev, msg, opts) < 0)
+		if (__fsm_index_client_options(dev, msg, opts) < 0)
 			return -1;
 
-		if (!msg->lease->dhcp6.rapid_commit) {
+		if (!msg->index.rapid_commit) {
 			ni_string_printf(hint, "rapid commit not set");
 			goto cleanup;
 		}
+		if (ni_dhcp6_config_server_preference(&msg->sender, &msg->index.server_id, &weight) &&
+		    weight < 0) {
+			ni_string_printf(hint, "blacklisted server");
+			goto cleanup;
+		}
+
+		if (__fsm_parse_client_options(dev, msg, opts) < 0)
+			return -1;
 
 
 		/*
@@ -1126,43 +1153,64 @@ cleanup:
 }
 
 static int
-__fsm_parse_client_options(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, ni_buffer_t *opts)
+__fsm_index_client_options(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, ni_buffer_t *opts)
 {
-	ni_addrconf_lease_t *lease = NULL;
-
-	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET6);
-	lease->state = NI_ADDRCONF_STATE_GRANTED;
-	lease->type = NI_ADDRCONF_DHCP;
-	lease->time_acquired = time(NULL);
-	lease->fqdn.enabled = NI_TRISTATE_DEFAULT;
-	lease->fqdn.qualify = dev->config->fqdn.qualify;
-
-	/* set the server address in the lease */
-	memcpy(&lease->dhcp6.server_addr, &msg->sender, sizeof(lease->dhcp6.server_addr));
+	if (msg->indexed)
+		return 0;
 
-	if (ni_dhcp6_parse_client_options(dev, opts, lease) < 0) {
+	if (ni_dhcp6_index_client_options(opts, &msg->index) < 0) {
 		ni_error("%s: unable to parse options in %s message xid 0x%06x from %s",
 			dev->ifname, ni_dhcp6_message_name(msg->type),
 			msg->xid, ni_dhcp6_address_print(&msg->sender));
-		goto failure;
+		return -1;
 	}
 
-	if (lease->dhcp6.client_id.len == 0) {
+	if (msg->index.client_id.len == 0) {
 		ni_error("%s: ignoring %s message xid 0x%06x from %s: client-id missed",
 				dev->ifname, ni_dhcp6_message_name(msg->type), msg->xid,
 				ni_dhcp6_address_print(&msg->sender));
-		goto failure;
+		return -1;
 	}
-	if (lease->dhcp6.server_id.len == 0) {
+	if (msg->index.server_id.len == 0) {
 		ni_error("%s]: ignoring %s message xid 0x%06x from %s: server-id missed",
 			dev->ifname, ni_dhcp6_message_name(msg->type), msg->xid,
 			ni_dhcp6_address_print(&msg->sender));
-		goto failure;
+		return -1;
 	}
-	if (!ni_opaque_eq(&dev->config->client_duid, &lease->dhcp6.client_id)) {
+	if (!ni_opaque_eq(&dev->config->client_duid, &msg->index.client_id)) {
 		ni_error("%s: ignoring %s message xid 0x%06x from %s: client-id differs",
 			dev->ifname, ni_dhcp6_message_name(msg->type), msg->xid,
 			ni_dhcp6_address_print(&msg->sender));
+		return -1;
+	}
+
+	msg->indexed = TRUE;
+	return 0;
+}
+
+static int
+__fsm_parse_client_options(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, ni_buffer_t *opts)
+{
+	ni_addrconf_lease_t *lease = NULL;
+
+	/* check the identifiers before to allocate and parse the lease */
+	if (__fsm_index_client_options(dev, msg, opts) < 0)
+		return -1;
+
+	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET6);
+	lease->state = NI_ADDRCONF_STATE_GRANTED;
+	lease->type = NI_ADDRCONF_DHCP;
+	lease->time_acquired = time(NULL);
+	lease->fqdn.enabled = NI_TRISTATE_DEFAULT;
+	lease->fqdn.qualify = dev->config->fqdn.qualify;
+
+	/* set the server address in the lease */
+	memcpy(&lease->dhcp6.server_addr, &msg->sender, sizeof(lease->dhcp6.server_addr));
+
+	if (ni_dhcp6_parse_client_options(dev, opts, lease) < 0) {
+		ni_error("%s: unable to parse options in %s message xid 0x%06x from %s",
+			dev->ifname, ni_dhcp6_message_name(msg->type),
+			msg->xid, ni_dhcp6_address_print(&msg->sender));
 		goto failure;
 	}
 
@@ -1188,6 +1236,7 @@ ni_dhcp6_fsm_process_client_message(ni_dhcp6_device_t *dev, unsigned int msg_typ
 	msg.sender = *sender;
 	msg.type = msg_type;
 	msg.xid = msg_xid;
+	msg.indexed = FALSE;
 	msg.lease = NULL;
 
 	ni_debug_dhcp("%s: received %s message xid 0x%06x in state %s from %s",
@@ -1452,6 +1501,32 @@ ni_dhcp6_fsm_confirm_lease(ni_dhcp6_device_t *dev, const ni_addrconf_lease_t *le
 	return rv;
 }
 
+/*
+ * Pace the renewals to the configured global max-rate; returns
+ * TRUE when the renewal has been deferred to a later slot.
+ */
+static ni_bool_t
+ni_dhcp6_fsm_renew_defer(ni_dhcp6_device_t *dev)
+{
+	unsigned long delay;
+
+	if (dev->fsm.renew_deferred) {
+		dev->fsm.renew_deferred = 0;
+		return FALSE;
+	}
+
+	delay = ni_dhcp_renew_delay(&ni_dhcp6_fsm_renew_limit,
+				ni_global.config->addrconf.dhcp6.renew.max_rate);
+	if (!delay)
+		return FALSE;
+
+	ni_debug_dhcp("%s: deferring renewal of DHCPv6 lease by %lu msec",
+			dev->ifname, delay);
+	dev->fsm.renew_deferred = 1;
+	ni_dhcp6_fsm_set_timeout_msec(dev, delay);
+	return TRUE;
+}
+
 static int
 ni_dhcp6_fsm_renew(ni_dhcp6_device_t *dev)
 {
@@ -1484,6 +1559,7 @@ ni_dhcp6_fsm_renew(ni_dhcp6_device_t *dev)
 
 		dev->retrans.duration = deadline * 1000;
 		dev->fsm.state = NI_DHCP6_STATE_RENEWING;
+		ni_metrics_inc(NI_METRIC_DHCP6_RENEWALS);
 
 		rv = ni_dhcp6_device_transmit_init(dev);
 	} else {
@@ -1788,6 +1864,7 @@ ni_dhcp6_fsm_bound(ni_dhcp6_device_t *dev)
 	timeout = ni_dhcp6_fsm_get_renewal_timeout(dev);
 	if (timeout > 0) {
 		dev->fsm.state = NI_DHCP6_STATE_BOUND;
+		dev->fsm.renew_deferred = 0;
 
 		if (timeout == NI_DHCP6_INFINITE_LIFETIME) {
 			/* Hmm... */
@@ -1812,8 +1889,9 @@ ni_dhcp6_fsm_bound(ni_dhcp6_device_t *dev)
 }
 
 static unsigned int
-__ni_dhcp6_fsm_mark_ia_by_time(ni_dhcp6_device_t *dev,  unsigned int (*get_ia_time)(ni_dhcp6_ia_t *),
-							unsigned int flag)
+__ni_dhcp6_fsm_mark_ia_by_time(ni_dhcp6_device_t *dev,
+				unsigned int (*get_ia_time)(const ni_dhcp6_device_t *, ni_dhcp6_ia_t *),
+				unsigned int flag)
 {
 	unsigned int rt, diff, aq;
 	unsigned int count;
@@ -1823,7 +1901,7 @@ __ni_dhcp6_fsm_mark_ia_by_time(ni_dhcp6_device_t *dev,  unsigned int (*get_ia_ti
 	count = 0;
 	ni_timer_get_time(&now);
 	for (ia = dev->lease->dhcp6.ia_list; ia; ia = ia->next) {
-		rt = get_ia_time(ia);
+		rt = get_ia_time(dev, ia);
 
 		if ((aq = ia->time_acquired) == 0)
 			aq = dev->lease->time_acquired;
@@ -1839,20 +1917,63 @@ __ni_dhcp6_fsm_mark_ia_by_time(ni_dhcp6_device_t *dev,  unsigned int (*get_ia_ti
 	return count;
 }
 
+/*
+ * Spread the renewal and rebind times of the IA; the hashed offset
+ * is derived from the DUID and IAID, the random one varies with the
+ * time the IA has been acquired.
+ */
+static unsigned int
+ni_dhcp6_fsm_ia_spread(const ni_dhcp6_device_t *dev, const ni_dhcp6_ia_t *ia, unsigned int lft)
+{
+	const ni_config_dhcp6_t *conf;
+	uint32_t hash, salt;
+
+	conf = ni_config_dhcp6_find_device(dev->ifname);
+	if (!conf || conf->renew.spread == NI_CONFIG_DHCP_RENEW_SPREAD_NONE)
+		return lft;
+
+	hash = ni_dhcp_renew_hash(0, dev->config->client_duid.data,
+					dev->config->client_duid.len);
+	hash = ni_dhcp_renew_hash(hash, &ia->iaid, sizeof(ia->iaid));
+	if ((salt = ia->time_acquired) == 0)
+		salt = dev->lease->time_acquired;
+
+	return ni_dhcp_renew_spread(&conf->renew, lft, hash, salt);
+}
+
+static unsigned int
+ni_dhcp6_fsm_ia_renewal_time(const ni_dhcp6_device_t *dev, ni_dhcp6_ia_t *ia)
+{
+	return ni_dhcp6_fsm_ia_spread(dev, ia, ni_dhcp6_ia_get_renewal_time(ia));
+}
+
+static unsigned int
+ni_dhcp6_fsm_ia_rebind_time(const ni_dhcp6_device_t *dev, ni_dhcp6_ia_t *ia)
+{
+	return ni_dhcp6_fsm_ia_spread(dev, ia, ni_dhcp6_ia_get_rebind_time(ia));
+}
+
+static unsigned int
+ni_dhcp6_fsm_ia_preferred_lft(const ni_dhcp6_device_t *dev, ni_dhcp6_ia_t *ia)
+{
+	return ni_dhcp6_ia_min_preferred_lft(ia);
+}
+
 static unsigned int
 ni_dhcp6_fsm_mark_renew_ia(ni_dhcp6_device_t *dev)
 {
-	return __ni_dhcp6_fsm_mark_ia_by_time(dev, ni_dhcp6_ia_get_renewal_time, NI_DHCP6_IA_RENEW);
+	return __ni_dhcp6_fsm_mark_ia_by_time(dev, ni_dhcp6_fsm_ia_renewal_time, NI_DHCP6_IA_RENEW);
 }
 
 static unsigned int
 ni_dhcp6_fsm_mark_rebind_ia(ni_dhcp6_device_t *dev)
 {
-	return __ni_dhcp6_fsm_mark_ia_by_time(dev, ni_dhcp6_ia_get_rebind_time, NI_DHCP6_IA_REBIND);
+	return __ni_dhcp6_fsm_mark_ia_by_time(dev, ni_dhcp6_fsm_ia_rebind_time, NI_DHCP6_IA_REBIND);
 }
 
 static ni_dhcp6_ia_t *
-__ni_dhcp6_fsm_find_lowest_ia(ni_dhcp6_ia_t *list, unsigned int (*get_ia_time)(ni_dhcp6_ia_t *),
+__ni_dhcp6_fsm_find_lowest_ia(const ni_dhcp6_device_t *dev,
+				unsigned int (*get_ia_time)(const ni_dhcp6_device_t *, ni_dhcp6_ia_t *),
 				unsigned int *ia_lft)
 {
 	unsigned int lowest, lt;
@@ -1860,8 +1981,8 @@ __ni_dhcp6_fsm_find_lowest_ia(ni_dhcp6_ia_t *list, unsigned int (*get_ia_time)(n
 
 	lowest = 0;
 	ia_low = NULL;
-	for (ia = list; ia; ia = ia->next) {
-		lt = get_ia_time(ia);
+	for (ia = dev->lease->dhcp6.ia_list; ia; ia = ia->next) {
+		lt = get_ia_time(dev, ia);
 		if (ia_low == NULL || lowest > lt) {
 			ia_low = ia;
 			lowest = lt;
@@ -1873,14 +1994,14 @@ __ni_dhcp6_fsm_find_lowest_ia(ni_dhcp6_ia_t *list, unsigned int (*get_ia_time)(n
 }
 
 static unsigned int
-__ni_dhcp6_fsm_get_timeout(ni_dhcp6_device_t *dev, unsigned int (*get_ia_time)(ni_dhcp6_ia_t *))
+__ni_dhcp6_fsm_get_timeout(ni_dhcp6_device_t *dev,
+			unsigned int (*get_ia_time)(const ni_dhcp6_device_t *, ni_dhcp6_ia_t *))
 {
 	unsigned int lt, aq, diff;
 	struct timeval now;
 	ni_dhcp6_ia_t *ia = NULL;
 
-	ia = __ni_dhcp6_fsm_find_lowest_ia(dev->lease->dhcp6.ia_list,
-						get_ia_time, &lt);
+	ia = __ni_dhcp6_fsm_find_lowest_ia(dev, get_ia_time, &lt);
 	if (!ia)
 		return 0;
 
@@ -1909,13 +2030,13 @@ __ni_dhcp6_fsm_get_timeout(ni_dhcp6_device_t *dev, unsigned int (*get_ia_time)(n
 static unsigned int
 ni_dhcp6_fsm_get_renewal_timeout(ni_dhcp6_device_t *dev)
 {
-	return __ni_dhcp6_fsm_get_timeout(dev, ni_dhcp6_ia_get_renewal_time);
+	return __ni_dhcp6_fsm_get_timeout(dev, ni_dhcp6_fsm_ia_renewal_time);
 }
 
 static unsigned int
 ni_dhcp6_fsm_get_rebind_timeout(ni_dhcp6_device_t *dev)
 {
-	return __ni_dhcp6_fsm_get_timeout(dev, ni_dhcp6_ia_get_rebind_time);
+	return __ni_dhcp6_fsm_get_timeout(dev, ni_dhcp6_fsm_ia_rebind_time);
 }
 
 
@@ -1926,8 +2047,7 @@ ni_dhcp6_fsm_get_expire_timeout(ni_dhcp6_device_t *dev)
 	struct timeval now;
 	ni_dhcp6_ia_t *ia = NULL;
 
-	ia = __ni_dhcp6_fsm_find_lowest_ia(dev->lease->dhcp6.ia_list,
-				ni_dhcp6_ia_min_preferred_lft, &lt);
+	ia = __ni_dhcp6_fsm_find_lowest_ia(dev, ni_dhcp6_fsm_ia_preferred_lft, &lt);
 	if (!ia)
 		return 0;
 
@@ -33,7 +33,9 @@
 #include <errno.h>
 #include <ctype.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
+#include <linux/filter.h>
 
 #include <wicked/logging.h>
 #include <wicked/netinfo.h>
@@ -162,6 +164,52 @@ __ni_dhcp6_mcast_socket_open(const struct ni_dhcp6_link *link, const char *ifnam
 	return fd;
 }
 
+/*
+ * Attach a socket filter accepting replies to the current transaction
+ * only, so the kernel drops replies for other clients on the link.
+ * The filter sees the udp header followed by the dhcp6 message.
+ */
+static int
+ni_dhcp6_mcast_socket_set_filter(ni_dhcp6_device_t *dev)
+{
+	struct sock_filter insns[] = {
+		/* Load the message type and transaction id */
+		BPF_STMT(BPF_LD + BPF_W + BPF_ABS, sizeof(struct udphdr)),
+		BPF_STMT(BPF_ALU + BPF_AND + BPF_K, NI_DHCP6_XID_MASK),
+
+		/* Make sure it's the xid of our transaction */
+		BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, dev->dhcp6.xid, 0, 1),
+		BPF_STMT(BPF_RET + BPF_K, ~0U),
+
+		/* Otherwise, drop it. */
+		BPF_STMT(BPF_RET + BPF_K, 0),
+	};
+	struct sock_fprog pf;
+	int fd = dev->mcast.sock->__fd;
+
+	if (dev->mcast.filter_xid == dev->dhcp6.xid)
+		return 0;
+
+	if (dev->dhcp6.xid == 0) {
+		if (setsockopt(fd, SOL_SOCKET, SO_DETACH_FILTER, NULL, 0) < 0 && errno != ENOENT) {
+			ni_error("%s: Cannot set setsockopt(SO_DETACH_FILTER): %m", dev->ifname);
+			return -1;
+		}
+	} else {
+		memset(&pf, 0, sizeof(pf));
+		pf.filter = insns;
+		pf.len = sizeof(insns) / sizeof(insns[0]);
+
+		if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) < 0) {
+			ni_error("%s: Cannot set setsockopt(SO_ATTACH_FILTER): %m", dev->ifname);
+			return -1;
+		}
+	}
+
+	dev->mcast.filter_xid = dev->dhcp6.xid;
+	return 0;
+}
+
 /*
  * Open a DHCP6 socket for send and receive
  */
@@ -186,8 +234,10 @@ ni_dhcp6_mcast_socket_open(ni_dhcp6_device_t *dev)
 	}
 
 	if (dev->mcast.sock != NULL) {
-		if (dev->mcast.sock->active && !dev->mcast.sock->error)
+		if (dev->mcast.sock->active && !dev->mcast.sock->error) {
+			ni_dhcp6_mcast_socket_set_filter(dev);
 			return 0;
+		}
 
 		/* there were a receive error, close and open again  */
 		ni_dhcp6_mcast_socket_close(dev);
@@ -218,6 +268,7 @@ ni_dhcp6_mcast_socket_open(ni_dhcp6_device_t *dev)
 		ni_buffer_init_dynamic(&dev->mcast.sock->rbuf, NI_DHCP6_RBUF_SIZE);
 
 		ni_socket_activate(dev->mcast.sock);
+		ni_dhcp6_mcast_socket_set_filter(dev);
 		return 0;
 	} else {
 		ni_error("%s: Unable to prepare DHCPv6 multicast socket",
@@ -233,6 +284,7 @@ ni_dhcp6_mcast_socket_close(ni_dhcp6_device_t *dev)
 	if (dev->mcast.sock)
 		ni_socket_close(dev->mcast.sock);
 	dev->mcast.sock = NULL;
+	dev->mcast.filter_xid = 0;
 	memset(&dev->mcast.dest, 0, sizeof(dev->mcast.dest));
 }
 
@@ -3066,6 +3118,41 @@ ni_dhcp6_parse_client_options(ni_dhcp6_device_t *dev, ni_buffer_t *buffer, ni_ad
 	return __ni_dhcp6_parse_client_options(dev, buffer, lease, FALSE);
 }
 
+int
+ni_dhcp6_index_client_options(const ni_buffer_t *buffer, ni_dhcp6_option_index_t *index)
+{
+	ni_buffer_t options = *buffer;
+	ni_buffer_t optbuf;
+	int option;
+
+	memset(index, 0, sizeof(*index));
+	while (ni_buffer_count(&options) && !options.underflow) {
+		ni_buffer_init(&optbuf, NULL, 0);
+		option = ni_dhcp6_option_next(&options, &optbuf);
+		if (option < 0)
+			return -1;
+
+		if (option == 0)
+			break;
+
+		switch (option) {
+		case NI_DHCP6_OPTION_CLIENTID:
+			ni_dhcp6_option_get_duid(&optbuf, &index->client_id);
+			break;
+		case NI_DHCP6_OPTION_SERVERID:
+			ni_dhcp6_option_get_duid(&optbuf, &index->server_id);
+			break;
+		case NI_DHCP6_OPTION_RAPID_COMMIT:
+			if (ni_buffer_count(&optbuf) == 0)
+				index->rapid_commit = TRUE;
+			break;
+		default:
+			break;
+		}
+	}
+	return options.underflow ? -1 : 0;
+}
+
 int
 ni_dhcp6_parse_client_header(ni_buffer_t *msgbuf, unsigned int *msg_type, unsigned int *msg_xid)
 {
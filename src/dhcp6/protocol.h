@@ -236,6 +236,20 @@ extern int		ni_dhcp6_parse_client_header(ni_buffer_t *msgbuf,
 extern int		ni_dhcp6_parse_client_options(ni_dhcp6_device_t *dev, ni_buffer_t *buffer,
 							ni_addrconf_lease_t *lease);
 
+/*
+ * Identifiers of a received message, picked up in a first pass over
+ * the options without to decode or allocate anything, to drop foreign
+ * and unwanted messages before the lease gets parsed.
+ */
+typedef struct ni_dhcp6_option_index {
+	ni_opaque_t		client_id;
+	ni_opaque_t		server_id;
+	ni_bool_t		rapid_commit;
+} ni_dhcp6_option_index_t;
+
+extern int		ni_dhcp6_index_client_options(const ni_buffer_t *buffer,
+							ni_dhcp6_option_index_t *index);
+
 extern int		ni_dhcp6_check_client_header(ni_dhcp6_device_t *dev, const struct in6_addr *sender,
 							unsigned int msg_type, unsigned int msg_xid);
 
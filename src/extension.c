@@ -63,6 +63,8 @@ ni_extension_free(ni_extension_t *ex)
 	}
 
 	ni_var_array_destroy(&ex->environment);
+	ni_coprocess_free(ex->coprocess);
+	ex->coprocess = NULL;
 }
 
 /*
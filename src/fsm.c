@@ -32,6 +32,7 @@
 #include "client/ifconfig.h"
 #include "appconfig.h"
 #include "util_priv.h"
+#include "metrics.h"
 
 static ni_fsm_user_prompt_fn_t *ni_fsm_user_prompt_fn;
 static void *			ni_fsm_user_prompt_data;
@@ -217,7 +218,7 @@ __ni_ifworker_new(ni_ifworker_type_t type, const char *name)
 {
 	ni_ifworker_t *w;
 
-	w = xcalloc(1, sizeof(*w));
+	w = xcalloc_tagged(NI_MEMTAG_IFWORKER, 1, sizeof(*w));
 	ni_string_dup(&w->name, name);
 	w->type = type;
 	w->refcount = 1;
@@ -413,7 +414,7 @@ ni_ifworker_free(ni_ifworker_t *w)
 	xml_node_free(w->state.node);
 	ni_string_free(&w->name);
 	ni_string_free(&w->old_name);
-	free(w);
+	xfree_tagged(NI_MEMTAG_IFWORKER, w);
 }
 
 /*
@@ -555,6 +556,7 @@ ni_ifworker_fail(ni_ifworker_t *w, const char *fmt, ...)
 	if (w->failed)
 		return;
 
+	ni_metrics_inc(NI_METRIC_FSM_FAILURES);
 	va_start(ap, fmt);
 	vsnprintf(errmsg, sizeof(errmsg), fmt, ap);
 	va_end(ap);
@@ -1611,6 +1613,7 @@ ni_ifworker_set_state(ni_ifworker_t *w, unsigned int new_state)
 	unsigned int prev_state = w->fsm.state;
 
 	if (prev_state != new_state) {
+		ni_metrics_inc(NI_METRIC_FSM_TRANSITIONS);
 		if (w->progress.callback)
 			w->progress.callback(w, new_state);
 
@@ -27,6 +27,7 @@
 #include "sysfs.h"
 #include "kernel.h"
 #include "appconfig.h"
+#include "metrics.h"
 
 #ifndef NI_ND_OPT_RDNSS_INFORMATION
 #define NI_ND_OPT_RDNSS_INFORMATION	25	/* RFC 5006 */
@@ -144,10 +145,12 @@ __ni_rtevent_process(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 
 	switch (h->nlmsg_type) {
 	case RTM_NEWLINK:
+		ni_metrics_inc(NI_METRIC_NETLINK_LINK);
 		rv = __ni_rtevent_newlink(nc, nladdr, h);
 		break;
 
 	case RTM_DELLINK:
+		ni_metrics_inc(NI_METRIC_NETLINK_LINK);
 		rv = __ni_rtevent_dellink(nc, nladdr, h);
 		break;
 
@@ -155,38 +158,47 @@ __ni_rtevent_process(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 	 * route prefix was configured statically, or received via a Router
 	 * Advertisement */
 	case RTM_NEWPREFIX:
+		ni_metrics_inc(NI_METRIC_NETLINK_PREFIX);
 		rv = __ni_rtevent_newprefix(nc, nladdr, h);
 		break;
 
 	case RTM_NEWADDR:
+		ni_metrics_inc(NI_METRIC_NETLINK_ADDR);
 		rv = __ni_rtevent_newaddr(nc, nladdr, h);
 		break;
 
 	case RTM_DELADDR:
+		ni_metrics_inc(NI_METRIC_NETLINK_ADDR);
 		rv = __ni_rtevent_deladdr(nc, nladdr, h);
 		break;
 
 	case RTM_NEWROUTE:
+		ni_metrics_inc(NI_METRIC_NETLINK_ROUTE);
 		rv = __ni_rtevent_newroute(nc, nladdr, h);
 		break;
 
 	case RTM_DELROUTE:
+		ni_metrics_inc(NI_METRIC_NETLINK_ROUTE);
 		rv = __ni_rtevent_delroute(nc, nladdr, h);
 		break;
 
 	case RTM_NEWRULE:
+		ni_metrics_inc(NI_METRIC_NETLINK_RULE);
 		rv = __ni_rtevent_newrule(nc, nladdr, h);
 		break;
 
 	case RTM_DELRULE:
+		ni_metrics_inc(NI_METRIC_NETLINK_RULE);
 		rv = __ni_rtevent_delrule(nc, nladdr, h);
 		break;
 
 	case RTM_NEWNDUSEROPT:
+		ni_metrics_inc(NI_METRIC_NETLINK_NDUSEROPT);
 		rv = __ni_rtevent_nduseropt(nc, nladdr, h);
 		break;
 
 	default:
+		ni_metrics_inc(NI_METRIC_NETLINK_OTHER);
 		rv = 0;
 	}
 
@@ -909,6 +921,7 @@ __ni_rtevent_process_cb(struct nl_msg *msg, void *ptr)
 
 	nlh = nlmsg_hdr(msg);
 	if (__ni_rtevent_process(nc, sender, nlh) < 0) {
+		ni_metrics_inc(NI_METRIC_NETLINK_IGNORED);
 		ni_debug_events("ignoring %s rtnetlink event",
 			ni_rtnl_msg_type_to_name(nlh->nlmsg_type, "unknown"));
 		return NL_SKIP;
@@ -940,6 +953,7 @@ __ni_rtevent_receive(ni_socket_t *sock)
 			break;
 
 		default:
+			ni_metrics_inc(NI_METRIC_NETLINK_RECV_ERRORS);
 			ni_error("rtnetlink event receive error: %s (%m)",
 					nl_geterror(ret));
 			if (__ni_rtevent_restart(sock)) {
@@ -33,6 +33,7 @@
 #include <wicked/tuntap.h>
 #include <wicked/tunneling.h>
 #include <wicked/linkstats.h>
+#include <wicked/pci.h>
 
 #if defined(HAVE_RTA_MARK)
 #  include <netlink/netlink.h>
@@ -59,6 +60,8 @@
 #include "pppd.h"
 #include "teamd.h"
 #include "ovs.h"
+#include "snapshot.h"
+#include "ifstats.h"
 
 
 static int		__ni_process_ifinfomsg(ni_linkinfo_t *link, struct nlmsghdr *h,
@@ -69,6 +72,8 @@ static int		__ni_netdev_process_newroute(ni_netdev_t *, struct nlmsghdr *,
 					struct rtmsg *, ni_netconfig_t *);
 static int		__ni_netdev_process_newrule(struct nlmsghdr *, struct fib_rule_hdr *,
 					ni_netconfig_t *);
+static void		__ni_process_ifinfomsg_ovs_type(ni_iftype_t *, const char *,
+					ni_netconfig_t *);
 static int		__ni_discover_bridge(ni_netdev_t *);
 static int		__ni_discover_bond(ni_netdev_t *, struct nlattr **, ni_netconfig_t *);
 static int		__ni_discover_addrconf(ni_netdev_t *);
@@ -518,13 +523,40 @@ __ni_system_refresh_interfaces(ni_netconfig_t *nc)
 	return __ni_system_refresh_all(nc, NULL);
 }
 
+/*
+ * Find the warm-restart snapshot of an unchanged device
+ */
+static const ni_netconfig_snapshot_dev_t *
+__ni_system_refresh_snapshot_find(struct nlmsghdr *h, struct ifinfomsg *ifi, const char *ifname)
+{
+	struct nlattr *nla;
+	ni_hwaddr_t hwaddr;
+	unsigned int alen;
+
+	if (!ni_netconfig_snapshot_active())
+		return NULL;
+
+	ni_link_address_init(&hwaddr);
+	hwaddr.type = ifi->ifi_type;
+	if ((nla = nlmsg_find_attr(h, sizeof(*ifi), IFLA_ADDRESS)) != NULL) {
+		alen = nla_len(nla);
+		if (alen > sizeof(hwaddr.data))
+			alen = sizeof(hwaddr.data);
+		memcpy(hwaddr.data, nla_data(nla), alen);
+		hwaddr.len = alen;
+	}
+	return ni_netconfig_snapshot_find(ifi->ifi_index, ifname, &hwaddr);
+}
+
 int
 __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 {
 	static int refresh = 0;
+	const ni_netconfig_snapshot_dev_t *snap;
 	struct ni_rtnl_query query;
 	struct nlmsghdr *h;
 	ni_netdev_t **tail, *dev;
+	ni_bool_t deferred;
 	unsigned int seqno;
 	int res = -1;
 
@@ -562,16 +594,25 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 			continue;
 		}
 		ifname = nla_get_string(nla);
+		snap = __ni_system_refresh_snapshot_find(h, ifi, ifname);
 
 		/* Create interface if it doesn't exist. */
 		if ((dev = ni_netdev_by_index(nc, ifi->ifi_index)) == NULL) {
-			ni_pci_dev_t *pci_dev;
+			ni_pci_dev_t *pci_dev = NULL;
 
 			dev = ni_netdev_new(ifname, ifi->ifi_index);
 			if (!dev)
 				goto failed;
 
-			if ((pci_dev = ni_sysfs_netdev_get_pci(ifname)) != NULL)
+			if (!snap)
+				pci_dev = ni_sysfs_netdev_get_pci(ifname);
+			else
+			if (snap->pci_dev) {
+				pci_dev = ni_pci_dev_new(snap->pci_dev->path);
+				pci_dev->vendor = snap->pci_dev->vendor;
+				pci_dev->device = snap->pci_dev->device;
+			}
+			if (pci_dev != NULL)
 				ni_netdev_set_pci(dev, pci_dev);
 
 			/* FIXME: use ni_netconfig_device_append() */
@@ -588,8 +629,21 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 
 		dev->seq = seqno;
 
+		/* Defer the link details of devices unchanged since the snapshot */
+		deferred = snap && !ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN);
+		if (deferred)
+			ni_netconfig_set_discover_filter(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN);
+
 		if (__ni_netdev_process_newlink(dev, h, ifi, nc) < 0)
 			ni_error("Problem parsing RTM_NEWLINK message for %s", ifname);
+
+		if (deferred) {
+			ni_netconfig_unset_discover_filter(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN);
+
+			/* the type selects the dbus services of the device */
+			if (dev->link.type == NI_IFTYPE_OVS_UNSPEC)
+				__ni_process_ifinfomsg_ovs_type(&dev->link.type, dev->name, nc);
+		}
 	}
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
@@ -634,6 +688,7 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 	}
 
 	/* Cull any interfaces that went away */
+	ni_client_state_begin();
 	tail = ni_netconfig_device_list_head(nc);
 	while ((dev = *tail) != NULL) {
 		ni_address_list_drop_by_seq(&dev->addrs, seqno);
@@ -653,6 +708,7 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 			tail = &dev->next;
 		}
 	}
+	ni_client_state_commit();
 
 	/* issue separate query ingnoring the error to not break
 	 * the bootstrap, e.g. when a kernel lacks rule support.
@@ -1037,15 +1093,18 @@ done:
 
 /*
  * Refresh interface statistics.
- * We assume that IFLA_STATS have already been covered by a generic ni_refresh;
- * all we want to do here is potentially retrieve additional stats eg via
- * ethtool.
+ * The link counters of all interfaces are refreshed in one (cached)
+ * RTM_GETSTATS dump instead of a generic ni_refresh; in addition we
+ * potentially retrieve additional stats eg via ethtool.
  */
 int
 __ni_system_interface_stats_refresh(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
 	int rv = 0;
 
+	if (ni_ifstats_refresh(nc, NI_IFSTATS_LINK) < 0)
+		return -1;
+
 	if (dev->link.ethtool_stats
 	 && (rv = __ni_ethtool_stats_refresh(dev->name, dev->link.ethtool_stats)) < 0)
 		return rv;
@@ -1539,6 +1598,10 @@ __ni_process_ifinfomsg_linkinfo(ni_linkinfo_t *link, const char *ifname,
 		link->oper_state = nla_get_u8(tb[IFLA_OPERSTATE]);
 	}
 
+	if (tb[IFLA_STATS64] &&
+	    nla_len(tb[IFLA_STATS64]) >= (int)sizeof(struct rtnl_link_stats64)) {
+		ni_ifstats_set_link64(link, nla_data(tb[IFLA_STATS64]));
+	} else
 	if (tb[IFLA_STATS]) {
 		struct rtnl_link_stats *s = nla_data(tb[IFLA_STATS]);
 		ni_link_stats_t *n;
@@ -1816,6 +1879,57 @@ __ni_process_ifinfomsg_af_spec(ni_netdev_t *dev, struct nlattr *ifla_af_spec, ni
 	return 0;
 }
 
+/*
+ * Discover the link details using external calls: ethtool, wireless,
+ * pppd, teamd and openvswitch.
+ */
+static void
+__ni_netdev_discover_link_extern(ni_netdev_t *dev, ni_netconfig_t *nc)
+{
+	int rv;
+
+	ni_system_ethtool_refresh(dev);
+
+	switch (dev->link.type) {
+	case NI_IFTYPE_ETHERNET:
+		__ni_system_ethernet_refresh(dev);
+		break;
+
+	case NI_IFTYPE_PPP:
+		if (ni_netdev_device_is_ready(dev))
+			ni_pppd_discover(dev, nc);
+		break;
+
+	case NI_IFTYPE_WIRELESS:
+		rv = ni_wireless_interface_refresh(dev);
+		if (rv == -NI_ERROR_RADIO_DISABLED) {
+			ni_debug_ifconfig("%s: radio disabled, not refreshing wireless info", dev->name);
+			ni_netdev_set_wireless(dev, NULL);
+		} else
+		if (rv < 0)
+			ni_error("%s: failed to refresh wireless info", dev->name);
+		break;
+
+	case NI_IFTYPE_TEAM:
+		/*
+		 * is using gennl, rtnl_link provides a kind only,
+		 * so we unfortunatelly have to ask teamd here and
+		 * even worser, by name...
+		 */
+		if (ni_config_teamd_enabled() && ni_netdev_device_is_ready(dev))
+			ni_teamd_discover(dev);
+		break;
+
+	case NI_IFTYPE_OVS_BRIDGE:
+		if (ni_netdev_device_is_ready(dev))
+			ni_ovs_bridge_discover(dev, nc);
+		break;
+
+	default:
+		break;
+	}
+}
+
 /*
  * Refresh complete interface link info given a RTM_NEWLINK message
  */
@@ -1868,16 +1982,9 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 	__ni_process_ifinfomsg_ipv6info(dev, tb[IFLA_PROTINFO]);
 
 	if (!ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN))
-		ni_system_ethtool_refresh(dev);
+		__ni_netdev_discover_link_extern(dev, nc);
 
 	switch (dev->link.type) {
-	case NI_IFTYPE_ETHERNET:
-		if (ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN))
-			break;
-
-		__ni_system_ethernet_refresh(dev);
-		break;
-
 	case NI_IFTYPE_INFINIBAND:
 	case NI_IFTYPE_INFINIBAND_CHILD:
 		__ni_discover_infiniband(dev, nc);
@@ -1903,59 +2010,17 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 		__ni_discover_macvlan(dev, tb, nc);
 		break;
 
-	case NI_IFTYPE_PPP:
-		if (ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN))
-			break;
-
-		if (ni_netdev_device_is_ready(dev))
-			ni_pppd_discover(dev, nc);
-		break;
-
 	case NI_IFTYPE_TUN:
 	case NI_IFTYPE_TAP:
 		__ni_discover_tuntap(dev);
 		break;
 
-	case NI_IFTYPE_WIRELESS:
-		if (ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN))
-			break;
-
-		rv = ni_wireless_interface_refresh(dev);
-		if (rv == -NI_ERROR_RADIO_DISABLED) {
-			ni_debug_ifconfig("%s: radio disabled, not refreshing wireless info", dev->name);
-			ni_netdev_set_wireless(dev, NULL);
-		} else 
-		if (rv < 0)
-			ni_error("%s: failed to refresh wireless info", dev->name);
-		break;
-
 	case NI_IFTYPE_IPIP:
 	case NI_IFTYPE_GRE:
 	case NI_IFTYPE_SIT:
 		__ni_discover_tunneling(dev, tb);
 		break;
 
-	case NI_IFTYPE_TEAM:
-		if (ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN))
-			break;
-
-		/*
-		 * is using gennl, rtnl_link provides a kind only,
-		 * so we unfortunatelly have to ask teamd here and
-		 * even worser, by name...
-		 */
-		if (ni_config_teamd_enabled() && ni_netdev_device_is_ready(dev))
-			ni_teamd_discover(dev);
-		break;
-
-	case NI_IFTYPE_OVS_BRIDGE:
-		if (ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN))
-			break;
-
-		if (ni_netdev_device_is_ready(dev))
-			ni_ovs_bridge_discover(dev, nc);
-		break;
-
 	default:
 		break;
 	}
@@ -1966,6 +2031,22 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 	return 0;
 }
 
+/*
+ * Run the link details discovery using external calls, which has
+ * been deferred in a refresh of a warm restart.
+ */
+void
+__ni_system_refresh_link_extern(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	if (!nc || !dev || ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN))
+		return;
+
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
+			"Deferred link details refresh of %s interface", dev->name);
+
+	__ni_netdev_discover_link_extern(dev, nc);
+}
+
 int
 __ni_discover_vlan(ni_netdev_t *dev, struct nlattr **tb, ni_netconfig_t *nc)
 {
@@ -0,0 +1,530 @@
+/*
+ *	Bulk network interface statistics via RTM_GETSTATS
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ *	The link counters are a side effect of the RTM_GETLINK refresh, which
+ *	processes all link details of each interface. The RTM_GETSTATS dump
+ *	(linux >= 4.7) transfers only the requested statistics groups of all
+ *	interfaces in one dump, selected by the IFLA_STATS_FILTER_BIT mask.
+ *	The results are cached for the <link-stats><cache-time> per group, so
+ *	frequent polls of many interfaces cause at most one dump per period.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netlink/attr.h>
+#include <netlink/msg.h>
+#include <string.h>
+#include <errno.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/linkstats.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+
+#include "netinfo_priv.h"
+#include "util_priv.h"
+#include "appconfig.h"
+#include "kernel.h"
+#include "ifstats.h"
+
+#ifndef RTM_NEWSTATS
+#define RTM_NEWSTATS		92
+#define RTM_GETSTATS		94
+#endif
+
+#define NI_IFSTATS_XSTATS_CHUNK	16
+/* dumps interrupted by concurrent link changes are repeated that often */
+#define NI_IFSTATS_DUMP_RETRIES	5
+
+/*
+ * Copied from linux/if_bonding.h, which includes linux/if.h that
+ * clashes with net/if.h, and from linux/if_bridge.h (linux >= 4.7)
+ */
+enum {
+	BOND_XSTATS_UNSPEC,
+	BOND_XSTATS_3AD,
+	__BOND_XSTATS_MAX
+};
+#define BOND_XSTATS_MAX (__BOND_XSTATS_MAX - 1)
+
+enum {
+	BOND_3AD_STAT_LACPDU_RX,
+	BOND_3AD_STAT_LACPDU_TX,
+	BOND_3AD_STAT_LACPDU_UNKNOWN_RX,
+	BOND_3AD_STAT_LACPDU_ILLEGAL_RX,
+	BOND_3AD_STAT_MARKER_RX,
+	BOND_3AD_STAT_MARKER_TX,
+	BOND_3AD_STAT_MARKER_RESP_RX,
+	BOND_3AD_STAT_MARKER_RESP_TX,
+	BOND_3AD_STAT_MARKER_UNKNOWN_RX,
+	BOND_3AD_STAT_PAD,
+	__BOND_3AD_STAT_MAX,
+};
+
+enum {
+	BRIDGE_XSTATS_UNSPEC,
+	BRIDGE_XSTATS_VLAN,
+	BRIDGE_XSTATS_MCAST,
+	BRIDGE_XSTATS_PAD,
+	BRIDGE_XSTATS_STP,
+	__BRIDGE_XSTATS_MAX
+};
+
+enum {
+	BR_MCAST_DIR_RX,
+	BR_MCAST_DIR_TX,
+	BR_MCAST_DIR_SIZE
+};
+
+struct br_mcast_stats {
+	uint64_t igmp_v1queries[BR_MCAST_DIR_SIZE];
+	uint64_t igmp_v2queries[BR_MCAST_DIR_SIZE];
+	uint64_t igmp_v3queries[BR_MCAST_DIR_SIZE];
+	uint64_t igmp_leaves[BR_MCAST_DIR_SIZE];
+	uint64_t igmp_v1reports[BR_MCAST_DIR_SIZE];
+	uint64_t igmp_v2reports[BR_MCAST_DIR_SIZE];
+	uint64_t igmp_v3reports[BR_MCAST_DIR_SIZE];
+	uint64_t igmp_parse_errors;
+
+	uint64_t mld_v1queries[BR_MCAST_DIR_SIZE];
+	uint64_t mld_v2queries[BR_MCAST_DIR_SIZE];
+	uint64_t mld_leaves[BR_MCAST_DIR_SIZE];
+	uint64_t mld_v1reports[BR_MCAST_DIR_SIZE];
+	uint64_t mld_v2reports[BR_MCAST_DIR_SIZE];
+	uint64_t mld_parse_errors;
+
+	uint64_t mcast_bytes[BR_MCAST_DIR_SIZE];
+	uint64_t mcast_packets[BR_MCAST_DIR_SIZE];
+};
+
+struct bridge_stp_xstats {
+	uint64_t transition_blk;
+	uint64_t transition_fwd;
+	uint64_t rx_bpdu;
+	uint64_t tx_bpdu;
+	uint64_t rx_tcn;
+	uint64_t tx_tcn;
+};
+
+static const unsigned int	ni_ifstats_filter_mask[] = {
+	[0]	= IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64),
+	[1]	= IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_XSTATS) |
+		  IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_XSTATS_SLAVE) |
+		  IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_OFFLOAD_XSTATS),
+};
+#define NI_IFSTATS_GROUPS	(sizeof(ni_ifstats_filter_mask)/sizeof(ni_ifstats_filter_mask[0]))
+
+static struct ni_ifstats_cache {
+	struct timeval		stamp[NI_IFSTATS_GROUPS];
+	ni_bool_t		getlink;
+} ni_ifstats_cache;
+
+/*
+ * Set the link counters from the 64bit IFLA_STATS_LINK_64 / IFLA_STATS64
+ */
+void
+ni_ifstats_set_link64(ni_linkinfo_t *link, const struct rtnl_link_stats64 *s)
+{
+	ni_link_stats_t *n;
+
+	if (!link->stats)
+		link->stats = xcalloc(1, sizeof(*n));
+
+	if (!(n = link->stats))
+		return;
+
+	n->rx_packets = s->rx_packets;
+	n->tx_packets = s->tx_packets;
+	n->rx_bytes = s->rx_bytes;
+	n->tx_bytes = s->tx_bytes;
+	n->rx_errors = s->rx_errors;
+	n->tx_errors = s->tx_errors;
+	n->rx_dropped = s->rx_dropped;
+	n->tx_dropped = s->tx_dropped;
+	n->multicast = s->multicast;
+	n->collisions = s->collisions;
+	n->rx_length_errors = s->rx_length_errors;
+	n->rx_over_errors = s->rx_over_errors;
+	n->rx_crc_errors = s->rx_crc_errors;
+	n->rx_frame_errors = s->rx_frame_errors;
+	n->rx_fifo_errors = s->rx_fifo_errors;
+	n->rx_missed_errors = s->rx_missed_errors;
+	n->tx_aborted_errors = s->tx_aborted_errors;
+	n->tx_carrier_errors = s->tx_carrier_errors;
+	n->tx_fifo_errors = s->tx_fifo_errors;
+	n->tx_heartbeat_errors = s->tx_heartbeat_errors;
+	n->tx_window_errors = s->tx_window_errors;
+	n->rx_compressed = s->rx_compressed;
+	n->tx_compressed = s->tx_compressed;
+}
+
+/*
+ * Extended link counters
+ */
+static void
+ni_ifstats_xstats_add(ni_linkinfo_t *link, const char *name, uint64_t value)
+{
+	ni_link_xstats_t *xs;
+
+	if (!(xs = link->xstats))
+		xs = link->xstats = xcalloc(1, sizeof(*xs));
+
+	if ((xs->count % NI_IFSTATS_XSTATS_CHUNK) == 0) {
+		xs->data = xrealloc(xs->data, (xs->count + NI_IFSTATS_XSTATS_CHUNK)
+						* sizeof(xs->data[0]));
+	}
+	xs->data[xs->count].name = name;
+	xs->data[xs->count].value = value;
+	xs->count++;
+}
+
+static void
+ni_ifstats_xstats_add_link64(ni_linkinfo_t *link, const char * const names[4],
+				const struct nlattr *nla)
+{
+	const struct rtnl_link_stats64 *s;
+
+	if (nla_len(nla) < (int)sizeof(*s))
+		return;
+
+	s = nla_data(nla);
+	ni_ifstats_xstats_add(link, names[0], s->rx_packets);
+	ni_ifstats_xstats_add(link, names[1], s->tx_packets);
+	ni_ifstats_xstats_add(link, names[2], s->rx_bytes);
+	ni_ifstats_xstats_add(link, names[3], s->tx_bytes);
+}
+
+static const char *		ni_ifstats_bond_3ad_names[] = {
+	[BOND_3AD_STAT_LACPDU_RX]		= "bond-3ad-lacpdu-rx",
+	[BOND_3AD_STAT_LACPDU_TX]		= "bond-3ad-lacpdu-tx",
+	[BOND_3AD_STAT_LACPDU_UNKNOWN_RX]	= "bond-3ad-lacpdu-unknown-rx",
+	[BOND_3AD_STAT_LACPDU_ILLEGAL_RX]	= "bond-3ad-lacpdu-illegal-rx",
+	[BOND_3AD_STAT_MARKER_RX]		= "bond-3ad-marker-rx",
+	[BOND_3AD_STAT_MARKER_TX]		= "bond-3ad-marker-tx",
+	[BOND_3AD_STAT_MARKER_RESP_RX]		= "bond-3ad-marker-resp-rx",
+	[BOND_3AD_STAT_MARKER_RESP_TX]		= "bond-3ad-marker-resp-tx",
+	[BOND_3AD_STAT_MARKER_UNKNOWN_RX]	= "bond-3ad-marker-unknown-rx",
+};
+
+static void
+ni_ifstats_process_bond_xstats(ni_linkinfo_t *link, struct nlattr *nla)
+{
+	struct nlattr *tb[BOND_XSTATS_MAX + 1];
+	struct nlattr *attr;
+	int rem;
+
+	if (nla_parse_nested(tb, BOND_XSTATS_MAX, nla, NULL) < 0 || !tb[BOND_XSTATS_3AD])
+		return;
+
+	nla_for_each_nested(attr, tb[BOND_XSTATS_3AD], rem) {
+		unsigned int type = nla_type(attr);
+
+		if (type >= sizeof(ni_ifstats_bond_3ad_names)/sizeof(ni_ifstats_bond_3ad_names[0]) ||
+		    !ni_ifstats_bond_3ad_names[type] || nla_len(attr) < (int)sizeof(uint64_t))
+			continue;
+
+		ni_ifstats_xstats_add(link, ni_ifstats_bond_3ad_names[type], nla_get_u64(attr));
+	}
+}
+
+static void
+ni_ifstats_process_bridge_mcast(ni_linkinfo_t *link, const struct br_mcast_stats *s)
+{
+	unsigned int dir;
+
+	for (dir = BR_MCAST_DIR_RX; dir < BR_MCAST_DIR_SIZE; ++dir) {
+		ni_bool_t rx = dir == BR_MCAST_DIR_RX;
+
+		ni_ifstats_xstats_add(link, rx ? "bridge-igmp-queries-rx" : "bridge-igmp-queries-tx",
+				s->igmp_v1queries[dir] + s->igmp_v2queries[dir] + s->igmp_v3queries[dir]);
+		ni_ifstats_xstats_add(link, rx ? "bridge-igmp-reports-rx" : "bridge-igmp-reports-tx",
+				s->igmp_v1reports[dir] + s->igmp_v2reports[dir] + s->igmp_v3reports[dir]);
+		ni_ifstats_xstats_add(link, rx ? "bridge-igmp-leaves-rx" : "bridge-igmp-leaves-tx",
+				s->igmp_leaves[dir]);
+		ni_ifstats_xstats_add(link, rx ? "bridge-mld-queries-rx" : "bridge-mld-queries-tx",
+				s->mld_v1queries[dir] + s->mld_v2queries[dir]);
+		ni_ifstats_xstats_add(link, rx ? "bridge-mld-reports-rx" : "bridge-mld-reports-tx",
+				s->mld_v1reports[dir] + s->mld_v2reports[dir]);
+		ni_ifstats_xstats_add(link, rx ? "bridge-mld-leaves-rx" : "bridge-mld-leaves-tx",
+				s->mld_leaves[dir]);
+		ni_ifstats_xstats_add(link, rx ? "bridge-mcast-packets-rx" : "bridge-mcast-packets-tx",
+				s->mcast_packets[dir]);
+		ni_ifstats_xstats_add(link, rx ? "bridge-mcast-bytes-rx" : "bridge-mcast-bytes-tx",
+				s->mcast_bytes[dir]);
+	}
+	ni_ifstats_xstats_add(link, "bridge-igmp-parse-errors", s->igmp_parse_errors);
+	ni_ifstats_xstats_add(link, "bridge-mld-parse-errors", s->mld_parse_errors);
+}
+
+static void
+ni_ifstats_process_bridge_stp(ni_linkinfo_t *link, const struct bridge_stp_xstats *s)
+{
+	ni_ifstats_xstats_add(link, "bridge-stp-transition-blk", s->transition_blk);
+	ni_ifstats_xstats_add(link, "bridge-stp-transition-fwd", s->transition_fwd);
+	ni_ifstats_xstats_add(link, "bridge-stp-bpdu-rx", s->rx_bpdu);
+	ni_ifstats_xstats_add(link, "bridge-stp-bpdu-tx", s->tx_bpdu);
+	ni_ifstats_xstats_add(link, "bridge-stp-tcn-rx", s->rx_tcn);
+	ni_ifstats_xstats_add(link, "bridge-stp-tcn-tx", s->tx_tcn);
+}
+
+static void
+ni_ifstats_process_bridge_xstats(ni_linkinfo_t *link, struct nlattr *nla)
+{
+	struct nlattr *attr;
+	int rem;
+
+	/* the vlan counters are repeated per vlan and not processed */
+	nla_for_each_nested(attr, nla, rem) {
+		switch (nla_type(attr)) {
+		case BRIDGE_XSTATS_MCAST:
+			if (nla_len(attr) >= (int)sizeof(struct br_mcast_stats))
+				ni_ifstats_process_bridge_mcast(link, nla_data(attr));
+			break;
+		case BRIDGE_XSTATS_STP:
+			if (nla_len(attr) >= (int)sizeof(struct bridge_stp_xstats))
+				ni_ifstats_process_bridge_stp(link, nla_data(attr));
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void
+ni_ifstats_process_link_xstats(ni_linkinfo_t *link, struct nlattr *nla)
+{
+	struct nlattr *tb[LINK_XSTATS_TYPE_MAX + 1];
+
+	if (nla_parse_nested(tb, LINK_XSTATS_TYPE_MAX, nla, NULL) < 0)
+		return;
+
+	if (tb[LINK_XSTATS_TYPE_BRIDGE])
+		ni_ifstats_process_bridge_xstats(link, tb[LINK_XSTATS_TYPE_BRIDGE]);
+	if (tb[LINK_XSTATS_TYPE_BOND])
+		ni_ifstats_process_bond_xstats(link, tb[LINK_XSTATS_TYPE_BOND]);
+}
+
+static void
+ni_ifstats_process_offload_xstats(ni_linkinfo_t *link, struct nlattr *nla)
+{
+	static const char * const cpu_hit_names[4] = {
+		"offload-cpu-hit-packets-rx",	"offload-cpu-hit-packets-tx",
+		"offload-cpu-hit-bytes-rx",	"offload-cpu-hit-bytes-tx",
+	};
+	struct nlattr *tb[IFLA_OFFLOAD_XSTATS_MAX + 1];
+
+	if (nla_parse_nested(tb, IFLA_OFFLOAD_XSTATS_MAX, nla, NULL) < 0)
+		return;
+
+	if (tb[IFLA_OFFLOAD_XSTATS_CPU_HIT])
+		ni_ifstats_xstats_add_link64(link, cpu_hit_names, tb[IFLA_OFFLOAD_XSTATS_CPU_HIT]);
+}
+
+static int
+ni_ifstats_process_newstats(ni_netconfig_t *nc, struct nlmsghdr *h, unsigned int groups)
+{
+	struct nlattr *tb[IFLA_STATS_MAX + 1];
+	struct if_stats_msg *ifsm;
+	ni_netdev_t *dev;
+
+	if (!(ifsm = ni_rtnl_statsmsg(h, RTM_NEWSTATS)))
+		return -1;
+
+	if (nlmsg_parse(h, sizeof(*ifsm), tb, IFLA_STATS_MAX, NULL) < 0) {
+		ni_error("unable to parse rtnl STATS message");
+		return -1;
+	}
+
+	/* not discovered yet, the next link refresh adds it */
+	if (!(dev = ni_netdev_by_index(nc, ifsm->ifindex)))
+		return 0;
+
+	if ((groups & NI_IFSTATS_LINK) && tb[IFLA_STATS_LINK_64] &&
+	    nla_len(tb[IFLA_STATS_LINK_64]) >= (int)sizeof(struct rtnl_link_stats64))
+		ni_ifstats_set_link64(&dev->link, nla_data(tb[IFLA_STATS_LINK_64]));
+
+	if (groups & NI_IFSTATS_XSTATS) {
+		if (tb[IFLA_STATS_LINK_XSTATS])
+			ni_ifstats_process_link_xstats(&dev->link, tb[IFLA_STATS_LINK_XSTATS]);
+		if (tb[IFLA_STATS_LINK_XSTATS_SLAVE])
+			ni_ifstats_process_link_xstats(&dev->link, tb[IFLA_STATS_LINK_XSTATS_SLAVE]);
+		if (tb[IFLA_STATS_LINK_OFFLOAD_XSTATS])
+			ni_ifstats_process_offload_xstats(&dev->link, tb[IFLA_STATS_LINK_OFFLOAD_XSTATS]);
+	}
+	return 0;
+}
+
+/*
+ * Fallback to the 64bit link counters in a RTM_GETLINK dump on
+ * kernels without RTM_GETSTATS; the extended counters are n/a.
+ */
+static int
+ni_ifstats_process_newlink(ni_netconfig_t *nc, struct nlmsghdr *h, unsigned int groups)
+{
+	struct nlattr *tb[IFLA_MAX + 1];
+	struct ifinfomsg *ifi;
+	ni_netdev_t *dev;
+
+	if (!(ifi = ni_rtnl_ifinfomsg(h, RTM_NEWLINK)))
+		return -1;
+
+	if (nlmsg_parse(h, sizeof(*ifi), tb, IFLA_MAX, NULL) < 0) {
+		ni_error("unable to parse rtnl LINK message");
+		return -1;
+	}
+
+	if (!(dev = ni_netdev_by_index(nc, ifi->ifi_index)))
+		return 0;
+
+	if ((groups & NI_IFSTATS_LINK) && tb[IFLA_STATS64] &&
+	    nla_len(tb[IFLA_STATS64]) >= (int)sizeof(struct rtnl_link_stats64))
+		ni_ifstats_set_link64(&dev->link, nla_data(tb[IFLA_STATS64]));
+	return 0;
+}
+
+static int
+ni_ifstats_dump(struct ni_nlmsg_list *list, unsigned int groups)
+{
+	struct if_stats_msg ifsm;
+	struct nl_msg *msg;
+	unsigned int i;
+	int rv;
+
+	memset(&ifsm, 0, sizeof(ifsm));
+	ifsm.family = AF_UNSPEC;
+	for (i = 0; i < NI_IFSTATS_GROUPS; ++i) {
+		if (groups & NI_BIT(i))
+			ifsm.filter_mask |= ni_ifstats_filter_mask[i];
+	}
+
+	if (!(msg = nlmsg_alloc_simple(RTM_GETSTATS, NLM_F_DUMP)))
+		return -NLE_NOMEM;
+
+	if ((rv = nlmsg_append(msg, &ifsm, sizeof(ifsm), NLMSG_ALIGNTO)) >= 0)
+		rv = ni_nl_dump_store_msg(msg, list);
+
+	nlmsg_free(msg);
+	return rv;
+}
+
+static unsigned int
+ni_ifstats_stale(unsigned int groups, const struct timeval *now)
+{
+	const ni_config_link_stats_t *conf = ni_config_link_stats();
+	unsigned int cache_time = conf ? conf->cache_time : 0;
+	unsigned int i, stale = 0;
+	struct timeval delta;
+
+	for (i = 0; i < NI_IFSTATS_GROUPS; ++i) {
+		if (!(groups & NI_BIT(i)))
+			continue;
+
+		if (!timerisset(&ni_ifstats_cache.stamp[i]) ||
+		    timercmp(now, &ni_ifstats_cache.stamp[i], <)) {
+			stale |= NI_BIT(i);
+			continue;
+		}
+		timersub(now, &ni_ifstats_cache.stamp[i], &delta);
+		if (delta.tv_sec * 1000 + delta.tv_usec / 1000 >= cache_time)
+			stale |= NI_BIT(i);
+	}
+	return stale;
+}
+
+/*
+ * Refresh the requested statistics groups of all interfaces in one
+ * dump, unless they've been refreshed within the cache time.
+ * Returns 1 after a dump, 0 when the cached counters are current
+ * and a negative netlink error code on error.
+ */
+int
+ni_ifstats_refresh(ni_netconfig_t *nc, unsigned int groups)
+{
+	struct ni_nlmsg_list list;
+	struct ni_nlmsg *entry;
+	struct timeval now;
+	unsigned int i, retries = 0;
+	ni_netdev_t *dev;
+	int rv;
+
+	if (!nc)
+		return -NLE_INVAL;
+
+	ni_timer_get_time(&now);
+	if (!(groups = ni_ifstats_stale(groups & NI_IFSTATS_ALL, &now)))
+		return 0;
+
+	ni_nlmsg_list_init(&list);
+retry:
+	if (!ni_ifstats_cache.getlink) {
+		rv = ni_ifstats_dump(&list, groups);
+		if (rv == -NLE_OPNOTSUPP || rv == -NLE_INVAL) {
+			ni_debug_ifconfig("RTM_GETSTATS not supported, using RTM_GETLINK");
+			ni_nlmsg_list_destroy(&list);
+			ni_ifstats_cache.getlink = TRUE;
+			goto retry;
+		}
+	} else {
+		rv = ni_nl_dump_store(AF_UNSPEC, RTM_GETLINK, &list);
+	}
+	if (rv == -NLE_DUMP_INTR && retries++ < NI_IFSTATS_DUMP_RETRIES) {
+		ni_nlmsg_list_destroy(&list);
+		goto retry;
+	}
+	if (rv < 0) {
+		ni_debug_ifconfig("unable to dump interface statistics: %s",
+				nl_geterror(rv));
+		ni_nlmsg_list_destroy(&list);
+		return rv;
+	}
+
+	if (groups & NI_IFSTATS_XSTATS) {
+		for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+			if (dev->link.xstats)
+				dev->link.xstats->count = 0;
+		}
+	}
+
+	for (entry = list.head; entry; entry = entry->next) {
+		if (ni_ifstats_cache.getlink)
+			ni_ifstats_process_newlink(nc, &entry->h, groups);
+		else
+			ni_ifstats_process_newstats(nc, &entry->h, groups);
+	}
+	ni_nlmsg_list_destroy(&list);
+
+	for (i = 0; i < NI_IFSTATS_GROUPS; ++i) {
+		if (groups & NI_BIT(i))
+			ni_ifstats_cache.stamp[i] = now;
+	}
+	return 1;
+}
+
+/*
+ * Discard the cache time stamps, so the next refresh dumps
+ */
+void
+ni_ifstats_invalidate(void)
+{
+	memset(&ni_ifstats_cache.stamp, 0, sizeof(ni_ifstats_cache.stamp));
+}
@@ -0,0 +1,44 @@
+/*
+ *	Bulk network interface statistics via RTM_GETSTATS
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifndef NI_IFSTATS_H
+#define NI_IFSTATS_H
+
+#include <wicked/types.h>
+#include <wicked/netinfo.h>
+
+/*
+ * The statistics groups to refresh: the 64bit link counters into
+ * the link stats and the bond, bridge and offload counters into the
+ * extended link stats of all interfaces in the netconfig.
+ */
+enum {
+	NI_IFSTATS_LINK		= NI_BIT(0),
+	NI_IFSTATS_XSTATS	= NI_BIT(1),
+};
+#define NI_IFSTATS_ALL		(NI_IFSTATS_LINK | NI_IFSTATS_XSTATS)
+
+struct rtnl_link_stats64;
+
+extern int		ni_ifstats_refresh(ni_netconfig_t *, unsigned int);
+extern void		ni_ifstats_invalidate(void);
+extern void		ni_ifstats_set_link64(ni_linkinfo_t *, const struct rtnl_link_stats64 *);
+
+#endif /* NI_IFSTATS_H */
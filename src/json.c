@@ -45,6 +45,17 @@
 #define	NI_JSON_OBJECT_CHUNK	4
 #define NI_JSON_ARRAY_CHUNK	4
 
+/*
+ * objects with more members get a hash index
+ * for the lookup by name
+ */
+#define NI_JSON_OBJECT_HASH_MIN	8
+
+/*
+ * max nesting depth accepted by the stream parser
+ */
+#define NI_JSON_STREAM_DEPTH_MAX	256
+
 
 /*
  * structured types
@@ -66,6 +77,7 @@ struct ni_json {
 struct ni_json_pair {
 	unsigned int		refcount;
 
+	unsigned int		hash;
 	char *			name;
 	ni_json_t *		value;
 };
@@ -73,6 +85,9 @@ struct ni_json_pair {
 struct ni_json_object {
 	unsigned int		count;
 	ni_json_pair_t **	data;
+
+	unsigned int		hsize;	/* power of 2 or 0 */
+	unsigned int *		hindex;	/* data position + 1 */
 };
 
 struct ni_json_array {
@@ -203,6 +218,7 @@ ni_json_pair_new(const char *name, ni_json_t *value)
 	if (name && value) {
 		pair = xcalloc(1, sizeof(*pair));
 		pair->refcount = 1;
+		pair->hash = ni_string_hash(name);
 		pair->name = xstrdup(name);
 		pair->value = value;
 		return pair;
@@ -275,6 +291,76 @@ ni_json_object_new(void)
 	return xcalloc(1, sizeof(ni_json_object_t));
 }
 
+static inline void
+ni_json_object_hash_drop(ni_json_object_t *njo)
+{
+	free(njo->hindex);
+	njo->hindex = NULL;
+	njo->hsize = 0;
+}
+
+static void
+ni_json_object_hash_insert(ni_json_object_t *njo, unsigned int pos)
+{
+	unsigned int mask = njo->hsize - 1;
+	unsigned int slot = njo->data[pos]->hash & mask;
+
+	while (njo->hindex[slot])
+		slot = (slot + 1) & mask;
+	njo->hindex[slot] = pos + 1;
+}
+
+static void
+ni_json_object_hash_build(ni_json_object_t *njo)
+{
+	unsigned int size, i;
+
+	for (size = 16; size < njo->count * 2; size <<= 1)
+		;
+
+	ni_json_object_hash_drop(njo);
+	njo->hindex = xcalloc(size, sizeof(unsigned int));
+	njo->hsize = size;
+
+	for (i = 0; i < njo->count; ++i)
+		ni_json_object_hash_insert(njo, i);
+}
+
+static ni_bool_t
+ni_json_object_find(ni_json_object_t *njo, const char *name, unsigned int *pos)
+{
+	unsigned int hash, mask, slot, i;
+	ni_json_pair_t *pair;
+
+	if (!name)
+		return FALSE;
+
+	if (njo->count <= NI_JSON_OBJECT_HASH_MIN) {
+		for (i = 0; i < njo->count; ++i) {
+			if (ni_string_eq(njo->data[i]->name, name)) {
+				*pos = i;
+				return TRUE;
+			}
+		}
+		return FALSE;
+	}
+
+	if (!njo->hindex)
+		ni_json_object_hash_build(njo);
+
+	hash = ni_string_hash(name);
+	mask = njo->hsize - 1;
+	for (slot = hash & mask; njo->hindex[slot]; slot = (slot + 1) & mask) {
+		i = njo->hindex[slot] - 1;
+		pair = njo->data[i];
+		if (pair->hash == hash && ni_string_eq(pair->name, name)) {
+			*pos = i;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 static void
 ni_json_object_free(ni_json_object_t *njo)
 {
@@ -285,6 +371,7 @@ ni_json_object_free(ni_json_object_t *njo)
 	}
 	free(njo->data);
 	njo->data = NULL;
+	ni_json_object_hash_drop(njo);
 	free(njo);
 }
 
@@ -292,18 +379,15 @@ ni_json_pair_t *
 ni_json_object_get_pair(ni_json_t *json, const char *name)
 {
 	ni_json_object_t *njo;
-	unsigned int i;
+	unsigned int pos;
 
 	if (!(njo = ni_json_to_object(json)))
 		return NULL;
 
-	for (i = 0; i < njo->count; ++i) {
-		ni_json_pair_t *pair = njo->data[i];
+	if (!ni_json_object_find(njo, name, &pos))
+		return NULL;
 
-		if (ni_string_eq(pair->name, name))
-			return pair;
-	}
-	return NULL;
+	return njo->data[pos];
 }
 
 ni_json_pair_t *
@@ -372,6 +456,14 @@ ni_json_object_append(ni_json_t *json, const char *name, ni_json_t *value)
 		ni_json_object_realloc(njo, njo->count);
 
 	njo->data[njo->count++] = pair;
+
+	/* keep an existing index up to date, build it lazily otherwise */
+	if (njo->hindex) {
+		if (njo->count * 2 > njo->hsize)
+			ni_json_object_hash_build(njo);
+		else
+			ni_json_object_hash_insert(njo, njo->count - 1);
+	}
 	return TRUE;
 }
 
@@ -423,6 +515,9 @@ ni_json_object_remove_at(ni_json_t *json, unsigned int pos)
 	ni_json_pair_free(njo->data[pos]);
 	njo->count--;
 
+	/* positions are shifting, rebuild index on next lookup */
+	ni_json_object_hash_drop(njo);
+
 	if (pos < njo->count) {
 		memmove(&njo->data[pos], &njo->data[pos + 1],
 			(njo->count - pos) * sizeof(ni_json_pair_t *));
@@ -444,18 +539,15 @@ ni_json_t *
 ni_json_object_remove(ni_json_t *json, const char *name)
 {
 	ni_json_object_t *njo;
-	unsigned int i;
+	unsigned int pos;
 
 	if (!(njo = ni_json_to_object(json)))
 		return NULL;
 
-	for (i = 0; i < njo->count; ++i) {
-		ni_json_pair_t *pair = njo->data[i];
+	if (!ni_json_object_find(njo, name, &pos))
+		return NULL;
 
-		if (ni_string_eq(pair->name, name))
-			return ni_json_object_remove_at(json, i);
-	}
-	return NULL;
+	return ni_json_object_remove_at(json, pos);
 }
 
 ni_bool_t
@@ -1066,6 +1158,7 @@ ni_json_reader_stack_pop(ni_json_reader_t *jr)
 		stack->parent = NULL;
 		ni_string_free(&stack->name);
 		ni_json_free(stack->value);
+		free(stack);
 	}
 	return jr->stack;
 }
@@ -1786,3 +1879,394 @@ ni_json_parse_string(const char *str)
 	return ni_json_parse_buffer(&buf);
 }
 
+
+/*
+ * streaming (event callback) parser
+ */
+typedef enum {
+	NI_JSON_STREAM_EMIT = 0U,	/* report events to handler	*/
+	NI_JSON_STREAM_MKTREE,		/* build the subtree		*/
+	NI_JSON_STREAM_IGNORE,		/* just parse over it		*/
+} ni_json_stream_mode_t;
+
+typedef struct ni_json_stream {
+	ni_json_reader_t		reader;
+	ni_json_stream_handler_t *	handler;
+	void *				user_data;
+	ni_stringbuf_t			path;
+	unsigned int			depth;
+	ni_bool_t			stop;
+} ni_json_stream_t;
+
+static ni_bool_t	ni_json_stream_value(ni_json_stream_t *, ni_json_token_type_t,
+					ni_stringbuf_t *, const char *,
+					ni_json_stream_mode_t, ni_json_t **);
+
+static ni_json_token_type_t
+ni_json_stream_token(ni_json_stream_t *js, ni_stringbuf_t *tok)
+{
+	ni_stringbuf_clear(tok);
+	ni_json_reader_skip_spaces(&js->reader);
+	return ni_json_get_token(&js->reader, tok);
+}
+
+static ni_bool_t
+ni_json_stream_error(ni_json_stream_t *js, const char *what)
+{
+	return ni_json_reader_set_error(&js->reader, "%s at '%s'", what,
+			js->path.string ? js->path.string : "/");
+}
+
+static ni_json_stream_action_t
+ni_json_stream_emit(ni_json_stream_t *js, ni_json_event_type_t type,
+			const char *name, ni_json_t *value)
+{
+	ni_json_event_t event;
+	ni_json_stream_action_t action;
+
+	event.type  = type;
+	event.path  = js->path.string ? js->path.string : "";
+	event.name  = name;
+	event.depth = js->depth;
+	event.value = value;
+
+	action = js->handler(&event, js->user_data);
+	if (action == NI_JSON_STREAM_STOP)
+		js->stop = TRUE;
+	return action;
+}
+
+static void
+ni_json_stream_path_push(ni_json_stream_t *js, const char *name, unsigned int index)
+{
+	if (name) {
+		ni_stringbuf_putc(&js->path, '/');
+		ni_stringbuf_puts(&js->path, name);
+	} else {
+		ni_stringbuf_printf(&js->path, "/%u", index);
+	}
+}
+
+static ni_bool_t
+ni_json_stream_object(ni_json_stream_t *js, ni_json_stream_mode_t mode, ni_json_t *object)
+{
+	ni_stringbuf_t tok = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_json_token_type_t token;
+	size_t len = js->path.len;
+	ni_json_t *value;
+	char *name = NULL;
+	ni_bool_t ret = FALSE;
+
+	token = ni_json_stream_token(js, &tok);
+	if (token == ObjectEnd) {
+		ni_stringbuf_destroy(&tok);
+		return TRUE;
+	}
+
+	while (!js->stop) {
+		if (token != String) {
+			ni_json_stream_error(js, "expected object member name");
+			break;
+		}
+		ni_string_dup(&name, tok.string);
+
+		if (ni_json_stream_token(js, &tok) != Colon) {
+			ni_json_stream_error(js, "expected colon after object member name");
+			break;
+		}
+
+		value = NULL;
+		ni_json_stream_path_push(js, name, 0);
+		token = ni_json_stream_token(js, &tok);
+		if (!ni_json_stream_value(js, token, &tok, name, mode, &value) || js->stop)
+			break;
+		ni_stringbuf_truncate(&js->path, len);
+
+		if (value && !ni_json_object_set(object, name, value)) {
+			ni_json_free(value);
+			ni_json_stream_error(js, "unable to add member to object");
+			break;
+		}
+
+		token = ni_json_stream_token(js, &tok);
+		if (token == ObjectEnd) {
+			ret = TRUE;
+			break;
+		}
+		if (token != Comma) {
+			ni_json_stream_error(js, "missed object member separator or end");
+			break;
+		}
+		token = ni_json_stream_token(js, &tok);
+	}
+
+	ni_string_free(&name);
+	ni_stringbuf_destroy(&tok);
+	return ret || js->stop;
+}
+
+static ni_bool_t
+ni_json_stream_array(ni_json_stream_t *js, ni_json_stream_mode_t mode, ni_json_t *array)
+{
+	ni_stringbuf_t tok = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_json_token_type_t token;
+	size_t len = js->path.len;
+	unsigned int index = 0;
+	ni_json_t *value;
+	ni_bool_t ret = FALSE;
+
+	token = ni_json_stream_token(js, &tok);
+	if (token == ArrayEnd) {
+		ni_stringbuf_destroy(&tok);
+		return TRUE;
+	}
+
+	while (!js->stop) {
+		value = NULL;
+		ni_json_stream_path_push(js, NULL, index++);
+		if (!ni_json_stream_value(js, token, &tok, NULL, mode, &value) || js->stop)
+			break;
+		ni_stringbuf_truncate(&js->path, len);
+
+		if (value && !ni_json_array_append(array, value)) {
+			ni_json_free(value);
+			ni_json_stream_error(js, "unable to add value to array");
+			break;
+		}
+
+		token = ni_json_stream_token(js, &tok);
+		if (token == ArrayEnd) {
+			ret = TRUE;
+			break;
+		}
+		if (token != Comma) {
+			ni_json_stream_error(js, "missed array element separator or end");
+			break;
+		}
+		token = ni_json_stream_token(js, &tok);
+	}
+
+	ni_stringbuf_destroy(&tok);
+	return ret || js->stop;
+}
+
+static ni_bool_t
+ni_json_stream_container(ni_json_stream_t *js, ni_json_token_type_t token,
+			const char *name, ni_json_stream_mode_t mode, ni_json_t **ret)
+{
+	ni_bool_t object = token == ObjectBegin;
+	ni_json_stream_action_t action;
+	ni_json_stream_mode_t inner = mode;
+	ni_json_t *tree = NULL;
+	ni_bool_t ok;
+
+	if (js->depth >= NI_JSON_STREAM_DEPTH_MAX)
+		return ni_json_stream_error(js, "maximum nesting depth exceeded");
+
+	if (mode == NI_JSON_STREAM_EMIT) {
+		action = ni_json_stream_emit(js, object ? NI_JSON_EVENT_OBJECT_BEGIN :
+					NI_JSON_EVENT_ARRAY_BEGIN, name, NULL);
+		switch (action) {
+		case NI_JSON_STREAM_STOP:
+			return TRUE;
+		case NI_JSON_STREAM_SKIP:
+			inner = NI_JSON_STREAM_IGNORE;
+			break;
+		case NI_JSON_STREAM_BUILD:
+			inner = NI_JSON_STREAM_MKTREE;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (inner == NI_JSON_STREAM_MKTREE)
+		tree = object ? ni_json_new_object() : ni_json_new_array();
+
+	js->depth++;
+	if (object)
+		ok = ni_json_stream_object(js, inner, tree);
+	else
+		ok = ni_json_stream_array(js, inner, tree);
+	js->depth--;
+
+	if (!ok || js->stop) {
+		ni_json_free(tree);
+		return ok;
+	}
+
+	if (mode == NI_JSON_STREAM_MKTREE) {
+		*ret = tree;
+	} else
+	if (mode == NI_JSON_STREAM_EMIT) {
+		if (inner == NI_JSON_STREAM_MKTREE)
+			ni_json_stream_emit(js, NI_JSON_EVENT_VALUE, name, tree);
+		else
+		if (inner == NI_JSON_STREAM_EMIT)
+			ni_json_stream_emit(js, object ? NI_JSON_EVENT_OBJECT_END :
+					NI_JSON_EVENT_ARRAY_END, name, NULL);
+		ni_json_free(tree);
+	}
+	return TRUE;
+}
+
+static ni_bool_t
+ni_json_stream_value(ni_json_stream_t *js, ni_json_token_type_t token,
+			ni_stringbuf_t *tok, const char *name,
+			ni_json_stream_mode_t mode, ni_json_t **ret)
+{
+	ni_json_t *value;
+
+	switch (token) {
+	case ObjectBegin:
+	case ArrayBegin:
+		return ni_json_stream_container(js, token, name, mode, ret);
+
+	case String:
+		if (mode == NI_JSON_STREAM_IGNORE)
+			return TRUE;
+		value = ni_json_new_string(tok->string);
+		break;
+
+	case Number:
+		if (!(value = ni_json_new_number(tok->string)))
+			return ni_json_stream_error(js, "invalid number");
+		break;
+
+	case Literal:
+		if (!(value = ni_json_new_literal(tok->string)))
+			return ni_json_stream_error(js, "invalid literal");
+		break;
+
+	case EndOfFile:
+		return ni_json_stream_error(js, "unexpected end of file");
+
+	default:
+		return ni_json_stream_error(js, "unexpected token");
+	}
+
+	switch (mode) {
+	case NI_JSON_STREAM_MKTREE:
+		*ret = value;
+		return TRUE;
+	case NI_JSON_STREAM_EMIT:
+		ni_json_stream_emit(js, NI_JSON_EVENT_VALUE, name, value);
+		/* fall through */
+	default:
+		ni_json_free(value);
+		return TRUE;
+	}
+}
+
+ni_bool_t
+ni_json_stream_parse_buffer(ni_buffer_t *buf, ni_json_stream_handler_t *handler, void *user_data)
+{
+	ni_stringbuf_t tok = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_json_token_type_t token;
+	ni_json_stream_t js;
+	ni_bool_t ret = FALSE;
+
+	if (!handler || !ni_json_reader_init_buffer(&js.reader, buf))
+		return FALSE;
+
+	js.handler = handler;
+	js.user_data = user_data;
+	js.depth = 0;
+	js.stop = FALSE;
+	ni_stringbuf_init(&js.path);
+	ni_json_reader_stack_new(&js.reader, Initial);
+
+	token = ni_json_stream_token(&js, &tok);
+	if (ni_json_stream_value(&js, token, &tok, NULL, NI_JSON_STREAM_EMIT, NULL)) {
+		if (js.stop || ni_json_stream_token(&js, &tok) == EndOfFile)
+			ret = TRUE;
+		else
+			ni_json_stream_error(&js, "unexpected data after value");
+	}
+
+	ni_stringbuf_destroy(&tok);
+	ni_stringbuf_destroy(&js.path);
+	ni_json_reader_destroy(&js.reader);
+	return ret;
+}
+
+ni_bool_t
+ni_json_stream_parse_string(const char *str, ni_json_stream_handler_t *handler, void *user_data)
+{
+	ni_buffer_t buf;
+
+	if (ni_string_empty(str))
+		return FALSE;
+
+	ni_buffer_init_reader(&buf, (char *)str, ni_string_len(str));
+	return ni_json_stream_parse_buffer(&buf, handler, user_data);
+}
+
+/*
+ * extract the values at the specified paths without
+ * building a tree for anything else in the document
+ */
+typedef struct ni_json_path_select {
+	unsigned int		count;
+	const char * const *	paths;
+	ni_json_t **		values;
+	unsigned int		found;
+} ni_json_path_select_t;
+
+static ni_json_stream_action_t
+ni_json_path_select_handler(const ni_json_event_t *event, void *user_data)
+{
+	ni_json_path_select_t *sel = user_data;
+	ni_bool_t inner = FALSE;
+	size_t len = strlen(event->path);
+	unsigned int i;
+
+	if (event->type == NI_JSON_EVENT_OBJECT_END ||
+	    event->type == NI_JSON_EVENT_ARRAY_END)
+		return NI_JSON_STREAM_CONTINUE;
+
+	for (i = 0; i < sel->count; ++i) {
+		const char *path = sel->paths[i];
+
+		if (sel->values[i] || !path)
+			continue;
+
+		if (ni_string_eq(path, event->path)) {
+			if (event->type != NI_JSON_EVENT_VALUE)
+				return NI_JSON_STREAM_BUILD;
+
+			sel->values[i] = ni_json_ref(event->value);
+			if (++sel->found == sel->count)
+				return NI_JSON_STREAM_STOP;
+		} else
+		if (!strncmp(path, event->path, len) && path[len] == '/') {
+			inner = TRUE;
+		}
+	}
+	return inner ? NI_JSON_STREAM_CONTINUE : NI_JSON_STREAM_SKIP;
+}
+
+int
+ni_json_parse_paths(const char *str, unsigned int count, const char * const *paths, ni_json_t **values)
+{
+	ni_json_path_select_t sel;
+	unsigned int i;
+
+	if (!count || !paths || !values)
+		return -1;
+
+	memset(values, 0, count * sizeof(values[0]));
+	sel.count = count;
+	sel.paths = paths;
+	sel.values = values;
+	sel.found = 0;
+
+	if (!ni_json_stream_parse_string(str, ni_json_path_select_handler, &sel)) {
+		for (i = 0; i < count; ++i) {
+			ni_json_free(values[i]);
+			values[i] = NULL;
+		}
+		return -1;
+	}
+	return sel.found;
+}
@@ -118,4 +118,42 @@ extern	const char *			ni_json_format_string(ni_stringbuf_t *buf,
 
 extern	ni_json_t *			ni_json_parse_string(const char *str);
 
+/*
+ * Streaming parser reporting events to a handler instead of building
+ * the tree. The handler may skip the contents of an object or array,
+ * request to build it (reported as a value event afterwards) or stop.
+ * Paths are of the form "/name/0/name", the document root is "".
+ */
+typedef enum {
+	NI_JSON_EVENT_VALUE = 0U,
+	NI_JSON_EVENT_OBJECT_BEGIN,
+	NI_JSON_EVENT_OBJECT_END,
+	NI_JSON_EVENT_ARRAY_BEGIN,
+	NI_JSON_EVENT_ARRAY_END,
+} ni_json_event_type_t;
+
+typedef enum {
+	NI_JSON_STREAM_CONTINUE = 0U,
+	NI_JSON_STREAM_SKIP,
+	NI_JSON_STREAM_BUILD,
+	NI_JSON_STREAM_STOP,
+} ni_json_stream_action_t;
+
+typedef struct ni_json_event {
+	ni_json_event_type_t		type;
+	const char *			path;
+	const char *			name;	/* member name, NULL in arrays */
+	unsigned int			depth;
+	ni_json_t *			value;	/* value events only, borrowed */
+} ni_json_event_t;
+
+typedef ni_json_stream_action_t		ni_json_stream_handler_t(const ni_json_event_t *, void *);
+
+extern	ni_bool_t			ni_json_stream_parse_buffer(ni_buffer_t *,
+							ni_json_stream_handler_t *, void *);
+extern	ni_bool_t			ni_json_stream_parse_string(const char *,
+							ni_json_stream_handler_t *, void *);
+extern	int				ni_json_parse_paths(const char *str, unsigned int count,
+							const char * const *paths, ni_json_t **values);
+
 #endif /* NI_JSON_H */
@@ -531,31 +531,18 @@ __ni_nl_dump_valid(struct nl_msg *msg, void *p)
 }
 
 /*
- * Issue a DUMP request and store all replies in list
+ * Receive the replies of a DUMP request and store them in list
  */
-int
-ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+static int
+__ni_nl_dump_recv(struct nl_sock *nl_sock, const char *name, struct ni_nlmsg_list *list)
 {
-	struct nl_sock *nl_sock;
 	struct __ni_nl_dump_state data = {
 		.msg_type = -1,
 		.list = list,
 	};
 	struct nl_cb *cb;
-	const char *name;
 	int rv;
 
-	name = ni_rtnl_msg_type_to_name(type, __func__);
-	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
-		ni_error("%s: no netlink socket", name);
-		return -NLE_BAD_SOCK;
-	}
-
-	if ((rv = nl_rtgen_request(nl_sock, type, af, NLM_F_DUMP)) < 0) {
-		ni_error("%s: failed to send request", name);
-		return rv;
-	}
-
 	if (!(cb = __ni_nl_cb_clone(__ni_global_netlink)))
 		return -NLE_NOMEM;
 
@@ -585,6 +572,55 @@ retry:
 	return rv;
 }
 
+/*
+ * Issue a DUMP request and store all replies in list
+ */
+int
+ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+{
+	struct nl_sock *nl_sock;
+	const char *name;
+	int rv;
+
+	name = ni_rtnl_msg_type_to_name(type, __func__);
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", name);
+		return -NLE_BAD_SOCK;
+	}
+
+	if ((rv = nl_rtgen_request(nl_sock, type, af, NLM_F_DUMP)) < 0) {
+		ni_error("%s: failed to send request", name);
+		return rv;
+	}
+
+	return __ni_nl_dump_recv(nl_sock, name, list);
+}
+
+/*
+ * Issue a DUMP request with a request specific header, e.g. the
+ * RTM_GETSTATS filter mask, and store all replies in list
+ */
+int
+ni_nl_dump_store_msg(struct nl_msg *msg, struct ni_nlmsg_list *list)
+{
+	struct nl_sock *nl_sock;
+	const char *name;
+	int rv;
+
+	name = ni_rtnl_msg_type_to_name(nlmsg_hdr(msg)->nlmsg_type, __func__);
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", name);
+		return -NLE_BAD_SOCK;
+	}
+
+	if ((rv = nl_send_auto(nl_sock, msg)) < 0) {
+		ni_error("%s: failed to send request", name);
+		return rv;
+	}
+
+	return __ni_nl_dump_recv(nl_sock, name, list);
+}
+
 /*
  * Send a message and capture the response message(s)
  */
@@ -697,6 +733,10 @@ static const char *	ni_rtnl_msg_type_names[RTM_MAX] = {
 	ni_t2n(RTM_DELNSID),
 	ni_t2n(RTM_GETNSID),
 #endif
+#ifdef	RTM_NEWSTATS
+	ni_t2n(RTM_NEWSTATS),
+	ni_t2n(RTM_GETSTATS),
+#endif
 };
 #undef	ni_t2n
 
@@ -11,6 +11,7 @@
 #include <netlink/netlink.h>
 #include <netlink/netlink.h>
 #include <linux/ethtool.h>
+#include <linux/if_link.h>
 #include <linux/fib_rules.h>
 
 #define __user /* unclean header file */
@@ -86,6 +87,7 @@ struct ni_nlmsg_list {
 
 extern int	ni_nl_talk(struct nl_msg *, struct ni_nlmsg_list *);
 extern int	ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list);
+extern int	ni_nl_dump_store_msg(struct nl_msg *, struct ni_nlmsg_list *list);
 
 extern void	ni_nlmsg_list_init(struct ni_nlmsg_list *);
 extern void	ni_nlmsg_list_destroy(struct ni_nlmsg_list *);
@@ -138,6 +140,12 @@ ni_rtnl_nduseroptmsg(struct nlmsghdr *h, int expected_type)
 	return __ni_rtnl_msgdata(h, expected_type, sizeof(struct nduseroptmsg));
 }
 
+static inline struct if_stats_msg *
+ni_rtnl_statsmsg(struct nlmsghdr *h, int expected_type)
+{
+	return __ni_rtnl_msgdata(h, expected_type, sizeof(struct if_stats_msg));
+}
+
 extern ni_bool_t	ni_rtnl_route_filter_msg(struct rtmsg *);
 extern int	ni_rtnl_route_parse_msg(struct nlmsghdr *, struct rtmsg *, ni_route_t *);
 extern int	ni_rtnl_rule_parse_msg(struct nlmsghdr *, struct fib_rule_hdr *, ni_rule_t *);
@@ -30,9 +30,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
+#include <arpa/inet.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/addrconf.h>
@@ -42,6 +45,7 @@
 #include <wicked/route.h>
 #include <wicked/logging.h>
 #include <wicked/xml.h>
+#include <wicked/socket.h>
 
 #include "appconfig.h"
 #include "leasefile.h"
@@ -49,6 +53,7 @@
 #include "dhcp4/lease.h"
 #include "dhcp6/lease.h"
 #include "netinfo_priv.h"
+#include "buffer.h"
 
 /*
  * utility returning a family + type specific node / name
@@ -1230,38 +1235,523 @@ ni_addrconf_lease_from_xml(ni_addrconf_lease_t **leasep, const xml_node_t *root,
 
 /*
  * lease file read and write routines
+ *
+ * Leases are written synchronously by default. With a write-delay,
+ * the writes are queued per ifname, type and family, a newer lease
+ * replaces the queued one, and the queue is written in one pass
+ * when the delay expires, on read and on flush.
  */
+#define NI_ADDRCONF_LEASE_FILE_BINARY_MAGIC	"NILB"
+#define NI_ADDRCONF_LEASE_FILE_BINARY_VERSION	1
+#define NI_ADDRCONF_LEASE_FILE_BINARY_HDRLEN	16
+#define NI_ADDRCONF_LEASE_FILE_BINARY_DEPTH	32
+#define NI_ADDRCONF_LEASE_FILE_BINARY_NULL	0xffff
+
+typedef struct ni_addrconf_lease_file_pending	ni_addrconf_lease_file_pending_t;
+
+struct ni_addrconf_lease_file_pending {
+	ni_addrconf_lease_file_pending_t *next;
+
+	char *			ifname;
+	int			type;
+	int			family;
+	xml_node_t *		xml;
+
+	char *			filename;
+	char			tempname[PATH_MAX];
+	ni_bool_t		fallback;
+	FILE *			fp;
+};
+
+static struct {
+	ni_addrconf_lease_file_pending_t *list;
+	const ni_timer_t *	timer;
+} ni_addrconf_lease_file_queue;
+
 static const char *		__ni_addrconf_lease_file_path(char **,
-				const char *, const char *, int, int);
+				const char *, const char *, int, int, unsigned int);
 static void			__ni_addrconf_lease_file_remove(
 				const char *, const char *, int, int);
 
+static const ni_config_lease_file_t *
+__ni_addrconf_lease_file_config(void)
+{
+	static const ni_config_lease_file_t defaults = {
+		.format		= NI_CONFIG_LEASE_FILE_FORMAT_XML,
+		.write_delay	= 0,
+		.sync		= FALSE,
+	};
+	const ni_config_lease_file_t *conf;
+
+	return (conf = ni_config_lease_file()) ? conf : &defaults;
+}
+
+/*
+ * Compact binary lease encoding: the lease xml tree, with a header
+ * carrying a magic, the format version, the length and a checksum
+ * of the node data, so truncated or foreign files are rejected.
+ */
+static ni_bool_t
+__ni_addrconf_lease_binary_put(ni_buffer_t *bp, const void *data, size_t len)
+{
+	ni_buffer_ensure_tailroom(bp, len);
+	return ni_buffer_put(bp, data, len) == 0;
+}
+
+static ni_bool_t
+__ni_addrconf_lease_binary_put_uint16(ni_buffer_t *bp, uint16_t value)
+{
+	value = htons(value);
+	return __ni_addrconf_lease_binary_put(bp, &value, sizeof(value));
+}
+
+static ni_bool_t
+__ni_addrconf_lease_binary_put_string(ni_buffer_t *bp, const char *str)
+{
+	size_t len;
+
+	if (!str)
+		return __ni_addrconf_lease_binary_put_uint16(bp, NI_ADDRCONF_LEASE_FILE_BINARY_NULL);
+
+	if ((len = strlen(str)) >= NI_ADDRCONF_LEASE_FILE_BINARY_NULL)
+		return FALSE;
+
+	return __ni_addrconf_lease_binary_put_uint16(bp, len) &&
+		__ni_addrconf_lease_binary_put(bp, str, len);
+}
+
+static ni_bool_t
+__ni_addrconf_lease_binary_put_node(ni_buffer_t *bp, const xml_node_t *node, unsigned int depth)
+{
+	const xml_node_t *child;
+	unsigned int i, count;
+
+	if (depth > NI_ADDRCONF_LEASE_FILE_BINARY_DEPTH || !node->name)
+		return FALSE;
+
+	if (!__ni_addrconf_lease_binary_put_string(bp, node->name) ||
+	    !__ni_addrconf_lease_binary_put_string(bp, node->cdata))
+		return FALSE;
+
+	if (node->attrs.count >= NI_ADDRCONF_LEASE_FILE_BINARY_NULL ||
+	    !__ni_addrconf_lease_binary_put_uint16(bp, node->attrs.count))
+		return FALSE;
+	for (i = 0; i < node->attrs.count; ++i) {
+		const ni_var_t *attr = &node->attrs.data[i];
+
+		if (!__ni_addrconf_lease_binary_put_string(bp, attr->name) ||
+		    !__ni_addrconf_lease_binary_put_string(bp, attr->value))
+			return FALSE;
+	}
+
+	for (count = 0, child = node->children; child; child = child->next)
+		count++;
+	if (count >= NI_ADDRCONF_LEASE_FILE_BINARY_NULL ||
+	    !__ni_addrconf_lease_binary_put_uint16(bp, count))
+		return FALSE;
+	for (child = node->children; child; child = child->next) {
+		if (!__ni_addrconf_lease_binary_put_node(bp, child, depth + 1))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static ni_bool_t
+__ni_addrconf_lease_binary_encode(ni_buffer_t *bp, const xml_node_t *xml)
+{
+	unsigned char *hdr;
+	uint32_t len, sum;
+	uint16_t version;
+
+	if (!__ni_addrconf_lease_binary_put(bp, NULL, NI_ADDRCONF_LEASE_FILE_BINARY_HDRLEN) ||
+	    !__ni_addrconf_lease_binary_put_node(bp, xml, 0))
+		return FALSE;
+
+	hdr = ni_buffer_head(bp);
+	len = ni_buffer_count(bp) - NI_ADDRCONF_LEASE_FILE_BINARY_HDRLEN;
+	sum = ni_hash_fnv1a(NI_HASH_FNV1A_INIT, hdr + NI_ADDRCONF_LEASE_FILE_BINARY_HDRLEN, len);
+	version = htons(NI_ADDRCONF_LEASE_FILE_BINARY_VERSION);
+	len = htonl(len);
+	sum = htonl(sum);
+
+	memcpy(hdr, NI_ADDRCONF_LEASE_FILE_BINARY_MAGIC, 4);
+	memcpy(hdr + 4, &version, sizeof(version));
+	memset(hdr + 6, 0, 2);
+	memcpy(hdr + 8, &len, sizeof(len));
+	memcpy(hdr + 12, &sum, sizeof(sum));
+	return TRUE;
+}
+
+static int
+__ni_addrconf_lease_binary_get_string(ni_buffer_t *bp, char **str)
+{
+	const char *data;
+	uint16_t len;
+
+	ni_string_free(str);
+	if (ni_buffer_get_uint16(bp, &len) < 0)
+		return -1;
+	if (len == NI_ADDRCONF_LEASE_FILE_BINARY_NULL)
+		return 0;
+	if (!(data = ni_buffer_pull_head(bp, len)) || memchr(data, '\0', len))
+		return -1;
+	ni_string_set(str, data, len);
+	return 0;
+}
+
+static xml_node_t *
+__ni_addrconf_lease_binary_get_node(ni_buffer_t *bp, xml_node_t *parent, unsigned int depth)
+{
+	char *name = NULL, *value = NULL;
+	xml_node_t *node;
+	uint16_t count;
+
+	if (depth > NI_ADDRCONF_LEASE_FILE_BINARY_DEPTH ||
+	    __ni_addrconf_lease_binary_get_string(bp, &name) < 0 || !name)
+		return NULL;
+
+	node = xml_node_new(name, parent);
+	ni_string_free(&name);
+	if (__ni_addrconf_lease_binary_get_string(bp, &node->cdata) < 0)
+		goto failed;
+
+	if (ni_buffer_get_uint16(bp, &count) < 0)
+		goto failed;
+	while (count--) {
+		if (__ni_addrconf_lease_binary_get_string(bp, &name) < 0 || !name ||
+		    __ni_addrconf_lease_binary_get_string(bp, &value) < 0)
+			goto failed;
+		xml_node_add_attr(node, name, value);
+	}
+	ni_string_free(&name);
+	ni_string_free(&value);
+
+	if (ni_buffer_get_uint16(bp, &count) < 0)
+		goto failed;
+	while (count--) {
+		if (!__ni_addrconf_lease_binary_get_node(bp, node, depth + 1))
+			goto failed;
+	}
+	return node;
+
+failed:
+	ni_string_free(&name);
+	ni_string_free(&value);
+	if (!parent)
+		xml_node_free(node);
+	return NULL;
+}
+
+static xml_node_t *
+__ni_addrconf_lease_binary_decode(ni_buffer_t *bp)
+{
+	const unsigned char *hdr;
+	uint32_t len, sum;
+	uint16_t version;
+	xml_node_t *xml;
+
+	if (!(hdr = ni_buffer_pull_head(bp, NI_ADDRCONF_LEASE_FILE_BINARY_HDRLEN)) ||
+	    memcmp(hdr, NI_ADDRCONF_LEASE_FILE_BINARY_MAGIC, 4))
+		return NULL;
+
+	memcpy(&version, hdr + 4, sizeof(version));
+	memcpy(&len, hdr + 8, sizeof(len));
+	memcpy(&sum, hdr + 12, sizeof(sum));
+	if (ntohs(version) != NI_ADDRCONF_LEASE_FILE_BINARY_VERSION) {
+		ni_debug_dhcp("Unsupported binary lease version %u", ntohs(version));
+		return NULL;
+	}
+	if (ntohl(len) != ni_buffer_count(bp) || ntohl(sum) !=
+	    ni_hash_fnv1a(NI_HASH_FNV1A_INIT, ni_buffer_head(bp), ni_buffer_count(bp)))
+		return NULL;
+
+	xml = __ni_addrconf_lease_binary_get_node(bp, NULL, 0);
+	if (xml && ni_buffer_count(bp)) {
+		xml_node_free(xml);
+		return NULL;
+	}
+	return xml;
+}
+
+/*
+ * Write-behind queue of lease files
+ */
+static void
+__ni_addrconf_lease_file_pending_free(ni_addrconf_lease_file_pending_t *p)
+{
+	if (p->fp)
+		fclose(p->fp);
+	if (p->tempname[0])
+		unlink(p->tempname);
+	xml_node_free(p->xml);
+	ni_string_free(&p->filename);
+	ni_string_free(&p->ifname);
+	free(p);
+}
+
+static ni_addrconf_lease_file_pending_t **
+__ni_addrconf_lease_file_pending_find(const char *ifname, int type, int family)
+{
+	ni_addrconf_lease_file_pending_t **pos, *p;
+
+	for (pos = &ni_addrconf_lease_file_queue.list; (p = *pos); pos = &p->next) {
+		if (p->type == type && p->family == family &&
+		    ni_string_eq(p->ifname, ifname))
+			return pos;
+	}
+	return NULL;
+}
+
+static void
+__ni_addrconf_lease_file_pending_drop(const char *ifname, int type, int family)
+{
+	ni_addrconf_lease_file_pending_t **pos, *p;
+
+	if ((pos = __ni_addrconf_lease_file_pending_find(ifname, type, family))) {
+		p = *pos;
+		*pos = p->next;
+		__ni_addrconf_lease_file_pending_free(p);
+	}
+}
+
+static int
+__ni_addrconf_lease_file_sync_dir(const char *dir)
+{
+	int fd, ret;
+
+	if ((fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+		return -1;
+	if ((ret = fsync(fd)) < 0)
+		ni_warn("Unable to sync lease directory '%s': %m", dir);
+	close(fd);
+	return ret;
+}
+
+/*
+ * Write the lease data to a temporary file in the storedir, or in
+ * the statedir when the storedir is on a read-only filesystem.
+ */
+static int
+__ni_addrconf_lease_file_prepare(ni_addrconf_lease_file_pending_t *p, unsigned int format)
+{
+	ni_buffer_t data;
+	ni_bool_t ok;
+	int fd;
+
+	if (!__ni_addrconf_lease_file_path(&p->filename, ni_config_storedir(),
+				p->ifname, p->type, p->family, format)) {
+		ni_error("Cannot construct lease file name: %m");
+		return -1;
+	}
+
+	snprintf(p->tempname, sizeof(p->tempname), "%s.XXXXXX", p->filename);
+	if ((fd = mkstemp(p->tempname)) < 0) {
+		if (errno == EROFS && __ni_addrconf_lease_file_path(&p->filename,
+						ni_config_statedir(), p->ifname,
+						p->type, p->family, format)) {
+			ni_debug_dhcp("Read-only filesystem, try fallback to %s",
+					p->filename);
+			snprintf(p->tempname, sizeof(p->tempname), "%s.XXXXXX", p->filename);
+			fd = mkstemp(p->tempname);
+			p->fallback = TRUE;
+		}
+		if (fd < 0) {
+			ni_error("Cannot create temporary lease file '%s': %m",
+					p->tempname);
+			p->tempname[0] = '\0';
+			return -1;
+		}
+	}
+	if ((p->fp = fdopen(fd, "we")) == NULL) {
+		close(fd);
+		ni_error("Cannot reopen temporary lease file '%s': %m", p->tempname);
+		goto failed;
+	}
+
+	ni_debug_dhcp("Writing lease to temporary file for '%s'", p->filename);
+	if (format == NI_CONFIG_LEASE_FILE_FORMAT_BINARY) {
+		ni_buffer_init_dynamic(&data, 512);
+		ok = __ni_addrconf_lease_binary_encode(&data, p->xml) &&
+			fwrite(ni_buffer_head(&data), ni_buffer_count(&data), 1, p->fp) == 1;
+		ni_buffer_destroy(&data);
+		if (!ok) {
+			ni_error("Unable to write binary lease to '%s'", p->tempname);
+			goto failed;
+		}
+	} else {
+		xml_node_print(p->xml, p->fp);
+	}
+
+	if (fflush(p->fp) != 0 || ferror(p->fp)) {
+		ni_error("Unable to write temporary lease file '%s': %m", p->tempname);
+		goto failed;
+	}
+	return 0;
+
+failed:
+	/* the sync and commit skip it, the last good lease file is kept */
+	if (p->fp) {
+		fclose(p->fp);
+		p->fp = NULL;
+	}
+	unlink(p->tempname);
+	p->tempname[0] = '\0';
+	return -1;
+}
+
+/*
+ * Rename the temporary file and remove the lease files the new one
+ * replaces: the file in the other format and the statedir fallback.
+ */
+static int
+__ni_addrconf_lease_file_commit(ni_addrconf_lease_file_pending_t *p, unsigned int format)
+{
+	const char *dir = p->fallback ? ni_config_statedir() : ni_config_storedir();
+	unsigned int other = format == NI_CONFIG_LEASE_FILE_FORMAT_BINARY ?
+		NI_CONFIG_LEASE_FILE_FORMAT_XML : NI_CONFIG_LEASE_FILE_FORMAT_BINARY;
+	char *filename = NULL;
+
+	fclose(p->fp);
+	p->fp = NULL;
+
+	if (rename(p->tempname, p->filename) != 0) {
+		ni_error("Unable to rename temporary lease file '%s' to '%s': %m",
+				p->tempname, p->filename);
+		return -1;
+	}
+	p->tempname[0] = '\0';
+
+	if (__ni_addrconf_lease_file_path(&filename, dir, p->ifname,
+					p->type, p->family, other)) {
+		if (ni_file_exists(filename) && unlink(filename) == 0)
+			ni_debug_dhcp("removed %s", filename);
+		ni_string_free(&filename);
+	}
+	if (!p->fallback && !ni_string_eq(ni_config_statedir(), ni_config_storedir())) {
+		__ni_addrconf_lease_file_remove(ni_config_statedir(),
+				p->ifname, p->type, p->family);
+	}
+
+	ni_debug_dhcp("Lease written to file '%s'", p->filename);
+	return 0;
+}
+
+/*
+ * Write a list of leases: the data of all files is written first,
+ * then synced when enabled, renamed and the directories synced once.
+ */
+static int
+__ni_addrconf_lease_file_store(ni_addrconf_lease_file_pending_t *list)
+{
+	const ni_config_lease_file_t *conf = __ni_addrconf_lease_file_config();
+	ni_bool_t sync_storedir = FALSE, sync_statedir = FALSE;
+	ni_addrconf_lease_file_pending_t *p;
+	int ret = 0;
+
+	for (p = list; p; p = p->next) {
+		if (__ni_addrconf_lease_file_prepare(p, conf->format) < 0) {
+			ret = -1;
+			continue;
+		}
+		if (conf->sync) {
+			/* start the write-out of all files before waiting for any */
+			sync_file_range(fileno(p->fp), 0, 0, SYNC_FILE_RANGE_WRITE);
+		}
+	}
+
+	if (conf->sync) {
+		for (p = list; p; p = p->next) {
+			if (!p->fp || fdatasync(fileno(p->fp)) == 0)
+				continue;
+			ni_error("Unable to sync temporary lease file '%s': %m", p->tempname);
+			fclose(p->fp);
+			p->fp = NULL;
+			ret = -1;
+		}
+	}
+
+	for (p = list; p; p = p->next) {
+		if (!p->fp)
+			continue;
+		if (__ni_addrconf_lease_file_commit(p, conf->format) < 0) {
+			ret = -1;
+			continue;
+		}
+		if (p->fallback)
+			sync_statedir = TRUE;
+		else
+			sync_storedir = TRUE;
+	}
+
+	if (conf->sync && sync_storedir)
+		__ni_addrconf_lease_file_sync_dir(ni_config_storedir());
+	if (conf->sync && sync_statedir)
+		__ni_addrconf_lease_file_sync_dir(ni_config_statedir());
+
+	return ret;
+}
+
+static void
+__ni_addrconf_lease_file_timeout(void *user_data, const ni_timer_t *timer)
+{
+	if (ni_addrconf_lease_file_queue.timer != timer)
+		return;
+
+	ni_addrconf_lease_file_queue.timer = NULL;
+	ni_addrconf_lease_file_flush();
+}
+
+/*
+ * Write all queued leases
+ */
+int
+ni_addrconf_lease_file_flush(void)
+{
+	ni_addrconf_lease_file_pending_t *list, *p;
+	int ret;
+
+	if (ni_addrconf_lease_file_queue.timer) {
+		ni_timer_cancel(ni_addrconf_lease_file_queue.timer);
+		ni_addrconf_lease_file_queue.timer = NULL;
+	}
+
+	if (!(list = ni_addrconf_lease_file_queue.list))
+		return 0;
+
+	ni_addrconf_lease_file_queue.list = NULL;
+	ret = __ni_addrconf_lease_file_store(list);
+	while ((p = list)) {
+		list = p->next;
+		__ni_addrconf_lease_file_pending_free(p);
+	}
+	return ret;
+}
+
 /*
  * Write a lease to a file
  */
 int
 ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 {
-	char tempname[PATH_MAX] = {'\0'};
-	ni_bool_t fallback = FALSE;
-	char *filename = NULL;
+	const ni_config_lease_file_t *conf = __ni_addrconf_lease_file_config();
+	ni_addrconf_lease_file_pending_t **pos, *p;
 	xml_node_t *xml = NULL;
-	FILE *fp = NULL;
-	int ret = -1;
-	int fd;
+	int ret;
 
 	if (lease->state == NI_ADDRCONF_STATE_RELEASED) {
 		ni_addrconf_lease_file_remove(ifname, lease->type, lease->family);
 		return 0;
 	}
 
-	if (!__ni_addrconf_lease_file_path(&filename, ni_config_storedir(),
-					ifname, lease->type, lease->family)) {
+	if (ni_string_empty(ifname) || !ni_addrconf_type_to_name(lease->type) ||
+	    !ni_addrfamily_type_to_name(lease->family)) {
 		ni_error("Cannot construct lease file name: %m");
 		return -1;
 	}
 
-	ni_debug_dhcp("Preparing xml lease data for '%s'", filename);
+	ni_debug_dhcp("Preparing xml lease data for %s:%s lease on %s",
+			ni_addrfamily_type_to_name(lease->family),
+			ni_addrconf_type_to_name(lease->type), ifname);
 	if ((ret = ni_addrconf_lease_to_xml(lease, &xml, ifname)) != 0) {
 		if (ret > 0) {
 			ni_debug_dhcp("Skipped, %s:%s leases are disabled",
@@ -1272,105 +1762,117 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 					ni_addrfamily_type_to_name(lease->family),
 					ni_addrconf_type_to_name(lease->type));
 		}
-		goto failed;
+		return -1;
 	}
 
-	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
-	if ((fd = mkstemp(tempname)) < 0) {
-		if (errno == EROFS && __ni_addrconf_lease_file_path(&filename,
-						ni_config_statedir(), ifname,
-						lease->type, lease->family)) {
-			ni_debug_dhcp("Read-only filesystem, try fallback to %s",
-					filename);
-			snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
-			fd = mkstemp(tempname);
-			fallback = TRUE;
-		}
-		if (fd < 0) {
-			ni_error("Cannot create temporary lease file '%s': %m",
-					tempname);
-			tempname[0] = '\0';
-			ret = -1;
-			goto failed;
-		}
-	}
-	if ((fp = fdopen(fd, "we")) == NULL) {
-		ret = -1;
-		close(fd);
-		ni_error("Cannot reopen temporary lease file '%s': %m", tempname);
-		goto failed;
+	if ((pos = __ni_addrconf_lease_file_pending_find(ifname, lease->type, lease->family))) {
+		ni_debug_dhcp("Replacing queued %s:%s lease on %s",
+				ni_addrfamily_type_to_name(lease->family),
+				ni_addrconf_type_to_name(lease->type), ifname);
+		p = *pos;
+		xml_node_free(p->xml);
+		p->xml = xml;
+		return 0;
 	}
 
-	ni_debug_dhcp("Writing lease to temporary file for '%s'", filename);
-	xml_node_print(xml, fp);
-	fclose(fp);
-	xml_node_free(xml);
+	p = xcalloc(1, sizeof(*p));
+	ni_string_dup(&p->ifname, ifname);
+	p->type = lease->type;
+	p->family = lease->family;
+	p->xml = xml;
 
-	if ((ret = rename(tempname, filename)) != 0) {
-		ni_error("Unable to rename temporary lease file '%s' to '%s': %m",
-				tempname, filename);
-		goto failed;
-	} else if (!fallback) {
-		__ni_addrconf_lease_file_remove(ni_config_statedir(),
-				ifname, lease->type, lease->family);
+	if (!conf->write_delay) {
+		ret = __ni_addrconf_lease_file_store(p);
+		__ni_addrconf_lease_file_pending_free(p);
+		return ret;
 	}
 
-	ni_debug_dhcp("Lease written to file '%s'", filename);
-	ni_string_free(&filename);
+	for (pos = &ni_addrconf_lease_file_queue.list; *pos; pos = &(*pos)->next)
+		;
+	*pos = p;
+	if (!ni_addrconf_lease_file_queue.timer) {
+		ni_addrconf_lease_file_queue.timer = ni_timer_register(conf->write_delay,
+				__ni_addrconf_lease_file_timeout, NULL);
+	}
 	return 0;
-
-failed:
-	if (fp)
-		fclose(fp);
-	if (xml)
-		xml_node_free(xml);
-	if (tempname[0])
-		unlink(tempname);
-	ni_string_free(&filename);
-	return -1;
 }
 
 /*
  * Read a lease from a file
  */
+static xml_node_t *
+__ni_addrconf_lease_file_load(const char *filename, unsigned int format)
+{
+	ni_buffer_t data;
+	xml_node_t *xml;
+	FILE *fp;
+
+	if ((fp = fopen(filename, "re")) == NULL) {
+		if (errno != ENOENT)
+			ni_error("Unable to open %s for reading: %m", filename);
+		return NULL;
+	}
+
+	ni_debug_dhcp("Reading lease from %s", filename);
+	if (format == NI_CONFIG_LEASE_FILE_FORMAT_BINARY) {
+		size_t len;
+
+		ni_buffer_init_dynamic(&data, 512);
+		do {
+			ni_buffer_ensure_tailroom(&data, 512);
+			len = fread(ni_buffer_tail(&data), 1, ni_buffer_tailroom(&data), fp);
+			ni_buffer_push_tail(&data, len);
+		} while (len);
+		xml = ferror(fp) ? NULL : __ni_addrconf_lease_binary_decode(&data);
+		ni_buffer_destroy(&data);
+	} else {
+		xml = xml_node_scan(fp, filename);
+	}
+	fclose(fp);
+
+	if (xml == NULL)
+		ni_error("Unable to parse %s", filename);
+	return xml;
+}
+
 ni_addrconf_lease_t *
 ni_addrconf_lease_file_read(const char *ifname, int type, int family)
 {
+	static const unsigned int formats[] = {
+		NI_CONFIG_LEASE_FILE_FORMAT_BINARY,
+		NI_CONFIG_LEASE_FILE_FORMAT_XML,
+	};
+	ni_addrconf_lease_file_pending_t **pos;
 	ni_addrconf_lease_t *lease = NULL;
 	xml_node_t *xml = NULL, *lnode;
+	const char *dirs[2];
 	char *filename = NULL;
-	FILE *fp;
+	unsigned int d, f;
 
-	if (!__ni_addrconf_lease_file_path(&filename,
-				ni_config_statedir(),
-				ifname, type, family)) {
-		ni_error("Unable to construct lease file name: %m");
-		return NULL;
-	}
-
-	if ((fp = fopen(filename, "re")) == NULL) {
-		if (errno == ENOENT) {
-			if (__ni_addrconf_lease_file_path(&filename,
-						ni_config_storedir(),
-						ifname, type, family))
-				fp = fopen(filename, "re");
-		}
-		if (fp == NULL) {
-			if (errno != ENOENT) {
-				ni_error("Unable to open %s for reading: %m",
-						filename);
-			}
-			ni_string_free(&filename);
+	if ((pos = __ni_addrconf_lease_file_pending_find(ifname, type, family))) {
+		ni_debug_dhcp("Reading queued %s:%s lease on %s",
+				ni_addrfamily_type_to_name(family),
+				ni_addrconf_type_to_name(type), ifname);
+		if (ni_addrconf_lease_from_xml(&lease, (*pos)->xml, ifname) < 0)
 			return NULL;
+		return lease;
+	}
+
+	/* the binary file first, the xml file is the fallback */
+	dirs[0] = ni_config_statedir();
+	dirs[1] = ni_config_storedir();
+	for (d = 0; !xml && d < 2; ++d) {
+		for (f = 0; !xml && f < 2; ++f) {
+			if (!__ni_addrconf_lease_file_path(&filename, dirs[d],
+						ifname, type, family, formats[f])) {
+				ni_error("Unable to construct lease file name: %m");
+				return NULL;
+			}
+			if (ni_file_exists(filename))
+				xml = __ni_addrconf_lease_file_load(filename, formats[f]);
 		}
 	}
-
-	ni_debug_dhcp("Reading lease from %s", filename);
-	xml = xml_node_scan(fp, filename);
-	fclose(fp);
-
 	if (xml == NULL) {
-		ni_error("Unable to parse %s", filename);
 		ni_string_free(&filename);
 		return NULL;
 	}
@@ -1406,53 +1908,72 @@ static void
 __ni_addrconf_lease_file_remove(const char *dir, const char *ifname,
 				int type, int family)
 {
+	static const unsigned int formats[] = {
+		NI_CONFIG_LEASE_FILE_FORMAT_XML,
+		NI_CONFIG_LEASE_FILE_FORMAT_BINARY,
+	};
 	char *filename = NULL;
+	unsigned int f;
 
-	if (!__ni_addrconf_lease_file_path(&filename, dir, ifname, type, family))
-		return;
+	for (f = 0; f < 2; ++f) {
+		if (!__ni_addrconf_lease_file_path(&filename, dir, ifname,
+						type, family, formats[f]))
+			continue;
 
-	if (ni_file_exists(filename) && unlink(filename) == 0)
-		ni_debug_dhcp("removed %s", filename);
+		if (ni_file_exists(filename) && unlink(filename) == 0)
+			ni_debug_dhcp("removed %s", filename);
+	}
 	ni_string_free(&filename);
 }
 
 void
 ni_addrconf_lease_file_remove(const char *ifname, int type, int family)
 {
+	__ni_addrconf_lease_file_pending_drop(ifname, type, family);
 	__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname, type, family);
 	__ni_addrconf_lease_file_remove(ni_config_storedir(), ifname, type, family);
 }
 
 static const char *
 __ni_addrconf_lease_file_path(char **path, const char *dir,
-		const char *ifname, int type, int family)
+		const char *ifname, int type, int family, unsigned int format)
 {
 	const char *t = ni_addrconf_type_to_name(type);
 	const char *f = ni_addrfamily_type_to_name(family);
+	const char *s = format == NI_CONFIG_LEASE_FILE_FORMAT_BINARY ? "bin" : "xml";
 
 	if (!path || ni_string_empty(dir) || ni_string_empty(ifname) || !t || !f)
 		return NULL;
-	return ni_string_printf(path, "%s/lease-%s-%s-%s.xml", dir, ifname, t, f);
+	return ni_string_printf(path, "%s/lease-%s-%s-%s.%s", dir, ifname, t, f, s);
 }
 
 ni_bool_t
 ni_addrconf_lease_file_exists(const char *ifname, int type, int family)
 {
+	static const unsigned int formats[] = {
+		NI_CONFIG_LEASE_FILE_FORMAT_BINARY,
+		NI_CONFIG_LEASE_FILE_FORMAT_XML,
+	};
+	const char *dirs[2];
 	char *filename = NULL;
+	unsigned int d, f;
 
-	if (__ni_addrconf_lease_file_path(&filename, ni_config_statedir(), ifname, type, family)) {
-		if (ni_file_exists(filename)) {
-			ni_string_free(&filename);
-			return TRUE;
-		}
-	}
-	if (__ni_addrconf_lease_file_path(&filename, ni_config_storedir(), ifname, type, family)) {
-		if (ni_file_exists(filename)) {
-			ni_string_free(&filename);
-			return TRUE;
+	if (__ni_addrconf_lease_file_pending_find(ifname, type, family))
+		return TRUE;
+
+	dirs[0] = ni_config_statedir();
+	dirs[1] = ni_config_storedir();
+	for (d = 0; d < 2; ++d) {
+		for (f = 0; f < 2; ++f) {
+			if (!__ni_addrconf_lease_file_path(&filename, dirs[d],
+						ifname, type, family, formats[f]))
+				continue;
+			if (ni_file_exists(filename)) {
+				ni_string_free(&filename);
+				return TRUE;
+			}
 		}
 	}
 	ni_string_free(&filename);
 	return FALSE;
 }
-
@@ -34,6 +34,7 @@
 #include "debug.h"
 #include "netinfo_priv.h"
 #include "socket_priv.h"
+#include "devindex.h"
 #include "lldp-priv.h"
 
 /*
@@ -41,14 +42,20 @@
  */
 #define NI_LLDP_MAX_PEERS	256
 
+/*
+ * Granularity of the tx timer; agents due within the same tick
+ * are sent in one timer run.
+ */
+#define NI_LLDP_TX_TICK		250	/* msec */
+
 typedef struct ni_lldp_agent ni_lldp_agent_t;
 typedef struct ni_lldp_peer ni_lldp_peer_t;
 
 struct ni_lldp_agent {
-	ni_lldp_agent_t *	next;
 	unsigned int		ifindex;
 
-	const ni_timer_t *	txTTR;
+	ni_lldp_agent_t *	tx_next;
+	struct timeval		txTTR;		/* tx deadline, queued when set */
 	uint16_t		msgFastTx;
 	uint16_t		msgTxHold;
 	uint16_t		msgTxInterval;
@@ -79,7 +86,18 @@ struct ni_lldp_peer {
 	unsigned char		raw_id[0];
 };
 
-static ni_lldp_agent_t *	ni_lldp_agents;
+static ni_devindex_t		ni_lldp_agents = NI_DEVINDEX_INIT;
+
+/*
+ * Agents waiting to transmit, ordered by their deadline, and
+ * the timer for the head of the queue.
+ */
+static struct {
+	ni_lldp_agent_t *	queue;
+	const ni_timer_t *	timer;
+	struct timeval		expires;
+	ni_bool_t		running;
+} ni_lldp_tx;
 
 static ni_hwaddr_t		ni_lldp_destaddr[__NI_LLDP_DEST_MAX] = {
 [NI_LLDP_DEST_NEAREST_BRIDGE] = {
@@ -110,6 +128,8 @@ static void		ni_lldp_agent_free(ni_lldp_agent_t *);
 static int		ni_lldp_agent_update(ni_lldp_agent_t *, ni_lldp_t *, const void *, unsigned int);
 static void		ni_lldp_tx_timer_arm(ni_lldp_agent_t *);
 static void		ni_lldp_tx_timer_arm_quick(ni_lldp_agent_t *);
+static void		ni_lldp_tx_timer_disarm(ni_lldp_agent_t *);
+static void		ni_lldp_tx_timer_update(void);
 static void		ni_lldp_receive(ni_socket_t *);
 static ni_lldp_peer_t *	ni_lldp_peer_new(const void *raw_id, unsigned int raw_id_len);
 static void		ni_lldp_peer_unlink_and_free(ni_lldp_peer_t **);
@@ -326,6 +346,7 @@ ni_lldp_agent_new(ni_netdev_t *dev, unsigned int mtu)
 	ni_buffer_init(&agent->sendbuf, (void *) (agent + 1), mtu);
 
 	agent->dev = ni_netdev_get(dev);
+	agent->ifindex = dev->link.ifindex;
 
 	/* init tx state machine variables with recommended defaults */
 	agent->msgFastTx = 1;
@@ -348,8 +369,7 @@ ni_lldp_agent_free(ni_lldp_agent_t *agent)
 {
 	ni_capture_free(agent->capture);
 	ni_lldp_free(agent->config);
-	if (agent->txTTR)
-		ni_timer_cancel(agent->txTTR);
+	ni_lldp_tx_timer_disarm(agent);
 	if (agent->dev)
 		ni_netdev_put(agent->dev);
 	if (agent->dcbx)
@@ -361,19 +381,12 @@ ni_lldp_agent_free(ni_lldp_agent_t *agent)
 }
 
 static ni_lldp_agent_t *
-__ni_lldp_take_agent(unsigned int ifindex, ni_lldp_agent_t ***pos_ret)
+__ni_lldp_take_agent(unsigned int ifindex)
 {
-	ni_lldp_agent_t *agent, **pos;
-
-	for (pos = &ni_lldp_agents; (agent = *pos) != NULL; pos = &agent->next) {
-		if (agent->ifindex == ifindex) {
-			*pos = agent->next;
-			agent->next = NULL;
-			break;
-		}
-	}
+	ni_lldp_agent_t *agent;
 
-	*pos_ret = pos;
+	if ((agent = ni_devindex_by_index(&ni_lldp_agents, ifindex)) != NULL)
+		ni_devindex_remove(&ni_lldp_agents, ifindex, agent);
 	return agent;
 }
 
@@ -446,18 +459,17 @@ ni_lldp_agent_configure(ni_lldp_agent_t *agent, ni_netdev_t *dev, ni_lldp_t *lld
 static int
 ni_lldp_agent_start(ni_netdev_t *dev, ni_lldp_t *lldp, ni_dcbx_state_t *dcbx)
 {
-	ni_lldp_agent_t *agent, **pos;
+	ni_lldp_agent_t *agent;
 	ni_capture_t *capture = NULL;
 
-	if ((agent = __ni_lldp_take_agent(dev->link.ifindex, &pos)) != NULL) {
+	if ((agent = __ni_lldp_take_agent(dev->link.ifindex)) != NULL) {
 		capture = agent->capture;
 		agent->capture = NULL;
 		ni_lldp_agent_free(agent);
 	}
 
 	agent = ni_lldp_agent_new(dev, 1500);
-	agent->next = *pos;
-	*pos = agent;
+	ni_devindex_add(&ni_lldp_agents, agent->ifindex, dev->name, agent);
 
 	if (ni_lldp_agent_configure(agent, dev, lldp, dcbx) < 0)
 		return -1;
@@ -468,6 +480,7 @@ ni_lldp_agent_start(ni_netdev_t *dev, ni_lldp_t *lldp, ni_dcbx_state_t *dcbx)
 
 		memset(&protinfo, 0, sizeof(protinfo));
 		protinfo.eth_protocol = ETHERTYPE_LLDP;
+		protinfo.shared = TRUE;
 
 		if (agent->config->destination >= __NI_LLDP_DEST_MAX)
 			return -1;
@@ -489,9 +502,9 @@ ni_lldp_agent_start(ni_netdev_t *dev, ni_lldp_t *lldp, ni_dcbx_state_t *dcbx)
 void
 ni_lldp_agent_stop(ni_netdev_t *dev)
 {
-	ni_lldp_agent_t *agent, **pos;
+	ni_lldp_agent_t *agent;
 
-	if ((agent = __ni_lldp_take_agent(dev->link.ifindex, &pos)) != NULL) {
+	if ((agent = __ni_lldp_take_agent(dev->link.ifindex)) != NULL) {
 		/* While the device is still up, try to send a shutdown PDU */
 		if (ni_netdev_device_is_up(dev))
 			ni_lldp_agent_send_shutdown(agent);
@@ -588,34 +601,123 @@ ni_lldp_agent_enter_fast_rx(ni_lldp_agent_t *agent)
 		ni_lldp_agent_send(agent);
 }
 
+/*
+ * The tx timer runs for the agent(s) at the head of the queue
+ * and sends all agents due in the current tick.
+ */
 static void
 ni_lldp_tx_timer_expires(void *user_data, const ni_timer_t *timer)
 {
-	ni_lldp_agent_t *agent = (ni_lldp_agent_t *) user_data;
+	ni_lldp_agent_t *agent;
+	struct timeval now, due;
 
-	if (agent->txTTR != timer) {
+	if (ni_lldp_tx.timer != timer) {
 		ni_error("ni_lldp_tx_timer_expires: bad timer handle");
 		return;
 	}
-	agent->txTTR = NULL;
+	ni_lldp_tx.timer = NULL;
 
-	/* FIXME: rebuild the packet? */
-	ni_lldp_agent_send(agent);
+	ni_timer_get_time(&now);
+	due.tv_sec = 0;
+	due.tv_usec = NI_LLDP_TX_TICK * 1000;
+	timeradd(&now, &due, &due);
+
+	/* Sending re-queues the agent; re-arm the timer when done */
+	ni_lldp_tx.running = TRUE;
+	while ((agent = ni_lldp_tx.queue) && timercmp(&agent->txTTR, &due, <)) {
+		ni_lldp_tx.queue = agent->tx_next;
+		agent->tx_next = NULL;
+		timerclear(&agent->txTTR);
+
+		/* FIXME: rebuild the packet? */
+		ni_lldp_agent_send(agent);
+	}
+	ni_lldp_tx.running = FALSE;
+
+	ni_lldp_tx_timer_update();
+}
+
+static void
+ni_lldp_tx_timer_update(void)
+{
+	const ni_lldp_agent_t *head = ni_lldp_tx.queue;
+	struct timeval now, delta;
+	unsigned long timeout = 0;
+
+	if (ni_lldp_tx.running)
+		return;
+
+	if (!head) {
+		if (ni_lldp_tx.timer)
+			ni_timer_cancel(ni_lldp_tx.timer);
+		ni_lldp_tx.timer = NULL;
+		return;
+	}
+	if (ni_lldp_tx.timer && timercmp(&ni_lldp_tx.expires, &head->txTTR, ==))
+		return;
+
+	ni_timer_get_time(&now);
+	if (timercmp(&head->txTTR, &now, >)) {
+		timersub(&head->txTTR, &now, &delta);
+		timeout = delta.tv_sec * 1000 + delta.tv_usec / 1000;
+	}
+
+	ni_lldp_tx.expires = head->txTTR;
+	if (ni_lldp_tx.timer)
+		ni_lldp_tx.timer = ni_timer_rearm(ni_lldp_tx.timer, timeout);
+	if (!ni_lldp_tx.timer)
+		ni_lldp_tx.timer = ni_timer_register(timeout, ni_lldp_tx_timer_expires, NULL);
+	if (!ni_lldp_tx.timer)
+		ni_error("failed to arm LLDP timer");
+}
+
+static void
+ni_lldp_tx_timer_disarm(ni_lldp_agent_t *agent)
+{
+	ni_lldp_agent_t **pos;
+
+	if (!timerisset(&agent->txTTR))
+		return;
+
+	for (pos = &ni_lldp_tx.queue; *pos; pos = &(*pos)->tx_next) {
+		if (*pos == agent) {
+			*pos = agent->tx_next;
+			break;
+		}
+	}
+	agent->tx_next = NULL;
+	timerclear(&agent->txTTR);
+	ni_lldp_tx_timer_update();
 }
 
 static void
 __ni_lldp_tx_timer_arm(ni_lldp_agent_t *agent, unsigned int timeout)
 {
 	static const ni_int_range_t jitter = { .min = 0, .max = 400 };
+	ni_lldp_agent_t **pos;
+	struct timeval now;
+	unsigned long msec;
 
 	/* Apply a jitter between 0 and 0.4 sec */
 	timeout = ni_timeout_randomize(timeout, &jitter);
 
-	if (agent->txTTR)
-		ni_timer_cancel(agent->txTTR);
-	agent->txTTR = ni_timer_register(timeout, ni_lldp_tx_timer_expires, agent);
-	if (agent->txTTR == NULL)
-		ni_error("%s: failed to arm LLDP timer", agent->dev->name);
+	ni_lldp_tx_timer_disarm(agent);
+
+	/* Round the deadline up to the next tick */
+	ni_timer_get_time(&now);
+	msec = (now.tv_usec / 1000) + timeout + NI_LLDP_TX_TICK - 1;
+	msec -= msec % NI_LLDP_TX_TICK;
+	agent->txTTR.tv_sec = now.tv_sec + msec / 1000;
+	agent->txTTR.tv_usec = (msec % 1000) * 1000;
+
+	for (pos = &ni_lldp_tx.queue; *pos; pos = &(*pos)->tx_next) {
+		if (timercmp(&agent->txTTR, &(*pos)->txTTR, <))
+			break;
+	}
+	agent->tx_next = *pos;
+	*pos = agent;
+
+	ni_lldp_tx_timer_update();
 }
 
 void
@@ -13,7 +13,14 @@
 #include <string.h>
 #include <syslog.h>
 #include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <time.h>
 
 #include <wicked/logging.h>
@@ -37,6 +44,71 @@ static unsigned int	ni_log_opts;
 
 static void		__ni_log_level_set(unsigned int level);
 
+/*
+ * The asynchronous logging ring: the producers reserve a record by
+ * advancing the head and publish it by setting its sequence to the
+ * position + 1; the writer thread consumes the records in order and
+ * releases each to the position of the next ring round. The messages
+ * are formatted into the record by the caller, as the arguments (and
+ * errno for %m) do not outlive the call; the time stamp formatting
+ * and the write or syslog calls are done by the writer.
+ *
+ * Messages longer than a record are spilled into up to MSGPARTS
+ * consecutive records reserved at once; the continuation records
+ * are published before the first one, so the writer can join the
+ * parts as soon as it sees the first record. Only messages beyond
+ * MSGPARTS records (or half of the ring) are truncated.
+ */
+#define NI_LOG_ASYNC_RECORDS_MIN	16
+#define NI_LOG_ASYNC_RECORDS_MAX	65536
+#define NI_LOG_ASYNC_MSGLEN		976
+#define NI_LOG_ASYNC_MSGPARTS		64
+#define NI_LOG_ASYNC_TEXTLEN		(NI_LOG_ASYNC_MSGPARTS * (NI_LOG_ASYNC_MSGLEN - 1) + 1)
+#define NI_LOG_PREFIX_LEN		256
+#define NI_LOG_ASYNC_LINELEN		(NI_LOG_PREFIX_LEN + NI_LOG_ASYNC_MSGLEN + 64)
+
+typedef struct ni_log_record {
+	unsigned long		seq;
+	unsigned long		id;
+	struct timeval		time;
+	int			prio;
+	unsigned short		part;
+	unsigned short		parts;
+	const char *		tag;
+	const char *		end;
+	char			msg[NI_LOG_ASYNC_MSGLEN];
+} ni_log_record_t;
+
+typedef struct ni_log_async {
+	ni_log_record_t *	ring;
+	unsigned long		size;
+	unsigned long		head;
+	unsigned long		tail;
+	unsigned long		dropped;
+	ni_log_overflow_t	overflow;
+
+	char			obuf[65536];
+	size_t			olen;
+	char			text[NI_LOG_ASYNC_TEXTLEN];
+
+	unsigned int		flight_records;
+	char *			dumpfile;
+
+	int			wakefd;
+	int			sleeping;
+	int			running;
+	pthread_t		writer;
+} ni_log_async_t;
+
+static ni_log_async_t *	ni_log_async;
+
+/*
+ * Held by the writer while it is in syslog or localtime_r, which take
+ * libc internal locks, and over a fork, so a forked child logging
+ * synchronously does not find them held by the lost writer thread.
+ */
+static pthread_mutex_t	ni_log_output_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /*
  * debug options short text representation
  */
@@ -306,6 +378,7 @@ ni_log_level_set(const char *name)
 void
 ni_log_close(void)
 {
+	ni_log_async_stop();
 	if (ni_log_syslog) {
 		closelog();
 	}
@@ -469,45 +542,580 @@ ni_log_destination(const char *progname, const char *destination)
 	return FALSE;
 }
 
-static inline void
-__ni_log_stderr(const char *tag, const char *fmt, va_list ap, const char *end)
+static const char *
+__ni_log_stderr_prefix(char *buf, size_t size, const struct timeval *tv)
 {
+	size_t len = 0;
+
 	/* rfc5424 / rfc3339 timestamp with ms precision, e.g.:
 	 * 	2013-11-07T19:29:38.663870+01:00
 	 */
-	if (ni_log_opts & NI_LOG_TIME) {
-		struct timeval tv;
+	buf[0] = '\0';
+	if (tv) {
 		struct tm lt;
 		char tzsign;
 
-		gettimeofday(&tv, NULL);
-		localtime_r(&tv.tv_sec, &lt);
+		localtime_r(&tv->tv_sec, &lt);
 		if (lt.tm_gmtoff < 0) {
 			lt.tm_gmtoff *= -1;
 			tzsign = '-';
 		} else {
 			tzsign = '+';
 		}
-		fprintf(stderr, "%04d-%02d-%02dT%02d:%02d:%02d.%06ld%c%02ld:%02ld ",
+		len = snprintf(buf, size, "%04d-%02d-%02dT%02d:%02d:%02d.%06ld%c%02ld:%02ld ",
 				lt.tm_year + 1900, lt.tm_mon + 1, lt.tm_mday,
-				lt.tm_hour, lt.tm_min, lt.tm_sec, tv.tv_usec,
+				lt.tm_hour, lt.tm_min, lt.tm_sec, (long)tv->tv_usec,
 				tzsign, lt.tm_gmtoff/3600, (lt.tm_gmtoff%3600)/60);
+		if (len >= size)
+			return buf;
 	}
 
 	if (ni_log_opts & NI_LOG_PID) {
 		if (ni_log_opts & NI_LOG_IDENT)
-			fprintf(stderr, "%s[%d]: ", ni_log_ident, getpid());
+			snprintf(buf + len, size - len, "%s[%d]: ", ni_log_ident, getpid());
 		else
-			fprintf(stderr, "[%d]: ", getpid());
+			snprintf(buf + len, size - len, "[%d]: ", getpid());
 	} else if (ni_log_opts & NI_LOG_IDENT) {
-		fprintf(stderr, "%s: ", ni_log_ident);
+		snprintf(buf + len, size - len, "%s: ", ni_log_ident);
 	}
+	return buf;
+}
 
-	fprintf(stderr, "%s", tag);
+static inline void
+__ni_log_stderr(const char *tag, const char *fmt, va_list ap, const char *end)
+{
+	struct timeval tv, *tp = NULL;
+	char prefix[NI_LOG_PREFIX_LEN];
+
+	if ((ni_log_opts & NI_LOG_TIME) && gettimeofday(&tv, NULL) == 0)
+		tp = &tv;
+
+	fprintf(stderr, "%s%s", __ni_log_stderr_prefix(prefix, sizeof(prefix), tp), tag);
 	vfprintf(stderr, fmt, ap);
 	fprintf(stderr, "%s\n", end);
 }
 
+/*
+ * Write the messages captured by the asynchronous logging; the
+ * stderr lines are collected in the output buffer and written
+ * at once.
+ */
+static void
+__ni_log_async_output(ni_log_async_t *la, int prio, const struct timeval *tv,
+			const char *tag, const char *msg, const char *end)
+{
+	char prefix[NI_LOG_PREFIX_LEN];
+
+	pthread_mutex_lock(&ni_log_output_lock);
+	if (ni_log_syslog) {
+		syslog(prio, "%s", msg);
+		pthread_mutex_unlock(&ni_log_output_lock);
+		return;
+	}
+
+	__ni_log_stderr_prefix(prefix, sizeof(prefix), ni_log_opts & NI_LOG_TIME ? tv : NULL);
+	pthread_mutex_unlock(&ni_log_output_lock);
+	la->olen += snprintf(la->obuf + la->olen, sizeof(la->obuf) - la->olen,
+				"%s%s%s%s\n", prefix, tag, msg, end);
+	if (la->olen > sizeof(la->obuf))
+		la->olen = sizeof(la->obuf);
+}
+
+static void
+__ni_log_async_output_flush(ni_log_async_t *la)
+{
+	size_t off = 0;
+	ssize_t n;
+
+	while (off < la->olen) {
+		n = write(STDERR_FILENO, la->obuf + off, la->olen - off);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		off += n;
+	}
+	la->olen = 0;
+}
+
+static void
+__ni_log_async_wakeup(ni_log_async_t *la, ni_bool_t force)
+{
+	uint64_t event = 1;
+
+	if (__atomic_exchange_n(&la->sleeping, 0, __ATOMIC_SEQ_CST) || force) {
+		if (write(la->wakefd, &event, sizeof(event)) < 0) {
+			/* counter overflow, the writer is woken up anyway */
+		}
+	}
+}
+
+/*
+ * Reserve count consecutive records; the writer releases the records
+ * in order, so the range is free when its first and last records are.
+ */
+static ni_bool_t
+__ni_log_async_reserve(ni_log_async_t *la, unsigned int count, unsigned long *head)
+{
+	struct timespec pause = { .tv_nsec = 100000 };
+	unsigned long pos, seq, last;
+
+	pos = __atomic_load_n(&la->head, __ATOMIC_RELAXED);
+	for (;;) {
+		seq = __atomic_load_n(&la->ring[pos & (la->size - 1)].seq, __ATOMIC_ACQUIRE);
+		if (seq == pos) {
+			last = pos + count - 1;
+			seq = __atomic_load_n(&la->ring[last & (la->size - 1)].seq, __ATOMIC_ACQUIRE);
+			if (seq == last) {
+				if (__atomic_compare_exchange_n(&la->head, &pos, pos + count, FALSE,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+					*head = pos;
+					return TRUE;
+				}
+				/* another producer was faster; pos is the new head */
+				continue;
+			}
+			/* the last record decides whether the ring is full */
+			seq -= count - 1;
+		}
+
+		if ((long)(seq - pos) < 0) {
+			/* the ring is full */
+			if (la->overflow == NI_LOG_OVERFLOW_DROP) {
+				__atomic_add_fetch(&la->dropped, 1, __ATOMIC_RELAXED);
+				return FALSE;
+			}
+			__ni_log_async_wakeup(la, FALSE);
+			nanosleep(&pause, NULL);
+		}
+		pos = __atomic_load_n(&la->head, __ATOMIC_RELAXED);
+	}
+}
+
+static void
+__ni_log_async_vpush(ni_log_async_t *la, int prio, const char *tag, const char *end,
+			const char *fmt, va_list ap)
+{
+	char buf[NI_LOG_ASYNC_MSGLEN], *text = buf;
+	unsigned int parts = 1, part;
+	ni_log_record_t *rec;
+	struct timeval now;
+	unsigned long pos;
+	size_t len, max, off, n;
+	va_list copy;
+	int ret;
+
+	gettimeofday(&now, NULL);
+	va_copy(copy, ap);
+	ret = vsnprintf(buf, sizeof(buf), fmt, ap);
+	len = ret > 0 ? (size_t)ret : 0;
+	if (len >= sizeof(buf)) {
+		max = min_t(size_t, NI_LOG_ASYNC_MSGPARTS, la->size / 2) * (sizeof(buf) - 1);
+		if ((text = malloc(len + 1)) != NULL) {
+			vsnprintf(text, len + 1, fmt, copy);
+		} else {
+			text = buf;
+			len = max = sizeof(buf) - 1;
+		}
+		if (len >= max) {
+			len = max;
+			memcpy(text + len - 3, "...", 3);
+		}
+		parts = (len + sizeof(buf) - 2) / (sizeof(buf) - 1);
+	}
+	va_end(copy);
+
+	if (__ni_log_async_reserve(la, parts, &pos)) {
+		/* the first record is published last, see above */
+		for (part = parts; part-- > 0; ) {
+			rec = &la->ring[(pos + part) & (la->size - 1)];
+			rec->time = now;
+			rec->id = pos + part;
+			rec->prio = prio;
+			rec->part = part;
+			rec->parts = parts;
+			rec->tag = tag;
+			rec->end = end;
+
+			off = part * (sizeof(rec->msg) - 1);
+			n = min_t(size_t, len - off, sizeof(rec->msg) - 1);
+			memcpy(rec->msg, text + off, n);
+			rec->msg[n] = '\0';
+			__atomic_store_n(&rec->seq, pos + part + 1, __ATOMIC_SEQ_CST);
+		}
+
+		if (__atomic_load_n(&la->sleeping, __ATOMIC_SEQ_CST))
+			__ni_log_async_wakeup(la, FALSE);
+	}
+
+	if (text != buf)
+		free(text);
+}
+
+static inline ni_log_record_t *
+__ni_log_async_next(ni_log_async_t *la, unsigned long pos)
+{
+	ni_log_record_t *rec = &la->ring[pos & (la->size - 1)];
+
+	if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != pos + 1)
+		return NULL;
+	return rec;
+}
+
+/*
+ * Join the parts of a message spilled into consecutive records
+ */
+static const char *
+__ni_log_async_join(ni_log_async_t *la, unsigned long pos, unsigned int parts)
+{
+	const ni_log_record_t *rec;
+	size_t len = 0, n;
+
+	for ( ; parts; --parts, ++pos) {
+		rec = &la->ring[pos & (la->size - 1)];
+		n = strnlen(rec->msg, sizeof(rec->msg));
+		memcpy(la->text + len, rec->msg, n);
+		len += n;
+	}
+	la->text[len] = '\0';
+	return la->text;
+}
+
+static void *
+__ni_log_async_writer(void *ptr)
+{
+	ni_log_async_t *la = ptr;
+	struct pollfd pfd = { .fd = la->wakefd, .events = POLLIN };
+	unsigned long pos = 0, dropped = 0, count;
+	unsigned int parts, part;
+	ni_log_record_t *rec;
+	struct timeval now;
+	char msg[64];
+	uint64_t events;
+	int running;
+
+	do {
+		running = __atomic_load_n(&la->running, __ATOMIC_ACQUIRE);
+
+		while ((rec = __ni_log_async_next(la, pos)) != NULL) {
+			parts = rec->parts;
+			if (la->olen + NI_LOG_ASYNC_LINELEN +
+			    (parts - 1) * (NI_LOG_ASYNC_MSGLEN - 1) > sizeof(la->obuf)) {
+				__ni_log_async_output_flush(la);
+				__atomic_store_n(&la->tail, pos, __ATOMIC_RELEASE);
+			}
+			__ni_log_async_output(la, rec->prio, &rec->time, rec->tag,
+					parts > 1 ? __ni_log_async_join(la, pos, parts) : rec->msg,
+					rec->end);
+			for (part = 0; part < parts; ++part, ++pos) {
+				rec = &la->ring[pos & (la->size - 1)];
+				__atomic_store_n(&rec->seq, pos + la->size, __ATOMIC_RELEASE);
+			}
+		}
+
+		count = __atomic_load_n(&la->dropped, __ATOMIC_RELAXED);
+		if (count != dropped) {
+			if (la->olen + NI_LOG_ASYNC_LINELEN > sizeof(la->obuf))
+				__ni_log_async_output_flush(la);
+			gettimeofday(&now, NULL);
+			snprintf(msg, sizeof(msg), "%lu log messages dropped", count - dropped);
+			__ni_log_async_output(la, LOG_WARNING, &now, "Warning: ", msg, "");
+			dropped = count;
+		}
+		__ni_log_async_output_flush(la);
+		__atomic_store_n(&la->tail, pos, __ATOMIC_RELEASE);
+
+		if (running) {
+			__atomic_store_n(&la->sleeping, 1, __ATOMIC_SEQ_CST);
+			if (!__ni_log_async_next(la, pos))
+				poll(&pfd, 1, 1000);
+			__atomic_store_n(&la->sleeping, 0, __ATOMIC_SEQ_CST);
+			if (read(la->wakefd, &events, sizeof(events)) < 0) {
+				/* no wakeup events pending */
+			}
+		}
+	} while (running);
+
+	return NULL;
+}
+
+static void
+__ni_log_async_free(ni_log_async_t *la)
+{
+	if (la->wakefd >= 0)
+		close(la->wakefd);
+	free(la->dumpfile);
+	free(la->ring);
+	free(la);
+}
+
+static void
+__ni_log_async_atfork_prepare(void)
+{
+	pthread_mutex_lock(&ni_log_output_lock);
+}
+
+static void
+__ni_log_async_atfork_parent(void)
+{
+	pthread_mutex_unlock(&ni_log_output_lock);
+}
+
+/*
+ * A forked child has no writer thread and logs synchronously
+ */
+static void
+__ni_log_async_atfork_child(void)
+{
+	pthread_mutex_unlock(&ni_log_output_lock);
+	ni_log_async = NULL;
+}
+
+static void
+__ni_log_async_atexit(void)
+{
+	ni_log_async_stop();
+}
+
+static void
+__ni_log_flight_recorder_signal(int sig)
+{
+	int saved_errno = errno;
+
+	ni_log_flight_recorder_dump();
+	errno = saved_errno;
+
+	/* crash signals use SA_RESETHAND, terminate with the default action */
+	if (sig != SIGUSR2)
+		raise(sig);
+}
+
+static void
+__ni_log_flight_recorder_install(void)
+{
+	static const int crash_signals[] = {
+		SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT
+	};
+	struct sigaction sa;
+	unsigned int i;
+
+	memset(&sa, 0, sizeof(sa));
+	sigemptyset(&sa.sa_mask);
+	sa.sa_handler = __ni_log_flight_recorder_signal;
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGUSR2, &sa, NULL);
+
+	sa.sa_flags = SA_RESETHAND;
+	for (i = 0; i < sizeof(crash_signals)/sizeof(crash_signals[0]); ++i)
+		sigaction(crash_signals[i], &sa, NULL);
+}
+
+ni_bool_t
+ni_log_async_start(unsigned int records, ni_log_overflow_t overflow,
+			unsigned int flight_records, const char *dumpfile)
+{
+	static ni_bool_t registered = FALSE;
+	ni_log_async_t *la;
+	sigset_t all, old;
+	unsigned long i;
+	int err;
+
+	if (ni_log_async)
+		return TRUE;
+
+	la = xcalloc(1, sizeof(*la));
+	la->size = NI_LOG_ASYNC_RECORDS_MIN;
+	while (la->size < records && la->size < NI_LOG_ASYNC_RECORDS_MAX)
+		la->size <<= 1;
+	la->ring = xcalloc(la->size, sizeof(ni_log_record_t));
+	for (i = 0; i < la->size; ++i)
+		la->ring[i].seq = i;
+	la->overflow = overflow;
+	la->flight_records = min_t(unsigned long, flight_records, la->size);
+	la->dumpfile = dumpfile ? xstrdup(dumpfile) : NULL;
+	la->running = 1;
+
+	if ((la->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+		ni_error("unable to create log writer wakeup event: %m");
+		__ni_log_async_free(la);
+		return FALSE;
+	}
+
+	/* signals are handled by the main thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	err = pthread_create(&la->writer, NULL, __ni_log_async_writer, la);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (err) {
+		ni_error("unable to start log writer thread: %s", strerror(err));
+		__ni_log_async_free(la);
+		return FALSE;
+	}
+
+	if (!registered) {
+		pthread_atfork(__ni_log_async_atfork_prepare,
+				__ni_log_async_atfork_parent,
+				__ni_log_async_atfork_child);
+		atexit(__ni_log_async_atexit);
+		registered = TRUE;
+	}
+
+	ni_log_async = la;
+	if (la->flight_records && la->dumpfile)
+		__ni_log_flight_recorder_install();
+	return TRUE;
+}
+
+/*
+ * Wait until the writer has written all messages logged so far
+ */
+void
+ni_log_async_flush(void)
+{
+	struct timespec pause = { .tv_nsec = 100000 };
+	ni_log_async_t *la = ni_log_async;
+	unsigned long head;
+
+	if (!la)
+		return;
+
+	head = __atomic_load_n(&la->head, __ATOMIC_ACQUIRE);
+	while ((long)(__atomic_load_n(&la->tail, __ATOMIC_ACQUIRE) - head) < 0) {
+		__ni_log_async_wakeup(la, FALSE);
+		nanosleep(&pause, NULL);
+	}
+}
+
+/*
+ * Write the pending messages, stop the writer and log synchronously
+ */
+void
+ni_log_async_stop(void)
+{
+	ni_log_async_t *la = ni_log_async;
+
+	if (!la)
+		return;
+
+	__atomic_store_n(&la->running, 0, __ATOMIC_RELEASE);
+	__ni_log_async_wakeup(la, TRUE);
+	pthread_join(la->writer, NULL);
+
+	ni_log_async = NULL;
+	__ni_log_async_free(la);
+}
+
+unsigned long
+ni_log_async_dropped(void)
+{
+	return ni_log_async ? __atomic_load_n(&ni_log_async->dropped, __ATOMIC_RELAXED) : 0;
+}
+
+/*
+ * Format a decimal number of at least width digits without stdio,
+ * which is not async-signal-safe; returns the length.
+ */
+static size_t
+__ni_log_format_ulong(char *buf, unsigned long value, unsigned int width)
+{
+	char digits[32];
+	size_t len = 0, i;
+
+	do {
+		digits[len++] = '0' + value % 10;
+		value /= 10;
+	} while (value && len < sizeof(digits));
+	while (len < width && len < sizeof(digits))
+		digits[len++] = '0';
+
+	for (i = 0; i < len; ++i)
+		buf[i] = digits[len - 1 - i];
+	return len;
+}
+
+/*
+ * Dump the last records of the ring into the flight recorder file.
+ * Called from signal handlers, so it uses async-signal-safe calls.
+ */
+int
+ni_log_flight_recorder_dump(void)
+{
+	ni_log_async_t *la = ni_log_async;
+	const ni_log_record_t *rec;
+	unsigned long head, pos, seq, next = 0;
+	ni_bool_t open_line = FALSE;
+	struct iovec iov[6];
+	char stamp[64];
+	size_t len;
+	int fd, n, count = 0;
+
+	if (!la || !la->dumpfile || !la->flight_records)
+		return -1;
+
+	fd = open(la->dumpfile, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0)
+		return -1;
+
+	head = __atomic_load_n(&la->head, __ATOMIC_ACQUIRE);
+	pos = head > la->flight_records ? head - la->flight_records : 0;
+	for ( ; pos < head; ++pos) {
+		rec = &la->ring[pos & (la->size - 1)];
+		seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+		if (rec->id != pos || (seq != pos + 1 && seq != pos + la->size))
+			continue;
+
+		/* the continuation of a long message follows its previous part */
+		if (rec->part && (!open_line || pos != next))
+			continue;
+
+		n = 0;
+		if (!rec->part) {
+			if (open_line) {
+				iov[n].iov_base = "\n";
+				iov[n++].iov_len = 1;
+			}
+			len = __ni_log_format_ulong(stamp, rec->time.tv_sec, 1);
+			stamp[len++] = '.';
+			len += __ni_log_format_ulong(stamp + len, rec->time.tv_usec, 6);
+			stamp[len++] = ' ';
+			iov[n].iov_base = stamp;
+			iov[n++].iov_len  = len;
+			iov[n].iov_base = (char *)rec->tag;
+			iov[n++].iov_len  = strlen(rec->tag);
+		}
+		iov[n].iov_base = (char *)rec->msg;
+		iov[n++].iov_len  = strnlen(rec->msg, sizeof(rec->msg));
+		open_line = rec->part + 1 < rec->parts;
+		if (!open_line) {
+			iov[n].iov_base = (char *)rec->end;
+			iov[n++].iov_len  = strlen(rec->end);
+			iov[n].iov_base = "\n";
+			iov[n++].iov_len  = 1;
+			count++;
+		}
+		if (writev(fd, iov, n) < 0)
+			break;
+		next = pos + 1;
+	}
+	if (open_line && write(fd, "\n", 1) < 0) {
+		/* the dump is truncated anyway */
+	}
+	close(fd);
+	return count;
+}
+
+static void
+__ni_log_vmsg(int prio, const char *tag, const char *end, const char *fmt, va_list ap)
+{
+	if (ni_log_async)
+		__ni_log_async_vpush(ni_log_async, prio, tag, end, fmt, ap);
+	else
+	if (!ni_log_syslog)
+		__ni_log_stderr(tag, fmt, ap, end);
+	else
+		vsyslog(prio, fmt, ap);
+}
+
 void
 ni_info(const char *fmt, ...)
 {
@@ -517,11 +1125,7 @@ ni_info(const char *fmt, ...)
 		return;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("Info: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_INFO, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_INFO, "Info: ", "", fmt, ap);
 	va_end(ap);
 }
 
@@ -534,11 +1138,7 @@ ni_note(const char *fmt, ...)
 		return;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("Notice: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_NOTICE, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_NOTICE, "Notice: ", "", fmt, ap);
 	va_end(ap);
 }
 
@@ -551,11 +1151,7 @@ ni_warn(const char *fmt, ...)
 		return;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("Warning: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_WARNING, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_WARNING, "Warning: ", "", fmt, ap);
 	va_end(ap);
 }
 
@@ -565,11 +1161,7 @@ ni_error(const char *fmt, ...)
 	va_list ap;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("Error: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_ERR, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_ERR, "Error: ", "", fmt, ap);
 	va_end(ap);
 }
 
@@ -583,11 +1175,7 @@ ni_error_extra(const char *fmt, ...)
 	va_list ap;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("       ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_ERR, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_ERR, "       ", "", fmt, ap);
 	va_end(ap);
 }
 
@@ -600,11 +1188,7 @@ ni_trace(const char *fmt, ...)
 		return;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("::: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_DEBUG, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_DEBUG, "::: ", "", fmt, ap);
 	va_end(ap);
 }
 
@@ -613,12 +1197,11 @@ ni_fatal(const char *fmt, ...)
 {
 	va_list ap;
 
+	/* write the pending messages first and this one synchronously */
+	ni_log_async_stop();
+
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("FATAL ERROR: *** ", fmt, ap, " ***");
-	} else {
-		vsyslog(LOG_CRIT, fmt, ap);
-	}
+	__ni_log_vmsg(LOG_CRIT, "FATAL ERROR: *** ", " ***", fmt, ap);
 	va_end(ap);
 
 	exit(1);
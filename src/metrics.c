@@ -0,0 +1,489 @@
+/*
+ *	Metrics of the wicked daemon internals
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ *	The metrics are plain counters in a static table, cheap enough to be
+ *	always updated. When enabled in the <metrics> config, each daemon
+ *	exports them on the "<statedir>/<daemon>.metrics" UNIX socket: it
+ *	answers a HTTP GET (e.g. curl --unix-socket) with a HTTP response
+ *	and any other (or no) request with the plain text exposition.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/poll.h>
+#include <sys/un.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+#include "socket_priv.h"
+#include "util_priv.h"
+#include "appconfig.h"
+#include "metrics.h"
+
+#define NI_METRICS_BUCKETS		10
+#define NI_METRICS_REQUEST_TIMEOUT	100
+#define NI_METRICS_RESPONSE_TIMEOUT	5000
+
+typedef struct ni_metric_def {
+	const char *		name;
+	const char *		labels;
+	ni_metric_type_t	type;
+	const char *		help;
+} ni_metric_def_t;
+
+typedef struct ni_metric_value {
+	uint64_t		count;
+	long			gauge;
+	double			sum;
+	uint64_t		buckets[NI_METRICS_BUCKETS];
+} ni_metric_value_t;
+
+static const double		ni_metrics_bounds[NI_METRICS_BUCKETS] = {
+	0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0
+};
+
+static const ni_metric_def_t	ni_metrics_defs[__NI_METRIC_MAX] = {
+	[NI_METRIC_EVENT_LOOP_ITERATIONS] = {
+		"wicked_event_loop_iterations_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"Event loop poll iterations." },
+	[NI_METRIC_EVENT_LOOP_DISPATCH] = {
+		"wicked_event_loop_dispatch_seconds", NULL, NI_METRIC_TYPE_HISTOGRAM,
+		"Time to dispatch the socket events of a poll iteration." },
+	[NI_METRIC_SOCKET_RECEIVE] = {
+		"wicked_socket_events_total", "event=\"receive\"", NI_METRIC_TYPE_COUNTER,
+		"Socket events dispatched by the event loop." },
+	[NI_METRIC_SOCKET_TRANSMIT] = {
+		"wicked_socket_events_total", "event=\"transmit\"", NI_METRIC_TYPE_COUNTER, NULL },
+	[NI_METRIC_SOCKET_HANGUP] = {
+		"wicked_socket_events_total", "event=\"hangup\"", NI_METRIC_TYPE_COUNTER, NULL },
+	[NI_METRIC_SOCKET_ERROR] = {
+		"wicked_socket_events_total", "event=\"error\"", NI_METRIC_TYPE_COUNTER, NULL },
+
+	[NI_METRIC_TIMERS_REGISTERED] = {
+		"wicked_timers_registered_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"Timers registered." },
+	[NI_METRIC_TIMERS_EXPIRED] = {
+		"wicked_timers_expired_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"Timers expired and run." },
+	[NI_METRIC_TIMERS_CANCELLED] = {
+		"wicked_timers_cancelled_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"Timers cancelled before they expired." },
+	[NI_METRIC_TIMERS_ACTIVE] = {
+		"wicked_timers_active", NULL, NI_METRIC_TYPE_GAUGE,
+		"Timers currently armed." },
+	[NI_METRIC_TIMER_LATENESS] = {
+		"wicked_timer_lateness_seconds", NULL, NI_METRIC_TYPE_HISTOGRAM,
+		"Delay of the timer callbacks behind the expiry time." },
+
+	[NI_METRIC_NETLINK_LINK] = {
+		"wicked_netlink_events_total", "type=\"link\"", NI_METRIC_TYPE_COUNTER,
+		"Rtnetlink event messages processed." },
+	[NI_METRIC_NETLINK_ADDR] = {
+		"wicked_netlink_events_total", "type=\"addr\"", NI_METRIC_TYPE_COUNTER, NULL },
+	[NI_METRIC_NETLINK_ROUTE] = {
+		"wicked_netlink_events_total", "type=\"route\"", NI_METRIC_TYPE_COUNTER, NULL },
+	[NI_METRIC_NETLINK_RULE] = {
+		"wicked_netlink_events_total", "type=\"rule\"", NI_METRIC_TYPE_COUNTER, NULL },
+	[NI_METRIC_NETLINK_PREFIX] = {
+		"wicked_netlink_events_total", "type=\"prefix\"", NI_METRIC_TYPE_COUNTER, NULL },
+	[NI_METRIC_NETLINK_NDUSEROPT] = {
+		"wicked_netlink_events_total", "type=\"nduseropt\"", NI_METRIC_TYPE_COUNTER, NULL },
+	[NI_METRIC_NETLINK_OTHER] = {
+		"wicked_netlink_events_total", "type=\"other\"", NI_METRIC_TYPE_COUNTER, NULL },
+	[NI_METRIC_NETLINK_IGNORED] = {
+		"wicked_netlink_events_ignored_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"Rtnetlink event messages ignored on errors." },
+	[NI_METRIC_NETLINK_RECV_ERRORS] = {
+		"wicked_netlink_receive_errors_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"Rtnetlink event socket receive errors and restarts." },
+
+	[NI_METRIC_DBUS_CALLS] = {
+		"wicked_dbus_calls_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"D-Bus method calls handled." },
+	[NI_METRIC_DBUS_CALL_ERRORS] = {
+		"wicked_dbus_call_errors_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"D-Bus method calls answered with an error." },
+	[NI_METRIC_DBUS_CALL_DURATION] = {
+		"wicked_dbus_call_duration_seconds", NULL, NI_METRIC_TYPE_HISTOGRAM,
+		"Time to handle a D-Bus method call." },
+
+	[NI_METRIC_FSM_TRANSITIONS] = {
+		"wicked_fsm_transitions_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"Interface worker state transitions." },
+	[NI_METRIC_FSM_FAILURES] = {
+		"wicked_fsm_failures_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"Interface workers failed." },
+
+	[NI_METRIC_PROCESSES_SPAWNED] = {
+		"wicked_processes_spawned_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"Processes started." },
+	[NI_METRIC_PROCESS_FAILURES] = {
+		"wicked_process_failures_total", NULL, NI_METRIC_TYPE_COUNTER,
+		"Processes failed to start." },
+
+	[NI_METRIC_DHCP4_RENEWALS] = {
+		"wicked_lease_renewals_total", "family=\"ipv4\"", NI_METRIC_TYPE_COUNTER,
+		"DHCP lease renewals initiated." },
+	[NI_METRIC_DHCP6_RENEWALS] = {
+		"wicked_lease_renewals_total", "family=\"ipv6\"", NI_METRIC_TYPE_COUNTER, NULL },
+};
+
+static ni_metric_value_t	ni_metrics_values[__NI_METRIC_MAX];
+
+void
+ni_metrics_inc(ni_metric_t id)
+{
+	ni_metrics_values[id].count++;
+}
+
+/*
+ * Add to a gauge
+ */
+void
+ni_metrics_add(ni_metric_t id, long delta)
+{
+	ni_metrics_values[id].gauge += delta;
+}
+
+/*
+ * Observe a duration in seconds
+ */
+void
+ni_metrics_observe(ni_metric_t id, double value)
+{
+	ni_metric_value_t *m = &ni_metrics_values[id];
+	unsigned int i;
+
+	for (i = 0; i < NI_METRICS_BUCKETS; ++i) {
+		if (value <= ni_metrics_bounds[i])
+			m->buckets[i]++;
+	}
+	m->sum += value;
+	m->count++;
+}
+
+void
+ni_metrics_observe_since(ni_metric_t id, double begin)
+{
+	ni_metrics_observe(id, ni_metrics_time() - begin);
+}
+
+/*
+ * Monotonic time in seconds for the duration measurements
+ */
+double
+ni_metrics_time(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+		return 0;
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+uint64_t
+ni_metrics_value(ni_metric_t id)
+{
+	if (ni_metrics_defs[id].type == NI_METRIC_TYPE_GAUGE)
+		return ni_metrics_values[id].gauge;
+	return ni_metrics_values[id].count;
+}
+
+void
+ni_metrics_reset(void)
+{
+	memset(ni_metrics_values, 0, sizeof(ni_metrics_values));
+}
+
+/*
+ * Format all metrics in the Prometheus text exposition format
+ */
+static void
+ni_metrics_format_metric(ni_stringbuf_t *out, const ni_metric_def_t *def,
+			const ni_metric_value_t *m)
+{
+	const char *sep = def->labels ? "," : "";
+	const char *labels = def->labels ? def->labels : "";
+	unsigned int i;
+
+	switch (def->type) {
+	case NI_METRIC_TYPE_COUNTER:
+		if (def->labels)
+			ni_stringbuf_printf(out, "%s{%s} %llu\n", def->name, labels,
+					(unsigned long long)m->count);
+		else
+			ni_stringbuf_printf(out, "%s %llu\n", def->name,
+					(unsigned long long)m->count);
+		break;
+
+	case NI_METRIC_TYPE_GAUGE:
+		if (def->labels)
+			ni_stringbuf_printf(out, "%s{%s} %ld\n", def->name, labels, m->gauge);
+		else
+			ni_stringbuf_printf(out, "%s %ld\n", def->name, m->gauge);
+		break;
+
+	case NI_METRIC_TYPE_HISTOGRAM:
+		for (i = 0; i < NI_METRICS_BUCKETS; ++i) {
+			ni_stringbuf_printf(out, "%s_bucket{%s%sle=\"%g\"} %llu\n",
+					def->name, labels, sep, ni_metrics_bounds[i],
+					(unsigned long long)m->buckets[i]);
+		}
+		ni_stringbuf_printf(out, "%s_bucket{%s%sle=\"+Inf\"} %llu\n",
+				def->name, labels, sep, (unsigned long long)m->count);
+		if (def->labels) {
+			ni_stringbuf_printf(out, "%s_sum{%s} %.6f\n", def->name, labels, m->sum);
+			ni_stringbuf_printf(out, "%s_count{%s} %llu\n", def->name, labels,
+					(unsigned long long)m->count);
+		} else {
+			ni_stringbuf_printf(out, "%s_sum %.6f\n", def->name, m->sum);
+			ni_stringbuf_printf(out, "%s_count %llu\n", def->name,
+					(unsigned long long)m->count);
+		}
+		break;
+	}
+}
+
+void
+ni_metrics_format(ni_stringbuf_t *out)
+{
+	static const char *type_names[] = {
+		[NI_METRIC_TYPE_COUNTER]	= "counter",
+		[NI_METRIC_TYPE_GAUGE]		= "gauge",
+		[NI_METRIC_TYPE_HISTOGRAM]	= "histogram",
+	};
+	const char *family = NULL;
+	unsigned int id;
+
+	for (id = 0; id < __NI_METRIC_MAX; ++id) {
+		const ni_metric_def_t *def = &ni_metrics_defs[id];
+
+		if (!ni_string_eq(family, def->name)) {
+			family = def->name;
+			if (def->help)
+				ni_stringbuf_printf(out, "# HELP %s %s\n", def->name, def->help);
+			ni_stringbuf_printf(out, "# TYPE %s %s\n", def->name, type_names[def->type]);
+		}
+		ni_metrics_format_metric(out, def, &ni_metrics_values[id]);
+	}
+}
+
+/*
+ * Export the metrics on a UNIX socket. The connections are served by
+ * the event loop without blocking: a client sending a "GET " request
+ * receives a HTTP response, a client sending nothing else or nothing
+ * within the request timeout receives the plain text.
+ */
+typedef struct ni_metrics_conn {
+	struct timeval		deadline;
+	ni_bool_t		answered;
+} ni_metrics_conn_t;
+
+static void
+ni_metrics_conn_set_deadline(ni_metrics_conn_t *conn, unsigned int msec)
+{
+	struct timeval now, tmo;
+
+	tmo.tv_sec = msec / 1000;
+	tmo.tv_usec = (msec % 1000) * 1000;
+	ni_timer_get_time(&now);
+	timeradd(&now, &tmo, &conn->deadline);
+}
+
+static void
+ni_metrics_conn_respond(ni_socket_t *sock, ni_bool_t http)
+{
+	ni_metrics_conn_t *conn = sock->user_data;
+	ni_stringbuf_t body = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t head = NI_STRINGBUF_INIT_DYNAMIC;
+
+	ni_metrics_format(&body);
+	if (http) {
+		ni_stringbuf_printf(&head, "HTTP/1.0 200 OK\r\n"
+				"Content-Type: text/plain; version=0.0.4\r\n"
+				"Content-Length: %zu\r\n\r\n", body.len);
+	}
+
+	ni_buffer_init_dynamic(&sock->wbuf, head.len + body.len + 1);
+	ni_buffer_put(&sock->wbuf, head.string, head.len);
+	ni_buffer_put(&sock->wbuf, body.string, body.len);
+	ni_stringbuf_destroy(&head);
+	ni_stringbuf_destroy(&body);
+
+	/* a client not reading its response is dropped after a while */
+	ni_metrics_conn_set_deadline(conn, NI_METRICS_RESPONSE_TIMEOUT);
+	conn->answered = TRUE;
+	sock->poll_flags = POLLOUT;
+}
+
+static void
+ni_metrics_conn_recv(ni_socket_t *sock)
+{
+	ni_metrics_conn_t *conn = sock->user_data;
+	char request[256];
+	ssize_t len;
+
+	if (conn->answered)
+		return;
+
+	len = recv(sock->__fd, request, sizeof(request), 0);
+	if (len < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+
+	ni_metrics_conn_respond(sock, len >= 4 && !strncmp(request, "GET ", 4));
+}
+
+static void
+ni_metrics_conn_send(ni_socket_t *sock)
+{
+	ssize_t len;
+
+	len = send(sock->__fd, ni_buffer_head(&sock->wbuf),
+			ni_buffer_count(&sock->wbuf), MSG_NOSIGNAL);
+	if (len < 0) {
+		if (errno == EAGAIN || errno == EINTR)
+			return;
+		ni_debug_socket("unable to send metrics: %m");
+		ni_socket_close(sock);
+		return;
+	}
+
+	ni_buffer_pull_head(&sock->wbuf, len);
+	if (!ni_buffer_count(&sock->wbuf))
+		ni_socket_close(sock);
+}
+
+static void
+ni_metrics_conn_hangup(ni_socket_t *sock)
+{
+	ni_socket_close(sock);
+}
+
+static int
+ni_metrics_conn_get_timeout(const ni_socket_t *sock, struct timeval *tv)
+{
+	const ni_metrics_conn_t *conn = sock->user_data;
+
+	*tv = conn->deadline;
+	return 0;
+}
+
+static void
+ni_metrics_conn_check_timeout(ni_socket_t *sock, const struct timeval *now)
+{
+	ni_metrics_conn_t *conn = sock->user_data;
+
+	if (timercmp(now, &conn->deadline, <))
+		return;
+
+	if (conn->answered) {
+		ni_debug_socket("metrics client does not read its response");
+		ni_socket_close(sock);
+	} else {
+		ni_metrics_conn_respond(sock, FALSE);
+	}
+}
+
+static void
+ni_metrics_accept(ni_socket_t *sock)
+{
+	ni_metrics_conn_t *conn;
+	ni_socket_t *client;
+	int fd;
+
+	if ((fd = accept4(sock->__fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0) {
+		if (errno != EAGAIN && errno != EINTR)
+			ni_debug_socket("unable to accept metrics connection: %m");
+		return;
+	}
+
+	if (!(client = ni_socket_wrap(fd, SOCK_STREAM))) {
+		close(fd);
+		return;
+	}
+
+	conn = xcalloc(1, sizeof(*conn));
+	ni_metrics_conn_set_deadline(conn, NI_METRICS_REQUEST_TIMEOUT);
+
+	client->user_data = conn;
+	client->release_user_data = free;
+	client->receive = ni_metrics_conn_recv;
+	client->transmit = ni_metrics_conn_send;
+	client->handle_hangup = ni_metrics_conn_hangup;
+	client->get_timeout = ni_metrics_conn_get_timeout;
+	client->check_timeout = ni_metrics_conn_check_timeout;
+	ni_socket_activate(client);
+}
+
+int
+ni_metrics_listen(const char *name)
+{
+	const ni_config_metrics_t *conf = ni_config_metrics();
+	struct sockaddr_un sun;
+	ni_socket_t *sock;
+	char path[PATH_MAX];
+	int fd;
+
+	if (!conf || !conf->enabled || ni_string_empty(name))
+		return 0;
+
+	snprintf(path, sizeof(path), "%s/%s.metrics", ni_config_statedir(), name);
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_LOCAL;
+	if (strlen(path) >= sizeof(sun.sun_path)) {
+		ni_error("metrics socket path %s too long", path);
+		return -1;
+	}
+	strcpy(sun.sun_path, path);
+
+	if ((fd = socket(AF_LOCAL, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+		ni_error("unable to create metrics socket: %m");
+		return -1;
+	}
+
+	unlink(path);
+	if (bind(fd, (struct sockaddr *) &sun, sizeof(sun)) < 0 ||
+	    chmod(path, 0600) < 0 || listen(fd, 8) < 0) {
+		ni_error("unable to listen on metrics socket %s: %m", path);
+		close(fd);
+		return -1;
+	}
+
+	if (!(sock = ni_socket_wrap(fd, SOCK_STREAM))) {
+		close(fd);
+		return -1;
+	}
+	sock->receive = ni_metrics_accept;
+	ni_socket_activate(sock);
+	ni_socket_release(sock);
+
+	ni_debug_socket("exporting metrics on %s", path);
+	return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ *	Metrics of the wicked daemon internals
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifndef NI_METRICS_H
+#define NI_METRICS_H
+
+#include <wicked/types.h>
+#include <wicked/util.h>
+
+/*
+ * The metrics registry: counters, gauges and histograms (of durations
+ * in seconds), exported in the Prometheus text exposition format.
+ * Metrics sharing the name differ in their labels.
+ */
+typedef enum {
+	NI_METRIC_EVENT_LOOP_ITERATIONS,
+	NI_METRIC_EVENT_LOOP_DISPATCH,
+	NI_METRIC_SOCKET_RECEIVE,
+	NI_METRIC_SOCKET_TRANSMIT,
+	NI_METRIC_SOCKET_HANGUP,
+	NI_METRIC_SOCKET_ERROR,
+
+	NI_METRIC_TIMERS_REGISTERED,
+	NI_METRIC_TIMERS_EXPIRED,
+	NI_METRIC_TIMERS_CANCELLED,
+	NI_METRIC_TIMERS_ACTIVE,
+	NI_METRIC_TIMER_LATENESS,
+
+	NI_METRIC_NETLINK_LINK,
+	NI_METRIC_NETLINK_ADDR,
+	NI_METRIC_NETLINK_ROUTE,
+	NI_METRIC_NETLINK_RULE,
+	NI_METRIC_NETLINK_PREFIX,
+	NI_METRIC_NETLINK_NDUSEROPT,
+	NI_METRIC_NETLINK_OTHER,
+	NI_METRIC_NETLINK_IGNORED,
+	NI_METRIC_NETLINK_RECV_ERRORS,
+
+	NI_METRIC_DBUS_CALLS,
+	NI_METRIC_DBUS_CALL_ERRORS,
+	NI_METRIC_DBUS_CALL_DURATION,
+
+	NI_METRIC_FSM_TRANSITIONS,
+	NI_METRIC_FSM_FAILURES,
+
+	NI_METRIC_PROCESSES_SPAWNED,
+	NI_METRIC_PROCESS_FAILURES,
+
+	NI_METRIC_DHCP4_RENEWALS,
+	NI_METRIC_DHCP6_RENEWALS,
+
+	__NI_METRIC_MAX
+} ni_metric_t;
+
+typedef enum {
+	NI_METRIC_TYPE_COUNTER,
+	NI_METRIC_TYPE_GAUGE,
+	NI_METRIC_TYPE_HISTOGRAM,
+} ni_metric_type_t;
+
+extern void		ni_metrics_inc(ni_metric_t);
+extern void		ni_metrics_add(ni_metric_t, long);
+extern void		ni_metrics_observe(ni_metric_t, double);
+extern void		ni_metrics_observe_since(ni_metric_t, double);
+extern double		ni_metrics_time(void);
+extern uint64_t		ni_metrics_value(ni_metric_t);
+
+extern void		ni_metrics_format(ni_stringbuf_t *);
+extern int		ni_metrics_listen(const char *);
+extern void		ni_metrics_reset(void);
+
+#endif /* NI_METRICS_H */
@@ -82,13 +82,14 @@ static const ni_intmap_t	__linktype_names[] = {
 
 	{ NULL }
 };
+static ni_intmap_index_t	__linktype_index = NI_INTMAP_INDEX_INIT(__linktype_names);
 
 int
 ni_linktype_name_to_type(const char *name)
 {
 	unsigned int value;
 
-	if (ni_parse_uint_mapped(name, __linktype_names, &value) < 0)
+	if (ni_parse_uint_indexed(name, &__linktype_index, &value) < 0)
 		return -1;
 	return value;
 }
@@ -96,7 +97,7 @@ ni_linktype_name_to_type(const char *name)
 const char *
 ni_linktype_type_to_name(unsigned int type)
 {
-	return ni_format_uint_mapped(type, __linktype_names);
+	return ni_format_uint_indexed(type, &__linktype_index);
 }
 
 /*
@@ -121,13 +122,14 @@ static const ni_intmap_t	__linkinfo_kind_names[] = {
 
 	{ NULL }
 };
+static ni_intmap_index_t	__linkinfo_kind_index = NI_INTMAP_INDEX_INIT(__linkinfo_kind_names);
 
 ni_bool_t
 __ni_linkinfo_kind_to_type(const char *name, ni_iftype_t *iftype)
 {
 	unsigned int value;
 
-	if (!iftype || ni_parse_uint_mapped(name, __linkinfo_kind_names, &value) < 0)
+	if (!iftype || ni_parse_uint_indexed(name, &__linkinfo_kind_index, &value) < 0)
 		return FALSE;
 	*iftype = value;
 	return TRUE;
@@ -525,13 +527,14 @@ static const ni_intmap_t	__arphrd_names[] = {
 
  { 0 }
 };
+static ni_intmap_index_t	__arphrd_index = NI_INTMAP_INDEX_INIT(__arphrd_names);
 
 int
 ni_arphrd_name_to_type(const char *name)
 {
 	unsigned int value;
 
-	if (ni_parse_uint_mapped(name, __arphrd_names, &value) < 0)
+	if (ni_parse_uint_indexed(name, &__arphrd_index, &value) < 0)
 		return -1;
 	return value;
 }
@@ -539,7 +542,7 @@ ni_arphrd_name_to_type(const char *name)
 const char *
 ni_arphrd_type_to_name(unsigned int type)
 {
-	return ni_format_uint_mapped(type, __arphrd_names);
+	return ni_format_uint_indexed(type, &__arphrd_index);
 }
 
 /*
@@ -580,13 +583,14 @@ static const ni_intmap_t		__event_names[] = {
 
 	{ NULL }
 };
+static ni_intmap_index_t		__event_index = NI_INTMAP_INDEX_INIT(__event_names);
 
 ni_event_t
 ni_event_name_to_type(const char *name)
 {
 	unsigned int value;
 
-	if (ni_parse_uint_mapped(name, __event_names, &value) < 0)
+	if (ni_parse_uint_indexed(name, &__event_index, &value) < 0)
 		return -1;
 	return value;
 }
@@ -594,7 +598,7 @@ ni_event_name_to_type(const char *name)
 const char *
 ni_event_type_to_name(ni_event_t type)
 {
-	return ni_format_uint_mapped(type, __event_names);
+	return ni_format_uint_indexed(type, &__event_index);
 }
 
 /*
@@ -35,6 +35,7 @@
 #include <wicked/ipv6.h>
 #include <wicked/pci.h>
 #include <wicked/lldp.h>
+#include <wicked/linkstats.h>
 #include <wicked/fsm.h>
 #include "netinfo_priv.h"
 #include "util_priv.h"
@@ -49,7 +50,7 @@ ni_netdev_new(const char *name, unsigned int index)
 {
 	ni_netdev_t *dev;
 
-	dev = calloc(1, sizeof(*dev));
+	dev = calloc_tagged(NI_MEMTAG_NETDEV, 1, sizeof(*dev));
 	if (!dev)
 		return NULL;
 
@@ -105,6 +106,7 @@ ni_netdev_free(ni_netdev_t *dev)
 	ni_netdev_ref_destroy(&dev->link.masterdev);
 	ni_netdev_slaveinfo_destroy(&dev->link.slave);
 	ni_netdev_set_link_stats(dev, NULL);
+	ni_netdev_set_link_xstats(dev, NULL);
 
 	/* Clear out addresses, routes, ... */
 	ni_netdev_clear_addresses(dev);
@@ -139,7 +141,7 @@ ni_netdev_free(ni_netdev_t *dev)
 	ni_addrconf_lease_list_destroy(&dev->leases);
 
 	ni_string_free(&dev->name);
-	free(dev);
+	xfree_tagged(NI_MEMTAG_NETDEV, dev);
 }
 
 /*
@@ -588,6 +590,19 @@ ni_netdev_set_link_stats(ni_netdev_t *dev, ni_link_stats_t *stats)
 	dev->link.stats = stats;
 }
 
+/*
+ * Set the interface's extended link stats
+ */
+void
+ni_netdev_set_link_xstats(ni_netdev_t *dev, ni_link_xstats_t *xstats)
+{
+	if (dev->link.xstats) {
+		free(dev->link.xstats->data);
+		free(dev->link.xstats);
+	}
+	dev->link.xstats = xstats;
+}
+
 /*
  * Set the PCI device info
  */
@@ -393,6 +393,28 @@ ni_server_background(const char *appname, ni_daemon_close_t close_flags)
 	return ni_daemonize(pidfilepath, 0644, close_flags);
 }
 
+/*
+ * Switch to the asynchronous logging when configured. The writer
+ * thread does not survive a fork, so call it after backgrounding.
+ */
+int
+ni_server_async_logging(const char *appname)
+{
+	const ni_config_async_logging_t *conf = ni_config_async_logging();
+	char dumpfile[PATH_MAX];
+
+	if (!conf || !conf->enabled)
+		return 0;
+
+	ni_assert(appname != NULL);
+	snprintf(dumpfile, sizeof(dumpfile), "%s/%s.flight-recorder",
+			ni_config_statedir(), appname);
+	if (!ni_log_async_start(conf->records, conf->overflow,
+				conf->flight_recorder, dumpfile))
+		return -1;
+	return 0;
+}
+
 void
 ni_server_listen_other_events(void (*event_handler)(ni_event_t))
 {
@@ -537,6 +559,16 @@ ni_netconfig_set_discover_filter(ni_netconfig_t *nc, unsigned int flag)
 	return FALSE;
 }
 
+ni_bool_t
+ni_netconfig_unset_discover_filter(ni_netconfig_t *nc, unsigned int flag)
+{
+	if (nc) {
+		nc->filter.discover &= ~flag;
+		return TRUE;
+	}
+	return FALSE;
+}
+
 ni_bool_t
 ni_netconfig_discover_filtered(ni_netconfig_t *nc, unsigned int flag)
 {
@@ -1100,7 +1132,7 @@ ni_addrconf_lease_new(int type, int family)
 {
 	ni_addrconf_lease_t *lease;
 
-	lease = calloc(1, sizeof(*lease));
+	lease = calloc_tagged(NI_MEMTAG_LEASE, 1, sizeof(*lease));
 	if (lease) {
 		lease->seqno = __ni_global_seqno++;
 		lease->type = type;
@@ -1115,7 +1147,7 @@ ni_addrconf_lease_free(ni_addrconf_lease_t *lease)
 {
 	if (lease)
 		ni_addrconf_lease_destroy(lease);
-	free(lease);
+	xfree_tagged(NI_MEMTAG_LEASE, lease);
 }
 
 static void
@@ -56,6 +56,7 @@ extern ni_rule_t *	ni_netconfig_rule_find(ni_netconfig_t *, const ni_rule_t *);
 extern ni_rule_array_t *ni_netconfig_rule_array(ni_netconfig_t *);
 
 extern ni_bool_t	ni_netconfig_set_discover_filter(ni_netconfig_t *, unsigned int);
+extern ni_bool_t	ni_netconfig_unset_discover_filter(ni_netconfig_t *, unsigned int);
 extern ni_bool_t	ni_netconfig_discover_filtered(ni_netconfig_t *, unsigned int);
 extern ni_bool_t	ni_netconfig_set_family_filter(ni_netconfig_t *, unsigned int);
 extern unsigned int	ni_netconfig_get_family_filter(ni_netconfig_t *);
@@ -82,6 +83,7 @@ extern ni_bool_t	__ni_address_list_remove(ni_address_t **, ni_address_t *);
 extern int		__ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list);
 extern int		__ni_system_refresh_interfaces(ni_netconfig_t *nc);
 extern int		__ni_system_refresh_interface(ni_netconfig_t *, ni_netdev_t *);
+extern void		__ni_system_refresh_link_extern(ni_netconfig_t *, ni_netdev_t *);
 extern int		__ni_system_refresh_interface_addrs(ni_netconfig_t *, ni_netdev_t *);
 extern int		__ni_system_refresh_interface_routes(ni_netconfig_t *, ni_netdev_t *);
 extern int		__ni_system_refresh_addrs(ni_netconfig_t *, unsigned int);
@@ -147,12 +149,25 @@ typedef struct ni_capture_protinfo {
 
 	/* If ip_protocol is IPPROT_UDP or TCP */
 	uint16_t		ip_port;
+
+	/* Permit to use a shared socket for all devices */
+	ni_bool_t		shared;
 } ni_capture_protinfo_t;
 
+#define NI_CAPTURE_MATCH_MAX	2
+
+typedef struct ni_capture_match {
+	unsigned int		offset;		/* in the udp payload */
+	unsigned int		len;
+	unsigned char		data[16];
+} ni_capture_match_t;
+
 extern int		ni_capture_devinfo_init(ni_capture_devinfo_t *, const char *, const ni_linkinfo_t *);
 extern int		ni_capture_devinfo_refresh(ni_capture_devinfo_t *, const char *, const ni_linkinfo_t *);
 extern ni_capture_t *	ni_capture_open(const ni_capture_devinfo_t *, const ni_capture_protinfo_t *, void (*)(ni_socket_t *));
 extern int		ni_capture_recv(ni_capture_t *, ni_buffer_t *, ni_sockaddr_t *, const char *);
+extern int		ni_capture_set_match(ni_capture_t *, const ni_capture_match_t *, unsigned int);
+extern int		ni_capture_set_arp_filter(ni_capture_t *, const struct in_addr *, unsigned int);
 extern ni_bool_t	ni_capture_from_hwaddr_set(ni_hwaddr_t *, const ni_sockaddr_t *);
 extern const char *	ni_capture_from_hwaddr_print(const ni_sockaddr_t *);
 extern ssize_t		ni_capture_send(ni_capture_t *, const ni_buffer_t *, const ni_timeout_param_t *);
@@ -197,13 +212,24 @@ extern int		ni_arp_send_grat_reply(ni_arp_socket_t *, struct in_addr);
 extern int		ni_arp_send_grat_request(ni_arp_socket_t *, struct in_addr);
 extern int		ni_arp_send(ni_arp_socket_t *, const ni_arp_packet_t *);
 
+/*
+ * Hash of the ipaddrs array positions by the IPv4 address
+ */
+typedef struct ni_arp_address_index {
+	unsigned int		size;
+	unsigned int *		slot;
+} ni_arp_address_index_t;
+
 typedef struct ni_arp_verify {
 	unsigned int		nprobes;
 
 	unsigned int		wait_ms;
 	struct timeval		started;
+	unsigned int		cursor;		/* paced position in the round */
+	unsigned int		sent;
 
 	ni_address_array_t	ipaddrs;
+	ni_arp_address_index_t	index;
 } ni_arp_verify_t;
 
 extern void		ni_arp_verify_init(ni_arp_verify_t *, unsigned int, unsigned int);
@@ -218,8 +244,11 @@ typedef struct ni_arp_notify {
 
 	unsigned int		wait_ms;
 	struct timeval		started;
+	unsigned int		cursor;
+	unsigned int		sent;
 
 	ni_address_array_t	ipaddrs;
+	ni_arp_address_index_t	index;
 } ni_arp_notify_t;
 
 extern void		ni_arp_notify_init(ni_arp_notify_t *, unsigned int, unsigned int);
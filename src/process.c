@@ -10,17 +10,24 @@
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <sys/socket.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <errno.h>
 #include <signal.h>
+#include <dirent.h>
+#include <poll.h>
+#include <spawn.h>
 
 #include <wicked/logging.h>
 #include <wicked/socket.h>
 #include "socket_priv.h"
 #include "process.h"
+#include "metrics.h"
 
 static int				__ni_process_run(ni_process_t *, int *);
+static int				__ni_process_start(ni_process_t *, int, int, int);
+static void				ni_coprocess_cancel(ni_process_t *);
 static int				__ni_process_run_info(ni_process_t *);
 static ni_socket_t *			__ni_process_get_output(ni_process_t *, int);
 static const ni_string_array_t *	__ni_default_environment(void);
@@ -45,6 +52,7 @@ __ni_shellcmd_free(ni_shellcmd_t *cmd)
 	ni_string_free(&cmd->command);
 	ni_string_array_destroy(&cmd->argv);
 	ni_string_array_destroy(&cmd->environ);
+	ni_coprocess_free(cmd->coprocess);
 	free(cmd);
 }
 
@@ -197,6 +205,9 @@ ni_process_new(ni_shellcmd_t *proc)
 void
 ni_process_free(ni_process_t *pi)
 {
+	if (pi->coproc.owner) {
+		ni_coprocess_cancel(pi);
+	} else
 	if (ni_process_running(pi)) {
 		if (kill(pi->pid, SIGKILL) < 0)
 			ni_info("Unable to kill process %d (%s): %m",
@@ -222,6 +233,7 @@ ni_process_free(ni_process_t *pi)
 
 	ni_string_array_destroy(&pi->argv);
 	ni_string_array_destroy(&pi->environ);
+	ni_buffer_destroy(&pi->coproc.output);
 	ni_shellcmd_release(pi->process);
 	free(pi);
 }
@@ -354,6 +366,11 @@ ni_process_run(ni_process_t *pi)
 {
 	int pfd[2], rv;
 
+	/* Pass it to the co-process of the command when possible */
+	if (pi->process && pi->process->coprocess && !pi->exec &&
+	    ni_coprocess_call(pi->process->coprocess, pi) == NI_PROCESS_SUCCESS)
+		return NI_PROCESS_SUCCESS;
+
 	/* Our code in socket.c is only able to deal with sockets for now; */
 	if (socketpair(AF_UNIX, SOCK_STREAM, 0, pfd) < 0) {
 		ni_error("%s: unable to create pipe: %m", __func__);
@@ -493,26 +510,142 @@ ni_process_run_and_capture_output(ni_process_t *pi, ni_buffer_t *out_buffer)
 	return __ni_process_run_info(pi);
 }
 
+/*
+ * Close the inherited descriptors from minfd on in the forked child.
+ * A loop up to getdtablesize() would mean a million close() calls
+ * with a high RLIMIT_NOFILE, so use close_range and fall back to the
+ * open descriptors listed in /proc/self/fd.
+ */
+static void
+__ni_process_close_fds(int minfd)
+{
+	struct dirent *d;
+	int fd, maxfd;
+	DIR *dir;
+
+#if defined(HAVE_CLOSE_RANGE)
+	if (close_range(minfd, ~0U, 0) == 0)
+		return;
+#elif defined(SYS_close_range)
+	if (syscall(SYS_close_range, minfd, ~0U, 0) == 0)
+		return;
+#endif
+
+	if ((dir = opendir("/proc/self/fd")) != NULL) {
+		while ((d = readdir(dir)) != NULL) {
+			if (ni_parse_int(d->d_name, &fd, 10) < 0)
+				continue;
+			if (fd >= minfd && fd != dirfd(dir))
+				close(fd);
+		}
+		closedir(dir);
+		return;
+	}
+
+	maxfd = getdtablesize();
+	for (fd = minfd; fd < maxfd; ++fd)
+		close(fd);
+}
+
+#if defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP) && \
+    defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP)
+/*
+ * Spawn the command without to fork our address space: posix_spawn
+ * uses a vfork-like clone(CLONE_VM|CLONE_VFORK) and applies the same
+ * setup as the child code in __ni_process_run in the new process.
+ */
+static int
+__ni_process_spawn(ni_process_t *pi, int infd, int outfd, int errfd, pid_t *pid)
+{
+	static char *empty[] = { NULL };
+	const char *arg0 = pi->argv.data[0];
+	posix_spawn_file_actions_t actions;
+	int err;
+
+	if ((err = posix_spawn_file_actions_init(&actions))) {
+		errno = err;
+		ni_error("%s: unable to init spawn actions: %m", __func__);
+		return NI_PROCESS_FAILURE;
+	}
+
+	if (posix_spawn_file_actions_addchdir_np(&actions, "/") ||
+	    (infd < 0 && posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0)) ||
+	    (infd >= 0 && posix_spawn_file_actions_adddup2(&actions, infd, 0)) ||
+	    (outfd >= 0 && posix_spawn_file_actions_adddup2(&actions, outfd, 1)) ||
+	    (errfd >= 0 && posix_spawn_file_actions_adddup2(&actions, errfd, 2)) ||
+	    posix_spawn_file_actions_addclosefrom_np(&actions, 3)) {
+		ni_error("%s: unable to set up spawn actions: %m", __func__);
+		posix_spawn_file_actions_destroy(&actions);
+		return NI_PROCESS_FAILURE;
+	}
+
+	/* The string arrays are NULL terminated behind the count */
+	err = posix_spawn(pid, arg0, &actions, NULL, pi->argv.data,
+			pi->environ.count ? pi->environ.data : empty);
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (err) {
+		errno = err;
+		ni_error("%s: cannot execute %s: %m", __func__, arg0);
+		return err == ENOENT || err == EACCES || err == ENOEXEC ?
+			NI_PROCESS_COMMAND : NI_PROCESS_FAILURE;
+	}
+	return NI_PROCESS_SUCCESS;
+}
+#endif
+
 int
 __ni_process_run(ni_process_t *pi, int *pfd)
+{
+	return __ni_process_start(pi, -1, pfd ? pfd[1] : -1, pfd ? pfd[1] : -1);
+}
+
+/*
+ * Start the process with stdin from infd or /dev/null and stdout,
+ * stderr to outfd, errfd or inherited when negative.
+ */
+static int
+__ni_process_start(ni_process_t *pi, int infd, int outfd, int errfd)
 {
 	const char *arg0 = pi->argv.data[0];
 	pid_t pid;
 
-	if (pi->pid != 0) {
+	if (pi->pid != 0 || pi->coproc.owner) {
 		ni_error("Cannot execute process instance twice (%s)", pi->process->command);
+		ni_metrics_inc(NI_METRIC_PROCESS_FAILURES);
 		return NI_PROCESS_FAILURE;
 	}
 
 	if (!pi->exec && !ni_file_executable(arg0)) {
 		ni_error("Unable to run %s; does not exist or is not executable", arg0);
+		ni_metrics_inc(NI_METRIC_PROCESS_FAILURES);
 		return NI_PROCESS_COMMAND;
 	}
 
 	signal(SIGCHLD, ni_process_sigchild);
 
+#if defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP) && \
+    defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP)
+	/* The exec hook runs our code in the child and needs a fork */
+	if (!pi->exec) {
+		int rv;
+
+		if ((rv = __ni_process_spawn(pi, infd, outfd, errfd, &pid)) < 0) {
+			ni_metrics_inc(NI_METRIC_PROCESS_FAILURES);
+			return rv;
+		}
+
+		pi->pid = pid;
+		pi->status = -1;
+		ni_timer_get_time(&pi->started);
+		ni_metrics_inc(NI_METRIC_PROCESSES_SPAWNED);
+		return NI_PROCESS_SUCCESS;
+	}
+#endif
+
 	if ((pid = fork()) < 0) {
 		ni_error("%s: unable to fork child process: %m", __func__);
+		ni_metrics_inc(NI_METRIC_PROCESS_FAILURES);
 		return NI_PROCESS_FAILURE;
 	}
 	pi->pid = pid;
@@ -520,26 +653,26 @@ __ni_process_run(ni_process_t *pi, int *pfd)
 	ni_timer_get_time(&pi->started);
 
 	if (pid == 0) {
-		int maxfd;
 		int fd;
 
 		if (chdir("/") < 0)
 			ni_warn("%s: unable to chdir to /: %m", __func__);
 
-		close(0);
-		if ((fd = open("/dev/null", O_RDONLY)) < 0)
-			ni_warn("%s: unable to open /dev/null: %m", __func__);
-		else if (dup2(fd, 0) < 0)
-			ni_warn("%s: cannot dup null descriptor: %m", __func__);
-
-		if (pfd) {
-			if (dup2(pfd[1], 1) < 0 || dup2(pfd[1], 2) < 0)
-				ni_warn("%s: cannot dup pipe out descriptor: %m", __func__);
+		if (infd >= 0) {
+			if (dup2(infd, 0) < 0)
+				ni_warn("%s: cannot dup input descriptor: %m", __func__);
+		} else {
+			close(0);
+			if ((fd = open("/dev/null", O_RDONLY)) < 0)
+				ni_warn("%s: unable to open /dev/null: %m", __func__);
+			else if (dup2(fd, 0) < 0)
+				ni_warn("%s: cannot dup null descriptor: %m", __func__);
 		}
 
-		maxfd = getdtablesize();
-		for (fd = 3; fd < maxfd; ++fd)
-			close(fd);
+		if ((outfd >= 0 && dup2(outfd, 1) < 0) || (errfd >= 0 && dup2(errfd, 2) < 0))
+			ni_warn("%s: cannot dup pipe out descriptor: %m", __func__);
+
+		__ni_process_close_fds(3);
 
 		/* NULL terminate argv and env lists */
 		ni_string_array_append(&pi->argv, NULL);
@@ -559,6 +692,7 @@ __ni_process_run(ni_process_t *pi, int *pfd)
 		}
 	}
 
+	ni_metrics_inc(NI_METRIC_PROCESSES_SPAWNED);
 	return NI_PROCESS_SUCCESS;
 }
 
@@ -666,7 +800,20 @@ __ni_process_get_output(ni_process_t *pi, int fd)
 ni_bool_t
 ni_process_running(const ni_process_t *pi)
 {
-	return pi && pi->pid > 0 && pi->status == -1;
+	return pi && (pi->pid > 0 || pi->coproc.owner) && pi->status == -1;
+}
+
+/*
+ * The captured stdout and stderr of the process or co-process call
+ */
+const ni_buffer_t *
+ni_process_output(const ni_process_t *pi)
+{
+	if (!pi)
+		return NULL;
+	if (pi->coproc.owner)
+		return &pi->coproc.output;
+	return pi->socket ? &pi->socket->rbuf : NULL;
 }
 
 ni_bool_t
@@ -727,3 +874,630 @@ ni_process_stop_signal(const ni_process_t *pi)
 	return ni_process_stopped(pi) ? WSTOPSIG(pi->status) : NI_PROCESS_FAILURE;
 }
 
+
+/*
+ * Co-processes
+ *
+ * A co-process is a command started once, serving the runs of the
+ * extension actions as calls on its stdin and stdout, one call at a
+ * time per instance. Each string of a call is sent as its decimal
+ * length on a line, followed by the bytes and a newline:
+ *
+ *   request:  "CALL <id> <argc> <envc>\n", the argc arguments and
+ *             the envc "NAME=value" environment entries
+ *   response: "DONE <id> <exit status> <length>\n", the length bytes
+ *             of the stdout and stderr output of the call and "\n"
+ *
+ * A call not answered within the timeout kills the instance, a dead
+ * instance is restarted by the next call. When the co-process fails
+ * too often, the runs fall back to subprocesses for a while.
+ *
+ * The instances of a co-process with reentrant scripts are started
+ * with WICKED_COPROCESS_REENTRANT=true in the environment, so they
+ * may run the calls without a fork per call.
+ */
+#define NI_COPROCESS_HEADER_MAX		64
+#define NI_COPROCESS_OUTPUT_MAX		(16 << 20)
+#define NI_COPROCESS_FAILURES_MAX	5
+#define NI_COPROCESS_FAILURE_WINDOW	60	/* sec */
+
+typedef struct ni_coprocess_worker	ni_coprocess_worker_t;
+
+struct ni_coprocess_worker {
+	ni_coprocess_worker_t *	next;
+	ni_coprocess_t *	owner;
+
+	ni_process_t *		process;
+	ni_socket_t *		sock;
+
+	ni_bool_t		busy;
+	ni_bool_t		dead;
+	unsigned int		id;
+	ni_process_t *		call;
+	const ni_timer_t *	timer;
+};
+
+struct ni_coprocess {
+	unsigned int		refcount;
+
+	ni_shellcmd_t *		command;
+	unsigned int		instances;
+	unsigned int		timeout;
+	ni_bool_t		reentrant;
+
+	unsigned int		count;
+	ni_coprocess_worker_t *	workers;
+	ni_process_t *		queue;
+	unsigned int		serial;
+
+	unsigned int		failures;
+	struct timeval		failed;
+	struct timeval		disabled;
+};
+
+static void			ni_coprocess_worker_recv(ni_socket_t *);
+static void			ni_coprocess_worker_hangup(ni_socket_t *);
+static void			ni_coprocess_worker_transmit(ni_socket_t *);
+static void			ni_coprocess_worker_failed(ni_coprocess_worker_t *);
+static void			ni_coprocess_dispatch(ni_coprocess_t *);
+
+ni_coprocess_t *
+ni_coprocess_new(const char *command, unsigned int instances, unsigned int timeout,
+			ni_bool_t reentrant)
+{
+	ni_coprocess_t *co;
+	ni_shellcmd_t *cmd;
+
+	if (!(cmd = ni_shellcmd_parse(command)))
+		return NULL;
+
+	co = xcalloc(1, sizeof(*co));
+	co->refcount = 1;
+	co->command = cmd;
+	co->timeout = timeout;
+	co->reentrant = reentrant;
+	if (!instances)
+		co->instances = NI_COPROCESS_INSTANCES_DEFAULT;
+	else
+		co->instances = min_t(unsigned int, instances, NI_COPROCESS_INSTANCES_MAX);
+	return co;
+}
+
+ni_coprocess_t *
+ni_coprocess_hold(ni_coprocess_t *co)
+{
+	if (co) {
+		ni_assert(co->refcount);
+		co->refcount++;
+	}
+	return co;
+}
+
+static void
+ni_coprocess_worker_free(ni_coprocess_worker_t *w)
+{
+	if (w->timer)
+		ni_timer_cancel(w->timer);
+	if (w->sock) {
+		w->sock->user_data = NULL;
+		ni_socket_close(w->sock);
+	}
+	if (w->process)
+		ni_process_free(w->process);
+	free(w);
+}
+
+void
+ni_coprocess_free(ni_coprocess_t *co)
+{
+	ni_coprocess_worker_t *w;
+
+	if (!co)
+		return;
+
+	ni_assert(co->refcount);
+	if (--co->refcount)
+		return;
+
+	/* every queued call holds a reference */
+	ni_assert(co->queue == NULL);
+	while ((w = co->workers)) {
+		co->workers = w->next;
+		ni_coprocess_worker_free(w);
+	}
+	ni_shellcmd_release(co->command);
+	free(co);
+}
+
+/*
+ * Count an instance failure; disable the co-process for a while
+ * when it fails too often.
+ */
+static void
+ni_coprocess_failure(ni_coprocess_t *co)
+{
+	struct timeval now;
+
+	ni_timer_get_time(&now);
+	if (!co->failures || now.tv_sec - co->failed.tv_sec > NI_COPROCESS_FAILURE_WINDOW) {
+		co->failures = 0;
+		co->failed = now;
+	}
+	if (++co->failures < NI_COPROCESS_FAILURES_MAX)
+		return;
+
+	ni_warn("%s: co-process failed %u times, using subprocesses for %u sec",
+			co->command->command, co->failures, NI_COPROCESS_FAILURE_WINDOW);
+	co->failures = 0;
+	co->disabled = now;
+	co->disabled.tv_sec += NI_COPROCESS_FAILURE_WINDOW;
+}
+
+static ni_coprocess_worker_t *
+ni_coprocess_worker_start(ni_coprocess_t *co)
+{
+	ni_coprocess_worker_t *w;
+	ni_process_t *pi;
+	int sv[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+		ni_error("%s: unable to create co-process socket: %m", co->command->command);
+		return NULL;
+	}
+
+	pi = ni_process_new(co->command);
+	if (co->reentrant)
+		ni_process_setenv(pi, "WICKED_COPROCESS_REENTRANT", "true");
+	if (__ni_process_start(pi, sv[1], sv[1], -1) < 0) {
+		ni_process_free(pi);
+		close(sv[0]);
+		close(sv[1]);
+		return NULL;
+	}
+	close(sv[1]);
+
+	w = xcalloc(1, sizeof(*w));
+	w->owner = co;
+	w->process = pi;
+	w->sock = ni_socket_wrap(sv[0], SOCK_STREAM);
+	w->sock->receive = ni_coprocess_worker_recv;
+	w->sock->transmit = ni_coprocess_worker_transmit;
+	w->sock->handle_hangup = ni_coprocess_worker_hangup;
+	w->sock->user_data = w;
+	ni_socket_activate(w->sock);
+
+	w->next = co->workers;
+	co->workers = w;
+	co->count++;
+
+	ni_debug_extension("%s: started co-process instance %d",
+			co->command->command, pi->pid);
+	return w;
+}
+
+static void
+ni_coprocess_worker_unlink(ni_coprocess_worker_t *w)
+{
+	ni_coprocess_t *co = w->owner;
+	ni_coprocess_worker_t **pos;
+
+	for (pos = &co->workers; *pos; pos = &(*pos)->next) {
+		if (*pos == w) {
+			*pos = w->next;
+			co->count--;
+			break;
+		}
+	}
+}
+
+/*
+ * An idle instance, a new one when below the limit, or NULL
+ */
+static ni_coprocess_worker_t *
+ni_coprocess_worker_get(ni_coprocess_t *co)
+{
+	ni_coprocess_worker_t *w;
+
+	for (w = co->workers; w; w = w->next) {
+		if (!w->busy && !w->dead)
+			return w;
+	}
+	if (co->count < co->instances)
+		return ni_coprocess_worker_start(co);
+	return NULL;
+}
+
+static void
+ni_coprocess_put_string(ni_stringbuf_t *buf, const char *str)
+{
+	str = str ? str : "";
+	ni_stringbuf_printf(buf, "%zu\n", strlen(str));
+	ni_stringbuf_puts(buf, str);
+	ni_stringbuf_putc(buf, '\n');
+}
+
+static int
+ni_coprocess_worker_send(ni_coprocess_worker_t *w, const ni_process_t *pi)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned int i;
+	ssize_t cnt;
+	size_t off;
+
+	ni_stringbuf_printf(&buf, "CALL %u %u %u\n", w->id,
+			pi->argv.count, pi->environ.count);
+	for (i = 0; i < pi->argv.count; ++i)
+		ni_coprocess_put_string(&buf, pi->argv.data[i]);
+	for (i = 0; i < pi->environ.count; ++i)
+		ni_coprocess_put_string(&buf, pi->environ.data[i]);
+
+	/* what the instance does not take at once is sent when it can */
+	for (off = 0; off < buf.len; off += cnt) {
+		cnt = send(w->sock->__fd, buf.string + off, buf.len - off,
+				MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (cnt < 0 && errno == EINTR) {
+			cnt = 0;
+			continue;
+		}
+		if (cnt < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			ni_buffer_ensure_tailroom(&w->sock->wbuf, buf.len - off);
+			ni_buffer_put(&w->sock->wbuf, buf.string + off, buf.len - off);
+			w->sock->poll_flags |= POLLOUT;
+			break;
+		}
+		if (cnt <= 0) {
+			ni_error("%s: unable to send call to co-process instance %d: %m",
+					w->owner->command->command, w->process->pid);
+			ni_stringbuf_destroy(&buf);
+			return -1;
+		}
+	}
+	ni_stringbuf_destroy(&buf);
+	return 0;
+}
+
+static void
+ni_coprocess_worker_transmit(ni_socket_t *sock)
+{
+	ni_coprocess_worker_t *w = sock->user_data;
+	ni_buffer_t *wbuf = &sock->wbuf;
+	ssize_t cnt;
+
+	if (!w || w->dead)
+		return;
+
+	cnt = send(sock->__fd, ni_buffer_head(wbuf), ni_buffer_count(wbuf),
+			MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (cnt < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return;
+		ni_error("%s: unable to send call to co-process instance %d: %m",
+				w->owner->command->command, w->process->pid);
+		ni_coprocess_worker_failed(w);
+		return;
+	}
+
+	ni_buffer_pull_head(wbuf, cnt);
+	if (!ni_buffer_count(wbuf)) {
+		ni_buffer_clear(wbuf);
+		sock->poll_flags &= ~POLLOUT;
+	}
+}
+
+/*
+ * Complete a call the way the hangup of a subprocess does
+ */
+static void
+ni_coprocess_complete(ni_process_t *pi, int status)
+{
+	pi->status = status;
+
+	if (pi->notify_callback)
+		pi->notify_callback(pi);
+
+	if (ni_process_exited(pi))
+		ni_debug_extension("co-process call (%s) exited with status %d",
+				pi->process->command, ni_process_exit_status(pi));
+	else
+		ni_debug_extension("co-process call (%s) died with signal %d",
+				pi->process->command, ni_process_term_signal(pi));
+
+	ni_process_free(pi);
+}
+
+static void
+ni_coprocess_worker_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_coprocess_worker_t *w = user_data;
+	ni_coprocess_t *co = w->owner;
+
+	if (w->timer != timer)
+		return;
+	w->timer = NULL;
+
+	ni_error("%s: call %u timed out after %u msec, killing co-process instance %d",
+			co->command->command, w->id, co->timeout, w->process->pid);
+	kill(w->process->pid, SIGKILL);
+	ni_coprocess_worker_hangup(w->sock);
+}
+
+static int
+ni_coprocess_worker_dispatch(ni_coprocess_worker_t *w, ni_process_t *pi)
+{
+	ni_coprocess_t *co = w->owner;
+
+	w->id = ++co->serial;
+	if (ni_coprocess_worker_send(w, pi) < 0)
+		return -1;
+
+	w->busy = TRUE;
+	w->call = pi;
+	if (co->timeout)
+		w->timer = ni_timer_register(co->timeout, ni_coprocess_worker_timeout, w);
+	return 0;
+}
+
+/*
+ * Drop a dead or misbehaving instance, fail its call
+ */
+static void
+ni_coprocess_worker_failed(ni_coprocess_worker_t *w)
+{
+	ni_coprocess_t *co = w->owner;
+	ni_process_t *wpi = w->process;
+	ni_process_t *pi = w->call;
+	int status;
+
+	ni_coprocess_worker_unlink(w);
+	w->call = NULL;
+
+	if (ni_process_running(wpi)) {
+		kill(wpi->pid, SIGKILL);
+		if (waitpid(wpi->pid, &wpi->status, 0) < 0)
+			ni_error("Cannot retrieve status for co-process %d (%s): %m",
+					wpi->pid, wpi->process->command);
+	}
+	if (ni_process_signaled(wpi) != NI_PROCESS_FAILURE)
+		ni_error("%s: co-process instance %d died with signal %d",
+				co->command->command, wpi->pid, ni_process_term_signal(wpi));
+	else
+		ni_error("%s: co-process instance %d exited with status %d",
+				co->command->command, wpi->pid, ni_process_exit_status(wpi));
+
+	status = WIFSIGNALED(wpi->status) ? wpi->status : 127 << 8;
+	ni_coprocess_worker_free(w);
+	ni_coprocess_failure(co);
+
+	ni_coprocess_hold(co);
+	if (pi)
+		ni_coprocess_complete(pi, status);
+	ni_coprocess_dispatch(co);
+	ni_coprocess_free(co);
+}
+
+/*
+ * Parse a response in the receive buffer; returns -1 when the
+ * instance failed and has been dropped, 1 for a response and 0
+ * when more data is needed.
+ */
+static int
+ni_coprocess_worker_parse(ni_coprocess_worker_t *w)
+{
+	ni_coprocess_t *co = w->owner;
+	ni_buffer_t *rbuf = &w->sock->rbuf;
+	char header[NI_COPROCESS_HEADER_MAX + 1];
+	unsigned int id, status, len;
+	const char *head, *nl;
+	ni_process_t *pi;
+	size_t count;
+
+	head = ni_buffer_head(rbuf);
+	count = ni_buffer_count(rbuf);
+	if (!count)
+		return 0;
+
+	if (!(nl = memchr(head, '\n', min_t(size_t, count, NI_COPROCESS_HEADER_MAX)))) {
+		if (count < NI_COPROCESS_HEADER_MAX)
+			return 0;
+		goto failed;
+	}
+
+	memcpy(header, head, nl - head);
+	header[nl - head] = '\0';
+	if (sscanf(header, "DONE %u %u %u", &id, &status, &len) != 3 ||
+	    !w->busy || id != w->id || status > 255 || len > NI_COPROCESS_OUTPUT_MAX)
+		goto failed;
+
+	/* one call at a time, nothing may follow the response */
+	head = nl + 1;
+	count -= head - (const char *)ni_buffer_head(rbuf);
+	if (count < len + 1)
+		return 0;
+	if (count > len + 1 || head[len] != '\n')
+		goto failed;
+
+	pi = w->call;
+	if (pi) {
+		ni_buffer_init_dynamic(&pi->coproc.output, len + 1);
+		ni_buffer_put(&pi->coproc.output, head, len);
+	}
+	ni_buffer_clear(rbuf);
+
+	if (w->timer)
+		ni_timer_cancel(w->timer);
+	w->timer = NULL;
+	w->busy = FALSE;
+	w->call = NULL;
+	co->failures = 0;
+
+	/* the instance may be reused by the callback */
+	ni_coprocess_hold(co);
+	if (pi)
+		ni_coprocess_complete(pi, status << 8);
+	ni_coprocess_dispatch(co);
+	ni_coprocess_free(co);
+	return 1;
+
+failed:
+	ni_error("%s: protocol error on co-process instance %d",
+			co->command->command, w->process->pid);
+	ni_coprocess_worker_failed(w);
+	return -1;
+}
+
+static void
+ni_coprocess_worker_recv(ni_socket_t *sock)
+{
+	ni_coprocess_worker_t *w = sock->user_data;
+	ni_buffer_t *rbuf = &sock->rbuf;
+	int cnt;
+
+	if (!w || w->dead)
+		return;
+
+	if (ni_buffer_tailroom(rbuf) < 256)
+		ni_buffer_ensure_tailroom(rbuf, 4096);
+
+	cnt = recv(sock->__fd, ni_buffer_tail(rbuf), ni_buffer_tailroom(rbuf), MSG_DONTWAIT);
+	if (cnt > 0) {
+		rbuf->tail += cnt;
+		ni_coprocess_worker_parse(w);
+	} else if (cnt == 0) {
+		ni_coprocess_worker_hangup(sock);
+	} else if (errno != EWOULDBLOCK && errno != EINTR) {
+		ni_error("read error on co-process socket: %m");
+		ni_coprocess_worker_failed(w);
+	}
+}
+
+static void
+ni_coprocess_worker_hangup(ni_socket_t *sock)
+{
+	ni_coprocess_worker_t *w = sock->user_data;
+	ni_buffer_t *rbuf = &sock->rbuf;
+	ni_coprocess_t *co;
+	int cnt;
+
+	if (!w || w->dead)
+		return;
+
+	/* a response sent before the exit still completes the call */
+	w->dead = TRUE;
+	do {
+		if (ni_buffer_tailroom(rbuf) < 256)
+			ni_buffer_ensure_tailroom(rbuf, 4096);
+		cnt = recv(sock->__fd, ni_buffer_tail(rbuf), ni_buffer_tailroom(rbuf), MSG_DONTWAIT);
+		if (cnt > 0)
+			rbuf->tail += cnt;
+	} while (cnt > 0);
+
+	co = ni_coprocess_hold(w->owner);
+	if (!w->busy || ni_coprocess_worker_parse(w) >= 0)
+		ni_coprocess_worker_failed(w);
+	ni_coprocess_free(co);
+}
+
+/*
+ * Pass queued calls to idle instances
+ */
+static void
+ni_coprocess_dispatch(ni_coprocess_t *co)
+{
+	ni_coprocess_worker_t *w;
+	ni_process_t *pi;
+
+	ni_coprocess_hold(co);
+	while ((pi = co->queue)) {
+		if (!(w = ni_coprocess_worker_get(co)) && co->count)
+			break;
+
+		co->queue = pi->coproc.next;
+		pi->coproc.next = NULL;
+
+		if (!w) {
+			ni_coprocess_failure(co);
+			ni_coprocess_complete(pi, 127 << 8);
+		} else
+		if (ni_coprocess_worker_dispatch(w, pi) < 0) {
+			ni_coprocess_worker_unlink(w);
+			ni_coprocess_worker_free(w);
+			ni_coprocess_failure(co);
+			ni_coprocess_complete(pi, 127 << 8);
+		}
+	}
+	ni_coprocess_free(co);
+}
+
+/*
+ * Pass the run of a process to the co-process. Returns an error
+ * when the co-process is unavailable and the caller has to run a
+ * subprocess instead; the call completes with the notify callback
+ * and frees the process as the hangup of a subprocess does.
+ */
+int
+ni_coprocess_call(ni_coprocess_t *co, ni_process_t *pi)
+{
+	ni_coprocess_worker_t *w = NULL;
+	ni_process_t **pos;
+	struct timeval now;
+
+	if (!co || !pi || pi->pid || pi->coproc.owner)
+		return NI_PROCESS_FAILURE;
+
+	ni_timer_get_time(&now);
+	if (timerisset(&co->disabled)) {
+		if (timercmp(&now, &co->disabled, <))
+			return NI_PROCESS_FAILURE;
+		timerclear(&co->disabled);
+	}
+
+	if (!co->queue && !(w = ni_coprocess_worker_get(co)) && co->count < co->instances) {
+		ni_coprocess_failure(co);
+		return NI_PROCESS_FAILURE;
+	}
+
+	if (w && ni_coprocess_worker_dispatch(w, pi) < 0) {
+		ni_coprocess_worker_unlink(w);
+		ni_coprocess_worker_free(w);
+		ni_coprocess_failure(co);
+		return NI_PROCESS_FAILURE;
+	}
+
+	pi->coproc.owner = ni_coprocess_hold(co);
+	pi->status = -1;
+	pi->started = now;
+
+	if (!w) {
+		for (pos = &co->queue; *pos; pos = &(*pos)->coproc.next)
+			;
+		*pos = pi;
+	}
+	return NI_PROCESS_SUCCESS;
+}
+
+/*
+ * Forget a call on the free of its process; the response of an
+ * instance still working on it is discarded.
+ */
+static void
+ni_coprocess_cancel(ni_process_t *pi)
+{
+	ni_coprocess_t *co = pi->coproc.owner;
+	ni_coprocess_worker_t *w;
+	ni_process_t **pos;
+
+	for (pos = &co->queue; *pos; pos = &(*pos)->coproc.next) {
+		if (*pos == pi) {
+			*pos = pi->coproc.next;
+			break;
+		}
+	}
+	for (w = co->workers; w; w = w->next) {
+		if (w->call == pi)
+			w->call = NULL;
+	}
+
+	pi->coproc.next = NULL;
+	pi->coproc.owner = NULL;
+	ni_coprocess_free(co);
+}
@@ -10,6 +10,9 @@
 
 #include <wicked/logging.h>
 #include <wicked/util.h>
+#include "buffer.h"
+
+typedef struct ni_coprocess	ni_coprocess_t;
 
 struct ni_shellcmd {
 	unsigned int		refcount;
@@ -20,6 +23,9 @@ struct ni_shellcmd {
 	ni_string_array_t	environ;
 
 	unsigned int		timeout;
+
+	/* Long-lived process serving the runs of this command */
+	ni_coprocess_t *	coprocess;
 };
 
 struct ni_process {
@@ -38,6 +44,13 @@ struct ni_process {
 
 	void			(*notify_callback)(ni_process_t *);
 	void *			user_data;
+
+	/* Run passed as a call to the co-process of the command */
+	struct {
+		ni_coprocess_t *	owner;
+		ni_process_t *		next;
+		ni_buffer_t		output;
+	} coproc;
 };
 
 extern ni_shellcmd_t *		ni_shellcmd_new(const ni_string_array_t *args);
@@ -77,6 +90,22 @@ extern ni_tempstate_t *		ni_process_tempstate(ni_process_t *);
 extern void			ni_process_free(ni_process_t *);
 
 extern ni_bool_t		ni_process_running(const ni_process_t *);
+extern const ni_buffer_t *	ni_process_output(const ni_process_t *);
+
+/*
+ * Co-processes: a command started once, which serves the runs of
+ * the extension actions as calls (see ni_coprocess_call).
+ */
+#define NI_COPROCESS_INSTANCES_DEFAULT	1
+#define NI_COPROCESS_INSTANCES_MAX	64
+#define NI_COPROCESS_TIMEOUT_DEFAULT	60000	/* msec */
+
+extern ni_coprocess_t *		ni_coprocess_new(const char *command,
+						unsigned int instances, unsigned int timeout,
+						ni_bool_t reentrant);
+extern ni_coprocess_t *		ni_coprocess_hold(ni_coprocess_t *);
+extern void			ni_coprocess_free(ni_coprocess_t *);
+extern int			ni_coprocess_call(ni_coprocess_t *, ni_process_t *);
 
 extern ni_bool_t		ni_process_exited(const ni_process_t *);
 extern int			ni_process_exit_status(const ni_process_t *);
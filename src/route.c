@@ -62,6 +62,7 @@ static const ni_intmap_t	ni_route_type_names[] = {
 
 	{ NULL,			RTN_UNSPEC		},
 };
+static ni_intmap_index_t	ni_route_type_index = NI_INTMAP_INDEX_INIT(ni_route_type_names);
 
 /*
  * Names for route table
@@ -74,6 +75,7 @@ static const ni_intmap_t	ni_route_table_names[] = {
 
 	{ NULL,			RT_TABLE_UNSPEC		},
 };
+static ni_intmap_index_t	ni_route_table_index = NI_INTMAP_INDEX_INIT(ni_route_table_names);
 
 /*
  * Names for route scope
@@ -88,6 +90,7 @@ static const ni_intmap_t	ni_route_scope_names[] = {
 
 	{ NULL,			RT_SCOPE_UNIVERSE	}
 };
+static ni_intmap_index_t	ni_route_scope_index = NI_INTMAP_INDEX_INIT(ni_route_scope_names);
 
 /*
  * Names for route protocol
@@ -110,6 +113,7 @@ static const ni_intmap_t	ni_route_protocol_names[] = {
 
 	{ NULL,			RTPROT_UNSPEC		}
 };
+static ni_intmap_index_t	ni_route_protocol_index = NI_INTMAP_INDEX_INIT(ni_route_protocol_names);
 
 /*
  * Names for bit numbers of route [next-hop] flags and lock bits.
@@ -159,7 +163,7 @@ ni_route_new(void)
 {
 	ni_route_t *rp;
 
-	rp = xcalloc(1, sizeof(ni_route_t));
+	rp = xcalloc_tagged(NI_MEMTAG_ROUTE, 1, sizeof(ni_route_t));
 	if (rp)
 		rp->users = 1;
 	return rp;
@@ -314,7 +318,7 @@ do_route_free(ni_route_t *rp)
 	ni_route_nexthop_list_destroy(&rp->nh.next);
 	ni_route_nexthop_destroy(&rp->nh);
 
-	free(rp);
+	xfree_tagged(NI_MEMTAG_ROUTE, rp);
 }
 
 void
@@ -963,7 +967,7 @@ ni_route_print(ni_stringbuf_t *out, const ni_route_t *rp)
 const char *
 ni_route_type_type_to_name(unsigned int type)
 {
-	return ni_format_uint_maybe_mapped(type, ni_route_type_names);
+	return ni_format_uint_maybe_indexed(type, &ni_route_type_index);
 }
 
 const char *
@@ -974,7 +978,7 @@ ni_route_table_type_to_name(unsigned int type, char **name)
 	if (!name)
 		return NULL;
 
-	if ((res = ni_format_uint_mapped(type, ni_route_table_names))) {
+	if ((res = ni_format_uint_indexed(type, &ni_route_table_index))) {
 		ni_string_dup(name, res);
 		return *name;
 	}
@@ -989,13 +993,13 @@ ni_route_table_type_to_name(unsigned int type, char **name)
 const char *
 ni_route_scope_type_to_name(unsigned int type)
 {
-	return ni_format_uint_maybe_mapped(type, ni_route_scope_names);
+	return ni_format_uint_maybe_indexed(type, &ni_route_scope_index);
 }
 
 const char *
 ni_route_protocol_type_to_name(unsigned int type)
 {
-	return ni_format_uint_maybe_mapped(type, ni_route_protocol_names);
+	return ni_format_uint_maybe_indexed(type, &ni_route_protocol_index);
 }
 
 const char *
@@ -1024,7 +1028,7 @@ ni_route_type_name_to_type(const char *name, unsigned int *type)
 	if (!type || !name)
 		return FALSE;
 
-	if (ni_parse_uint_maybe_mapped(name, ni_route_type_names, &value, 10) < 0)
+	if (ni_parse_uint_maybe_indexed(name, &ni_route_type_index, &value, 10) < 0)
 		return FALSE;
 
 	*type = value;
@@ -1040,7 +1044,7 @@ ni_route_table_name_to_type(const char *name, unsigned int *table)
 	if (!table || !name)
 		return FALSE;
 
-	if (ni_parse_uint_maybe_mapped(name, ni_route_table_names, &value, 10) != -1) {
+	if (ni_parse_uint_maybe_indexed(name, &ni_route_table_index, &value, 10) != -1) {
 		*table = value;
 		return TRUE;
 	}
@@ -1069,7 +1073,7 @@ ni_route_scope_name_to_type(const char *name, unsigned int *scope)
 	if (!scope || !name)
 		return FALSE;
 
-	if (ni_parse_uint_maybe_mapped(name, ni_route_scope_names, &value, 10) < 0)
+	if (ni_parse_uint_maybe_indexed(name, &ni_route_scope_index, &value, 10) < 0)
 		return FALSE;
 
 	*scope = value;
@@ -1084,7 +1088,7 @@ ni_route_protocol_name_to_type(const char *name, unsigned int *proto)
 	if (!proto || !name)
 		return FALSE;
 
-	if (ni_parse_uint_maybe_mapped(name, ni_route_protocol_names, &value, 10) < 0)
+	if (ni_parse_uint_maybe_indexed(name, &ni_route_protocol_index, &value, 10) < 0)
 		return FALSE;
 
 	*proto = value;
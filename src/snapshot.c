@@ -0,0 +1,378 @@
+/*
+ *	Warm-restart snapshot of the wickedd network interface list
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <net/if.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+#include <wicked/pci.h>
+
+#include "netinfo_priv.h"
+#include "appconfig.h"
+#include "util_priv.h"
+#include "snapshot.h"
+
+#define NI_NETCONFIG_SNAPSHOT_FILE	"netconfig.snapshot"
+#define NI_NETCONFIG_SNAPSHOT_MAGIC	"wicked-netconfig-snapshot"
+#define NI_NETCONFIG_SNAPSHOT_VERSION	1U
+#define NI_NETCONFIG_SNAPSHOT_BOOT_ID	"/proc/sys/kernel/random/boot_id"
+
+/*
+ * The snapshot loaded on start, sorted by the interface index.
+ * It is released once the background refresh of all deferred
+ * devices is done.
+ */
+static struct {
+	unsigned int			count;
+	unsigned int			deferred;
+	unsigned int			next;
+	ni_netconfig_snapshot_dev_t *	devs;
+	const ni_timer_t *		timer;
+} ni_netconfig_snapshot;
+
+static void	ni_netconfig_snapshot_timeout(void *, const ni_timer_t *);
+
+static ni_bool_t
+ni_netconfig_snapshot_boot_id(char *buf, size_t size)
+{
+	FILE *fp;
+	ni_bool_t ret;
+
+	if (!(fp = fopen(NI_NETCONFIG_SNAPSHOT_BOOT_ID, "re")))
+		return FALSE;
+
+	ret = fgets(buf, size, fp) != NULL;
+	fclose(fp);
+	if (ret)
+		buf[strcspn(buf, " \t\r\n")] = '\0';
+	return ret && *buf;
+}
+
+static char *
+ni_netconfig_snapshot_path(void)
+{
+	char *path = NULL;
+
+	ni_string_printf(&path, "%s/%s", ni_config_statedir(), NI_NETCONFIG_SNAPSHOT_FILE);
+	return path;
+}
+
+/*
+ * Write the snapshot on a clean shutdown. It records the identity
+ * of each device, its index, name and link address, and the result
+ * of its sysfs discovery.
+ */
+int
+ni_netconfig_snapshot_save(ni_netconfig_t *nc)
+{
+	const ni_config_warm_restart_t *conf = ni_config_warm_restart();
+	char boot_id[64], hwaddr[NI_MAXHWADDRLEN * 3 + 1];
+	char *path, *temp = NULL;
+	ni_netdev_t *dev;
+	FILE *fp = NULL;
+	int fd, ret = -1;
+
+	if (!conf || !conf->enabled)
+		return 0;
+
+	if (!nc || !ni_netconfig_snapshot_boot_id(boot_id, sizeof(boot_id)))
+		return -1;
+
+	path = ni_netconfig_snapshot_path();
+	ni_string_printf(&temp, "%s.XXXXXX", path);
+	if ((fd = mkostemp(temp, O_CLOEXEC)) < 0 || !(fp = fdopen(fd, "w"))) {
+		ni_error("Unable to create netconfig snapshot %s: %m", temp);
+		if (fd >= 0) {
+			close(fd);
+			unlink(temp);
+		}
+		goto done;
+	}
+
+	fprintf(fp, "%s %u %s\n", NI_NETCONFIG_SNAPSHOT_MAGIC,
+			NI_NETCONFIG_SNAPSHOT_VERSION, boot_id);
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		const ni_pci_dev_t *pci = dev->pci_dev;
+
+		if (!dev->link.ifindex || ni_string_empty(dev->name))
+			continue;
+
+		if (!dev->link.hwaddr.len ||
+		    !ni_format_hex(dev->link.hwaddr.data, dev->link.hwaddr.len,
+				    hwaddr, sizeof(hwaddr)))
+			strcpy(hwaddr, "-");
+
+		fprintf(fp, "%u %s %u %s %s %x %x\n", dev->link.ifindex, dev->name,
+				dev->link.hwaddr.type, hwaddr,
+				pci && !ni_string_empty(pci->path) ? pci->path : "-",
+				pci ? pci->vendor : 0, pci ? pci->device : 0);
+	}
+
+	if (fflush(fp) == EOF || ferror(fp)) {
+		ni_error("Unable to write netconfig snapshot %s: %m", temp);
+		fclose(fp);
+		unlink(temp);
+		goto done;
+	}
+	fclose(fp);
+
+	if (rename(temp, path) < 0) {
+		ni_error("Unable to rename %s to %s: %m", temp, path);
+		unlink(temp);
+		goto done;
+	}
+	ni_debug_ifconfig("Wrote netconfig snapshot %s", path);
+	ret = 0;
+
+done:
+	ni_string_free(&temp);
+	ni_string_free(&path);
+	return ret;
+}
+
+static int
+ni_netconfig_snapshot_dev_cmp(const void *a, const void *b)
+{
+	const ni_netconfig_snapshot_dev_t *d1 = a, *d2 = b;
+
+	return d1->ifindex < d2->ifindex ? -1 : d1->ifindex > d2->ifindex;
+}
+
+static ni_bool_t
+ni_netconfig_snapshot_parse_dev(ni_netconfig_snapshot_dev_t *sd, const char *line)
+{
+	char ifname[IFNAMSIZ * 2], hwaddr[NI_MAXHWADDRLEN * 3 + 1], pci_path[PATH_MAX];
+	unsigned int ifindex, type, vendor, device;
+	int len = 0;
+
+	if (sscanf(line, "%u %31s %u %192s %4095s %x %x", &ifindex, ifname, &type,
+				hwaddr, pci_path, &vendor, &device) != 7)
+		return FALSE;
+	if (!ifindex || strlen(ifname) >= IFNAMSIZ)
+		return FALSE;
+
+	memset(sd, 0, sizeof(*sd));
+	ni_link_address_init(&sd->hwaddr);
+	if (strcmp(hwaddr, "-") &&
+	    (len = ni_parse_hex(hwaddr, sd->hwaddr.data, sizeof(sd->hwaddr.data))) <= 0)
+		return FALSE;
+
+	sd->ifindex = ifindex;
+	sd->hwaddr.type = type;
+	sd->hwaddr.len = len;
+	ni_string_dup(&sd->ifname, ifname);
+	if (strcmp(pci_path, "-")) {
+		sd->pci_dev = ni_pci_dev_new(pci_path);
+		sd->pci_dev->vendor = vendor;
+		sd->pci_dev->device = device;
+	}
+	sd->deferred = TRUE;
+	return TRUE;
+}
+
+/*
+ * Load the snapshot before the initial refresh. The snapshot is
+ * removed, so it is not applied again after an unclean shutdown,
+ * and it is ignored after a reboot or a format change.
+ */
+ni_bool_t
+ni_netconfig_snapshot_load(void)
+{
+	const ni_config_warm_restart_t *conf = ni_config_warm_restart();
+	char boot_id[64], line[PATH_MAX + 128], magic[32], sboot_id[64];
+	ni_netconfig_snapshot_dev_t *sd;
+	unsigned int version, size = 0;
+	char *path;
+	FILE *fp;
+
+	ni_netconfig_snapshot_destroy();
+	if (!conf || !conf->enabled)
+		return FALSE;
+
+	path = ni_netconfig_snapshot_path();
+	if (!(fp = fopen(path, "re"))) {
+		if (errno != ENOENT)
+			ni_warn("Unable to open netconfig snapshot %s: %m", path);
+		ni_string_free(&path);
+		return FALSE;
+	}
+	unlink(path);
+
+	if (!fgets(line, sizeof(line), fp) ||
+	    sscanf(line, "%31s %u %63s", magic, &version, sboot_id) != 3 ||
+	    strcmp(magic, NI_NETCONFIG_SNAPSHOT_MAGIC) ||
+	    version != NI_NETCONFIG_SNAPSHOT_VERSION) {
+		ni_warn("Ignoring netconfig snapshot %s with unsupported format", path);
+		goto failed;
+	}
+	if (!ni_netconfig_snapshot_boot_id(boot_id, sizeof(boot_id)) ||
+	    strcmp(boot_id, sboot_id)) {
+		ni_debug_ifconfig("Ignoring netconfig snapshot %s of another boot", path);
+		goto failed;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (ni_netconfig_snapshot.count == size) {
+			size = size ? size * 2 : 64;
+			ni_netconfig_snapshot.devs = xrealloc(ni_netconfig_snapshot.devs,
+							size * sizeof(*sd));
+		}
+		sd = &ni_netconfig_snapshot.devs[ni_netconfig_snapshot.count];
+		if (!ni_netconfig_snapshot_parse_dev(sd, line)) {
+			ni_warn("Ignoring corrupt netconfig snapshot %s", path);
+			goto failed;
+		}
+		ni_netconfig_snapshot.count++;
+	}
+	fclose(fp);
+
+	qsort(ni_netconfig_snapshot.devs, ni_netconfig_snapshot.count,
+			sizeof(*sd), ni_netconfig_snapshot_dev_cmp);
+	ni_netconfig_snapshot.deferred = ni_netconfig_snapshot.count;
+	if (ni_netconfig_snapshot.deferred) {
+		ni_netconfig_snapshot.timer = ni_timer_register(conf->refresh_interval,
+						ni_netconfig_snapshot_timeout, NULL);
+	}
+
+	ni_debug_ifconfig("Loaded netconfig snapshot %s with %u devices",
+			path, ni_netconfig_snapshot.count);
+	ni_string_free(&path);
+	return ni_netconfig_snapshot.deferred > 0;
+
+failed:
+	fclose(fp);
+	ni_string_free(&path);
+	ni_netconfig_snapshot_destroy();
+	return FALSE;
+}
+
+ni_bool_t
+ni_netconfig_snapshot_active(void)
+{
+	return ni_netconfig_snapshot.deferred > 0;
+}
+
+/*
+ * Reconcile a device found in a link dump with the snapshot: return
+ * the snapshot of the device when it is unchanged and its discovery
+ * is still deferred. A changed device is discovered immediately.
+ */
+const ni_netconfig_snapshot_dev_t *
+ni_netconfig_snapshot_find(unsigned int ifindex, const char *ifname, const ni_hwaddr_t *hwaddr)
+{
+	ni_netconfig_snapshot_dev_t key, *sd;
+
+	if (!ni_netconfig_snapshot.deferred)
+		return NULL;
+
+	key.ifindex = ifindex;
+	sd = bsearch(&key, ni_netconfig_snapshot.devs, ni_netconfig_snapshot.count,
+			sizeof(key), ni_netconfig_snapshot_dev_cmp);
+	if (!sd || !sd->deferred)
+		return NULL;
+
+	if (!ni_string_eq(sd->ifname, ifname) || !hwaddr ||
+	    !ni_link_address_equal(&sd->hwaddr, hwaddr)) {
+		ni_debug_ifconfig("%s[%u]: device changed since the netconfig snapshot",
+				ifname, ifindex);
+		sd->deferred = FALSE;
+		ni_netconfig_snapshot.deferred--;
+		return NULL;
+	}
+	return sd;
+}
+
+/*
+ * Run the deferred discovery of up to max devices, returning the
+ * number of devices still deferred.
+ */
+unsigned int
+ni_netconfig_snapshot_refresh(ni_netconfig_t *nc, unsigned int max)
+{
+	ni_netconfig_snapshot_dev_t *sd;
+	ni_netdev_t *dev;
+	unsigned int done = 0;
+
+	while (ni_netconfig_snapshot.deferred && done < max &&
+	       ni_netconfig_snapshot.next < ni_netconfig_snapshot.count) {
+		sd = &ni_netconfig_snapshot.devs[ni_netconfig_snapshot.next++];
+		if (!sd->deferred)
+			continue;
+
+		sd->deferred = FALSE;
+		ni_netconfig_snapshot.deferred--;
+
+		dev = ni_netdev_by_index(nc, sd->ifindex);
+		if (dev && ni_string_eq(dev->name, sd->ifname)) {
+			__ni_system_refresh_link_extern(nc, dev);
+			done++;
+		}
+	}
+	return ni_netconfig_snapshot.deferred;
+}
+
+static void
+ni_netconfig_snapshot_timeout(void *user_data, const ni_timer_t *timer)
+{
+	const ni_config_warm_restart_t *conf = ni_config_warm_restart();
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+
+	if (ni_netconfig_snapshot.timer != timer)
+		return;
+
+	ni_netconfig_snapshot.timer = NULL;
+	if (nc && conf && ni_netconfig_snapshot_refresh(nc, conf->refresh_batch)) {
+		ni_netconfig_snapshot.timer = ni_timer_register(conf->refresh_interval,
+						ni_netconfig_snapshot_timeout, NULL);
+		return;
+	}
+
+	ni_debug_ifconfig("Deferred discovery of the netconfig snapshot devices done");
+	ni_netconfig_snapshot_destroy();
+}
+
+void
+ni_netconfig_snapshot_destroy(void)
+{
+	unsigned int i;
+
+	if (ni_netconfig_snapshot.timer)
+		ni_timer_cancel(ni_netconfig_snapshot.timer);
+
+	for (i = 0; i < ni_netconfig_snapshot.count; ++i) {
+		ni_string_free(&ni_netconfig_snapshot.devs[i].ifname);
+		if (ni_netconfig_snapshot.devs[i].pci_dev)
+			ni_pci_dev_free(ni_netconfig_snapshot.devs[i].pci_dev);
+	}
+	free(ni_netconfig_snapshot.devs);
+	memset(&ni_netconfig_snapshot, 0, sizeof(ni_netconfig_snapshot));
+}
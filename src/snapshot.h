@@ -0,0 +1,49 @@
+/*
+ *	Warm-restart snapshot of the wickedd network interface list
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifndef NI_SNAPSHOT_H
+#define NI_SNAPSHOT_H
+
+#include <wicked/types.h>
+#include <wicked/netinfo.h>
+
+/*
+ * A device as recorded on the clean shutdown of wickedd. When the
+ * device found on start still has the same index, name and link
+ * address, its sysfs discovery is taken from the snapshot and the
+ * discovery of the link details is deferred to a background refresh.
+ */
+typedef struct ni_netconfig_snapshot_dev {
+	unsigned int		ifindex;
+	char *			ifname;
+	ni_hwaddr_t		hwaddr;
+	ni_pci_dev_t *		pci_dev;
+	ni_bool_t		deferred;
+} ni_netconfig_snapshot_dev_t;
+
+extern int				ni_netconfig_snapshot_save(ni_netconfig_t *);
+extern ni_bool_t			ni_netconfig_snapshot_load(void);
+extern ni_bool_t			ni_netconfig_snapshot_active(void);
+extern const ni_netconfig_snapshot_dev_t *ni_netconfig_snapshot_find(unsigned int, const char *,
+						const ni_hwaddr_t *);
+extern unsigned int			ni_netconfig_snapshot_refresh(ni_netconfig_t *, unsigned int);
+extern void				ni_netconfig_snapshot_destroy(void);
+
+#endif /* NI_SNAPSHOT_H */
@@ -27,6 +27,7 @@
 #include "netinfo_priv.h"
 #include "socket_priv.h"
 #include "appconfig.h"
+#include "metrics.h"
 
 #define	NI_SOCKET_ARRAY_CHUNK	16
 
@@ -119,6 +120,7 @@ ni_socket_array_wait(ni_socket_array_t *array, long timeout)
 	struct pollfd pfd[array->count];
 	struct timeval now, expires;
 	unsigned int i, socket_count;
+	double dispatch;
 
 	/* First step - cleanup empty socket slots from the array. */
 	ni_socket_array_cleanup(array);
@@ -171,6 +173,8 @@ ni_socket_array_wait(ni_socket_array_t *array, long timeout)
 		return -1;
 	}
 
+	ni_metrics_inc(NI_METRIC_EVENT_LOOP_ITERATIONS);
+	dispatch = ni_metrics_time();
 	for (i = 0; i < socket_count; ++i) {
 		ni_socket_t *sock = array->data[i];
 
@@ -183,6 +187,7 @@ ni_socket_array_wait(ni_socket_array_t *array, long timeout)
 		ni_socket_hold(sock);
 
 		if (pfd[i].revents & POLLERR) {
+			ni_metrics_inc(NI_METRIC_SOCKET_ERROR);
 			/* Deactivate socket */
 			__ni_socket_deactivate(&array->data[i]);
 			sock->handle_error(sock);
@@ -190,6 +195,7 @@ ni_socket_array_wait(ni_socket_array_t *array, long timeout)
 		}
 
 		if (pfd[i].revents & POLLIN) {
+			ni_metrics_inc(NI_METRIC_SOCKET_RECEIVE);
 			if (sock->receive == NULL) {
 				ni_error("socket %d has no receive callback", sock->__fd);
 				__ni_socket_deactivate(&array->data[i]);
@@ -201,6 +207,7 @@ ni_socket_array_wait(ni_socket_array_t *array, long timeout)
 		}
 
 		if (pfd[i].revents & POLLHUP) {
+			ni_metrics_inc(NI_METRIC_SOCKET_HANGUP);
 			if (sock->handle_hangup)
 				sock->handle_hangup(sock);
 			if (sock->__fd < 0)
@@ -208,6 +215,7 @@ ni_socket_array_wait(ni_socket_array_t *array, long timeout)
 		} else
 
 		if (pfd[i].revents & POLLOUT) {
+			ni_metrics_inc(NI_METRIC_SOCKET_TRANSMIT);
 			if (sock->transmit == NULL) {
 				ni_error("socket %d has no transmit callback", sock->__fd);
 				__ni_socket_deactivate(&array->data[i]);
@@ -219,6 +227,7 @@ ni_socket_array_wait(ni_socket_array_t *array, long timeout)
 done_with_this_socket:
 		ni_socket_release(sock);
 	}
+	ni_metrics_observe_since(NI_METRIC_EVENT_LOOP_DISPATCH, dispatch);
 
 	gettimeofday(&now, NULL);
 	for (i = 0; i < array->count && i < socket_count; ++i) {
@@ -1020,10 +1020,15 @@ ni_teamd_discover_ports(ni_team_t *team, ni_json_t *conf)
 int
 ni_teamd_discover(ni_netdev_t *dev)
 {
+	static const char * const paths[] = {
+		"/runner", "/link_watch", "/ports"
+	};
+	ni_json_t *values[sizeof(paths)/sizeof(paths[0])];
 	ni_teamd_client_t *tdc = NULL;
 	ni_json_t *conf = NULL;
 	ni_team_t *team = NULL;
 	char *val = NULL;
+	unsigned int i;
 
 	if (!dev || dev->link.type != NI_IFTYPE_TEAM)
 		return -1;
@@ -1039,9 +1044,16 @@ ni_teamd_discover(ni_netdev_t *dev)
 	if (ni_teamd_ctl_config_dump(tdc, TRUE, &val) < 0)
 		goto failure;
 
-	if (!(conf = ni_json_parse_string(val)))
+	/* extract the members we're interested in only */
+	if (ni_json_parse_paths(val, sizeof(paths)/sizeof(paths[0]), paths, values) < 0)
 		goto failure;
 
+	conf = ni_json_new_object();
+	for (i = 0; i < sizeof(paths)/sizeof(paths[0]); ++i) {
+		if (values[i] && !ni_json_object_set(conf, paths[i] + 1, values[i]))
+			ni_json_free(values[i]);
+	}
+
 	if (ni_teamd_discover_runner(team, conf) < 0)
 		goto failure;
 
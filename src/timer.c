@@ -11,6 +11,7 @@
 #include <wicked/socket.h>
 #include "netinfo_priv.h"
 #include "util_priv.h"
+#include "metrics.h"
 
 struct ni_timer {
 	ni_timer_t *		next;
@@ -39,6 +40,8 @@ ni_timer_register(unsigned long timeout, ni_timeout_callback_t *callback, void *
 			"%s: new timer %p id %x, callback %p/%p",
 			__func__, timer, timer->ident, callback, data);
 	__ni_timer_arm(timer, timeout);
+	ni_metrics_inc(NI_METRIC_TIMERS_REGISTERED);
+	ni_metrics_add(NI_METRIC_TIMERS_ACTIVE, 1);
 
 	return timer;
 }
@@ -52,6 +55,8 @@ ni_timer_cancel(const ni_timer_t *handle)
 	if ((timer = __ni_timer_disarm(handle)) != NULL) {
 		user_data = timer->user_data;
 		free(timer);
+		ni_metrics_inc(NI_METRIC_TIMERS_CANCELLED);
+		ni_metrics_add(NI_METRIC_TIMERS_ACTIVE, -1);
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: released timer %p", __func__, timer);
 	} else {
@@ -98,6 +103,15 @@ ni_timer_next_timeout(void)
 				(long) now.tv_sec, (long) now.tv_usec,
 				(long) timer->expires.tv_sec, (long) timer->expires.tv_usec);
 		ni_timer_list = timer->next;
+		ni_metrics_inc(NI_METRIC_TIMERS_EXPIRED);
+		ni_metrics_add(NI_METRIC_TIMERS_ACTIVE, -1);
+		if (timercmp(&timer->expires, &now, <)) {
+			timersub(&now, &timer->expires, &delta);
+			ni_metrics_observe(NI_METRIC_TIMER_LATENESS,
+					delta.tv_sec + delta.tv_usec / 1000000.0);
+		} else {
+			ni_metrics_observe(NI_METRIC_TIMER_LATENESS, 0);
+		}
 		timer->callback(timer->user_data, timer);
 		free(timer);
 	}
@@ -8,6 +8,7 @@
 #endif
 
 #include <unistd.h>
+#include <sys/time.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
@@ -82,6 +83,7 @@ struct ni_updater_job {
 	const ni_addrconf_lease_t *	lease;
 
 	ni_updater_job_state_t		state;
+	struct timeval			created;
 
 	ni_updater_job_flow_t		flow;
 	unsigned int			kind;
@@ -101,6 +103,7 @@ struct ni_updater {
 	int				format;
 	ni_bool_t			enabled;
 	unsigned int			have_backup;
+	unsigned int			settle;
 
 	ni_shellcmd_t *			proc_backup;
 	ni_shellcmd_t *			proc_restore;
@@ -126,6 +129,7 @@ static const ni_intmap_t		ni_updater_kind_names[] = {
 };
 
 static ni_bool_t			ni_system_updater_generic_batch_test(ni_updater_t *);
+static inline ni_bool_t			can_update_type(const ni_addrconf_lease_t *, unsigned int);
 
 /*
  * Get the name of an updater
@@ -385,6 +389,7 @@ ni_updater_job_new(ni_updater_job_t **list, const ni_addrconf_lease_t *lease,
 
 	job->nr = job_nr++; /* for debugging purposes only */
 	job->refcount = 1;
+	ni_timer_get_time(&job->created);
 	if (!ni_netdev_ref_set(&job->device, ifname, ifindex)) {
 		free(job);
 		return NULL;
@@ -560,6 +565,52 @@ ni_updater_job_list_find_pending(ni_updater_job_t **list)
 	return NULL;
 }
 
+/*
+ * A later pending job for the same device and lease type/family, which
+ * runs the updater kind too, replaces what this job would apply.
+ */
+static ni_updater_job_t *
+ni_updater_job_list_find_superseding(const ni_updater_job_t *job, unsigned int kind)
+{
+	ni_updater_job_t *j;
+
+	for (j = job->next; j; j = j->next) {
+		if (j->state != NI_UPDATER_JOB_PENDING)
+			continue;
+		if (j->device.index != job->device.index ||
+		    j->lease->family != job->lease->family ||
+		    j->lease->type != job->lease->type)
+			continue;
+		if (ni_uint_array_index(&j->updater, kind) == -1U ||
+		    !can_update_type(j->lease, kind))
+			continue;
+		return j;
+	}
+	return NULL;
+}
+
+/*
+ * Remaining msec of the updater settle window of the job, which
+ * lets the jobs of a burst of lease events queue up and coalesce.
+ */
+static unsigned int
+ni_updater_job_settle_time(const ni_updater_t *updater, const ni_updater_job_t *job)
+{
+	struct timeval now, delta;
+	unsigned long age;
+
+	if (!updater->settle)
+		return 0;
+
+	ni_timer_get_time(&now);
+	if (!timercmp(&now, &job->created, >))
+		return updater->settle;
+
+	timersub(&now, &job->created, &delta);
+	age = delta.tv_sec * 1000 + delta.tv_usec / 1000;
+	return age < updater->settle ? updater->settle - age : 0;
+}
+
 /*
  * Initialize the system updaters based on the data found in the config
  * file.
@@ -589,6 +640,7 @@ ni_system_updaters_init(void)
 
 		updater->enabled = TRUE;
 		updater->format = ni_updater_format_type(ex->format);
+		updater->settle = ex->settle;
 		updater->proc_backup = ni_extension_script_find(ex, "backup");
 		updater->proc_restore = ni_extension_script_find(ex, "restore");
 		updater->proc_install = ni_extension_script_find(ex, "install");
@@ -669,6 +721,7 @@ static void
 ni_system_updater_notify(ni_process_t *pi)
 {
 	ni_updater_job_t *job = pi->user_data;
+	const ni_buffer_t *output;
 	const char *ptr;
 	size_t len;
 
@@ -688,8 +741,8 @@ ni_system_updater_notify(ni_process_t *pi)
 			ni_basename(pi->process->command), pi->pid, job->result);
 	switch (job->kind) {
 	case NI_ADDRCONF_UPDATER_HOSTNAME:
-		if (pi->socket && (len = ni_buffer_count(&pi->socket->rbuf))) {
-			ptr = ni_buffer_head(&pi->socket->rbuf);
+		if ((output = ni_process_output(pi)) && (len = ni_buffer_count(output))) {
+			ptr = ni_buffer_head(output);
 			if (ni_check_domain_name(ptr, len, 0))
 				ni_string_set(&job->hostname, ptr, len);
 		}
@@ -1139,10 +1192,12 @@ ni_system_updater_generic_batch_call(ni_updater_t *updater, ni_updater_job_t *jo
 	for (j = job->next; (j = ni_updater_job_list_find_pending(&j)); j = j->next) {
 		unsigned int pos;
 
-		if ((pos = ni_uint_array_index(&j->updater, j->kind)) == -1U)
+		if ((pos = ni_uint_array_index(&j->updater, updater->kind)) == -1U)
 			continue;
 
-		if (ni_system_updater_generic_batch_add(out, j, ident) < 0)
+		/* a later job of the batch updates the same lease source */
+		if (!ni_updater_job_list_find_superseding(j, updater->kind) &&
+		    ni_system_updater_generic_batch_add(out, j, ident) < 0)
 			break;
 
 		ni_uint_array_remove_at(&j->updater, pos);
@@ -1812,8 +1867,26 @@ ni_updater_job_execute(ni_updater_job_t *job)
 		updater = &updaters[job->kind];
 
 		if (updater && updater->enabled && can_update_type(job->lease, job->kind)) {
-			if (!job->actions)
+			if (!job->actions) {
+				ni_updater_job_t *next;
+				unsigned int delay;
+
+				if ((next = ni_updater_job_list_find_superseding(job, job->kind))) {
+					ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
+						"%s: %s updater for lease %s:%s coalesced into job[%lu]",
+						job->device.name, ni_updater_name(job->kind),
+						ni_addrfamily_type_to_name(job->lease->family),
+						ni_addrconf_type_to_name(job->lease->type),
+						next->nr);
+					ni_uint_array_remove(&job->updater, job->kind);
+					continue;
+				}
+				if ((delay = ni_updater_job_settle_time(updater, job))) {
+					ni_updater_job_set_timeout(job, delay);
+					return 1;
+				}
 				job->actions = system_updater_action_table(job->kind, job->flow);
+			}
 
 			ni_updater_job_set_timeout(job, 5 * 1000);
 			if (ni_updater_job_action_call(updater, job) > 0)
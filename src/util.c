@@ -20,6 +20,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <stdint.h>
+#include <malloc.h>
 
 #include <wicked/util.h>
 #include <wicked/logging.h>
@@ -1231,6 +1232,34 @@ ni_string_toupper(char *str)
 		str[i] = toupper(str[i]);
 }
 
+/*
+ * Cheap FNV-1a hash, continuing the hash of the preceding data or
+ * starting with NI_HASH_FNV1A_INIT; not cryptographically safe.
+ */
+uint32_t
+ni_hash_fnv1a(uint32_t hash, const void *data, size_t len)
+{
+	const unsigned char *ptr = data;
+
+	while (len--) {
+		hash ^= *ptr++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+/*
+ * String hash used by the hash indexes of lookup tables and caches
+ */
+unsigned int
+ni_string_hash(const char *str)
+{
+	if (!str)
+		return 0;
+
+	return ni_hash_fnv1a(NI_HASH_FNV1A_INIT, str, strlen(str));
+}
+
 char *
 ni_sprint_hex(const unsigned char *data, size_t len)
 {
@@ -1515,6 +1544,196 @@ ni_format_uint_maybe_mapped(unsigned int value, const ni_intmap_t *map)
 	return name;
 }
 
+/*
+ * Hash indexes over static ni_intmap_t arrays.
+ *
+ * Both tables use open addressing with linear probing and store the
+ * map position + 1. Entries sharing a key are inserted in map order,
+ * so they keep that order along their probe sequence and a lookup
+ * returns the same (first) entry as the linear scan above would.
+ * Maps with only a handful of entries are not worth an index and
+ * are scanned as before.
+ */
+#define NI_INTMAP_INDEX_MIN	8
+
+static unsigned int
+ni_intmap_name_hash(const char *name)
+{
+	unsigned int hash = NI_HASH_FNV1A_INIT;
+	unsigned char buf[64];
+	size_t len;
+
+	/* case-insensitive, like the strcasecmp in ni_parse_uint_mapped */
+	while (*name) {
+		for (len = 0; len < sizeof(buf) && *name; )
+			buf[len++] = tolower((unsigned char)*name++);
+		hash = ni_hash_fnv1a(hash, buf, len);
+	}
+	return hash;
+}
+
+static inline unsigned int
+ni_intmap_value_hash(unsigned int value)
+{
+	value ^= value >> 16;
+	value *= 0x45d9f3bU;
+	value ^= value >> 16;
+	return value;
+}
+
+static ni_bool_t
+ni_intmap_index_build(ni_intmap_index_t *index)
+{
+	const ni_intmap_t *map;
+	unsigned int count, size, pos, i;
+
+	if (index->size)
+		return index->names != NULL;
+
+	if (!index->map)
+		return FALSE;
+
+	for (count = 0, map = index->map; map->name; ++map)
+		count++;
+
+	if (count < NI_INTMAP_INDEX_MIN) {
+		/* remember that we've looked at it */
+		index->size = 1;
+		return FALSE;
+	}
+
+	for (size = 16; size < count * 2; size <<= 1)
+		;
+
+	index->names = xcalloc(size, sizeof(index->names[0]));
+	index->values = xcalloc(size, sizeof(index->values[0]));
+	for (pos = 0, map = index->map; pos < count; ++pos, ++map) {
+		i = ni_intmap_name_hash(map->name) & (size - 1);
+		while (index->names[i])
+			i = (i + 1) & (size - 1);
+		index->names[i] = pos + 1;
+
+		i = ni_intmap_value_hash(map->value) & (size - 1);
+		while (index->values[i])
+			i = (i + 1) & (size - 1);
+		index->values[i] = pos + 1;
+	}
+	index->size = size;
+	return TRUE;
+}
+
+static const ni_intmap_t *
+ni_intmap_index_find_name(const ni_intmap_index_t *index, const char *name,
+			int (*cmp)(const char *, const char *))
+{
+	const ni_intmap_t *map;
+	unsigned int i, pos;
+
+	i = ni_intmap_name_hash(name) & (index->size - 1);
+	while ((pos = index->names[i])) {
+		map = &index->map[pos - 1];
+		if (!cmp(map->name, name))
+			return map;
+		i = (i + 1) & (index->size - 1);
+	}
+	return NULL;
+}
+
+static const ni_intmap_t *
+ni_intmap_index_find_value(const ni_intmap_index_t *index, unsigned int value)
+{
+	const ni_intmap_t *map;
+	unsigned int i, pos;
+
+	i = ni_intmap_value_hash(value) & (index->size - 1);
+	while ((pos = index->values[i])) {
+		map = &index->map[pos - 1];
+		if (map->value == value)
+			return map;
+		i = (i + 1) & (index->size - 1);
+	}
+	return NULL;
+}
+
+int
+ni_parse_uint_indexed(const char *input, ni_intmap_index_t *index, unsigned int *result)
+{
+	const ni_intmap_t *map;
+
+	if (!index || !input || !result)
+		return -1;
+
+	if (!ni_intmap_index_build(index))
+		return ni_parse_uint_mapped(input, index->map, result);
+
+	if (!(map = ni_intmap_index_find_name(index, input, strcasecmp)))
+		return -1;
+
+	*result = map->value;
+	return 0;
+}
+
+const char *
+ni_format_uint_indexed(unsigned int value, ni_intmap_index_t *index)
+{
+	const ni_intmap_t *map;
+
+	if (!index)
+		return NULL;
+
+	if (!ni_intmap_index_build(index))
+		return ni_format_uint_mapped(value, index->map);
+
+	map = ni_intmap_index_find_value(index, value);
+	return map ? map->name : NULL;
+}
+
+int
+ni_parse_uint_maybe_indexed(const char *input, ni_intmap_index_t *index, unsigned int *result, int base)
+{
+	if (!index || !input || !result)
+		return -1;
+
+	if (ni_parse_uint_indexed(input, index, result) == 0)
+		return 0;
+
+	if (ni_parse_uint(input, result, base) < 0)
+		return -1;
+
+	if (ni_format_uint_indexed(*result, index) == NULL)
+		return 1;
+
+	return 0;
+}
+
+const char *
+ni_format_uint_maybe_indexed(unsigned int value, ni_intmap_index_t *index)
+{
+	static char buffer[20];
+	const char *name;
+
+	if (!index)
+		return NULL;
+
+	if (!(name = ni_format_uint_indexed(value, index))) {
+		snprintf(buffer, sizeof(buffer), "%u", value);
+		name = buffer;
+	}
+	return name;
+}
+
+void
+ni_intmap_index_destroy(ni_intmap_index_t *index)
+{
+	if (index) {
+		free(index->names);
+		free(index->values);
+		index->names = NULL;
+		index->values = NULL;
+		index->size = 0;
+	}
+}
+
 int
 ni_parse_double(const char *input, double *result)
 {
@@ -1726,43 +1945,50 @@ ni_format_bitmap(ni_stringbuf_t *buf, const ni_intmap_t *map,
 	return buf->string;
 }
 
-static ni_bool_t
-ni_intmap_cmp_get_name(unsigned int num, const char *ptr,
-			unsigned int *value, char **name)
-{
-	if (name && value && num == *value) {
-		ni_string_dup(name, ptr);
-		return TRUE;
-	}
-	return FALSE;
-}
+/*
+ * Runtime maps read from files such as /etc/iproute2/rt_tables.
+ * The parsed map is kept together with an index and only re-read
+ * when the file has been replaced or modified.
+ */
+typedef struct ni_intmap_file	ni_intmap_file_t;
+struct ni_intmap_file {
+	ni_intmap_file_t *	next;
+	char *			filename;
+
+	dev_t			dev;
+	ino_t			ino;
+	off_t			size;
+	struct timespec		mtime;
+
+	ni_intmap_t *		map;
+	ni_intmap_index_t	index;
+};
 
-static ni_bool_t
-ni_intmap_cmp_get_value(unsigned int num, const char *ptr,
-			unsigned int *value, char **name)
+static ni_intmap_file_t *	ni_intmap_files;
+
+static void
+ni_intmap_file_clear(ni_intmap_file_t *imf)
 {
-	if (name && value && ni_string_eq(*name, ptr)) {
-		*value = num;
-		return TRUE;
+	ni_intmap_t *map;
+
+	ni_intmap_index_destroy(&imf->index);
+	if ((map = imf->map)) {
+		for (; map->name; ++map)
+			free((char *) map->name);
+		free(imf->map);
+		imf->map = NULL;
 	}
-	return FALSE;
+	imf->index.map = NULL;
 }
 
-static ni_bool_t
-__ni_intmap_file_parse(const char *filename, unsigned int *value, char **name,
-	ni_bool_t (*cmpget)(unsigned int, const char *, unsigned int *, char **))
+static void
+ni_intmap_file_load(ni_intmap_file_t *imf, FILE *file)
 {
 	char *ptr, buf[512] = {'\0'};
-	FILE *file;
-	unsigned int num;
+	unsigned int num, count = 0;
 	size_t off;
 
-	if (ni_string_empty(filename))
-		return FALSE;
-
-	if (!(file = fopen(filename, "r")))
-		return FALSE;
-
+	imf->map = xcalloc(1, sizeof(ni_intmap_t));
 	while (fgets(buf, sizeof(buf), file)) {
 		buf[strcspn(buf, "#\n\r")] = '\0';
 		ptr = buf;
@@ -1784,26 +2010,111 @@ __ni_intmap_file_parse(const char *filename, unsigned int *value, char **name,
 		if (!ni_check_domain_name(ptr, off, 0))
 			continue;
 
-		if(cmpget(num, ptr, value, name)) {
+		if ((count % 16) == 0)
+			imf->map = xrealloc(imf->map, (count + 17) * sizeof(ni_intmap_t));
+		imf->map[count].name = xstrdup(ptr);
+		imf->map[count].value = num;
+		count++;
+		imf->map[count].name = NULL;
+		imf->map[count].value = 0;
+	}
+	imf->index.map = imf->map;
+}
+
+static ni_intmap_file_t *
+ni_intmap_file_get(const char *filename)
+{
+	ni_intmap_file_t *imf, **pos;
+	struct stat st;
+	FILE *file;
+
+	if (ni_string_empty(filename))
+		return NULL;
+
+	for (pos = &ni_intmap_files; (imf = *pos); pos = &imf->next) {
+		if (ni_string_eq(imf->filename, filename))
+			break;
+	}
+
+	if (!(file = fopen(filename, "r")) || fstat(fileno(file), &st) < 0) {
+		if (file)
 			fclose(file);
-			return TRUE;
+		if (imf) {
+			*pos = imf->next;
+			ni_intmap_file_clear(imf);
+			free(imf->filename);
+			free(imf);
 		}
+		return NULL;
+	}
 
+	if (imf && imf->map && imf->dev == st.st_dev && imf->ino == st.st_ino &&
+	    imf->size == st.st_size &&
+	    imf->mtime.tv_sec == st.st_mtim.tv_sec &&
+	    imf->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+		fclose(file);
+		return imf;
 	}
+
+	if (!imf) {
+		imf = xcalloc(1, sizeof(*imf));
+		imf->filename = xstrdup(filename);
+		*pos = imf;
+	}
+
+	ni_intmap_file_clear(imf);
+	ni_intmap_file_load(imf, file);
 	fclose(file);
-	return FALSE;
+
+	imf->dev = st.st_dev;
+	imf->ino = st.st_ino;
+	imf->size = st.st_size;
+	imf->mtime = st.st_mtim;
+	return imf;
 }
 
 ni_bool_t
 ni_intmap_file_get_name(const char *filename, unsigned int *value, char **name)
 {
-	return __ni_intmap_file_parse(filename, value, name, ni_intmap_cmp_get_name);
+	ni_intmap_file_t *imf;
+	const ni_intmap_t *map;
+
+	if (!name || !value || !(imf = ni_intmap_file_get(filename)))
+		return FALSE;
+
+	if (ni_intmap_index_build(&imf->index))
+		map = ni_intmap_index_find_value(&imf->index, *value);
+	else
+		for (map = imf->map; map->name && map->value != *value; ++map)
+			;
+
+	if (!map || !map->name)
+		return FALSE;
+
+	ni_string_dup(name, map->name);
+	return TRUE;
 }
 
 ni_bool_t
 ni_intmap_file_get_value(const char *filename, unsigned int *value, char **name)
 {
-	return __ni_intmap_file_parse(filename, value, name, ni_intmap_cmp_get_value);
+	ni_intmap_file_t *imf;
+	const ni_intmap_t *map;
+
+	if (!name || !*name || !value || !(imf = ni_intmap_file_get(filename)))
+		return FALSE;
+
+	if (ni_intmap_index_build(&imf->index))
+		map = ni_intmap_index_find_name(&imf->index, *name, strcmp);
+	else
+		for (map = imf->map; map->name && !ni_string_eq(map->name, *name); ++map)
+			;
+
+	if (!map || !map->name)
+		return FALSE;
+
+	*value = map->value;
+	return TRUE;
 }
 
 /*
@@ -2773,6 +3084,122 @@ xstrdup(const char *string)
 	return p;
 }
 
+/*
+ * Tagged alloc helpers accounting the usable size of each
+ * allocation, that is including the malloc rounding slack.
+ */
+static ni_memstat_t		ni_memstat[__NI_MEMTAG_MAX];
+
+static const char *		ni_memtag_names[__NI_MEMTAG_MAX] = {
+	[NI_MEMTAG_NETDEV]	= "netdev",
+	[NI_MEMTAG_ADDRESS]	= "address",
+	[NI_MEMTAG_ROUTE]	= "route",
+	[NI_MEMTAG_LEASE]	= "lease",
+	[NI_MEMTAG_XML_NODE]	= "xml-node",
+	[NI_MEMTAG_DBUS_OBJECT]	= "dbus-object",
+	[NI_MEMTAG_DBUS_ARRAY]	= "dbus-array",
+	[NI_MEMTAG_IFWORKER]	= "ifworker",
+};
+
+static inline void *
+ni_memstat_account(ni_memtag_t tag, void *p)
+{
+	ni_memstat_t *stat;
+
+	if (p && tag < __NI_MEMTAG_MAX) {
+		stat = &ni_memstat[tag];
+		stat->bytes += malloc_usable_size(p);
+		stat->count++;
+		if (stat->peak_bytes < stat->bytes)
+			stat->peak_bytes = stat->bytes;
+		if (stat->peak_count < stat->count)
+			stat->peak_count = stat->count;
+	}
+	return p;
+}
+
+void *
+xmalloc_tagged(ni_memtag_t tag, size_t size)
+{
+	return ni_memstat_account(tag, xmalloc(size));
+}
+
+void *
+xcalloc_tagged(ni_memtag_t tag, unsigned int count, size_t size)
+{
+	return ni_memstat_account(tag, xcalloc(count, size));
+}
+
+void *
+calloc_tagged(ni_memtag_t tag, unsigned int count, size_t size)
+{
+	return ni_memstat_account(tag, calloc(count, size));
+}
+
+char *
+xstrdup_tagged(ni_memtag_t tag, const char *string)
+{
+	return ni_memstat_account(tag, xstrdup(string));
+}
+
+void
+xfree_tagged(ni_memtag_t tag, void *p)
+{
+	ni_memstat_t *stat;
+	size_t size;
+
+	if (p == NULL)
+		return;
+
+	if (tag < __NI_MEMTAG_MAX) {
+		stat = &ni_memstat[tag];
+		size = malloc_usable_size(p);
+		stat->bytes = stat->bytes > size ? stat->bytes - size : 0;
+		stat->count = stat->count ? stat->count - 1 : 0;
+	}
+	free(p);
+}
+
+const char *
+ni_memtag_name(ni_memtag_t tag)
+{
+	return tag < __NI_MEMTAG_MAX ? ni_memtag_names[tag] : NULL;
+}
+
+const ni_memstat_t *
+ni_memstat_get(ni_memtag_t tag)
+{
+	return tag < __NI_MEMTAG_MAX ? &ni_memstat[tag] : NULL;
+}
+
+void
+ni_memstat_format(ni_stringbuf_t *buf)
+{
+	const ni_memstat_t *stat;
+	unsigned int tag;
+
+	ni_stringbuf_printf(buf, "%-12s %10s %12s %10s %12s\n",
+			"tag", "objects", "bytes", "peak", "peak-bytes");
+	for (tag = 0; tag < __NI_MEMTAG_MAX; ++tag) {
+		stat = &ni_memstat[tag];
+		ni_stringbuf_printf(buf, "%-12s %10zu %12zu %10zu %12zu\n",
+				ni_memtag_names[tag], stat->count, stat->bytes,
+				stat->peak_count, stat->peak_bytes);
+	}
+}
+
+void
+ni_memstat_reset(void)
+{
+	unsigned int tag;
+
+	/* the high-water marks restart from the live values */
+	for (tag = 0; tag < __NI_MEMTAG_MAX; ++tag) {
+		ni_memstat[tag].peak_bytes = ni_memstat[tag].bytes;
+		ni_memstat[tag].peak_count = ni_memstat[tag].count;
+	}
+}
+
 ni_bool_t
 ni_uint_in_range(const ni_uint_range_t *range, const unsigned int value)
 {
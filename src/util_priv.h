@@ -8,12 +8,52 @@
 #ifndef __WICKED_UTIL_PRIV_H__
 #define __WICKED_UTIL_PRIV_H__
 
+#include <wicked/util.h>
+
 extern void *	xmalloc(size_t);
 extern void *	xcalloc(unsigned int, size_t);
 extern void *	xrealloc(void *, size_t);
 
 extern char *	xstrdup(const char *);
 
+/*
+ * Tagged allocations: the live bytes, object counts and their
+ * high-water marks are accounted per tag. Memory allocated with
+ * a tag has to be released with xfree_tagged using the same tag.
+ * As calloc, calloc_tagged returns NULL when the allocation fails,
+ * the x variants abort.
+ */
+typedef enum {
+	NI_MEMTAG_NETDEV,
+	NI_MEMTAG_ADDRESS,
+	NI_MEMTAG_ROUTE,
+	NI_MEMTAG_LEASE,
+	NI_MEMTAG_XML_NODE,
+	NI_MEMTAG_DBUS_OBJECT,
+	NI_MEMTAG_DBUS_ARRAY,
+	NI_MEMTAG_IFWORKER,
+
+	__NI_MEMTAG_MAX
+} ni_memtag_t;
+
+typedef struct ni_memstat {
+	size_t		bytes;
+	size_t		count;
+	size_t		peak_bytes;
+	size_t		peak_count;
+} ni_memstat_t;
+
+extern void *	xmalloc_tagged(ni_memtag_t, size_t);
+extern void *	xcalloc_tagged(ni_memtag_t, unsigned int, size_t);
+extern void *	calloc_tagged(ni_memtag_t, unsigned int, size_t);
+extern char *	xstrdup_tagged(ni_memtag_t, const char *);
+extern void	xfree_tagged(ni_memtag_t, void *);
+
+extern const char *		ni_memtag_name(ni_memtag_t);
+extern const ni_memstat_t *	ni_memstat_get(ni_memtag_t);
+extern void			ni_memstat_format(ni_stringbuf_t *);
+extern void			ni_memstat_reset(void);
+
 #endif /* __WICKED_UTIL_PRIV_H__ */
 
 
@@ -141,7 +141,7 @@ xml_node_new(const char *ident, xml_node_t *parent)
 {
 	xml_node_t *node;
 
-	node = xcalloc(1, sizeof(xml_node_t));
+	node = xcalloc_tagged(NI_MEMTAG_XML_NODE, 1, sizeof(xml_node_t));
 	if (ident)
 		node->name = xstrdup(ident);
 
@@ -302,7 +302,7 @@ xml_node_free(xml_node_t *node)
 	ni_var_array_destroy(&node->attrs);
 	free(node->cdata);
 	free(node->name);
-	free(node);
+	xfree_tagged(NI_MEMTAG_XML_NODE, node);
 }
 
 void
@@ -65,8 +65,42 @@ struct xpath_enode {
 
 	char *			identifier;
 	xpath_integer_t		integer;
+
+	unsigned int		users;		/* expression root only */
+};
+
+/*
+ * Cache of compiled expressions, keyed by the expression string.
+ */
+#define XPATH_CACHE_BUCKETS	64
+#define XPATH_CACHE_MAX		256
+
+typedef struct xpath_cache_entry xpath_cache_entry_t;
+struct xpath_cache_entry {
+	xpath_cache_entry_t *	next;
+	unsigned int		hash;
+	char *			expr;
+	xpath_enode_t *		tree;
 };
 
+static struct xpath_cache {
+	unsigned int		count;
+	xpath_cache_entry_t *	bucket[XPATH_CACHE_BUCKETS];
+} xpath_expression_cache;
+
+/*
+ * Pool of released results; we keep their node arrays
+ * around, so the evaluation of cached expressions mostly
+ * runs without hitting the allocator.
+ */
+#define XPATH_RESULT_POOL_MAX	64
+#define XPATH_RESULT_KEEP_MAX	256
+
+static struct xpath_result_pool {
+	unsigned int		count;
+	xpath_result_t *	free[XPATH_RESULT_POOL_MAX];
+} xpath_result_pool;
+
 static xpath_operator_t	__xpath_operator_node;
 static xpath_operator_t	__xpath_operator_child;
 static xpath_operator_t	__xpath_operator_descendant;
@@ -89,6 +123,7 @@ static void		__xpath_skipws(const char **);
 
 static xpath_enode_t *	xpath_enode_new(const xpath_operator_t *);
 static void		xpath_enode_free(xpath_enode_t *);
+static void		xpath_enode_tree_free(xpath_enode_t *);
 
 #ifdef NI_XPATH_DEBUG_LEVEL
 # define xtrace(fmt, args...)	ni_debug_verbose(NI_XPATH_DEBUG_LEVEL, NI_TRACE_XPATH, fmt, ##args)
@@ -122,6 +157,7 @@ xpath_expression_parse(const char *expr)
 	if (*expr)
 		goto failed;
 
+	tree->users = 1;
 	return tree;
 
 failed:
@@ -147,18 +183,107 @@ xpath_expression_eval(const xpath_enode_t *enode, xml_node_t *xn)
 }
 
 /*
- * Free a parsed XPATH expression
+ * Free a parsed XPATH expression, resp. drop the reference
+ * obtained from xpath_expression_compile().
  */
 void
 xpath_expression_free(xpath_enode_t *enode)
 {
 	if (!enode)
 		return;
-	if (enode->left)
-		xpath_enode_free(enode->left);
-	if (enode->right)
-		xpath_enode_free(enode->right);
-	xpath_enode_free(enode);
+
+	if (enode->users > 1) {
+		enode->users--;
+		return;
+	}
+	xpath_enode_tree_free(enode);
+}
+
+/*
+ * Compile an XPATH expression, reusing an already compiled
+ * tree of an identical expression string from the cache.
+ * The returned tree is shared and has to be released using
+ * xpath_expression_free().
+ */
+static void
+xpath_expression_cache_expire(void)
+{
+	struct xpath_cache *cache = &xpath_expression_cache;
+	xpath_cache_entry_t **pos, *entry;
+	unsigned int i;
+
+	for (i = 0; i < XPATH_CACHE_BUCKETS; ++i) {
+		pos = &cache->bucket[i];
+		while ((entry = *pos) != NULL) {
+			if (entry->tree->users > 1) {
+				pos = &entry->next;
+				continue;
+			}
+			*pos = entry->next;
+			xpath_expression_free(entry->tree);
+			free(entry->expr);
+			free(entry);
+			cache->count--;
+		}
+	}
+}
+
+xpath_enode_t *
+xpath_expression_compile(const char *expr)
+{
+	struct xpath_cache *cache = &xpath_expression_cache;
+	xpath_cache_entry_t *entry;
+	xpath_enode_t *tree;
+	unsigned int hash;
+
+	if (!expr)
+		return NULL;
+
+	hash = ni_string_hash(expr);
+	for (entry = cache->bucket[hash % XPATH_CACHE_BUCKETS]; entry; entry = entry->next) {
+		if (entry->hash == hash && !strcmp(entry->expr, expr)) {
+			entry->tree->users++;
+			return entry->tree;
+		}
+	}
+
+	if (!(tree = xpath_expression_parse(expr)))
+		return NULL;
+
+	if (cache->count >= XPATH_CACHE_MAX)
+		xpath_expression_cache_expire();
+	if (cache->count >= XPATH_CACHE_MAX)
+		return tree;	/* all in use, don't cache */
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->hash = hash;
+	entry->expr = xstrdup(expr);
+	entry->tree = tree;
+	entry->next = cache->bucket[hash % XPATH_CACHE_BUCKETS];
+	cache->bucket[hash % XPATH_CACHE_BUCKETS] = entry;
+	cache->count++;
+
+	tree->users++;
+	return tree;
+}
+
+/*
+ * Drop all cached expressions no longer referenced by a caller
+ * and release the result pool.
+ */
+void
+xpath_expression_cache_flush(void)
+{
+	struct xpath_result_pool *pool = &xpath_result_pool;
+	xpath_result_t *na;
+
+	xpath_expression_cache_expire();
+
+	while (pool->count) {
+		na = pool->free[--(pool->count)];
+		free(na->node);
+		free(na);
+	}
 }
 
 /*
@@ -172,7 +297,7 @@ xml_xpath_eval_string(xml_document_t *doc, xml_node_t *xn, const char *expr)
 	xpath_enode_t *expr_tree;
 	char *result = NULL;
 
-	expr_tree = xpath_expression_parse(expr);
+	expr_tree = xpath_expression_compile(expr);
 	if (!expr_tree)
 		return NULL;
 
@@ -1055,7 +1180,8 @@ __xpath_enode_predicate_evaluate(const xpath_enode_t *enode, xpath_result_t *lef
 				/* Just return all elements */
 				if (rn->value.boolean) {
 					xpath_result_free(result);
-					return left;
+					xpath_result_free(right);
+					return xpath_result_dup(left);
 				}
 				break;
 
@@ -1552,6 +1678,16 @@ xpath_enode_free(xpath_enode_t *enode)
 	free(enode);
 }
 
+static void
+xpath_enode_tree_free(xpath_enode_t *enode)
+{
+	if (enode->left)
+		xpath_enode_tree_free(enode->left);
+	if (enode->right)
+		xpath_enode_tree_free(enode->right);
+	xpath_enode_free(enode);
+}
+
 static void
 __xpath_node_destroy(xpath_node_t *xpn)
 {
@@ -1565,9 +1701,13 @@ __xpath_node_destroy(xpath_node_t *xpn)
 xpath_result_t *
 xpath_result_new(xpath_node_type_t type)
 {
+	struct xpath_result_pool *pool = &xpath_result_pool;
 	xpath_result_t *na;
 
-	na = calloc(1, sizeof(xpath_result_t));
+	if (pool->count)
+		na = pool->free[--(pool->count)];
+	else
+		na = xcalloc(1, sizeof(xpath_result_t));
 	na->users = 1;
 	na->type = type;
 	return na;
@@ -1592,6 +1732,18 @@ xpath_result_free(xpath_result_t *na)
 		return;
 	while (na->count)
 		__xpath_node_destroy(&na->node[--(na->count)]);
+
+	if (xpath_result_pool.count < XPATH_RESULT_POOL_MAX) {
+		if (na->size > XPATH_RESULT_KEEP_MAX) {
+			free(na->node);
+			na->node = NULL;
+			na->size = 0;
+		}
+		na->type = XPATH_VOID;
+		xpath_result_pool.free[xpath_result_pool.count++] = na;
+		return;
+	}
+
 	free(na->node);
 	memset(na, 0, sizeof(*na));
 	free(na);
@@ -1644,9 +1796,9 @@ __xpath_node_array_append(xpath_result_t *na, xpath_node_type_t type)
 {
 	xpath_node_t *xpn;
 
-	if ((na->count & 15) == 0) {
-		na->node = realloc(na->node, (na->count + 16) * sizeof(xpath_node_t));
-		assert(na->node);
+	if (na->count >= na->size) {
+		na->size = na->count + 16;
+		na->node = xrealloc(na->node, na->size * sizeof(xpath_node_t));
 	}
 
 	xpn = &na->node[na->count++];
@@ -0,0 +1,411 @@
+/*
+ * Benchmark for the DHCPv4 packet capture: opens a capture on each of
+ * the <prefix><N> interfaces and sends rounds of DHCP client port udp
+ * packets to all of them via their <prefix><N>p peers (veth pairs set
+ * up by scripts/capture-bench.sh), comparing one socket per device to
+ * the shared capture socket. With --retransmit-close, each capture is
+ * closed from a retransmit callback, which also closes the capture of
+ * the next interface.
+ *
+ * Copyright (C) 2026 SUSE LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/> or write
+ * to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <linux/if_packet.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/socket.h>
+#include <wicked/logging.h>
+#include "netinfo_priv.h"
+#include "socket_priv.h"
+#include "appconfig.h"
+#include "buffer.h"
+
+#define DHCP4_CLIENT_PORT	68
+#define DHCP4_SERVER_PORT	67
+
+enum {
+	OPT_DEBUG,
+	OPT_INTERFACES,
+	OPT_ROUNDS,
+	OPT_PREFIX,
+	OPT_SHARED,
+	OPT_RX_RING,
+	OPT_MATCH,
+	OPT_RETRANSMIT_CLOSE,
+};
+
+static struct option	options[] = {
+	{ "debug",		required_argument,	NULL,	OPT_DEBUG },
+	{ "interfaces",		required_argument,	NULL,	OPT_INTERFACES },
+	{ "rounds",		required_argument,	NULL,	OPT_ROUNDS },
+	{ "prefix",		required_argument,	NULL,	OPT_PREFIX },
+	{ "shared",		no_argument,		NULL,	OPT_SHARED },
+	{ "rx-ring",		no_argument,		NULL,	OPT_RX_RING },
+	{ "match",		no_argument,		NULL,	OPT_MATCH },
+	{ "retransmit-close",	no_argument,		NULL,	OPT_RETRANSMIT_CLOSE },
+
+	{ NULL }
+};
+
+static unsigned long	received;
+static unsigned long	callbacks;
+
+static void
+bench_recv(ni_socket_t *sock)
+{
+	ni_capture_t *capture = sock->user_data;
+	ni_buffer_t buf;
+
+	callbacks++;
+	if (ni_capture_recv(capture, &buf, NULL, "bench") >= 0)
+		received++;
+}
+
+static ni_capture_t *
+bench_open(const char *ifname, ni_bool_t shared)
+{
+	ni_capture_devinfo_t devinfo;
+	ni_capture_protinfo_t protinfo;
+	ni_capture_t *capture;
+
+	memset(&devinfo, 0, sizeof(devinfo));
+	devinfo.ifname = (char *)ifname;
+	devinfo.ifindex = if_nametoindex(ifname);
+	devinfo.iftype = NI_IFTYPE_ETHERNET;
+	devinfo.mtu = 1500;
+	devinfo.hwaddr.type = ARPHRD_ETHER;
+	devinfo.hwaddr.len = ETH_ALEN;
+
+	memset(&protinfo, 0, sizeof(protinfo));
+	protinfo.eth_protocol = ETHERTYPE_IP;
+	protinfo.ip_protocol = IPPROTO_UDP;
+	protinfo.ip_port = DHCP4_CLIENT_PORT;
+	protinfo.shared = shared;
+
+	if (!devinfo.ifindex) {
+		fprintf(stderr, "%s: interface does not exist\n", ifname);
+		return NULL;
+	}
+	if (!(capture = ni_capture_open(&devinfo, &protinfo, bench_recv)))
+		fprintf(stderr, "%s: unable to open capture\n", ifname);
+	return capture;
+}
+
+static int
+bench_send(int fd, const ni_buffer_t *bp, const char *ifname)
+{
+	struct sockaddr_ll sll;
+
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETHERTYPE_IP);
+	sll.sll_ifindex = if_nametoindex(ifname);
+	sll.sll_halen = ETH_ALEN;
+	memset(sll.sll_addr, 0xff, ETH_ALEN);
+
+	return sendto(fd, ni_buffer_head(bp), ni_buffer_count(bp), 0,
+			(struct sockaddr *)&sll, sizeof(sll));
+}
+
+static double
+cputime(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+		(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000000.0;
+}
+
+/*
+ * A bootp sized packet to the dhcp client port with the xid
+ * at the offset of the dhcp transaction id.
+ */
+static int
+bench_packet(ni_buffer_t *bp, unsigned char *data, size_t size, uint32_t xid)
+{
+	struct in_addr any;
+
+	memset(data, 0, size);
+	ni_buffer_init(bp, data, size);
+	ni_buffer_reserve_head(bp, 64);
+	xid = htonl(xid);
+	memcpy(data + 64 + 4, &xid, sizeof(xid));
+	ni_buffer_put(bp, NULL, 300);
+
+	any.s_addr = INADDR_ANY;
+	return ni_capture_build_udp_header(bp, any, DHCP4_SERVER_PORT,
+				any, DHCP4_CLIENT_PORT);
+}
+
+/*
+ * Restrict each capture to its own xid, as on a mass start of
+ * dhcp clients, and apply the deferred shared filter update.
+ */
+static double
+bench_match(ni_capture_t **captures, unsigned int count)
+{
+	ni_capture_match_t match;
+	unsigned int i;
+	uint32_t xid;
+	double cpu;
+
+	cpu = cputime();
+	for (i = 0; i < count; ++i) {
+		memset(&match, 0, sizeof(match));
+		match.offset = 4;
+		match.len = sizeof(xid);
+		xid = htonl(i + 1);
+		memcpy(match.data, &xid, sizeof(xid));
+		if (ni_capture_set_match(captures[i], &match, 1) < 0)
+			return -1;
+	}
+	ni_socket_wait(0);
+	return cputime() - cpu;
+}
+
+/*
+ * Retransmit callback closing its own capture and the capture of the
+ * next interface, which may be any other member of the shared socket,
+ * and with the last member the shared socket itself.
+ */
+static ni_capture_t **	retrans_captures;
+static unsigned int	retrans_count;
+static unsigned int	retrans_closed;
+
+static void
+bench_close(unsigned int i)
+{
+	if (i < retrans_count && retrans_captures[i]) {
+		ni_capture_free(retrans_captures[i]);
+		retrans_captures[i] = NULL;
+		retrans_closed++;
+	}
+}
+
+static int
+bench_retransmit_close(void *data)
+{
+	unsigned int i = (ni_capture_t **)data - retrans_captures;
+
+	bench_close(i);
+	bench_close(i + 1);
+	return 0;
+}
+
+static int
+bench_retransmit(ni_capture_t **captures, unsigned int count, const ni_buffer_t *bp)
+{
+	ni_timeout_param_t timeout;
+	unsigned int i, idle;
+
+	retrans_captures = captures;
+	retrans_count = count;
+	for (i = 0; i < count; ++i) {
+		memset(&timeout, 0, sizeof(timeout));
+		timeout.timeout = 1;
+		timeout.nretries = -1;
+		timeout.timeout_callback = bench_retransmit_close;
+		timeout.timeout_data = &captures[i];
+		if (ni_capture_send(captures[i], bp, &timeout) < 0)
+			return -1;
+		ni_capture_force_retransmit(captures[i], 0);
+	}
+
+	for (idle = 0; retrans_closed < count && idle < 10; ++idle)
+		ni_socket_wait(100);
+	return retrans_closed == count ? 0 : -1;
+}
+
+static unsigned int
+count_fds(void)
+{
+	unsigned int count = 0;
+	struct dirent *d;
+	DIR *dir;
+
+	if (!(dir = opendir("/proc/self/fd")))
+		return 0;
+	while ((d = readdir(dir)) != NULL) {
+		if (d->d_name[0] != '.')
+			count++;
+	}
+	closedir(dir);
+	return count - 1;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int opt_interfaces = 100;
+	unsigned int opt_rounds = 10;
+	const char *opt_prefix = "cbench";
+	ni_bool_t opt_shared = FALSE;
+	ni_bool_t opt_rx_ring = FALSE;
+	ni_bool_t opt_match = FALSE;
+	ni_bool_t opt_retransmit_close = FALSE;
+	unsigned char data[1024];
+	unsigned long wakeups = 0, expected;
+	unsigned int i, n, idle, fds;
+	ni_capture_t **captures;
+	ni_buffer_t buf;
+	char ifname[IFNAMSIZ + 8];
+	double cpu, setup = 0;
+	int c, fd;
+
+	while ((c = getopt_long(argc, argv, "", options, NULL)) != EOF) {
+		switch (c) {
+		default:
+		usage:
+			fprintf(stderr,
+				"./capture-bench [--interfaces <count>] [--rounds <count>] [--prefix <name>]\n"
+				"                [--shared] [--rx-ring] [--match] [--retransmit-close]\n"
+			       );
+			return 1;
+
+		case OPT_DEBUG:
+			if (ni_enable_debug(optarg) < 0) {
+				fprintf(stderr, "Bad debug facility \"%s\"\n", optarg);
+				return 1;
+			}
+			break;
+
+		case OPT_INTERFACES:
+			if (ni_parse_uint(optarg, &opt_interfaces, 10) || !opt_interfaces ||
+			    opt_interfaces > 100000)
+				goto usage;
+			break;
+
+		case OPT_ROUNDS:
+			if (ni_parse_uint(optarg, &opt_rounds, 10) || !opt_rounds)
+				goto usage;
+			break;
+
+		case OPT_PREFIX:
+			/* with up to 5 digits and the peer suffix below IFNAMSIZ */
+			if (ni_string_len(optarg) > 8)
+				goto usage;
+			opt_prefix = optarg;
+			break;
+
+		case OPT_SHARED:
+			opt_shared = TRUE;
+			break;
+
+		case OPT_RX_RING:
+			opt_rx_ring = TRUE;
+			break;
+
+		case OPT_MATCH:
+			opt_match = TRUE;
+			break;
+
+		case OPT_RETRANSMIT_CLOSE:
+			opt_retransmit_close = TRUE;
+			break;
+		}
+	}
+
+	if (optind < argc)
+		goto usage;
+
+	ni_global.config = ni_config_new();
+	ni_global.config->packet_capture.shared = opt_shared;
+	ni_global.config->packet_capture.rx_ring = opt_rx_ring;
+
+	fds = count_fds();
+	captures = calloc(opt_interfaces, sizeof(*captures));
+	for (i = 0; i < opt_interfaces; ++i) {
+		snprintf(ifname, sizeof(ifname), "%.8s%u", opt_prefix, i);
+		if (!(captures[i] = bench_open(ifname, opt_shared)))
+			return 1;
+	}
+	fds = count_fds() - fds;
+
+	if ((fd = socket(PF_PACKET, SOCK_DGRAM, htons(ETHERTYPE_IP))) < 0) {
+		perror("socket");
+		return 1;
+	}
+
+	if (opt_match && (setup = bench_match(captures, opt_interfaces)) < 0)
+		return 1;
+
+	if (bench_packet(&buf, data, sizeof(data), 0) < 0)
+		return 1;
+
+	cpu = cputime();
+	expected = 0;
+	for (n = 0; n < opt_rounds; ++n) {
+		for (i = 0; i < opt_interfaces; ++i) {
+			snprintf(ifname, sizeof(ifname), "%.8s%up", opt_prefix, i);
+			if (opt_match && bench_packet(&buf, data, sizeof(data), i + 1) < 0)
+				return 1;
+			if (bench_send(fd, &buf, ifname) > 0)
+				expected++;
+		}
+
+		for (idle = 0; received < expected && idle < 10; ) {
+			unsigned long before = callbacks;
+
+			ni_socket_wait(100);
+			if (callbacks == before)
+				idle++;
+			else
+				wakeups++;
+		}
+	}
+	cpu = cputime() - cpu;
+
+	printf("%s%s%s: %u interfaces, %u capture fds, %lu/%lu packets received, "
+		"%lu wakeups, %lu callbacks, %.3fs cpu",
+		opt_shared ? "shared" : "per-device",
+		opt_rx_ring ? "+rx-ring" : "",
+		opt_match ? "+match" : "",
+		opt_interfaces, fds, received, expected,
+		wakeups, callbacks, cpu);
+	if (opt_match)
+		printf(", %.3fs cpu to set the matches", setup);
+	printf("\n");
+
+	if (opt_retransmit_close && bench_retransmit(captures, opt_interfaces, &buf) < 0) {
+		printf("check: %u/%u captures closed in retransmit callbacks\n",
+			retrans_closed, opt_interfaces);
+		return 1;
+	}
+
+	for (i = 0; i < opt_interfaces; ++i)
+		ni_capture_free(captures[i]);
+	free(captures);
+	close(fd);
+	return received == expected ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+/*
+ *	Benchmark for the internet checksum routines: throughput of the
+ *	variants available on this host for dhcp sized packets and for
+ *	larger buffers.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <wicked/socket.h>
+#include <wicked/util.h>
+
+#include "checksum.h"
+
+static const char * const	impls[] = {
+	"scalar", "generic", "sse2", "avx2", "neon", NULL
+};
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+int
+main(int argc, char **argv)
+{
+	static const unsigned int sizes[] = { 20, 300, 576, 1500, 9000, 65535 };
+	unsigned int megs = 256, i, s, n, loops;
+	ni_checksum_func_t *func;
+	struct timeval begin;
+	unsigned char *data;
+	uint32_t sum = 0;
+	double secs;
+
+	if (argc > 1 && (ni_parse_uint(argv[1], &megs, 10) || !megs)) {
+		fprintf(stderr, "Usage: checksum-bench [MiB per run]\n");
+		return 1;
+	}
+
+	data = malloc(65536 + 1);
+	for (i = 0; i < 65536 + 1; ++i)
+		data[i] = random();
+
+	printf("default variant: %s\n", ni_checksum_impl_name());
+	for (s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s) {
+		loops = (megs << 20) / sizes[s];
+		for (i = 0; impls[i]; ++i) {
+			if (!(func = ni_checksum_impl(impls[i])))
+				continue;
+
+			/* odd address, as the ip header in a frame */
+			ni_timer_get_time(&begin);
+			for (n = 0; n < loops; ++n)
+				sum += func(n, data + 1, sizes[s]);
+			secs = elapsed(&begin);
+
+			printf("%5u bytes, %-7s: %8.1f MiB/s, %6.1f ns/packet\n",
+					sizes[s], impls[i], megs / secs,
+					secs * 1e9 / loops);
+		}
+	}
+
+	free(data);
+	return sum == 42 ? 2 : 0;
+}
@@ -0,0 +1,132 @@
+/*
+ *	Test for the internet checksum routines: compares all variants
+ *	available on this host to the reference 16-bit word loop, for
+ *	all lengths up to a few KiB, at all alignments and with chained
+ *	partial sums, plus the ip header example of RFC 1071.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "checksum.h"
+
+#define TEST_MAX_LEN	4096
+#define TEST_MAX_ALIGN	32
+
+static const char * const	impls[] = {
+	"generic", "sse2", "avx2", "neon", NULL
+};
+
+static unsigned int
+test_rfc1071(void)
+{
+	/* ip header with the checksum set, sums up to 0 */
+	static const unsigned char iphdr[] = {
+		0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00,
+		0x40, 0x11, 0xb8, 0x61, 0xc0, 0xa8, 0x00, 0x01,
+		0xc0, 0xa8, 0x00, 0xc7,
+	};
+	unsigned char buf[sizeof(iphdr)];
+	uint16_t sum;
+
+	if (ni_checksum(iphdr, sizeof(iphdr)) != 0) {
+		printf("rfc1071: ip header checksum does not verify\n");
+		return 1;
+	}
+
+	memcpy(buf, iphdr, sizeof(buf));
+	buf[10] = buf[11] = 0;
+	sum = ni_checksum(buf, sizeof(buf));
+	if (ntohs(sum) != 0xb861) {
+		printf("rfc1071: ip header checksum 0x%04x, expected 0xb861\n", ntohs(sum));
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned int
+test_impl(const char *name, ni_checksum_func_t *func, ni_checksum_func_t *ref,
+		const unsigned char *data)
+{
+	unsigned int len, align, split, failed = 0;
+	uint16_t want, have;
+
+	for (len = 0; len <= TEST_MAX_LEN; ++len) {
+		for (align = 0; align < TEST_MAX_ALIGN; ++align) {
+			want = ni_checksum_fold(ref(len, data + align, len));
+			have = ni_checksum_fold(func(len, data + align, len));
+			if (want != have) {
+				if (failed++ < 10)
+					printf("%s: len %u, align %u: 0x%04x != 0x%04x\n",
+						name, len, align, have, want);
+			}
+		}
+
+		/* a chain of partial sums, with the odd part last */
+		split = (len / 3) & ~1U;
+		have = ni_checksum_fold(func(func(len, data, split),
+					data + split, len - split));
+		want = ni_checksum_fold(ref(len, data, len));
+		if (want != have) {
+			if (failed++ < 10)
+				printf("%s: len %u, split %u: 0x%04x != 0x%04x\n",
+					name, len, split, have, want);
+		}
+	}
+
+	printf("%s: %s\n", name, failed ? "FAILED" : "ok");
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned char *data;
+	ni_checksum_func_t *ref, *func;
+	unsigned int i, failed = 0;
+
+	data = malloc(TEST_MAX_LEN + TEST_MAX_ALIGN);
+	srandom(1071);
+	for (i = 0; i < TEST_MAX_LEN + TEST_MAX_ALIGN; ++i)
+		data[i] = random();
+	/* make carries likely */
+	memset(data + 1024, 0xff, 512);
+
+	failed += test_rfc1071();
+
+	ref = ni_checksum_impl("scalar");
+	for (i = 0; impls[i]; ++i) {
+		if (!(func = ni_checksum_impl(impls[i]))) {
+			printf("%s: not available\n", impls[i]);
+			continue;
+		}
+		failed += test_impl(impls[i], func, ref, data);
+	}
+	failed += test_impl("default", ni_checksum_partial, ref, data);
+	printf("default variant: %s\n", ni_checksum_impl_name());
+
+	free(data);
+	return failed ? 1 : 0;
+}
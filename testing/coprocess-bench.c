@@ -0,0 +1,317 @@
+/*
+ *	Benchmark for the extension co-processes: runs a trivial bash
+ *	script as asynchronous subprocesses and as co-process calls, with
+ *	a subshell per call and sourced as a reentrant script, and checks
+ *	the output, exit status, timeout and crash handling of the calls.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <wicked/util.h>
+#include <wicked/socket.h>
+#include <wicked/logging.h>
+#include "process.h"
+
+#define BENCH_COPROCESS	"/usr/lib/wicked/extensions/coprocess"
+#define BENCH_PARALLEL	4
+#define BENCH_LARGE	(1 << 20)
+
+static const char	bench_script[] =
+	"#!/bin/bash\n"
+	"case $1 in\n"
+	"echo)  echo \"$2 $BENCH_VALUE\" ;;\n"
+	"utf8)  export LC_ALL=C.UTF-8 ; echo \"$2\" ; exit 0 ;;\n"
+	"exit)  exit $2 ;;\n"
+	"return) return $2 ;;\n"
+	"sleep) sleep $2 ;;\n"
+	"crash) kill -9 $$ ;;\n"
+	"esac\n";
+
+typedef struct bench_state {
+	unsigned int		started;
+	unsigned int		done;
+	unsigned int		failed;
+
+	int			status;
+	char *			output;
+} bench_state_t;
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+/*
+ * Run the main loop once, with the timers
+ */
+static int
+bench_wait(void)
+{
+	long timeout;
+
+	timeout = ni_timer_next_timeout();
+	if (timeout < 0 || timeout > 1000)
+		timeout = 1000;
+	return ni_socket_wait(timeout);
+}
+
+static void
+bench_notify(ni_process_t *pi)
+{
+	bench_state_t *state = pi->user_data;
+	const ni_buffer_t *output;
+
+	state->done++;
+	state->status = pi->status;
+	if (!ni_process_exit_status_okay(pi))
+		state->failed++;
+
+	ni_string_free(&state->output);
+	if ((output = ni_process_output(pi)))
+		ni_string_set(&state->output, ni_buffer_head(output), ni_buffer_count(output));
+}
+
+static ni_bool_t
+bench_start(ni_shellcmd_t *cmd, bench_state_t *state)
+{
+	ni_process_t *pi;
+
+	if (!(pi = ni_process_new(cmd)))
+		return FALSE;
+
+	ni_process_setenv(pi, "BENCH_VALUE", "value");
+	if (ni_process_run(pi) < 0) {
+		ni_process_free(pi);
+		return FALSE;
+	}
+	pi->notify_callback = bench_notify;
+	pi->user_data = state;
+	state->started++;
+	return TRUE;
+}
+
+/*
+ * Run count calls of the command, parallel at a time
+ */
+static unsigned int
+bench_run(ni_shellcmd_t *cmd, unsigned int count, unsigned int parallel)
+{
+	bench_state_t state;
+
+	memset(&state, 0, sizeof(state));
+	while (state.done < count) {
+		while (state.started < count && state.started - state.done < parallel) {
+			if (!bench_start(cmd, &state))
+				return 0;
+		}
+		if (bench_wait() < 0)
+			break;
+	}
+	ni_string_free(&state.output);
+	return state.done - state.failed;
+}
+
+static ni_bool_t
+bench_call(ni_coprocess_t *co, const char *script, const char *args, bench_state_t *state)
+{
+	ni_shellcmd_t *cmd;
+	char *command = NULL;
+	ni_bool_t ret;
+
+	ni_string_printf(&command, "%s %s", script, args);
+	cmd = ni_shellcmd_parse(command);
+	ni_string_free(&command);
+	if (!cmd)
+		return FALSE;
+
+	cmd->coprocess = ni_coprocess_hold(co);
+	memset(state, 0, sizeof(*state));
+	ret = bench_start(cmd, state);
+	while (ret && !state->done) {
+		if (bench_wait() < 0)
+			ret = FALSE;
+	}
+	ni_shellcmd_release(cmd);
+	return ret;
+}
+
+static unsigned int
+bench_check(const char *coprocess, const char *script, ni_bool_t reentrant)
+{
+	const char *mode = reentrant ? "reentrant" : "subshell";
+	char *large = NULL, *expect = NULL;
+	bench_state_t state;
+	ni_coprocess_t *co;
+	struct timeval begin;
+	unsigned int i, failed = 0;
+
+	if (!(co = ni_coprocess_new(coprocess, 1, 500, reentrant)))
+		return 1;
+
+	if (!bench_call(co, script, "echo hello", &state) ||
+	    !ni_string_eq(state.output, "hello value\n")) {
+		printf("check: unexpected output '%s'\n", state.output);
+		failed++;
+	}
+	/* the output length is counted in bytes in any locale */
+	if (!bench_call(co, script, "utf8 \xc3\xa4\xc3\xb6", &state) ||
+	    !ni_string_eq(state.output, "\xc3\xa4\xc3\xb6\n")) {
+		printf("check: unexpected utf-8 output '%s'\n", state.output);
+		failed++;
+	}
+
+	/* a request larger than the socket buffer is sent in parts */
+	ni_string_printf(&large, "echo %0*u", BENCH_LARGE, 0);
+	ni_string_printf(&expect, "%0*u value\n", BENCH_LARGE, 0);
+	if (!bench_call(co, script, large, &state) ||
+	    !ni_string_eq(state.output, expect)) {
+		printf("check: large request failed (status %d)\n", state.status);
+		failed++;
+	}
+	ni_string_free(&expect);
+	ni_string_free(&large);
+
+	if (reentrant && (!bench_call(co, script, "return 4", &state) ||
+	    !WIFEXITED(state.status) || WEXITSTATUS(state.status) != 4)) {
+		printf("check: unexpected return status %d\n", state.status);
+		failed++;
+	}
+	if (!bench_call(co, script, "exit 3", &state) ||
+	    !WIFEXITED(state.status) || WEXITSTATUS(state.status) != 3) {
+		printf("check: unexpected exit status %d\n", state.status);
+		failed++;
+	}
+
+	ni_timer_get_time(&begin);
+	if (!bench_call(co, script, "sleep 5", &state) ||
+	    !WIFSIGNALED(state.status) || WTERMSIG(state.status) != SIGKILL ||
+	    elapsed(&begin) > 2) {
+		printf("check: call not timed out (status %d)\n", state.status);
+		failed++;
+	}
+
+	if (!bench_call(co, script, "crash", &state) ||
+	    !WIFSIGNALED(state.status)) {
+		printf("check: crash not reported (status %d)\n", state.status);
+		failed++;
+	}
+	if (!bench_call(co, script, "echo restarted", &state) ||
+	    !ni_string_eq(state.output, "restarted value\n")) {
+		printf("check: co-process not restarted\n");
+		failed++;
+	}
+
+	/* too many failures fall back to subprocesses */
+	for (i = 0; i < 5; ++i)
+		bench_call(co, script, "crash", &state);
+	if (!bench_call(co, script, "echo fallback", &state) ||
+	    !ni_string_eq(state.output, "fallback value\n")) {
+		printf("check: no fallback to subprocesses\n");
+		failed++;
+	}
+
+	ni_string_free(&state.output);
+	ni_coprocess_free(co);
+
+	printf("check: %s %s\n", mode, failed ? "FAILED" : "ok");
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *coprocess = BENCH_COPROCESS;
+	char script[] = "/tmp/coprocess-bench.XXXXXX";
+	unsigned int count = 1000, ok;
+	ni_shellcmd_t *cmd = NULL;
+	char *command = NULL;
+	struct timeval begin;
+	double forked, called, sourced;
+	int fd, rv = 1;
+
+	if ((argc > 1 && (ni_parse_uint(argv[1], &count, 10) || !count)) ||
+	    (argc > 2 && !(coprocess = argv[2])) || !ni_file_executable(coprocess)) {
+		fprintf(stderr, "Usage: coprocess-bench [calls] [coprocess command]\n");
+		return 1;
+	}
+
+	if ((fd = mkstemp(script)) < 0 ||
+	    write(fd, bench_script, sizeof(bench_script) - 1) < 0 ||
+	    fchmod(fd, 0755) < 0) {
+		fprintf(stderr, "Unable to create the script %s\n", script);
+		return 1;
+	}
+	close(fd);
+
+	if (bench_check(coprocess, script, FALSE) ||
+	    bench_check(coprocess, script, TRUE))
+		goto done;
+
+	ni_string_printf(&command, "%s echo hello", script);
+	if (!(cmd = ni_shellcmd_parse(command)))
+		goto done;
+
+	ni_timer_get_time(&begin);
+	ok = bench_run(cmd, count, BENCH_PARALLEL);
+	forked = elapsed(&begin);
+	printf("subprocess: %u of %u calls in %.3fs, %.0f/s\n",
+			ok, count, forked, count / forked);
+	if (ok != count)
+		goto done;
+
+	cmd->coprocess = ni_coprocess_new(coprocess, BENCH_PARALLEL, 0, FALSE);
+	ni_timer_get_time(&begin);
+	ok = bench_run(cmd, count, BENCH_PARALLEL);
+	called = elapsed(&begin);
+	printf("coprocess:  %u of %u calls in %.3fs, %.0f/s (%.1fx)\n",
+			ok, count, called, count / called, forked / called);
+	if (ok != count)
+		goto done;
+
+	ni_coprocess_free(cmd->coprocess);
+	cmd->coprocess = ni_coprocess_new(coprocess, BENCH_PARALLEL, 0, TRUE);
+	ni_timer_get_time(&begin);
+	ok = bench_run(cmd, count, BENCH_PARALLEL);
+	sourced = elapsed(&begin);
+	printf("reentrant:  %u of %u calls in %.3fs, %.0f/s (%.1fx)\n",
+			ok, count, sourced, count / sourced, forked / sourced);
+	rv = ok == count ? 0 : 1;
+
+done:
+	ni_shellcmd_release(cmd);
+	ni_string_free(&command);
+	unlink(script);
+	return rv;
+}
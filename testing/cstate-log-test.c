@@ -0,0 +1,281 @@
+/*
+ *	Test for the client-state log store: checks the migration of the
+ *	state files and its retry after a failed write, the transactions,
+ *	the recovery of a torn update and the compaction, and compares the
+ *	state files to the log store.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include <wicked/util.h>
+#include <wicked/socket.h>
+#include <wicked/fsm.h>
+
+#include "appconfig.h"
+#include "client/client_state.h"
+
+#define TEST_OWNER	42
+
+static char	test_dir[] = "/tmp/cstate-log-test.XXXXXX";
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+static ni_bool_t
+test_save(unsigned int ifindex, const char *origin)
+{
+	ni_client_state_t *cs;
+	ni_bool_t ret;
+
+	cs = ni_client_state_new(NI_FSM_STATE_DEVICE_UP);
+	cs->control.persistent = TRUE;
+	ni_string_dup(&cs->config.origin, origin);
+	cs->config.owner = TEST_OWNER;
+	ret = ni_client_state_save(cs, ifindex);
+	ni_client_state_free(cs);
+	return ret;
+}
+
+static ni_bool_t
+test_load(unsigned int ifindex, const char *origin)
+{
+	ni_client_state_t cs;
+	ni_bool_t ret;
+
+	ni_client_state_init(&cs);
+	ret = ni_client_state_load(&cs, ifindex) && cs.control.persistent &&
+		ni_string_eq(cs.config.origin, origin) && cs.config.owner == TEST_OWNER;
+	ni_client_state_reset(&cs);
+	return ret;
+}
+
+static off_t
+test_log_size(void)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	snprintf(path, sizeof(path), "%s/client-state.log", test_dir);
+	return stat(path, &st) == 0 ? st.st_size : -1;
+}
+
+static unsigned int
+test_log(ni_config_client_state_t *conf)
+{
+	unsigned int i, failed = 0;
+	char path[PATH_MAX];
+	struct rlimit rlim;
+	off_t size;
+	FILE *fp;
+
+	/* state files are imported into a new log */
+	conf->store = NI_CONFIG_CLIENT_STATE_STORE_FILES;
+	test_save(1, "file-1");
+	test_save(2, "file-2");
+	snprintf(path, sizeof(path), "%s/state-9.xml", test_dir);
+	if ((fp = fopen(path, "w"))) {
+		fputs("<broken", fp);
+		fclose(fp);
+	}
+	conf->store = NI_CONFIG_CLIENT_STATE_STORE_LOG;
+
+	/* a failed import keeps the files and is retried on the next open */
+	snprintf(path, sizeof(path), "%s/state-1.xml", test_dir);
+	signal(SIGXFSZ, SIG_IGN);
+	getrlimit(RLIMIT_FSIZE, &rlim);
+	setrlimit(RLIMIT_FSIZE, &(struct rlimit){ 16, rlim.rlim_max });
+	if (test_load(1, "file-1") || !ni_file_exists(path)) {
+		printf("log: state files lost by a failed migration\n");
+		failed++;
+	}
+	setrlimit(RLIMIT_FSIZE, &rlim);
+
+	if (!test_load(1, "file-1") || !test_load(2, "file-2") || ni_file_exists(path)) {
+		printf("log: state files not migrated\n");
+		failed++;
+	}
+
+	/* a file which cannot be imported is kept */
+	snprintf(path, sizeof(path), "%s/state-9.xml", test_dir);
+	if (!ni_file_exists(path)) {
+		printf("log: unparsable state file removed\n");
+		failed++;
+	}
+	unlink(path);
+
+	if (!test_save(3, "log-3") || !test_load(3, "log-3") ||
+	    !ni_client_state_move(3, 4) || test_load(3, "log-3") || !test_load(4, "log-3") ||
+	    !ni_client_state_drop(4) || test_load(4, "log-3")) {
+		printf("log: save, move or drop failed\n");
+		failed++;
+	}
+
+	/* updates are written at the outermost commit */
+	size = test_log_size();
+	ni_client_state_begin();
+	test_save(5, "tx-5");
+	ni_client_state_begin();
+	test_save(6, "tx-6");
+	ni_client_state_drop(1);
+	ni_client_state_commit();
+	if (test_log_size() != size) {
+		printf("log: transaction written before the commit\n");
+		failed++;
+	}
+	ni_client_state_commit();
+	if (!test_load(5, "tx-5") || !test_load(6, "tx-6") || test_load(1, "file-1")) {
+		printf("log: transaction not applied\n");
+		failed++;
+	}
+
+	/* drops without state are skipped in transactions as well */
+	size = test_log_size();
+	ni_client_state_begin();
+	ni_client_state_drop(1);
+	ni_client_state_drop(99);
+	ni_client_state_commit();
+	ni_client_state_begin();
+	test_save(10, "tx-10");
+	ni_client_state_drop(10);
+	ni_client_state_commit();
+	if (test_log_size() == size || test_load(10, "tx-10")) {
+		printf("log: transaction drop of a new state lost\n");
+		failed++;
+	}
+	size = test_log_size();
+	ni_client_state_begin();
+	ni_client_state_drop(10);
+	ni_client_state_commit();
+	if (test_log_size() != size) {
+		printf("log: transaction drop without state written\n");
+		failed++;
+	}
+
+	/* a torn update is discarded and truncated */
+	size = test_log_size();
+	test_save(7, "torn-7");
+	snprintf(path, sizeof(path), "%s/client-state.log", test_dir);
+	if (truncate(path, test_log_size() - 4) < 0 ||
+	    test_load(7, "torn-7") || !test_load(6, "tx-6") || test_log_size() != size) {
+		printf("log: torn update not discarded\n");
+		failed++;
+	}
+
+	/* the log is compacted to the live state */
+	conf->sync = TRUE;
+	for (i = 0; i < 2000; ++i)
+		test_save(8, "compact-8");
+	conf->sync = FALSE;
+	if (!test_load(8, "compact-8") || !test_load(2, "file-2") ||
+	    test_log_size() > 64 * 1024 * 2) {
+		printf("log: not compacted, %ld bytes\n", (long)test_log_size());
+		failed++;
+	}
+
+	for (i = 1; i <= 8; ++i)
+		ni_client_state_drop(i);
+
+	printf("log: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
+
+static double
+test_bench(unsigned int count)
+{
+	struct timeval begin;
+	unsigned int i, ok = 0;
+	double taken;
+
+	ni_timer_get_time(&begin);
+	for (i = 1; i <= count; ++i)
+		ok += test_save(i, "bench");
+	for (i = 1; i <= count; ++i)
+		ok += test_load(i, "bench");
+	ni_client_state_begin();
+	for (i = 1; i <= count; ++i)
+		ok += ni_client_state_drop(i);
+	ni_client_state_commit();
+	taken = elapsed(&begin);
+
+	return ok == 3 * count ? taken : -1;
+}
+
+int
+main(int argc, char **argv)
+{
+	ni_config_client_state_t *conf;
+	unsigned int count = 5000;
+	double files, logged;
+	char path[PATH_MAX];
+	int rv = 1;
+
+	if (argc > 1 && (ni_parse_uint(argv[1], &count, 10) || !count)) {
+		fprintf(stderr, "Usage: cstate-log-test [interfaces]\n");
+		return 1;
+	}
+	if (!mkdtemp(test_dir)) {
+		fprintf(stderr, "Unable to create the directory %s\n", test_dir);
+		return 1;
+	}
+
+	ni_global.config = ni_config_new();
+	ni_config_fslocation_init(&ni_global.config->statedir, test_dir, 0755);
+	conf = &ni_global.config->client_state;
+
+	if (test_log(conf))
+		goto done;
+
+	conf->store = NI_CONFIG_CLIENT_STATE_STORE_FILES;
+	if ((files = test_bench(count)) < 0)
+		goto done;
+	printf("files: save, load and drop of %u interfaces in %.3fs\n", count, files);
+
+	conf->store = NI_CONFIG_CLIENT_STATE_STORE_LOG;
+	if ((logged = test_bench(count)) < 0)
+		goto done;
+	printf("log:   save, load and drop of %u interfaces in %.3fs (%.1fx)\n",
+			count, logged, files / logged);
+	rv = 0;
+
+done:
+	snprintf(path, sizeof(path), "%s/client-state.log", test_dir);
+	unlink(path);
+	rmdir(test_dir);
+	ni_config_free(ni_global.config);
+	return rv;
+}
@@ -0,0 +1,174 @@
+/*
+ *	Benchmark for the dhcp4 and dhcp6 supplicant device registries:
+ *	simulates an event storm on many devices, where each rtnetlink
+ *	event looks up the device handle by interface index and name,
+ *	comparing the hash index to a scan of the device list.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <net/if_arp.h>
+#include <wicked/socket.h>
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+
+#include "appconfig.h"
+#include "dhcp4/dhcp4.h"
+#include "dhcp6/dhcp6.h"
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+static ni_dhcp4_device_t *
+dhcp4_scan_index(unsigned int ifindex)
+{
+	ni_dhcp4_device_t *dev;
+
+	for (dev = ni_dhcp4_active; dev; dev = dev->next) {
+		if (dev->system.ifindex == ifindex)
+			return dev;
+	}
+	return NULL;
+}
+
+static ni_dhcp4_device_t *
+dhcp4_scan_name(const char *ifname)
+{
+	ni_dhcp4_device_t *dev;
+
+	for (dev = ni_dhcp4_active; dev; dev = dev->next) {
+		if (ni_string_eq(dev->ifname, ifname))
+			return dev;
+	}
+	return NULL;
+}
+
+static ni_dhcp6_device_t *
+dhcp6_scan_index(unsigned int ifindex)
+{
+	ni_dhcp6_device_t *dev;
+
+	for (dev = ni_dhcp6_active; dev; dev = dev->next) {
+		if (dev->link.ifindex == ifindex)
+			return dev;
+	}
+	return NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int ndevs = 10000, nevents = 20000, i, n, ifindex, found;
+	ni_dhcp4_device_t **dhcp4;
+	ni_dhcp6_device_t **dhcp6;
+	struct timeval begin;
+	ni_linkinfo_t link;
+	char ifname[32];
+	double secs;
+
+	if (argc > 1 && (ni_parse_uint(argv[1], &ndevs, 10) || !ndevs)) {
+		fprintf(stderr, "Usage: devindex-bench [devices] [events]\n");
+		return 1;
+	}
+	if (argc > 2 && (ni_parse_uint(argv[2], &nevents, 10) || !nevents)) {
+		fprintf(stderr, "Usage: devindex-bench [devices] [events]\n");
+		return 1;
+	}
+
+	ni_global.config = ni_config_new();
+	dhcp4 = calloc(ndevs, sizeof(*dhcp4));
+	dhcp6 = calloc(ndevs, sizeof(*dhcp6));
+
+	ni_timer_get_time(&begin);
+	memset(&link, 0, sizeof(link));
+	link.hwaddr.type = ARPHRD_ETHER;
+	link.hwaddr.len = 6;
+	for (i = 0; i < ndevs; ++i) {
+		snprintf(ifname, sizeof(ifname), "eth%u", i);
+		link.ifindex = i + 1;
+		link.hwaddr.data[4] = i >> 8;
+		link.hwaddr.data[5] = i;
+		if (!(dhcp4[i] = ni_dhcp4_device_new(ifname, &link)) ||
+		    !(dhcp6[i] = ni_dhcp6_device_new(ifname, &link))) {
+			fprintf(stderr, "%s: cannot create device\n", ifname);
+			return 1;
+		}
+	}
+	secs = elapsed(&begin);
+	printf("created %u dhcp4 and dhcp6 devices in %.3fs\n", ndevs, secs);
+
+	/* each event: the dhcp4 and dhcp6 handle by index, dhcp4 by name */
+	srandom(ndevs);
+	ni_timer_get_time(&begin);
+	for (n = found = 0; n < nevents; ++n) {
+		ifindex = 1 + random() % ndevs;
+		snprintf(ifname, sizeof(ifname), "eth%u", ifindex - 1);
+		found += dhcp4_scan_index(ifindex) == dhcp4[ifindex - 1];
+		found += dhcp6_scan_index(ifindex) == dhcp6[ifindex - 1];
+		found += dhcp4_scan_name(ifname) == dhcp4[ifindex - 1];
+	}
+	secs = elapsed(&begin);
+	printf("list scan:  %u events in %.3fs, %.2fus/event, %u/%u found\n",
+			nevents, secs, secs * 1e6 / nevents, found, 3 * nevents);
+
+	srandom(ndevs);
+	ni_timer_get_time(&begin);
+	for (n = found = 0; n < nevents; ++n) {
+		ifindex = 1 + random() % ndevs;
+		snprintf(ifname, sizeof(ifname), "eth%u", ifindex - 1);
+		found += ni_dhcp4_device_by_index(ifindex) == dhcp4[ifindex - 1];
+		found += ni_dhcp6_device_by_index(ifindex) == dhcp6[ifindex - 1];
+		found += ni_dhcp4_device_find(ifname) == dhcp4[ifindex - 1];
+	}
+	secs = elapsed(&begin);
+	printf("hash index: %u events in %.3fs, %.2fus/event, %u/%u found\n",
+			nevents, secs, secs * 1e6 / nevents, found, 3 * nevents);
+	if (found != 3 * nevents)
+		return 1;
+
+	ni_timer_get_time(&begin);
+	for (i = 0; i < ndevs; ++i) {
+		ni_dhcp4_device_put(dhcp4[i]);
+		ni_dhcp6_device_put(dhcp6[i]);
+	}
+	secs = elapsed(&begin);
+	printf("deleted %u dhcp4 and dhcp6 devices in %.3fs\n", ndevs, secs);
+
+	if (ni_dhcp4_active || ni_dhcp6_active ||
+	    ni_dhcp4_device_by_index(1) || ni_dhcp6_device_find("eth0")) {
+		printf("registries not empty after delete\n");
+		return 1;
+	}
+
+	free(dhcp4);
+	free(dhcp6);
+	ni_config_free(ni_global.config);
+	return 0;
+}
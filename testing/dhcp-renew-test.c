@@ -0,0 +1,160 @@
+/*
+ *	Test for the DHCP lease renewal spreading and rate limit: checks
+ *	the hashed offsets are stable, stay in the jitter window, keep
+ *	the T1 < T2 order and spread a fleet of clients evenly, and the
+ *	pacing of the renewals to the max-rate.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wicked/util.h>
+#include "appconfig.h"
+#include "dhcp.h"
+
+#define TEST_CLIENTS	10000
+#define TEST_BUCKETS	10
+#define TEST_T1		1800
+#define TEST_T2		3150
+
+static unsigned int
+test_client_hash(unsigned int client)
+{
+	unsigned char duid[14] = { 0x00, 0x01, 0x00, 0x01, 0x1d, 0x2e, 0x3f, 0x40,
+				   0x52, 0x54, 0x00, 0x00, 0x00, 0x00 };
+	uint32_t iaid = 1;
+
+	/* the clients differ in the mac address part of the DUID-LLT */
+	duid[12] = client >> 8;
+	duid[13] = client;
+	return ni_dhcp_renew_hash(ni_dhcp_renew_hash(0, duid, sizeof(duid)),
+					&iaid, sizeof(iaid));
+}
+
+static unsigned int
+test_spread(void)
+{
+	ni_config_dhcp_renew_t renew = { NI_CONFIG_DHCP_RENEW_SPREAD_HASHED, 20, 0 };
+	unsigned int buckets[TEST_BUCKETS] = { 0 };
+	unsigned int window = TEST_T1 * renew.jitter / 100;
+	unsigned int i, t1, t2, hash, failed = 0;
+
+	for (i = 0; i < TEST_CLIENTS; ++i) {
+		hash = test_client_hash(i);
+		t1 = ni_dhcp_renew_spread(&renew, TEST_T1, hash, 0);
+		t2 = ni_dhcp_renew_spread(&renew, TEST_T2, hash, 0);
+
+		if (t1 > TEST_T1 || t1 < TEST_T1 - window) {
+			if (failed++ < 10)
+				printf("hashed: client %u: t1 %u outside of the window\n", i, t1);
+		}
+		if (t1 >= t2 || t2 > TEST_T2) {
+			if (failed++ < 10)
+				printf("hashed: client %u: t1 %u, t2 %u out of order\n", i, t1, t2);
+		}
+		if (t1 != ni_dhcp_renew_spread(&renew, TEST_T1, hash, i)) {
+			if (failed++ < 10)
+				printf("hashed: client %u: offset is not stable\n", i);
+		}
+		buckets[(TEST_T1 - t1) * TEST_BUCKETS / (window + 1)]++;
+	}
+
+	for (i = 0; i < TEST_BUCKETS; ++i) {
+		/* within 20% of an even share */
+		if (buckets[i] < TEST_CLIENTS / TEST_BUCKETS * 8 / 10 ||
+		    buckets[i] > TEST_CLIENTS / TEST_BUCKETS * 12 / 10) {
+			printf("hashed: bucket %u has %u of %u clients\n", i,
+					buckets[i], TEST_CLIENTS);
+			failed++;
+		}
+	}
+
+	hash = test_client_hash(42);
+	renew.spread = NI_CONFIG_DHCP_RENEW_SPREAD_RANDOM;
+	for (i = 1, t2 = 0; i < 100; ++i)
+		t2 += ni_dhcp_renew_spread(&renew, TEST_T1, hash, i) !=
+			ni_dhcp_renew_spread(&renew, TEST_T1, hash, i + 1);
+	if (t2 < 90) {
+		printf("random: offsets do not vary with the salt\n");
+		failed++;
+	}
+
+	renew.spread = NI_CONFIG_DHCP_RENEW_SPREAD_NONE;
+	if (ni_dhcp_renew_spread(&renew, TEST_T1, hash, 0) != TEST_T1) {
+		printf("none: the time is modified\n");
+		failed++;
+	}
+	renew.spread = NI_CONFIG_DHCP_RENEW_SPREAD_HASHED;
+	if (ni_dhcp_renew_spread(&renew, -1U, hash, 0) != -1U) {
+		printf("hashed: the infinite time is modified\n");
+		failed++;
+	}
+
+	printf("spread: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
+
+static unsigned int
+test_limit(void)
+{
+	ni_dhcp_renew_limit_t limit;
+	unsigned int i, rate = 10, failed = 0;
+	unsigned long delay, last = 0;
+
+	memset(&limit, 0, sizeof(limit));
+	for (i = 0; i < 5 * rate; ++i) {
+		delay = ni_dhcp_renew_delay(&limit, rate);
+		if (i < rate && delay) {
+			printf("limit: renewal %u of the burst delayed by %lu msec\n", i, delay);
+			failed++;
+		}
+		if (i >= rate && (delay < last || delay > (i - rate + 1) * 1000 / rate + 50)) {
+			printf("limit: renewal %u delayed by %lu msec\n", i, delay);
+			failed++;
+		}
+		last = delay;
+	}
+	if (last < (4 * rate - 1) * 1000 / rate - 50) {
+		printf("limit: last renewal delayed by %lu msec only\n", last);
+		failed++;
+	}
+	if (ni_dhcp_renew_delay(&limit, 0)) {
+		printf("limit: unlimited rate delays renewals\n");
+		failed++;
+	}
+
+	printf("limit: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int failed = 0;
+
+	failed += test_spread();
+	failed += test_limit();
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,246 @@
+/*
+ *	Benchmark for the DHCPv4 response parser: compares the rate of
+ *	the full lease decoding to the option index pass, which is all
+ *	a dropped (foreign, blacklisted or not chosen) offer costs now,
+ *	and checks the index matches the decoded lease and rejects a
+ *	truncated offer or one with an oversized client-id.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <wicked/util.h>
+#include <wicked/socket.h>
+#include <wicked/logging.h>
+#include <wicked/resolver.h>
+
+#include "dhcp4/dhcp4.h"
+#include "dhcp4/protocol.h"
+#include "dhcp.h"
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+static unsigned char *
+put_option(unsigned char *p, unsigned int code, const void *data, unsigned int len)
+{
+	*p++ = code;
+	*p++ = len;
+	memcpy(p, data, len);
+	return p + len;
+}
+
+static unsigned char *
+put_addr(unsigned char *p, unsigned int code, const char *addr)
+{
+	struct in_addr in;
+
+	inet_aton(addr, &in);
+	return put_option(p, code, &in, sizeof(in));
+}
+
+static unsigned char *
+put_uint32(unsigned char *p, unsigned int code, uint32_t value)
+{
+	value = htonl(value);
+	return put_option(p, code, &value, sizeof(value));
+}
+
+/*
+ * An offer with the usual options, a DNS server list split in two
+ * parts (RFC 3396) and a domain name in the overloaded file field.
+ */
+static size_t
+build_offer(unsigned char *pkt, size_t size)
+{
+	static const unsigned char client_id[] = { 0x01, 0x52, 0x54, 0x00, 0x12, 0x34, 0x56 };
+	static const unsigned char csr[] = { 24, 10, 1, 2, 10, 0, 0, 1, 0, 10, 0, 0, 1 };
+	static const unsigned char vendor[] = { 0x01, 0x04, 0xde, 0xad, 0xbe, 0xef };
+	static const unsigned char dns1[] = { 10, 0, 0, 53, 10, 0, 1, 53 };
+	static const unsigned char dns2[] = { 10, 0, 2, 53 };
+	ni_dhcp4_message_t *message = (ni_dhcp4_message_t *)pkt;
+	unsigned char type = DHCP4_OFFER, overload = DHCP4_OVERLOAD_BOOTFILE;
+	unsigned char *p, *f;
+	uint16_t mtu = htons(1500);
+
+	memset(pkt, 0, size);
+	message->op = DHCP4_BOOTREPLY;
+	message->xid = 0x12345678;
+	inet_aton("10.0.0.42", (struct in_addr *)&message->yiaddr);
+	message->cookie = htonl(MAGIC_COOKIE);
+
+	f = put_option(message->bootfile, DHCP4_DNSDOMAIN, "example.com", 11);
+	*f = DHCP4_END;
+
+	p = pkt + sizeof(*message);
+	p = put_option(p, DHCP4_MESSAGETYPE, &type, 1);
+	p = put_addr(p, DHCP4_SERVERIDENTIFIER, "10.0.0.1");
+	p = put_option(p, DHCP4_CLIENTID, client_id, sizeof(client_id));
+	p = put_option(p, DHCP4_OPTIONSOVERLOADED, &overload, 1);
+	p = put_uint32(p, DHCP4_LEASETIME, 3600);
+	p = put_uint32(p, DHCP4_RENEWALTIME, 1800);
+	p = put_uint32(p, DHCP4_REBINDTIME, 3150);
+	p = put_addr(p, DHCP4_NETMASK, "255.255.255.0");
+	p = put_addr(p, DHCP4_BROADCAST, "10.0.0.255");
+	p = put_addr(p, DHCP4_ROUTERS, "10.0.0.1");
+	p = put_option(p, DHCP4_DNSSERVER, dns1, sizeof(dns1));
+	p = put_addr(p, DHCP4_NTPSERVER, "10.0.0.123");
+	p = put_option(p, DHCP4_MTU, &mtu, sizeof(mtu));
+	p = put_option(p, DHCP4_HOSTNAME, "client42", 8);
+	p = put_option(p, DHCP4_CSR, csr, sizeof(csr));
+	p = put_option(p, DHCP4_DNSSERVER, dns2, sizeof(dns2));
+	p = put_option(p, DHCP4_VENDORSPECIFICINFO, vendor, sizeof(vendor));
+	*p++ = DHCP4_END;
+
+	return p - pkt;
+}
+
+static int
+parse_index(unsigned char *pkt, size_t len, ni_dhcp4_option_index_t *index)
+{
+	ni_dhcp4_message_t *message;
+	ni_buffer_t buf;
+
+	ni_buffer_init_reader(&buf, pkt, len);
+	message = ni_buffer_pull_head(&buf, sizeof(*message));
+	return ni_dhcp4_parse_index(message, &buf, index);
+}
+
+static int
+parse_response(const ni_dhcp4_config_t *config, unsigned char *pkt, size_t len,
+		ni_addrconf_lease_t **lease)
+{
+	ni_dhcp4_message_t *message;
+	ni_buffer_t buf;
+
+	ni_buffer_init_reader(&buf, pkt, len);
+	message = ni_buffer_pull_head(&buf, sizeof(*message));
+	return ni_dhcp4_parse_response(config, message, &buf, lease);
+}
+
+static unsigned int
+check_offer(const ni_dhcp4_config_t *config, unsigned char *pkt, size_t len)
+{
+	unsigned char big[sizeof(ni_dhcp4_message_t) + 600], filler[200], *p;
+	ni_dhcp4_option_index_t index;
+	ni_addrconf_lease_t *lease = NULL;
+	const ni_resolver_info_t *resolver;
+	unsigned int failed = 0;
+
+	if (parse_index(pkt, len, &index) != DHCP4_OFFER ||
+	    parse_response(config, pkt, len, &lease) != DHCP4_OFFER || !lease) {
+		printf("check: unable to parse the offer\n");
+		return 1;
+	}
+	if (index.server_id.s_addr != lease->dhcp4.server_id.s_addr ||
+	    !ni_opaque_eq(&index.client_id, &lease->dhcp4.client_id) ||
+	    lease->dhcp4.client_id.len != 7) {
+		printf("check: index identifiers do not match the lease\n");
+		failed++;
+	}
+	if (lease->dhcp4.lease_time != 3600 || lease->dhcp4.mtu != 1500 ||
+	    !ni_string_eq(lease->hostname, "client42")) {
+		printf("check: lease options not decoded\n");
+		failed++;
+	}
+	resolver = lease->resolver;
+	if (!resolver || resolver->dns_servers.count != 3 ||
+	    !ni_string_eq(resolver->default_domain, "example.com")) {
+		printf("check: split or overloaded options not decoded\n");
+		failed++;
+	}
+	if (!ni_dhcp_option_list_find(lease->dhcp4.options, DHCP4_VENDORSPECIFICINFO)) {
+		printf("check: unparsed option not kept in the lease\n");
+		failed++;
+	}
+	ni_addrconf_lease_free(lease);
+
+	/* truncated options have to fail in the index pass already */
+	if (parse_index(pkt, len - 3, &index) >= 0) {
+		printf("check: truncated offer not rejected\n");
+		failed++;
+	}
+
+	/* a client-id too long to compare has to drop the offer */
+	memcpy(big, pkt, len);
+	memset(filler, 0x42, sizeof(filler));
+	p = put_option(big + len - 1, DHCP4_CLIENTID, filler, sizeof(filler));
+	*p++ = DHCP4_END;
+	if (parse_index(big, p - big, &index) >= 0) {
+		printf("check: offer with oversized client-id not rejected\n");
+		failed++;
+	}
+
+	printf("check: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned char pkt[sizeof(ni_dhcp4_message_t) + 312];
+	ni_dhcp4_option_index_t index;
+	ni_dhcp4_config_t config;
+	ni_addrconf_lease_t *lease;
+	unsigned int count = 200000, n, ok;
+	struct timeval begin;
+	double full, indexed;
+	size_t len;
+
+	if (argc > 1 && (ni_parse_uint(argv[1], &count, 10) || !count)) {
+		fprintf(stderr, "Usage: dhcp4-parse-bench [messages]\n");
+		return 1;
+	}
+
+	memset(&config, 0, sizeof(config));
+	len = build_offer(pkt, sizeof(pkt));
+	if (check_offer(&config, pkt, len))
+		return 1;
+
+	ni_timer_get_time(&begin);
+	for (n = ok = 0; n < count; ++n) {
+		lease = NULL;
+		ok += parse_response(&config, pkt, len, &lease) == DHCP4_OFFER;
+		ni_addrconf_lease_free(lease);
+	}
+	full = elapsed(&begin);
+	printf("full parse: %u messages in %.3fs, %.0f msg/s\n",
+			ok, full, count / full);
+
+	ni_timer_get_time(&begin);
+	for (n = ok = 0; n < count; ++n)
+		ok += parse_index(pkt, len, &index) == DHCP4_OFFER;
+	indexed = elapsed(&begin);
+	printf("index only: %u messages in %.3fs, %.0f msg/s (%.1fx)\n",
+			ok, indexed, count / indexed, full / indexed);
+
+	return ok == count ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+/*
+ *	Benchmark for the bulk interface statistics: compares the link
+ *	counters refresh by a full interface refresh to the RTM_GETSTATS
+ *	dump and checks the counters and the statistics cache.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <wicked/util.h>
+#include <wicked/socket.h>
+#include <wicked/netinfo.h>
+#include <wicked/linkstats.h>
+#include <wicked/logging.h>
+#include "netinfo_priv.h"
+#include "appconfig.h"
+#include "ifstats.h"
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+static ni_bool_t
+bench_sysfs_counter(const char *ifname, const char *name, unsigned long *value)
+{
+	char path[256];
+	FILE *fp;
+	ni_bool_t ret;
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/%s", ifname, name);
+	if (!(fp = fopen(path, "r")))
+		return FALSE;
+	ret = fscanf(fp, "%lu", value) == 1;
+	fclose(fp);
+	return ret;
+}
+
+static unsigned int
+bench_check(ni_netconfig_t *nc, ni_config_link_stats_t *conf)
+{
+	unsigned long before = 0, after = 0;
+	unsigned int failed = 0, count = 0, xstats = 0;
+	ni_netdev_t *dev;
+
+	/* the counters are within the sysfs counters read around the dump */
+	conf->cache_time = 0;
+	dev = ni_netdev_by_name(nc, "lo");
+	if (!dev || !bench_sysfs_counter(dev->name, "rx_bytes", &before) ||
+	    ni_ifstats_refresh(nc, NI_IFSTATS_ALL) != 1 ||
+	    !bench_sysfs_counter(dev->name, "rx_bytes", &after) || !dev->link.stats ||
+	    dev->link.stats->rx_bytes < before || dev->link.stats->rx_bytes > after) {
+		printf("check: lo rx_bytes %lu not within %lu..%lu\n",
+				dev && dev->link.stats ? dev->link.stats->rx_bytes : 0,
+				before, after);
+		failed++;
+	}
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		if (!dev->link.stats)
+			continue;
+		count++;
+		if (dev->link.xstats && dev->link.xstats->count)
+			xstats++;
+	}
+
+	/* refreshes within the cache time use the cached counters */
+	conf->cache_time = 60000;
+	if (ni_ifstats_refresh(nc, NI_IFSTATS_LINK) != 0 ||
+	    ni_ifstats_refresh(nc, NI_IFSTATS_ALL) != 0) {
+		printf("check: cached counters not used\n");
+		failed++;
+	}
+	ni_ifstats_invalidate();
+	if (ni_ifstats_refresh(nc, NI_IFSTATS_LINK) != 1 ||
+	    ni_ifstats_refresh(nc, NI_IFSTATS_ALL) != 1 ||
+	    ni_ifstats_refresh(nc, NI_IFSTATS_XSTATS) != 0) {
+		printf("check: invalidated counters not refreshed\n");
+		failed++;
+	}
+
+	printf("check: %s (%u devices, %u with extended counters)\n",
+			failed ? "FAILED" : "ok", count, xstats);
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	ni_config_link_stats_t *conf;
+	unsigned int count = 20, n;
+	struct timeval begin;
+	ni_netconfig_t *nc;
+	double full, bulk;
+
+	if (argc > 1 && (ni_parse_uint(argv[1], &count, 10) || !count)) {
+		fprintf(stderr, "Usage: ifstats-bench [refreshes]\n");
+		return 1;
+	}
+
+	if (ni_init("server") < 0)
+		return 1;
+	conf = &ni_global.config->link_stats;
+
+	if (!(nc = ni_global_state_handle(1)))
+		return 1;
+
+	if (bench_check(nc, conf))
+		return 1;
+
+	ni_timer_get_time(&begin);
+	for (n = 0; n < count; ++n) {
+		if (__ni_system_refresh_interfaces(nc) < 0)
+			return 1;
+	}
+	full = elapsed(&begin);
+	printf("link refresh:  %u refreshes in %.3fs\n", count, full);
+
+	conf->cache_time = 0;
+	ni_timer_get_time(&begin);
+	for (n = 0; n < count; ++n) {
+		if (ni_ifstats_refresh(nc, NI_IFSTATS_LINK) != 1)
+			return 1;
+	}
+	bulk = elapsed(&begin);
+	printf("stats refresh: %u refreshes in %.3fs (%.1fx)\n", count, bulk, full / bulk);
+
+	return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ *	Benchmark for our JSON routines: member lookups in large
+ *	objects and extraction of selected paths via the stream
+ *	parser vs. a full parse of a teamd-like state dump.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <wicked/socket.h>
+
+#include "json.h"
+
+static ni_json_t *
+init_state(unsigned int nports)
+{
+	ni_json_t *state, *ports, *port, *link, *runner;
+	unsigned int i;
+	char name[32];
+
+	state = ni_json_new_object();
+	ports = ni_json_new_object();
+	for (i = 0; i < nports; ++i) {
+		port = ni_json_new_object();
+
+		link = ni_json_new_object();
+		ni_json_object_set(link, "duplex", ni_json_new_string("full"));
+		ni_json_object_set(link, "speed", ni_json_new_int64(10000));
+		ni_json_object_set(link, "up", ni_json_new_bool(TRUE));
+		ni_json_object_set(port, "link", link);
+
+		link = ni_json_new_object();
+		ni_json_object_set(link, "name", ni_json_new_string("ethtool"));
+		ni_json_object_set(link, "delay_up", ni_json_new_int64(0));
+		ni_json_object_set(link, "delay_down", ni_json_new_int64(0));
+		ni_json_object_set(link, "up", ni_json_new_bool(i % 3 != 0));
+		ni_json_object_set(port, "link_watches", link);
+
+		snprintf(name, sizeof(name), "eth%u", i);
+		ni_json_object_set(ports, name, port);
+	}
+	ni_json_object_set(state, "ports", ports);
+
+	runner = ni_json_new_object();
+	ni_json_object_set(runner, "active_port", ni_json_new_string("eth0"));
+	ni_json_object_set(state, "runner", runner);
+
+	runner = ni_json_new_object();
+	ni_json_object_set(runner, "kernel_team_mode_name", ni_json_new_string("activebackup"));
+	ni_json_object_set(runner, "runner_name", ni_json_new_string("activebackup"));
+	ni_json_object_set(state, "setup", runner);
+	return state;
+}
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+static unsigned int
+lookup_ports(ni_json_t *state, unsigned int nports)
+{
+	ni_json_t *ports, *port, *link;
+	unsigned int i, up = 0;
+	ni_bool_t b;
+	char name[32];
+
+	ports = ni_json_object_get_value(state, "ports");
+	for (i = 0; i < nports; ++i) {
+		snprintf(name, sizeof(name), "eth%u", i);
+		port = ni_json_object_get_value(ports, name);
+		link = ni_json_object_get_value(port, "link_watches");
+		if (ni_json_bool_get(ni_json_object_get_value(link, "up"), &b) && b)
+			up++;
+	}
+	return up;
+}
+
+int
+main(int argc, char **argv)
+{
+	static const char * const paths[] = {
+		"/runner/active_port",
+		"/setup/runner_name",
+	};
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned int nports = 2000, loops = 50, n, up = 0;
+	ni_json_t *state, *values[2];
+	struct timeval begin;
+	double secs;
+	char *active = NULL;
+
+	if (argc > 1 && (ni_parse_uint(argv[1], &nports, 10) || !nports)) {
+		fprintf(stderr, "Usage: json-bench [ports] [loops]\n");
+		return 1;
+	}
+	if (argc > 2 && (ni_parse_uint(argv[2], &loops, 10) || !loops)) {
+		fprintf(stderr, "Usage: json-bench [ports] [loops]\n");
+		return 1;
+	}
+
+	state = init_state(nports);
+	ni_json_format_string(&buf, state, NULL);
+	ni_json_free(state);
+	printf("state dump with %u ports, %zu bytes\n", nports, buf.len);
+
+	ni_timer_get_time(&begin);
+	for (n = 0; n < loops; ++n) {
+		if (!(state = ni_json_parse_string(buf.string))) {
+			printf("parse error\n");
+			return 1;
+		}
+		up = lookup_ports(state, nports);
+		ni_json_free(state);
+	}
+	secs = elapsed(&begin);
+	printf("parse+lookup: %u loops in %.3fs, %.2fms/loop, %u ports up\n",
+			loops, secs, secs * 1000 / loops, up);
+
+	ni_timer_get_time(&begin);
+	for (n = 0; n < loops; ++n) {
+		if (ni_json_parse_paths(buf.string, 2, paths, values) != 2) {
+			printf("stream parse error\n");
+			return 1;
+		}
+		if (n + 1 == loops)
+			ni_json_string_get(values[0], &active);
+		ni_json_free(values[0]);
+		ni_json_free(values[1]);
+	}
+	secs = elapsed(&begin);
+	printf("parse-paths:  %u loops in %.3fs, %.2fms/loop, active port %s\n",
+			loops, secs, secs * 1000 / loops, active);
+
+	ni_string_free(&active);
+	ni_stringbuf_destroy(&buf);
+	return 0;
+}
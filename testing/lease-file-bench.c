@@ -0,0 +1,331 @@
+/*
+ *	Benchmark for the lease file store: compares synchronous lease
+ *	writes to the write-behind queue and the xml to the binary lease
+ *	file reads, and checks the coalescing, the binary encoding, the
+ *	fallback to the xml lease files and that a failed write keeps
+ *	the last good lease file.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+
+#include <wicked/util.h>
+#include <wicked/socket.h>
+#include <wicked/logging.h>
+#include <wicked/address.h>
+#include <wicked/addrconf.h>
+#include <wicked/resolver.h>
+#include "appconfig.h"
+#include "util_priv.h"
+
+#define BENCH_IFNAMES	4
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+static ni_addrconf_lease_t *
+bench_lease(unsigned int serial)
+{
+	ni_addrconf_lease_t *lease;
+
+	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET);
+	lease->state = NI_ADDRCONF_STATE_GRANTED;
+	lease->time_acquired = serial;
+	ni_string_dup(&lease->hostname, "client42");
+
+	lease->dhcp4.address.s_addr = inet_addr("10.0.0.42");
+	lease->dhcp4.server_id.s_addr = inet_addr("10.0.0.1");
+	lease->dhcp4.lease_time = 3600;
+	lease->dhcp4.renewal_time = 1800;
+	lease->dhcp4.rebind_time = 3150;
+
+	lease->resolver = ni_resolver_info_new();
+	ni_string_dup(&lease->resolver->default_domain, "example.com");
+	ni_string_array_append(&lease->resolver->dns_servers, "10.0.0.53");
+	ni_string_array_append(&lease->resolver->dns_servers, "10.0.1.53");
+	ni_string_array_append(&lease->ntp_servers, "10.0.0.123");
+	return lease;
+}
+
+static ni_bool_t
+bench_lease_eq(const ni_addrconf_lease_t *lease, unsigned int serial)
+{
+	return lease && lease->type == NI_ADDRCONF_DHCP && lease->family == AF_INET &&
+		lease->time_acquired == serial &&
+		ni_string_eq(lease->hostname, "client42") &&
+		lease->dhcp4.address.s_addr == inet_addr("10.0.0.42") &&
+		lease->dhcp4.lease_time == 3600 &&
+		lease->resolver && lease->resolver->dns_servers.count == 2 &&
+		lease->ntp_servers.count == 1;
+}
+
+static ni_bool_t
+bench_read_eq(const char *ifname, unsigned int serial)
+{
+	ni_addrconf_lease_t *lease;
+	ni_bool_t ret;
+
+	lease = ni_addrconf_lease_file_read(ifname, NI_ADDRCONF_DHCP, AF_INET);
+	ret = bench_lease_eq(lease, serial);
+	ni_addrconf_lease_free(lease);
+	return ret;
+}
+
+static int
+bench_write(const char *ifname, unsigned int serial)
+{
+	ni_addrconf_lease_t *lease;
+	int ret;
+
+	lease = bench_lease(serial);
+	ret = ni_addrconf_lease_file_write(ifname, lease);
+	ni_addrconf_lease_free(lease);
+	return ret;
+}
+
+static ni_bool_t
+bench_file_exists(const char *dir, const char *ifname, const char *suffix)
+{
+	char *path = NULL;
+	ni_bool_t ret;
+
+	ni_string_printf(&path, "%s/lease-%s-dhcp-ipv4.%s", dir, ifname, suffix);
+	ret = ni_file_exists(path);
+	ni_string_free(&path);
+	return ret;
+}
+
+static unsigned int
+bench_check(ni_config_lease_file_t *conf, const char *dir)
+{
+	ni_addrconf_lease_t *lease;
+	unsigned int failed = 0;
+	char *path = NULL;
+	FILE *fp;
+
+	conf->format = NI_CONFIG_LEASE_FILE_FORMAT_XML;
+	conf->write_delay = 0;
+	if (bench_write("check0", 1) < 0 || !bench_file_exists(dir, "check0", "xml") ||
+	    !bench_read_eq("check0", 1)) {
+		printf("check: xml lease not written\n");
+		failed++;
+	}
+
+	/* existing xml leases are read with the binary format */
+	conf->format = NI_CONFIG_LEASE_FILE_FORMAT_BINARY;
+	if (!bench_read_eq("check0", 1)) {
+		printf("check: no fallback to the xml lease\n");
+		failed++;
+	}
+	if (bench_write("check0", 2) < 0 || !bench_file_exists(dir, "check0", "bin") ||
+	    bench_file_exists(dir, "check0", "xml") || !bench_read_eq("check0", 2)) {
+		printf("check: binary lease not written\n");
+		failed++;
+	}
+
+	/* a corrupt binary lease falls back to the xml lease */
+	conf->format = NI_CONFIG_LEASE_FILE_FORMAT_XML;
+	bench_write("check1", 3);
+	ni_string_printf(&path, "%s/lease-check1-dhcp-ipv4.bin", dir);
+	if ((fp = fopen(path, "w"))) {
+		fputs("NILB\0\1", fp);
+		fclose(fp);
+	}
+	if (!bench_read_eq("check1", 3)) {
+		printf("check: corrupt binary lease not ignored\n");
+		failed++;
+	}
+	ni_addrconf_lease_file_remove("check1", NI_ADDRCONF_DHCP, AF_INET);
+	if (ni_file_exists(path) ||
+	    ni_addrconf_lease_file_exists("check1", NI_ADDRCONF_DHCP, AF_INET)) {
+		printf("check: lease files not removed\n");
+		failed++;
+	}
+	ni_string_free(&path);
+
+	/* queued writes are coalesced, readable and written on flush */
+	conf->write_delay = 1000;
+	bench_write("check2", 4);
+	bench_write("check2", 5);
+	if (bench_file_exists(dir, "check2", "xml") || !bench_read_eq("check2", 5) ||
+	    !ni_addrconf_lease_file_exists("check2", NI_ADDRCONF_DHCP, AF_INET)) {
+		printf("check: queued lease not coalesced\n");
+		failed++;
+	}
+	if (ni_addrconf_lease_file_flush() < 0 || !bench_file_exists(dir, "check2", "xml") ||
+	    !bench_read_eq("check2", 5)) {
+		printf("check: queued lease not written on flush\n");
+		failed++;
+	}
+	bench_write("check2", 6);
+	ni_addrconf_lease_file_remove("check2", NI_ADDRCONF_DHCP, AF_INET);
+	ni_addrconf_lease_file_flush();
+	if (ni_addrconf_lease_file_exists("check2", NI_ADDRCONF_DHCP, AF_INET)) {
+		printf("check: removed lease written on flush\n");
+		failed++;
+	}
+	ni_addrconf_lease_file_remove("check0", NI_ADDRCONF_DHCP, AF_INET);
+
+	/* a lease failing to encode keeps the last good lease file */
+	conf->format = NI_CONFIG_LEASE_FILE_FORMAT_BINARY;
+	conf->write_delay = 1000;
+	bench_write("check3", 7);
+	ni_addrconf_lease_file_flush();
+	lease = bench_lease(8);
+	ni_string_free(&lease->hostname);
+	lease->hostname = xcalloc(1, 70000);
+	memset(lease->hostname, 'x', 70000 - 1);
+	ni_addrconf_lease_file_write("check3", lease);
+	ni_addrconf_lease_free(lease);
+	if (ni_addrconf_lease_file_flush() == 0 || !bench_read_eq("check3", 7)) {
+		printf("check: lease file replaced by a failed write\n");
+		failed++;
+	}
+	ni_addrconf_lease_file_remove("check3", NI_ADDRCONF_DHCP, AF_INET);
+	conf->write_delay = 0;
+
+	printf("check: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
+
+/*
+ * Write count leases, round robin to the interfaces, flushing the
+ * queue after every burst of updates
+ */
+static unsigned int
+bench_run_write(unsigned int count, unsigned int burst)
+{
+	char ifname[IFNAMSIZ];
+	unsigned int n, ok = 0;
+
+	for (n = 0; n < count; ++n) {
+		snprintf(ifname, sizeof(ifname), "bench%u", n % BENCH_IFNAMES);
+		ok += bench_write(ifname, n) == 0;
+		if ((n + 1) % burst == 0 && ni_addrconf_lease_file_flush() < 0)
+			ok = 0;
+	}
+	if (ni_addrconf_lease_file_flush() < 0)
+		ok = 0;
+	return ok;
+}
+
+static unsigned int
+bench_run_read(unsigned int count)
+{
+	ni_addrconf_lease_t *lease;
+	unsigned int n, ok = 0;
+
+	for (n = 0; n < count; ++n) {
+		lease = ni_addrconf_lease_file_read("bench0", NI_ADDRCONF_DHCP, AF_INET);
+		ok += lease != NULL;
+		ni_addrconf_lease_free(lease);
+	}
+	return ok;
+}
+
+int
+main(int argc, char **argv)
+{
+	char dir[] = "/tmp/lease-file-bench.XXXXXX";
+	unsigned int count = 1000, burst = 16, ok, i;
+	ni_config_lease_file_t *conf;
+	struct timeval begin;
+	double synced, queued, xml, bin;
+	char *path = NULL;
+	int rv = 1;
+
+	if ((argc > 1 && (ni_parse_uint(argv[1], &count, 10) || !count)) ||
+	    (argc > 2 && (ni_parse_uint(argv[2], &burst, 10) || !burst))) {
+		fprintf(stderr, "Usage: lease-file-bench [writes] [burst]\n");
+		return 1;
+	}
+	if (!mkdtemp(dir)) {
+		fprintf(stderr, "Unable to create the directory %s\n", dir);
+		return 1;
+	}
+
+	ni_global.config = ni_config_new();
+	ni_config_fslocation_init(&ni_global.config->storedir, dir, 0755);
+	ni_config_fslocation_init(&ni_global.config->statedir, dir, 0755);
+	conf = &ni_global.config->addrconf.lease_file;
+
+	if (bench_check(conf, dir))
+		goto done;
+
+	conf->format = NI_CONFIG_LEASE_FILE_FORMAT_XML;
+	conf->write_delay = 0;
+	conf->sync = TRUE;
+	ni_timer_get_time(&begin);
+	ok = bench_run_write(count, 1);
+	synced = elapsed(&begin);
+	printf("sync write:   %u of %u leases in %.3fs, %.0f/s\n",
+			ok, count, synced, count / synced);
+	if (ok != count)
+		goto done;
+
+	conf->write_delay = 1000;
+	ni_timer_get_time(&begin);
+	ok = bench_run_write(count, burst);
+	queued = elapsed(&begin);
+	printf("queued write: %u of %u leases in %.3fs, %.0f/s (%.1fx), bursts of %u\n",
+			ok, count, queued, count / queued, synced / queued, burst);
+	if (ok != count)
+		goto done;
+
+	ni_timer_get_time(&begin);
+	ok = bench_run_read(count);
+	xml = elapsed(&begin);
+	printf("xml read:     %u of %u leases in %.3fs, %.0f/s\n",
+			ok, count, xml, count / xml);
+	if (ok != count)
+		goto done;
+
+	conf->format = NI_CONFIG_LEASE_FILE_FORMAT_BINARY;
+	bench_run_write(BENCH_IFNAMES, 1);
+	ni_timer_get_time(&begin);
+	ok = bench_run_read(count);
+	bin = elapsed(&begin);
+	printf("binary read:  %u of %u leases in %.3fs, %.0f/s (%.1fx)\n",
+			ok, count, bin, count / bin, xml / bin);
+	rv = ok == count ? 0 : 1;
+
+done:
+	for (i = 0; i < BENCH_IFNAMES; ++i) {
+		ni_string_printf(&path, "bench%u", i);
+		ni_addrconf_lease_file_remove(path, NI_ADDRCONF_DHCP, AF_INET);
+	}
+	ni_string_free(&path);
+	rmdir(dir);
+	return rv;
+}
@@ -0,0 +1,313 @@
+/*
+ *	Benchmark for the asynchronous logging: compares the time spent
+ *	in the debug log calls with synchronous and asynchronous logging
+ *	and checks the order of the written messages, the drop overflow
+ *	policy, the messages spilled into several records, the flight
+ *	recorder dump and the synchronous logging of forked children.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <wicked/util.h>
+#include <wicked/socket.h>
+#include <wicked/logging.h>
+
+#define FLIGHT_RECORDS	256
+#define LONG_MSGLEN	20000
+#define LONG_COUNT	3
+
+static char	test_dir[] = "/tmp/log-async-bench.XXXXXX";
+static char	log_file[PATH_MAX];
+static char	dump_file[PATH_MAX];
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+/*
+ * Send stderr into a new log file
+ */
+static ni_bool_t
+bench_log_open(void)
+{
+	int fd;
+
+	fflush(stderr);
+	if ((fd = open(log_file, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0)
+		return FALSE;
+	dup2(fd, 2);
+	close(fd);
+	return TRUE;
+}
+
+/*
+ * Count the messages in a file and check their order
+ */
+static unsigned int
+bench_count(const char *path, const char *pattern, ni_bool_t *ordered)
+{
+	unsigned int count = 0, n, last = 0;
+	char line[1024], *p;
+	FILE *fp;
+
+	*ordered = TRUE;
+	if (!(fp = fopen(path, "r")))
+		return 0;
+	while (fgets(line, sizeof(line), fp)) {
+		if (!(p = strstr(line, pattern)) || sscanf(p + strlen(pattern), "%u", &n) != 1)
+			continue;
+		if (count && n <= last)
+			*ordered = FALSE;
+		last = n;
+		count++;
+	}
+	fclose(fp);
+	return count;
+}
+
+/*
+ * Count the complete long messages in a file
+ */
+static unsigned int
+bench_count_long(const char *path, const char *text)
+{
+	unsigned int count = 0;
+	size_t size = 0;
+	char *line = NULL;
+	FILE *fp;
+
+	if (!(fp = fopen(path, "r")))
+		return 0;
+	while (getline(&line, &size, fp) > 0) {
+		if (strstr(line, text) && strstr(line, "long message end"))
+			count++;
+	}
+	free(line);
+	fclose(fp);
+	return count;
+}
+
+static unsigned int
+bench_check_long(void)
+{
+	unsigned int failed = 0, written, dumped, n;
+	char *text;
+
+	if (!(text = malloc(LONG_MSGLEN + 1)))
+		return 1;
+	memset(text, 'x', LONG_MSGLEN);
+	text[LONG_MSGLEN] = '\0';
+
+	if (!bench_log_open() || !ni_log_async_start(1024, NI_LOG_OVERFLOW_BLOCK,
+						FLIGHT_RECORDS, dump_file)) {
+		free(text);
+		return 1;
+	}
+	for (n = 0; n < LONG_COUNT; ++n) {
+		ni_debug_events("short message %u", n);
+		ni_debug_events("long message %u %s long message end", n, text);
+	}
+	ni_log_async_flush();
+	raise(SIGUSR2);
+	ni_log_async_stop();
+
+	written = bench_count_long(log_file, text);
+	dumped = bench_count_long(dump_file, text);
+	if (written != LONG_COUNT || dumped != LONG_COUNT) {
+		printf("check: %u long messages written, %u dumped of %u\n",
+				written, dumped, LONG_COUNT);
+		failed++;
+	}
+	free(text);
+	return failed;
+}
+
+static double
+bench_run(const char *name, unsigned int count)
+{
+	struct timeval begin;
+	unsigned int n;
+
+	ni_timer_get_time(&begin);
+	for (n = 0; n < count; ++n)
+		ni_debug_events("%s message %u of interface %s", name, n, "eth0");
+	return elapsed(&begin);
+}
+
+/*
+ * Children forked while the writer formats time stamps log synchronously
+ * and must not find the libc locks held by the lost writer thread.
+ */
+static unsigned int
+bench_check_fork(unsigned int count)
+{
+	struct timespec pause = { .tv_nsec = 1000000 };
+	unsigned int n, waited, hung = 0;
+	pid_t pid;
+	int status;
+
+	if (!bench_log_open() || !ni_log_async_start(4096, NI_LOG_OVERFLOW_BLOCK, 0, NULL))
+		return 1;
+	for (n = 0; n < 100; ++n) {
+		bench_run("fork", count / 100);
+		if ((pid = fork()) < 0)
+			break;
+		if (pid == 0) {
+			bench_run("child", 10);
+			_exit(0);
+		}
+		for (waited = 0; waitpid(pid, &status, WNOHANG) == 0; ++waited) {
+			if (waited == 5000) {
+				kill(pid, SIGKILL);
+				waitpid(pid, &status, 0);
+				hung++;
+				break;
+			}
+			nanosleep(&pause, NULL);
+		}
+	}
+	ni_log_async_stop();
+
+	if (hung) {
+		printf("check: %u of %u forked children hung logging\n", hung, n);
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned int
+bench_check(unsigned int count)
+{
+	unsigned int failed = 0, written, dumped;
+	ni_bool_t ordered;
+	unsigned long dropped;
+
+	/* all messages are written in order in block mode */
+	if (!bench_log_open() || !ni_log_async_start(1024, NI_LOG_OVERFLOW_BLOCK,
+						FLIGHT_RECORDS, dump_file))
+		return 1;
+	bench_run("block", count);
+	ni_log_async_flush();
+
+	written = bench_count(log_file, "block message ", &ordered);
+	if (written != count || !ordered) {
+		printf("check: block wrote %u of %u messages%s\n", written, count,
+				ordered ? "" : " out of order");
+		failed++;
+	}
+
+	/* the flight recorder dumps the last messages on SIGUSR2 */
+	raise(SIGUSR2);
+	dumped = bench_count(dump_file, "block message ", &ordered);
+	if (dumped != FLIGHT_RECORDS || !ordered) {
+		printf("check: flight recorder dumped %u of %u messages%s\n",
+				dumped, FLIGHT_RECORDS, ordered ? "" : " out of order");
+		failed++;
+	}
+	ni_log_async_stop();
+
+	/* a burst into a small ring drops messages and reports them */
+	if (!bench_log_open() || !ni_log_async_start(16, NI_LOG_OVERFLOW_DROP, 0, NULL))
+		return failed + 1;
+	bench_run("drop", count);
+	dropped = ni_log_async_dropped();
+	ni_log_async_stop();
+
+	written = bench_count(log_file, "drop message ", &ordered);
+	if (written + dropped != count || !ordered ||
+	    (dropped && !bench_count(log_file, "Warning: ", &ordered))) {
+		printf("check: drop wrote %u and dropped %lu of %u messages\n",
+				written, dropped, count);
+		failed++;
+	}
+
+	failed += bench_check_long();
+	failed += bench_check_fork(count);
+
+	printf("check: %s (%lu of %u dropped with 16 records)\n",
+			failed ? "FAILED" : "ok", dropped, count);
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int count = 100000;
+	double sync, async, flush;
+	struct timeval begin;
+	int rv = 1;
+
+	if (argc > 1 && (ni_parse_uint(argv[1], &count, 10) || !count)) {
+		fprintf(stderr, "Usage: log-async-bench [messages]\n");
+		return 1;
+	}
+	if (!mkdtemp(test_dir)) {
+		fprintf(stderr, "Unable to create the directory %s\n", test_dir);
+		return 1;
+	}
+	snprintf(log_file, sizeof(log_file), "%s/bench.log", test_dir);
+	snprintf(dump_file, sizeof(dump_file), "%s/bench.flight-recorder", test_dir);
+
+	ni_log_destination("log-async-bench", "stderr:time,pid,ident");
+	ni_enable_debug("events");
+
+	if (bench_check(count))
+		goto done;
+
+	if (!bench_log_open())
+		goto done;
+	sync = bench_run("sync", count);
+	printf("sync:  %u debug messages in %.3fs\n", count, sync);
+
+	if (!bench_log_open() || !ni_log_async_start(4096, NI_LOG_OVERFLOW_BLOCK, 0, NULL))
+		goto done;
+	ni_timer_get_time(&begin);
+	async = bench_run("async", count);
+	ni_log_async_flush();
+	flush = elapsed(&begin);
+	ni_log_async_stop();
+	printf("async: %u debug messages in %.3fs (%.1fx), written after %.3fs\n",
+			count, async, sync / async, flush);
+	rv = 0;
+
+done:
+	unlink(log_file);
+	unlink(dump_file);
+	rmdir(test_dir);
+	return rv;
+}
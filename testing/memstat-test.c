@@ -0,0 +1,177 @@
+/*
+ *	Test for the tagged allocations: creates synthetic network devices
+ *	with addresses and routes and checks the live bytes, object counts
+ *	and high-water marks accounted per tag as well as the per-object cost
+ *	and that grown dbus variant arrays are accounted until destroyed.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+#include <wicked/address.h>
+#include <wicked/route.h>
+#include <wicked/dbus.h>
+
+#include "util_priv.h"
+
+#define NETDEV_COUNT	10000
+
+/* the malloc chunk header and rounding slack per object */
+#define MALLOC_SLACK	(4 * sizeof(size_t))
+
+static unsigned int
+test_cost(ni_memtag_t tag, size_t count, size_t size)
+{
+	const ni_memstat_t *stat = ni_memstat_get(tag);
+	size_t cost;
+
+	if (!stat || stat->count != count) {
+		printf("%s: %zu of %zu objects accounted\n", ni_memtag_name(tag),
+				stat ? stat->count : 0, count);
+		return 1;
+	}
+
+	cost = stat->bytes / count;
+	printf("%s: %zu objects, %zu bytes, %zu bytes per object of size %zu\n",
+			ni_memtag_name(tag), stat->count, stat->bytes, cost, size);
+	if (cost < size || cost > size + MALLOC_SLACK) {
+		printf("%s: unexpected per-object cost\n", ni_memtag_name(tag));
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned int
+test_released(ni_memtag_t tag, size_t peak)
+{
+	const ni_memstat_t *stat = ni_memstat_get(tag);
+
+	if (stat->count || stat->bytes || stat->peak_count != peak) {
+		printf("%s: %zu objects with %zu bytes live after release, peak %zu\n",
+				ni_memtag_name(tag), stat->count, stat->bytes,
+				stat->peak_count);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Grow the arrays of a dict with byte, string, variant and
+ * struct members beyond the allocation chunk and release it.
+ */
+static unsigned int
+test_dbus_array(void)
+{
+	ni_dbus_variant_t dict = NI_DBUS_VARIANT_INIT;
+	ni_dbus_variant_t *var;
+	const ni_memstat_t *stat;
+	unsigned char data[100];
+	unsigned int i;
+	char name[32];
+
+	memset(data, 0x5a, sizeof(data));
+	ni_dbus_variant_init_dict(&dict);
+	for (i = 0; i < 40; ++i) {
+		snprintf(name, sizeof(name), "entry%u", i);
+		ni_dbus_dict_add_byte_array(&dict, name, data, sizeof(data));
+	}
+
+	var = ni_dbus_dict_add(&dict, "strings");
+	ni_dbus_variant_init_string_array(var);
+	for (i = 0; i < 40; ++i)
+		ni_dbus_variant_append_string_array(var, "string");
+
+	var = ni_dbus_dict_add(&dict, "variants");
+	ni_dbus_variant_init_variant_array(var);
+	for (i = 0; i < 40; ++i)
+		ni_dbus_variant_set_uint32(ni_dbus_variant_append_variant_element(var), i);
+
+	var = ni_dbus_dict_add(&dict, "struct");
+	ni_dbus_variant_init_struct(var);
+	for (i = 0; i < 40; ++i)
+		ni_dbus_struct_add_string(var, "member");
+
+	stat = ni_memstat_get(NI_MEMTAG_DBUS_ARRAY);
+	printf("%s: %zu arrays, %zu bytes\n", ni_memtag_name(NI_MEMTAG_DBUS_ARRAY),
+			stat->count, stat->bytes);
+	if (stat->count < 44) {
+		printf("%s: arrays not accounted\n", ni_memtag_name(NI_MEMTAG_DBUS_ARRAY));
+		return 1;
+	}
+
+	ni_dbus_variant_destroy(&dict);
+	return test_released(NI_MEMTAG_DBUS_ARRAY, stat->peak_count);
+}
+
+int
+main(int argc, char **argv)
+{
+	ni_netdev_t **devs;
+	ni_sockaddr_t local;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned int i, failed = 0;
+	char name[IFNAMSIZ];
+
+	devs = calloc(NETDEV_COUNT, sizeof(*devs));
+	for (i = 0; i < NETDEV_COUNT; ++i) {
+		snprintf(name, sizeof(name), "dummy%u", i);
+		devs[i] = ni_netdev_new(name, i + 1);
+
+		ni_sockaddr_parse(&local, "192.0.2.1", AF_INET);
+		local.sin.sin_addr.s_addr = htonl(0xc0000201 + i);
+		ni_address_new(AF_INET, 24, &local, &devs[i]->addrs);
+		ni_route_create(24, &local, NULL, 0, &devs[i]->routes);
+	}
+
+	failed += test_cost(NI_MEMTAG_NETDEV,  NETDEV_COUNT, sizeof(ni_netdev_t));
+	failed += test_cost(NI_MEMTAG_ADDRESS, NETDEV_COUNT, sizeof(ni_address_t));
+	failed += test_cost(NI_MEMTAG_ROUTE,   NETDEV_COUNT, sizeof(ni_route_t));
+
+	ni_memstat_format(&buf);
+	printf("%s", buf.string);
+	ni_stringbuf_destroy(&buf);
+
+	for (i = 0; i < NETDEV_COUNT; ++i)
+		ni_netdev_put(devs[i]);
+	free(devs);
+
+	failed += test_released(NI_MEMTAG_NETDEV,  NETDEV_COUNT);
+	failed += test_released(NI_MEMTAG_ADDRESS, NETDEV_COUNT);
+	failed += test_released(NI_MEMTAG_ROUTE,   NETDEV_COUNT);
+
+	failed += test_dbus_array();
+
+	/* the high-water marks restart from the live values */
+	ni_memstat_reset();
+	if (ni_memstat_get(NI_MEMTAG_NETDEV)->peak_count) {
+		printf("%s: high-water mark not reset\n", ni_memtag_name(NI_MEMTAG_NETDEV));
+		failed++;
+	}
+
+	printf("memstat: %s\n", failed ? "FAILED" : "ok");
+	return failed ? 1 : 0;
+}
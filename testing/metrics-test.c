@@ -0,0 +1,297 @@
+/*
+ *	Test for the daemon metrics: updates timer and process metrics,
+ *	scrapes the metrics socket as HTTP and plain text client and checks
+ *	the exposition format, counters and histograms of the response.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <wicked/util.h>
+#include <wicked/socket.h>
+
+#include "appconfig.h"
+#include "process.h"
+#include "metrics.h"
+
+static char	test_dir[] = "/tmp/metrics-test.XXXXXX";
+
+static void
+test_timer_expired(void *user_data, const ni_timer_t *timer)
+{
+	(*(unsigned int *)user_data)++;
+}
+
+static unsigned int
+test_update(void)
+{
+	unsigned int failed = 0, expired = 0;
+	const ni_timer_t *timer;
+	ni_shellcmd_t *cmd;
+	ni_process_t *pi;
+
+	ni_timer_register(1, test_timer_expired, &expired);
+	timer = ni_timer_register(60000, test_timer_expired, &expired);
+	ni_timer_cancel(timer);
+	usleep(5000);
+	ni_timer_next_timeout();
+
+	if ((cmd = ni_shellcmd_parse("/bin/true")) != NULL) {
+		if ((pi = ni_process_new(cmd)) != NULL) {
+			ni_process_run_and_wait(pi);
+			ni_process_free(pi);
+		}
+		ni_shellcmd_release(cmd);
+	}
+
+	if (expired != 1 ||
+	    ni_metrics_value(NI_METRIC_TIMERS_REGISTERED) != 2 ||
+	    ni_metrics_value(NI_METRIC_TIMERS_EXPIRED) != 1 ||
+	    ni_metrics_value(NI_METRIC_TIMERS_CANCELLED) != 1 ||
+	    ni_metrics_value(NI_METRIC_TIMERS_ACTIVE) != 0 ||
+	    ni_metrics_value(NI_METRIC_TIMER_LATENESS) != 1) {
+		printf("update: timer metrics not updated\n");
+		failed++;
+	}
+	if (ni_metrics_value(NI_METRIC_PROCESSES_SPAWNED) != 1) {
+		printf("update: process metrics not updated\n");
+		failed++;
+	}
+	return failed;
+}
+
+static ni_bool_t
+test_scrape(const char *request, ni_stringbuf_t *response)
+{
+	struct sockaddr_un sun;
+	char buf[4096];
+	ssize_t len = -1;
+	double begin;
+	int fd;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_LOCAL;
+	snprintf(sun.sun_path, sizeof(sun.sun_path), "%s/metrics-test.metrics", test_dir);
+
+	if ((fd = socket(AF_LOCAL, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0)
+		return FALSE;
+	if (connect(fd, (struct sockaddr *) &sun, sizeof(sun)) < 0 ||
+	    (request && write(fd, request, strlen(request)) < 0)) {
+		close(fd);
+		return FALSE;
+	}
+
+	/* the metrics connection is served by the event loop */
+	begin = ni_metrics_time();
+	while (len && ni_metrics_time() - begin < 5.0) {
+		if (ni_socket_wait(100) < 0)
+			break;
+		while ((len = read(fd, buf, sizeof(buf) - 1)) > 0) {
+			buf[len] = '\0';
+			ni_stringbuf_puts(response, buf);
+		}
+	}
+	close(fd);
+	return len == 0 && response->len;
+}
+
+/*
+ * Accepting a client that does not send a request and does not
+ * read the response must not block the event loop.
+ */
+static ni_bool_t
+test_silent_client(void)
+{
+	struct sockaddr_un sun;
+	unsigned int loops;
+	double begin;
+	int fd;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_LOCAL;
+	snprintf(sun.sun_path, sizeof(sun.sun_path), "%s/metrics-test.metrics", test_dir);
+
+	if ((fd = socket(AF_LOCAL, SOCK_STREAM, 0)) < 0)
+		return FALSE;
+	if (connect(fd, (struct sockaddr *) &sun, sizeof(sun)) < 0) {
+		close(fd);
+		return FALSE;
+	}
+
+	begin = ni_metrics_time();
+	for (loops = 0; loops < 3; ++loops)
+		ni_socket_wait(0);
+	close(fd);
+	return ni_metrics_time() - begin < 0.05;
+}
+
+static unsigned int
+test_check_format(const char *text)
+{
+	ni_string_array_t lines = NI_STRING_ARRAY_INIT;
+	ni_string_array_t types = NI_STRING_ARRAY_INIT;
+	unsigned long long value, bucket = 0;
+	unsigned int i, failed = 0, samples = 0;
+	char name[128];
+
+	ni_string_split(&lines, text, "\n", 0);
+	for (i = 0; i < lines.count; ++i) {
+		const char *line = lines.data[i];
+		const char *sp;
+
+		if (sscanf(line, "# TYPE %127s", name) == 1) {
+			ni_string_array_append(&types, name);
+			continue;
+		}
+		if (line[0] == '#')
+			continue;
+
+		if (!(sp = strrchr(line, ' ')) || sscanf(line, "%127[^{ ]", name) != 1) {
+			printf("format: invalid sample line '%s'\n", line);
+			failed++;
+			continue;
+		}
+		samples++;
+
+		/* the samples of a histogram belong to its family */
+		ni_string_strip_suffix(name, "_bucket");
+		ni_string_strip_suffix(name, "_sum");
+		ni_string_strip_suffix(name, "_count");
+		if (ni_string_array_index(&types, name) < 0) {
+			printf("format: sample '%s' without type\n", line);
+			failed++;
+		}
+
+		/* the cumulative buckets increase up to the +Inf bucket */
+		value = strtoull(sp + 1, NULL, 10);
+		if (strstr(line, "_bucket{")) {
+			if (strstr(line, "le=\"0.0001\""))
+				bucket = 0;
+			if (value < bucket) {
+				printf("format: bucket '%s' not cumulative\n", line);
+				failed++;
+			}
+			bucket = value;
+		} else
+		if (strstr(line, "_count")) {
+			if (value != bucket) {
+				printf("format: '%s' differs from the +Inf bucket\n", line);
+				failed++;
+			}
+		}
+	}
+
+	if (!samples || !strstr(text, "wicked_timers_expired_total 1\n") ||
+	    !strstr(text, "wicked_processes_spawned_total 1\n") ||
+	    !strstr(text, "wicked_timer_lateness_seconds_count 1\n") ||
+	    !strstr(text, "wicked_netlink_events_total{type=\"link\"} 0\n")) {
+		printf("format: expected metrics missing\n");
+		failed++;
+	}
+
+	ni_string_array_destroy(&types);
+	ni_string_array_destroy(&lines);
+	return failed;
+}
+
+static unsigned int
+test_export(void)
+{
+	ni_stringbuf_t http = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t plain = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned int failed = 0;
+	const char *body;
+
+	if (!test_scrape("GET /metrics HTTP/1.0\r\n\r\n", &http) ||
+	    !ni_string_startswith(http.string, "HTTP/1.0 200 OK\r\n") ||
+	    !strstr(http.string, "Content-Type: text/plain; version=0.0.4\r\n") ||
+	    !(body = strstr(http.string, "\r\n\r\n"))) {
+		printf("export: invalid http response\n");
+		failed++;
+	} else {
+		failed += test_check_format(body + 4);
+	}
+
+	if (!test_scrape(NULL, &plain) || !ni_string_startswith(plain.string, "# HELP ")) {
+		printf("export: invalid plain response\n");
+		failed++;
+	} else {
+		failed += test_check_format(plain.string);
+	}
+
+	if (!test_silent_client()) {
+		printf("export: a silent client stalls the event loop\n");
+		failed++;
+	}
+
+	if (ni_metrics_value(NI_METRIC_EVENT_LOOP_ITERATIONS) < 2 ||
+	    ni_metrics_value(NI_METRIC_SOCKET_RECEIVE) < 2) {
+		printf("export: event loop metrics not updated\n");
+		failed++;
+	}
+
+	printf("export: %s (%zu bytes)\n", failed ? "FAILED" : "ok", http.len);
+	ni_stringbuf_destroy(&plain);
+	ni_stringbuf_destroy(&http);
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	char path[PATH_MAX];
+	int rv = 1;
+
+	if (!mkdtemp(test_dir)) {
+		fprintf(stderr, "Unable to create the directory %s\n", test_dir);
+		return 1;
+	}
+
+	ni_global.config = ni_config_new();
+	ni_config_fslocation_init(&ni_global.config->statedir, test_dir, 0755);
+	ni_global.config->metrics.enabled = TRUE;
+
+	ni_metrics_reset();
+	if (test_update())
+		goto done;
+
+	if (ni_metrics_listen("metrics-test") < 0)
+		goto done;
+
+	if (test_export())
+		goto done;
+	rv = 0;
+
+done:
+	ni_socket_deactivate_all();
+	snprintf(path, sizeof(path), "%s/metrics-test.metrics", test_dir);
+	unlink(path);
+	rmdir(test_dir);
+	ni_config_free(ni_global.config);
+	return rv;
+}
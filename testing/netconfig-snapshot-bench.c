@@ -0,0 +1,195 @@
+/*
+ *	Benchmark for the wickedd warm-restart snapshot: compares the
+ *	initial interface refresh without and with the snapshot written
+ *	on the previous shutdown, and checks the reconciliation with the
+ *	current devices and the deferred link details refresh.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <wicked/util.h>
+#include <wicked/socket.h>
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+#include "netinfo_priv.h"
+#include "appconfig.h"
+#include "snapshot.h"
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+static unsigned int
+bench_count(ni_netconfig_t *nc)
+{
+	unsigned int count = 0;
+	ni_netdev_t *dev;
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+		count++;
+	return count;
+}
+
+/*
+ * Refresh count times from an empty interface list, as on a start
+ */
+static double
+bench_refresh(ni_netconfig_t *nc, unsigned int count, ni_bool_t warm)
+{
+	struct timeval begin;
+	double taken = 0;
+	unsigned int n;
+
+	for (n = 0; n < count; ++n) {
+		if (warm && ni_netconfig_snapshot_save(nc) < 0)
+			return -1;
+		ni_netconfig_destroy(nc);
+
+		ni_timer_get_time(&begin);
+		if (warm && !ni_netconfig_snapshot_load())
+			return -1;
+		if (__ni_system_refresh_interfaces(nc) < 0)
+			return -1;
+		taken += elapsed(&begin);
+
+		ni_netconfig_snapshot_destroy();
+	}
+	return taken;
+}
+
+static unsigned int
+bench_check(ni_netconfig_t *nc, const char *dir)
+{
+	unsigned int failed = 0, count, deferred;
+	char *path = NULL;
+	ni_netdev_t *dev;
+	FILE *fp;
+
+	count = bench_count(nc);
+	ni_string_printf(&path, "%s/netconfig.snapshot", dir);
+	if (ni_netconfig_snapshot_save(nc) < 0 || !ni_file_exists(path)) {
+		printf("check: snapshot not written\n");
+		failed++;
+	}
+
+	/* all devices are unchanged, the snapshot is consumed */
+	ni_netconfig_destroy(nc);
+	if (!ni_netconfig_snapshot_load() || ni_file_exists(path) ||
+	    __ni_system_refresh_interfaces(nc) < 0 || bench_count(nc) != count) {
+		printf("check: snapshot not loaded\n");
+		failed++;
+	}
+	deferred = ni_netconfig_snapshot_refresh(nc, 0);
+	if (deferred != count) {
+		printf("check: %u of %u devices deferred\n", deferred, count);
+		failed++;
+	}
+	if (ni_netconfig_snapshot_refresh(nc, -1U) || ni_netconfig_snapshot_active()) {
+		printf("check: deferred refresh not done\n");
+		failed++;
+	}
+	ni_netconfig_snapshot_destroy();
+
+	/* a renamed device is discovered immediately */
+	if ((dev = ni_netconfig_devlist(nc)))
+		ni_string_dup(&dev->name, "renamed0");
+	ni_netconfig_snapshot_save(nc);
+	ni_netconfig_destroy(nc);
+	ni_netconfig_snapshot_load();
+	__ni_system_refresh_interfaces(nc);
+	if (ni_netconfig_snapshot_refresh(nc, 0) != count - 1) {
+		printf("check: renamed device still deferred\n");
+		failed++;
+	}
+	ni_netconfig_snapshot_destroy();
+
+	/* the snapshot of another boot is ignored */
+	ni_netconfig_snapshot_save(nc);
+	if ((fp = fopen(path, "r+"))) {
+		fputs("wicked-netconfig-snapshot 1 00000000-0000", fp);
+		fclose(fp);
+	}
+	if (ni_netconfig_snapshot_load() || ni_file_exists(path)) {
+		printf("check: snapshot of another boot not ignored\n");
+		failed++;
+	}
+
+	ni_string_free(&path);
+	printf("check: %s (%u devices)\n", failed ? "FAILED" : "ok", count);
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	char dir[] = "/tmp/netconfig-snapshot-bench.XXXXXX";
+	unsigned int count = 5;
+	ni_netconfig_t *nc;
+	double cold, warm;
+	int rv = 1;
+
+	if (argc > 1 && (ni_parse_uint(argv[1], &count, 10) || !count)) {
+		fprintf(stderr, "Usage: netconfig-snapshot-bench [refreshes]\n");
+		return 1;
+	}
+	if (!mkdtemp(dir)) {
+		fprintf(stderr, "Unable to create the directory %s\n", dir);
+		return 1;
+	}
+
+	if (ni_init("server") < 0)
+		goto done;
+	ni_config_fslocation_init(&ni_global.config->statedir, dir, 0755);
+	ni_global.config->warm_restart.enabled = TRUE;
+
+	if (!(nc = ni_global_state_handle(1)))
+		goto done;
+
+	if (bench_check(nc, dir))
+		goto done;
+
+	if ((cold = bench_refresh(nc, count, FALSE)) < 0)
+		goto done;
+	printf("cold start: %u refreshes of %u devices in %.3fs\n",
+			count, bench_count(nc), cold);
+
+	if ((warm = bench_refresh(nc, count, TRUE)) < 0)
+		goto done;
+	printf("warm start: %u refreshes of %u devices in %.3fs (%.1fx)\n",
+			count, bench_count(nc), warm, cold / warm);
+	rv = 0;
+
+done:
+	rmdir(dir);
+	return rv;
+}
@@ -0,0 +1,130 @@
+/*
+ *	Benchmark for the subprocess execution: runs /bin/true from a
+ *	process with a large heap and a high open files limit, as with
+ *	wickedd under systemd, comparing the spawn path to the fork path
+ *	used for the in-process exec hooks.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <wicked/util.h>
+#include <wicked/socket.h>
+#include <wicked/logging.h>
+#include "process.h"
+
+#define BENCH_COMMAND	"/bin/true"
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+/*
+ * An exec hook forces the fork path for the same command
+ */
+static int
+exec_hook(int argc, char *const argv[], char *const envp[])
+{
+	execve(argv[0], argv, envp);
+	return -1;
+}
+
+static unsigned int
+run(ni_shellcmd_t *cmd, unsigned int count, ni_bool_t fork_path)
+{
+	ni_process_t *pi;
+	unsigned int n, ok;
+
+	for (n = ok = 0; n < count; ++n) {
+		if (!(pi = ni_process_new(cmd)))
+			break;
+		if (fork_path)
+			pi->exec = exec_hook;
+		ok += ni_process_run_and_wait(pi) == NI_PROCESS_SUCCESS;
+		ni_process_free(pi);
+	}
+	return ok;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int count = 1000, heap = 1024, ok;
+	struct timeval begin;
+	ni_shellcmd_t *cmd;
+	struct rlimit rlim;
+	double spawned, forked;
+	char *mem;
+
+	if ((argc > 1 && (ni_parse_uint(argv[1], &count, 10) || !count)) ||
+	    (argc > 2 && ni_parse_uint(argv[2], &heap, 10))) {
+		fprintf(stderr, "Usage: process-spawn-bench [processes] [heap MiB]\n");
+		return 1;
+	}
+
+	/* Open files limit as high as permitted */
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0) {
+		rlim.rlim_cur = rlim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rlim);
+	}
+	printf("open files limit %ld, heap %u MiB\n", (long)getdtablesize(), heap);
+
+	/* Touch the heap, so fork has to copy all its page tables */
+	if (heap) {
+		if (!(mem = malloc((size_t)heap << 20))) {
+			fprintf(stderr, "Unable to allocate the heap\n");
+			return 1;
+		}
+		memset(mem, 0x5a, (size_t)heap << 20);
+	}
+
+	if (!(cmd = ni_shellcmd_parse(BENCH_COMMAND)))
+		return 1;
+
+	ni_timer_get_time(&begin);
+	ok = run(cmd, count, FALSE);
+	spawned = elapsed(&begin);
+	printf("spawn: %u of %u processes in %.3fs, %.0f/s\n",
+			ok, count, spawned, count / spawned);
+	if (ok != count)
+		return 1;
+
+	ni_timer_get_time(&begin);
+	ok = run(cmd, count, TRUE);
+	forked = elapsed(&begin);
+	printf("fork:  %u of %u processes in %.3fs, %.0f/s (%.1fx)\n",
+			ok, count, forked, count / forked, forked / spawned);
+
+	ni_shellcmd_free(cmd);
+	return ok == count ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#!/bin/bash
+#
+# Benchmark of the DHCPv4 packet capture: creates <count> veth pairs
+# and runs capture-bench with a socket per device, the shared socket
+# and the shared socket with receive ring on them, and closes all
+# captures from their retransmit callbacks.
+#
+# Usage: capture-bench.sh [count] [capture-bench binary] [rounds]
+#
+
+count=${1:-2000}
+bench=${2:-./capture-bench}
+rounds=${3:-10}
+prefix=cbench
+
+number='^[0-9]+$'
+if [[ ! $count =~ $number ]] || [[ ! $rounds =~ $number ]] || [ ! -x "$bench" ] ; then
+	echo "Usage: `basename $0` [count] [capture-bench binary] [rounds]"
+	exit 1
+fi
+
+cleanup()
+{
+	for ((i = 0; i < count; i++)); do
+		ip link del "$prefix$i" 2>/dev/null
+	done
+}
+trap cleanup EXIT
+
+for ((i = 0; i < count; i++)); do
+	ip link add "$prefix$i" type veth peer name "$prefix${i}p" || exit 1
+	ip link set "$prefix$i" up
+	ip link set "$prefix${i}p" up
+done
+
+# the per-device mode needs a fd per interface
+ulimit -n $((count + 64))
+
+"$bench" --interfaces $count --rounds $rounds --prefix $prefix
+"$bench" --interfaces $count --rounds $rounds --prefix $prefix --shared
+"$bench" --interfaces $count --rounds $rounds --prefix $prefix --shared --rx-ring
+"$bench" --interfaces $count --rounds 1 --prefix $prefix --shared --retransmit-close
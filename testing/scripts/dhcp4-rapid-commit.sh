@@ -0,0 +1,71 @@
+#!/bin/bash
+#
+# Test of the DHCPv4 rapid commit (RFC 4039): creates a veth pair,
+# runs dnsmasq with rapid commit on the peer and requests a lease
+# with and without rapid commit using the wickedd-dhcp4 test mode.
+#
+# Usage: dhcp4-rapid-commit.sh [wickedd-dhcp4 binary] [dnsmasq binary]
+#
+
+dhcp4=${1:-/usr/lib/wicked/bin/wickedd-dhcp4}
+dnsmasq=${2:-dnsmasq}
+ifname=rcommit0
+peer=rcommit0p
+tmpdir=
+
+if [ ! -x "$dhcp4" ] || ! type -p "$dnsmasq" >/dev/null ; then
+	echo "Usage: `basename $0` [wickedd-dhcp4 binary] [dnsmasq binary]"
+	exit 1
+fi
+
+cleanup()
+{
+	test -n "$pid" && kill $pid 2>/dev/null
+	ip link del "$ifname" 2>/dev/null
+	test -n "$tmpdir" && rm -rf "$tmpdir"
+}
+trap cleanup EXIT
+
+tmpdir=`mktemp -d` || exit 1
+ip link add "$ifname" type veth peer name "$peer" || exit 1
+ip link set "$ifname" up
+ip link set "$peer" up
+ip addr add 10.99.0.1/24 dev "$peer"
+
+"$dnsmasq" --keep-in-foreground --port=0 --interface="$peer" --bind-interfaces \
+	--dhcp-range=10.99.0.50,10.99.0.99,1h --dhcp-rapid-commit \
+	--dhcp-leasefile="$tmpdir/leases" --pid-file="$tmpdir/pid" &
+pid=$!
+sleep 1
+
+rc=0
+for rapid in true false ; do
+	cat > "$tmpdir/request.xml" <<-EOF
+	<request type="lease">
+	  <rapid-commit>$rapid</rapid-commit>
+	</request>
+	EOF
+
+	"$dhcp4" --debug dhcp --test --test-timeout 10 \
+		--test-request "$tmpdir/request.xml" "$ifname" \
+		> "$tmpdir/lease" 2> "$tmpdir/log"
+	if ! grep -q "^IPADDR='10.99.0" "$tmpdir/lease" ; then
+		echo "FAIL: rapid-commit $rapid: no lease"
+		rc=1
+	elif grep -q "Received rapid commit ack" "$tmpdir/log" ; then
+		if [ $rapid = true ] ; then
+			echo "PASS: rapid-commit $rapid: two message exchange"
+		else
+			echo "FAIL: rapid-commit $rapid: unrequested rapid commit ack"
+			rc=1
+		fi
+	else
+		if [ $rapid = true ] ; then
+			echo "FAIL: rapid-commit $rapid: four message exchange"
+			rc=1
+		else
+			echo "PASS: rapid-commit $rapid: four message exchange"
+		fi
+	fi
+done
+exit $rc
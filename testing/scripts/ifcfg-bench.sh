@@ -0,0 +1,66 @@
+#!/bin/bash
+#
+# Benchmark of the suse ifcfg reader: generates a directory with
+# <count> ifcfg files and measures "wicked show-config" on it with
+# the sequential and the threaded reader (WICKED_IFCFG_WORKERS).
+#
+# The outputs of all runs are compared to verify the threaded reader
+# generates the same configuration in the same order.
+#
+# Usage: ifcfg-bench.sh [count] [wicked binary] [workers ...]
+#
+
+count=${1:-5000}
+wicked=${2:-wicked}
+workers=${@:3}
+workers=${workers:-"1 2 4 8"}
+
+number='^[0-9]+$'
+if [[ ! $count =~ $number ]] || ! type -p "$wicked" >/dev/null ; then
+	echo "Usage: `basename $0` [count] [wicked binary] [workers ...]"
+	exit 1
+fi
+
+dir=`mktemp -d /tmp/ifcfg-bench.XXXXXX` || exit 1
+trap 'rm -rf "$dir"' EXIT
+
+printf '<config>\n</config>\n' > "$dir/config.xml"
+mkdir -p "$dir/network"
+printf 'DHCLIENT_SET_HOSTNAME="no"\n' > "$dir/network/dhcp"
+
+for ((i = 0; i < count; i++)); do
+	case $((i % 4)) in
+	0)	printf "STARTMODE='auto'\nBOOTPROTO='static'\nIPADDR='10.%u.%u.1/24'\nMTU='1500'\n" \
+			$((i / 256 % 256)) $((i % 256))
+		;;
+	1)	printf "STARTMODE='hotplug'\nBOOTPROTO='dhcp'\nDHCLIENT_SET_DEFAULT_ROUTE='no'\n"
+		;;
+	2)	printf "STARTMODE='auto'\nBOOTPROTO='static'\nIPADDR='fd00::%x/64'\nIPADDR_1='10.255.%u.%u/16'\n" \
+			$i $((i / 256 % 256)) $((i % 256))
+		;;
+	3)	printf "STARTMODE='manual'\nBOOTPROTO='none'\nETHTOOL_OPTIONS='-K iface tso off'\n"
+		;;
+	esac > "$dir/network/ifcfg-eth$i"
+done
+
+ref=""
+for n in $workers ; do
+	# a different config content invalidates the ifconfig cache
+	printf 'WAIT_FOR_INTERFACES="30"\nWICKED_IFCFG_WORKERS="%u"\n' $n \
+		> "$dir/network/config"
+
+	start=`date +%s%N`
+	"$wicked" --config "$dir/config.xml" show-config \
+		"compat:suse:$dir/network" > "$dir/out.$n" 2>/dev/null
+	end=`date +%s%N`
+
+	printf "%6u ifcfg files, %2u worker(s): %5u ms\n" \
+		$count $n $(((end - start) / 1000000))
+
+	if [ -z "$ref" ]; then
+		ref="$dir/out.$n"
+	elif ! cmp -s "$ref" "$dir/out.$n" ; then
+		echo "ERROR: output with $n workers differs from $ref"
+		exit 1
+	fi
+done
@@ -0,0 +1,194 @@
+/*
+ *	Throughput benchmark for our XPATH routines, comparing the
+ *	parse-per-evaluation path with the compiled expression cache.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <wicked/netinfo.h>
+#include <wicked/socket.h>
+#include <wicked/xpath.h>
+#include <wicked/logging.h>
+
+enum {
+	OPT_DEBUG,
+	OPT_INTERFACES,
+	OPT_ITERATIONS,
+};
+
+static struct option	options[] = {
+	{ "debug",		required_argument,	NULL,	OPT_DEBUG },
+	{ "interfaces",		required_argument,	NULL,	OPT_INTERFACES },
+	{ "iterations",		required_argument,	NULL,	OPT_ITERATIONS },
+
+	{ NULL }
+};
+
+static const char *	expressions[] = {
+	"name",
+	"ipv4/@family",
+	"ipv4:static/address/local",
+	"//address[@family = 'ipv4']/local",
+	"control/mode = 'boot' and ipv4/enabled",
+	"not(ipv6/enabled) or count",
+	NULL
+};
+
+static xml_document_t *
+build_document(unsigned int count)
+{
+	xml_document_t *doc = xml_document_new();
+	unsigned int i;
+
+	for (i = 0; i < count; ++i) {
+		xml_node_t *ifnode, *node, *addr;
+		char buf[64];
+
+		ifnode = xml_node_new("interface", doc->root);
+		snprintf(buf, sizeof(buf), "eth%u", i);
+		xml_node_new_element("name", ifnode, buf);
+
+		node = xml_node_new("control", ifnode);
+		xml_node_new_element("mode", node, i % 2 ? "boot" : "manual");
+
+		node = xml_node_new("ipv4", ifnode);
+		xml_node_add_attr(node, "family", "ipv4");
+		xml_node_new_element("enabled", node, "true");
+
+		node = xml_node_new("ipv4:static", ifnode);
+		addr = xml_node_new("address", node);
+		xml_node_add_attr(addr, "family", "ipv4");
+		snprintf(buf, sizeof(buf), "10.%u.%u.1/24", (i >> 8) & 0xff, i & 0xff);
+		xml_node_new_element("local", addr, buf);
+	}
+	return doc;
+}
+
+static double
+elapsed(const struct timeval *begin)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, begin, &delta);
+	return delta.tv_sec + delta.tv_usec / 1000000.0;
+}
+
+static unsigned long
+run(xml_document_t *doc, unsigned int iterations, ni_bool_t cached)
+{
+	unsigned long evals = 0;
+	const char **expr;
+	xml_node_t *ifnode;
+	unsigned int n;
+
+	for (n = 0; n < iterations; ++n) {
+		for (ifnode = doc->root->children; ifnode; ifnode = ifnode->next) {
+			for (expr = expressions; *expr; ++expr) {
+				xpath_enode_t *enode;
+				xpath_result_t *result;
+
+				if (cached)
+					enode = xpath_expression_compile(*expr);
+				else
+					enode = xpath_expression_parse(*expr);
+				if (!enode)
+					return 0;
+
+				result = xpath_expression_eval(enode, ifnode);
+				xpath_result_free(result);
+				xpath_expression_free(enode);
+				evals++;
+			}
+		}
+	}
+	return evals;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int opt_interfaces = 1000;
+	unsigned int opt_iterations = 20;
+	unsigned long evals;
+	xml_document_t *doc;
+	struct timeval begin;
+	double secs;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "", options, NULL)) != EOF) {
+		switch (c) {
+		default:
+		usage:
+			fprintf(stderr,
+				"./xpath-bench [--interfaces <count>] [--iterations <count>]\n"
+			       );
+			return 1;
+
+		case OPT_DEBUG:
+			if (ni_enable_debug(optarg) < 0) {
+				fprintf(stderr, "Bad debug facility \"%s\"\n", optarg);
+				return 1;
+			}
+			break;
+
+		case OPT_INTERFACES:
+			if (ni_parse_uint(optarg, &opt_interfaces, 10) || !opt_interfaces)
+				goto usage;
+			break;
+
+		case OPT_ITERATIONS:
+			if (ni_parse_uint(optarg, &opt_iterations, 10) || !opt_iterations)
+				goto usage;
+			break;
+		}
+	}
+
+	if (optind < argc)
+		goto usage;
+
+	doc = build_document(opt_interfaces);
+
+	ni_timer_get_time(&begin);
+	if (!(evals = run(doc, opt_iterations, FALSE))) {
+		fprintf(stderr, "Error parsing XPATH expressions\n");
+		return 1;
+	}
+	secs = elapsed(&begin);
+	printf("parse+eval:    %lu evaluations in %.3fs, %.0f/s\n",
+			evals, secs, secs > 0 ? evals / secs : 0);
+
+	ni_timer_get_time(&begin);
+	if (!(evals = run(doc, opt_iterations, TRUE))) {
+		fprintf(stderr, "Error compiling XPATH expressions\n");
+		return 1;
+	}
+	secs = elapsed(&begin);
+	printf("compiled+eval: %lu evaluations in %.3fs, %.0f/s\n",
+			evals, secs, secs > 0 ? evals / secs : 0);
+
+	xpath_expression_cache_flush();
+	xml_document_free(doc);
+	return 0;
+}